@@ -0,0 +1,115 @@
+-- MS-MARCO Approximate Top-k Recall
+-- Measures recall@10 and latency of pg_textsearch.threshold_inflation
+-- against the precomputed exact ground truth.
+--
+-- Requires: msmarco_passages with msmarco_bm25_idx (see load.sql) and a
+--   ground truth file, by default ground_truth.tsv in this directory
+--   (copy ground_truth_pgNN.tsv for your Postgres version).
+-- Usage: psql -p PORT -f approximate_recall.sql
+--        [-v ground_truth=path/to/ground_truth_pg17.tsv]
+--
+-- Two recalls are reported per factor:
+--   doc_recall   - share of the ground truth's top-10 doc IDs returned
+--   score_recall - share of returned rows scoring at least the ground
+--                  truth's 10th score; unlike doc_recall it does not
+--                  count a tie broken the other way as a miss
+
+\set ON_ERROR_STOP on
+
+\if :{?ground_truth}
+\else
+\set ground_truth 'benchmarks/datasets/msmarco/ground_truth.tsv'
+\endif
+
+\echo '=== MS-MARCO Approximate Top-k Recall ==='
+
+DROP TABLE IF EXISTS ground_truth;
+CREATE TABLE ground_truth (
+    query_id int,
+    query_text text,
+    rank int,
+    doc_id int,
+    score float8
+);
+\copy ground_truth FROM :'ground_truth' WITH (FORMAT text, DELIMITER E'\t', HEADER true)
+
+DROP TABLE IF EXISTS recall_results;
+CREATE TABLE recall_results (
+    inflation float8,
+    query_id int,
+    doc_hits int,
+    score_hits int,
+    returned int,
+    ms float8
+);
+
+-- Run every ground truth query once at one inflation factor
+CREATE OR REPLACE FUNCTION measure_recall(p_inflation float8)
+RETURNS void AS $$
+DECLARE
+    q record;
+    t0 timestamptz;
+    elapsed float8;
+    ids int[];
+    scores float8[];
+BEGIN
+    PERFORM set_config('pg_textsearch.threshold_inflation',
+                       p_inflation::text, true);
+    FOR q IN SELECT DISTINCT query_id, query_text FROM ground_truth
+             ORDER BY query_id
+    LOOP
+        t0 := clock_timestamp();
+        SELECT array_agg(passage_id), array_agg(score)
+        INTO ids, scores
+        FROM (
+            SELECT passage_id,
+                   -(passage_text <@> to_bm25query(q.query_text,
+                                                   'msmarco_bm25_idx'))::float8
+                       AS score
+            FROM msmarco_passages
+            ORDER BY passage_text <@> to_bm25query(q.query_text,
+                                                   'msmarco_bm25_idx')
+            LIMIT 10
+        ) t;
+        elapsed := extract(epoch FROM clock_timestamp() - t0) * 1000;
+
+        INSERT INTO recall_results
+        SELECT p_inflation, q.query_id,
+               (SELECT count(*) FROM ground_truth gt
+                WHERE gt.query_id = q.query_id AND gt.rank <= 10
+                  AND gt.doc_id = ANY (ids)),
+               (SELECT count(*) FROM unnest(scores) s
+                WHERE s >= (SELECT min(score) - 0.001 FROM ground_truth gt
+                            WHERE gt.query_id = q.query_id
+                              AND gt.rank <= 10)),
+               coalesce(array_length(ids, 1), 0),
+               elapsed;
+    END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Warm the cache so the first factor is not charged for it
+SELECT measure_recall(1.0);
+TRUNCATE recall_results;
+
+SELECT measure_recall(f)
+FROM unnest(ARRAY[1.0, 1.1, 1.25, 1.5, 2.0, 3.0]) f;
+
+\echo ''
+\echo '=== Recall@10 by threshold_inflation ==='
+SELECT r.inflation,
+       round(100.0 * sum(r.doc_hits) / sum(g.expected), 1) AS doc_recall,
+       round(100.0 * sum(r.score_hits) / sum(g.expected), 1) AS score_recall,
+       round(avg(r.ms)::numeric, 2) AS avg_ms,
+       round((percentile_cont(0.95) WITHIN GROUP (ORDER BY r.ms))::numeric,
+             2) AS p95_ms
+FROM recall_results r
+JOIN (SELECT query_id, count(*) FILTER (WHERE rank <= 10) AS expected
+      FROM ground_truth GROUP BY query_id) g USING (query_id)
+GROUP BY r.inflation
+ORDER BY r.inflation;
+
+-- Cleanup
+DROP FUNCTION measure_recall(float8);
+DROP TABLE recall_results;
+DROP TABLE ground_truth;
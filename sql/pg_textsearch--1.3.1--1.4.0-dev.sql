@@ -1,4 +1,10 @@
 -- Upgrade from 1.3.1 to 1.4.0-dev
+--
+-- Query text gains syntax in 1.4.0: +word, -word, "phrase"~N, word*
+-- and word~N.  Queries written for 1.3.1 that begin words with + or -
+-- or quote them change meaning; SET pg_textsearch.query_operators = off
+-- reads +, - and quotes as 1.3.1 did.  See "Upgrading from 1.3.x" in
+-- README.md.
 
 -- Verify the library is loaded. The version-equality check lives in
 -- the main install file (pg_textsearch--<default_version>.sql); upgrade
@@ -14,3 +20,141 @@ BEGIN
             'Add pg_textsearch to shared_preload_libraries and restart.';
     END IF;
 END $$;
+
+-- Shared query result cache (pg_textsearch.result_cache).
+CREATE FUNCTION @extschema@.bm25_result_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_result_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_result_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_result_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_result_cache_stats() FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_result_cache_reset() FROM PUBLIC;
+
+-- Shared segment doc_freq cache (pg_textsearch.doc_freq_cache).
+CREATE FUNCTION @extschema@.bm25_doc_freq_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_doc_freq_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_doc_freq_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_doc_freq_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_doc_freq_cache_stats()
+    FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_doc_freq_cache_reset()
+    FROM PUBLIC;
+
+-- Backend-local segment reader cache (pg_textsearch.segment_reader_cache).
+CREATE FUNCTION @extschema@.bm25_segment_reader_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_segment_reader_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_segment_reader_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_segment_reader_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+-- Minimum-should-match queries.
+CREATE FUNCTION @extschema@.to_bm25query(
+    input_text text, index_name text, min_should_match integer)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'to_tpquery_text_index_msm'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Boolean match operator @@, answered by bitmap scans.
+CREATE FUNCTION @extschema@.bm25_text_bm25query_match(left_text text, right_query @extschema@.bm25query)
+RETURNS boolean
+AS 'MODULE_PATHNAME', 'bm25_text_bm25query_match'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE COST 1000;
+
+CREATE FUNCTION @extschema@.bm25_textarray_bm25query_match(
+    left_arr text[], right_query @extschema@.bm25query)
+RETURNS boolean
+AS 'MODULE_PATHNAME', 'bm25_textarray_bm25query_match'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE COST 1000;
+
+CREATE FUNCTION @extschema@.bm25_match_sel(internal, oid, internal, integer)
+RETURNS float8
+AS 'MODULE_PATHNAME', 'bm25_match_sel'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+CREATE OPERATOR @extschema@.@@ (
+    LEFTARG = text,
+    RIGHTARG = @extschema@.bm25query,
+    PROCEDURE = @extschema@.bm25_text_bm25query_match,
+    RESTRICT = @extschema@.bm25_match_sel
+);
+
+CREATE OPERATOR @extschema@.@@ (
+    LEFTARG = text[],
+    RIGHTARG = @extschema@.bm25query,
+    PROCEDURE = @extschema@.bm25_textarray_bm25query_match,
+    RESTRICT = @extschema@.bm25_match_sel
+);
+
+ALTER OPERATOR FAMILY @extschema@.text_bm25_ops USING bm25
+    ADD OPERATOR 2 @extschema@.@@ (text, @extschema@.bm25query);
+
+ALTER OPERATOR FAMILY @extschema@.text_array_bm25_ops USING bm25
+    ADD OPERATOR 2 @extschema@.@@ (text[], @extschema@.bm25query);
+
+-- Search-after pagination.
+CREATE FUNCTION @extschema@.bm25query_after(
+    query @extschema@.bm25query, score double precision, after_ctid tid)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_search_after'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Static per-document priors (the index's INCLUDE column).
+CREATE FUNCTION @extschema@.bm25query_with_prior(
+    query @extschema@.bm25query, weight double precision)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_with_prior'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION @extschema@.bm25query_with_decay(
+    query @extschema@.bm25query,
+    weight double precision,
+    half_life interval,
+    origin timestamptz DEFAULT now())
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_with_decay'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+-- Score many queries against one index in a single call.
+CREATE FUNCTION @extschema@.bm25_search_batch(
+    index_name text,
+    queries @extschema@.bm25query[],
+    k integer,
+    OUT query_ordinal integer,
+    OUT ctid tid,
+    OUT score double precision)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'bm25_search_batch'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+-- Whether the backend's last ranked index scan stopped at its scoring
+-- budget (pg_textsearch.scoring_time_budget / scoring_block_budget)
+-- and returned a partial top-k.
+CREATE FUNCTION @extschema@.bm25_last_scan_partial() RETURNS boolean
+    AS 'MODULE_PATHNAME', 'bm25_last_scan_partial'
+    LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+-- Segments this backend scored with each multi-term evaluator
+-- (pg_textsearch.multi_term_evaluator).
+CREATE FUNCTION @extschema@.bm25_evaluator_stats(
+    OUT wand bigint, OUT maxscore bigint, OUT conjunctive bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_evaluator_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
@@ -104,6 +104,33 @@ RETURNS @extschema@.bm25query
 AS 'MODULE_PATHNAME', 'to_tpquery_text_index'
 LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
+CREATE FUNCTION @extschema@.to_bm25query(
+    input_text text, index_name text, min_should_match integer)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'to_tpquery_text_index_msm'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION @extschema@.bm25query_after(
+    query @extschema@.bm25query, score double precision, after_ctid tid)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_search_after'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION @extschema@.bm25query_with_prior(
+    query @extschema@.bm25query, weight double precision)
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_with_prior'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION @extschema@.bm25query_with_decay(
+    query @extschema@.bm25query,
+    weight double precision,
+    half_life interval,
+    origin timestamptz DEFAULT now())
+RETURNS @extschema@.bm25query
+AS 'MODULE_PATHNAME', 'tpquery_with_decay'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
 
 -- Equality function: bm25vector = bm25vector → boolean
 CREATE FUNCTION @extschema@.bm25vector_eq(@extschema@.bm25vector, @extschema@.bm25vector)
@@ -168,6 +195,21 @@ CREATE FUNCTION @extschema@.bm25_get_current_score() RETURNS float8
     AS 'MODULE_PATHNAME', 'bm25_get_current_score'
     LANGUAGE C VOLATILE STRICT PARALLEL SAFE;
 
+-- Whether the backend's last ranked index scan stopped at its scoring
+-- budget (pg_textsearch.scoring_time_budget / scoring_block_budget)
+-- and returned a partial top-k.
+CREATE FUNCTION @extschema@.bm25_last_scan_partial() RETURNS boolean
+    AS 'MODULE_PATHNAME', 'bm25_last_scan_partial'
+    LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+-- Segments this backend scored with each multi-term evaluator
+-- (pg_textsearch.multi_term_evaluator).
+CREATE FUNCTION @extschema@.bm25_evaluator_stats(
+    OUT wand bigint, OUT maxscore bigint, OUT conjunctive bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_evaluator_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
 -- <@> operator for text <@> text operations (implicit index resolution)
 -- The planner hook transforms this to text <@> bm25query when a BM25 index exists
 CREATE OPERATOR @extschema@.<@> (
@@ -185,12 +227,35 @@ CREATE OPERATOR @extschema@.= (
     HASHES
 );
 
+-- Boolean match for text @@ bm25query: true for exactly the documents an
+-- index scan considers (+required, -excluded, "phrases", min_should_match).
+-- Used in WHERE; a bm25 index answers it with a bitmap scan.
+CREATE FUNCTION @extschema@.bm25_text_bm25query_match(left_text text, right_query @extschema@.bm25query)
+RETURNS boolean
+AS 'MODULE_PATHNAME', 'bm25_text_bm25query_match'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE COST 1000;
+
+-- Selectivity of @@, estimated from the query terms' document frequencies
+CREATE FUNCTION @extschema@.bm25_match_sel(internal, oid, internal, integer)
+RETURNS float8
+AS 'MODULE_PATHNAME', 'bm25_match_sel'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+-- @@ operator for text @@ bm25query matching
+CREATE OPERATOR @extschema@.@@ (
+    LEFTARG = text,
+    RIGHTARG = @extschema@.bm25query,
+    PROCEDURE = @extschema@.bm25_text_bm25query_match,
+    RESTRICT = @extschema@.bm25_match_sel
+);
+
 -- bm25 operator class for text columns
 -- The planner hook rewrites text <@> text to text <@> bm25query, so we only
 -- need to register the bm25query operator and support function here.
 CREATE OPERATOR CLASS @extschema@.text_bm25_ops
 DEFAULT FOR TYPE text USING bm25 AS
     OPERATOR    1   @extschema@.<@> (text, @extschema@.bm25query) FOR ORDER BY float_ops,
+    OPERATOR    2   @extschema@.@@ (text, @extschema@.bm25query),
     FUNCTION    8   (text, @extschema@.bm25query)   @extschema@.bm25_text_bm25query_score(text, @extschema@.bm25query);
 
 -- BM25 scoring function for text[] <@> bm25query operations
@@ -223,15 +288,43 @@ CREATE OPERATOR @extschema@.<@> (
     PROCEDURE = @extschema@.bm25_textarray_text_score
 );
 
+-- Boolean match for text[] @@ bm25query (flattened like <@>)
+CREATE FUNCTION @extschema@.bm25_textarray_bm25query_match(
+    left_arr text[], right_query @extschema@.bm25query)
+RETURNS boolean
+AS 'MODULE_PATHNAME', 'bm25_textarray_bm25query_match'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE COST 1000;
+
+-- @@ operator for text[] @@ bm25query matching
+CREATE OPERATOR @extschema@.@@ (
+    LEFTARG = text[],
+    RIGHTARG = @extschema@.bm25query,
+    PROCEDURE = @extschema@.bm25_textarray_bm25query_match,
+    RESTRICT = @extschema@.bm25_match_sel
+);
+
 -- bm25 operator class for text[] columns
 CREATE OPERATOR CLASS @extschema@.text_array_bm25_ops
 DEFAULT FOR TYPE text[] USING bm25 AS
     OPERATOR    1   @extschema@.<@> (text[], @extschema@.bm25query)
                     FOR ORDER BY float_ops,
+    OPERATOR    2   @extschema@.@@ (text[], @extschema@.bm25query),
     FUNCTION    8   (text[], @extschema@.bm25query)
                     @extschema@.bm25_textarray_bm25query_score(
                         text[], @extschema@.bm25query);
 
+-- Score many queries against one index in a single call
+CREATE FUNCTION @extschema@.bm25_search_batch(
+    index_name text,
+    queries @extschema@.bm25query[],
+    k integer,
+    OUT query_ordinal integer,
+    OUT ctid tid,
+    OUT score double precision)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'bm25_search_batch'
+LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
 -- Debug function to dump index contents (memtable and segments)
 CREATE FUNCTION @extschema@.bm25_dump_index(text) RETURNS text
     AS 'MODULE_PATHNAME', 'tp_dump_index'
@@ -382,3 +475,47 @@ REVOKE EXECUTE ON FUNCTION @extschema@.bm25_cache_global_estimated_bytes()
     FROM PUBLIC;
 REVOKE EXECUTE ON FUNCTION @extschema@.bm25_cache_evict_largest(text)
     FROM PUBLIC;
+
+-- Shared query result cache (pg_textsearch.result_cache).
+CREATE FUNCTION @extschema@.bm25_result_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_result_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_result_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_result_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_result_cache_stats() FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_result_cache_reset() FROM PUBLIC;
+
+-- Shared segment doc_freq cache (pg_textsearch.doc_freq_cache).
+CREATE FUNCTION @extschema@.bm25_doc_freq_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_doc_freq_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_doc_freq_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_doc_freq_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_doc_freq_cache_stats()
+    FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION @extschema@.bm25_doc_freq_cache_reset()
+    FROM PUBLIC;
+
+-- Backend-local segment reader cache (pg_textsearch.segment_reader_cache).
+CREATE FUNCTION @extschema@.bm25_segment_reader_cache_stats(
+    OUT hits bigint, OUT misses bigint, OUT entries bigint, OUT bytes bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'bm25_segment_reader_cache_stats'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+CREATE FUNCTION @extschema@.bm25_segment_reader_cache_reset()
+RETURNS void
+AS 'MODULE_PATHNAME', 'bm25_segment_reader_cache_reset'
+LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
@@ -11,11 +11,14 @@
 #include <access/amapi.h>
 #include <access/reloptions.h>
 #include <access/transam.h>
+#include <datatype/timestamp.h>
+#include <nodes/tidbitmap.h>
 #include <storage/block.h>
 #include <storage/bufpage.h>
 #include <tsearch/ts_type.h>
 
 #include "index/state.h"
+#include "types/query.h"
 #include "types/vector.h"
 
 /*
@@ -28,8 +31,21 @@ typedef struct TpScanOpaqueData
 	/* Query processing state */
 	char	 *query_text;	/* Search query text */
 	TpVector *query_vector; /* Original query vector from ORDER BY */
+	TpVector *required_vector; /* "+word" lexemes, NULL if none */
+	TpVector *excluded_vector; /* "-word" lexemes, NULL if none */
+	List	 *phrases;		   /* Analyzed TpPhrase *, NIL if none */
+	float4	 *term_weights; /* Per query_vector term IDF scale, or NULL */
+	int32	  min_should_match; /* Optional terms to match, 0 if any */
 	Oid		  index_oid;	/* Index OID */
 
+	/* Static prior weighting of the <@> key (has_prior), see prior.h */
+	bool		 has_prior;
+	TpQueryPrior prior;
+
+	/* Sorted CTIDs matching every @@ key when ranking by <@>, or NULL */
+	ItemPointer allowed_tids;
+	int			allowed_count;
+
 	/* Scan results state */
 	ItemPointer result_ctids;  /* Array of matching CTIDs */
 	float4	   *result_scores; /* Array of BM25 scores */
@@ -41,12 +57,27 @@ typedef struct TpScanOpaqueData
 	int limit;			  /* Query LIMIT value, -1 if none */
 	int max_results_used; /* Internal limit used for current batch */
 
-	/* CTIDs already emitted; used across limit-doubling re-execs. */
-	struct HTAB *returned_ctids;
+	/*
+	 * Resume point of the next scoring batch (serial scans), and CTIDs
+	 * already emitted, a guard against a document scoring differently
+	 * in a later batch or, in parallel scans, limit-doubling re-execs.
+	 */
+	struct TpScoreCursor *cursor;
+	struct HTAB			 *returned_ctids;
+
+	/* Parallel scan participant state, NULL for serial scans */
+	struct TpParallelScanState *parallel;
+
+	/* Ranked scans of a partition: threshold sharing state, else NULL */
+	struct TpPartitionScanState *partition;
 } TpScanOpaqueData;
 
 typedef TpScanOpaqueData *TpScanOpaque;
 
+/* Operator strategies of the bm25 operator classes */
+#define TP_STRATEGY_SCORE 1 /* <@> bm25query, ORDER BY */
+#define TP_STRATEGY_MATCH 2 /* @@ bm25query, WHERE */
+
 /* Index options structure */
 typedef struct TpOptions
 {
@@ -54,6 +85,8 @@ typedef struct TpOptions
 	int32  text_config_offset; /* offset to text config string */
 	double k1;				   /* BM25 k1 parameter */
 	double b;				   /* BM25 b parameter */
+	bool   positions;		   /* Store token positions (phrases) */
+	bool   impacts;			   /* Store quantized BM25 impacts */
 } TpOptions;
 
 /* Tapir-specific build phases for progress reporting */
@@ -79,6 +112,10 @@ struct IndexBuildResult;
 /* Cached score for ORDER BY optimization */
 float8 tp_get_cached_score(void);
 
+/* Did a scoring budget cut the backend's last ranked scan short? */
+bool tp_get_scan_partial(void);
+void tp_note_scan_partial(void);
+
 /*
  * Access method handler
  */
@@ -119,12 +156,16 @@ bool tp_process_document_text(
 		Relation		   index_rel,
 		int32			  *doc_length_out);
 
-/* Extract terms and frequencies from a TSVector */
+/*
+ * Extract terms and frequencies from a TSVector.  positions_out may be
+ * NULL; otherwise it receives frequencies[i] ascending positions per term.
+ */
 int tp_extract_terms_from_tsvector(
-		TSVector tsvector,
-		char  ***terms_out,
-		int32  **frequencies_out,
-		int		*term_count_out);
+		TSVector  tsvector,
+		char   ***terms_out,
+		int32	**frequencies_out,
+		uint32 ***positions_out,
+		int		 *term_count_out);
 
 /*
  * Tokenize a document into terms and frequencies. Handles documents whose
@@ -141,6 +182,20 @@ int tp_tokenize_text(
 		int32 **frequencies_out,
 		int	   *term_count_out);
 
+/*
+ * As tp_tokenize_text, also returning each term's token positions
+ * (frequencies[i] of them, ascending).  Free with
+ * tp_free_term_positions.
+ */
+int tp_tokenize_text_with_positions(
+		text	 *document_text,
+		Oid		  text_config_oid,
+		char	***terms_out,
+		int32	**frequencies_out,
+		uint32 ***positions_out,
+		int		 *term_count_out);
+void tp_free_term_positions(uint32 **positions, int term_count);
+
 /* Build progress tracking for partitioned tables */
 void tp_build_progress_begin(void);
 void tp_build_progress_end(void);
@@ -157,6 +212,18 @@ void		  tp_rescan(
 				 int		   norderbys);
 void tp_endscan(IndexScanDesc scan);
 bool tp_gettuple(IndexScanDesc scan, ScanDirection dir);
+int64 tp_getbitmap(IndexScanDesc scan, TIDBitmap *tbm);
+
+/*
+ * Parallel scan functions (am/scan.c)
+ */
+#if PG_VERSION_NUM >= 180000
+Size tp_estimateparallelscan(Relation index, int nkeys, int norderbys);
+#else
+Size tp_estimateparallelscan(int nkeys, int norderbys);
+#endif
+void tp_initparallelscan(void *target);
+void tp_parallelrescan(IndexScanDesc scan);
 
 /*
  * Vacuum functions (am/vacuum.c)
@@ -215,6 +282,14 @@ bool tp_do_spill(
  */
 bytea *tp_options(Datum reloptions, bool validate);
 bool   tp_validate(Oid opclassoid);
+bool   tp_index_has_positions(Relation index);
+bool   tp_index_has_prior(Relation index);
+void   tp_index_check_prior(Relation index);
+float4 tp_index_prior_value(Relation index, Datum *values, bool *isnull);
+double tp_epoch_seconds(Timestamp ts);
+
+struct TpImpactParams; /* segment/impact.h */
+void tp_index_impact_params(Relation index, struct TpImpactParams *params);
 
 /* Relation options kind - initialized in mod.c */
 extern relopt_kind tp_relopt_kind;
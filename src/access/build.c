@@ -730,17 +730,23 @@ tp_build_init_metapage(
 /*
  * Extract terms and frequencies from a TSVector
  * Returns the document length (sum of all term frequencies)
+ *
+ * If positions_out is not NULL it receives, per term, the term's
+ * positions (frequencies[i] of them, ascending).  to_tsvector always
+ * records positions; a lexeme without any gets the single position 0.
  */
 int
 tp_extract_terms_from_tsvector(
 		TSVector tsvector,
 		char  ***terms_out,
 		int32  **frequencies_out,
+		uint32 ***positions_out,
 		int		*term_count_out)
 {
 	int		   term_count = tsvector->size;
 	char	 **terms;
 	int32	  *frequencies;
+	uint32	 **positions = NULL;
 	int		   doc_length = 0;
 	int		   i;
 	WordEntry *we;
@@ -751,6 +757,8 @@ tp_extract_terms_from_tsvector(
 	{
 		*terms_out		 = NULL;
 		*frequencies_out = NULL;
+		if (positions_out != NULL)
+			*positions_out = NULL;
 		return 0;
 	}
 
@@ -758,6 +766,8 @@ tp_extract_terms_from_tsvector(
 
 	terms		= palloc(term_count * sizeof(char *));
 	frequencies = palloc(term_count * sizeof(int32));
+	if (positions_out != NULL)
+		positions = palloc(term_count * sizeof(uint32 *));
 
 	for (i = 0; i < term_count; i++)
 	{
@@ -778,15 +788,49 @@ tp_extract_terms_from_tsvector(
 		else
 			frequencies[i] = 1;
 
+		if (positions != NULL)
+		{
+			positions[i] = palloc(frequencies[i] * sizeof(uint32));
+			if (we[i].haspos)
+			{
+				WordEntryPos *wep = POSDATAPTR(tsvector, &we[i]);
+				int			  j;
+
+				for (j = 0; j < frequencies[i]; j++)
+					positions[i][j] = WEP_GETPOS(wep[j]);
+			}
+			else
+				positions[i][0] = 0;
+		}
+
 		doc_length += frequencies[i];
 	}
 
 	*terms_out		 = terms;
 	*frequencies_out = frequencies;
+	if (positions_out != NULL)
+		*positions_out = positions;
 
 	return doc_length;
 }
 
+/*
+ * Free a positions array returned by tp_tokenize_text_with_positions
+ */
+void
+tp_free_term_positions(uint32 **positions, int term_count)
+{
+	int i;
+
+	if (positions == NULL)
+		return;
+
+	for (i = 0; i < term_count; i++)
+		pfree(positions[i]);
+
+	pfree(positions);
+}
+
 /*
  * Free memory allocated for terms array
  */
@@ -829,6 +873,7 @@ tp_tokenize_chunk(
 		Oid			text_config_oid,
 		char	 ***terms_out,
 		int32	  **frequencies_out,
+		uint32	 ***positions_out,
 		int		   *term_count_out)
 {
 	text	*chunk_text;
@@ -846,7 +891,11 @@ tp_tokenize_chunk(
 	tsvector = DatumGetTSVector(tsvector_datum);
 
 	doc_length = tp_extract_terms_from_tsvector(
-			tsvector, terms_out, frequencies_out, term_count_out);
+			tsvector,
+			terms_out,
+			frequencies_out,
+			positions_out,
+			term_count_out);
 
 	pfree(chunk_text);
 	pfree(tsvector);
@@ -899,8 +948,9 @@ tp_find_chunk_boundary(const char *data, int target)
 
 typedef struct TpTermEntry
 {
-	char *term;
-	int32 freq;
+	char   *term;
+	int32	freq;
+	uint32 *positions; /* freq entries, or NULL without positions */
 } TpTermEntry;
 
 static int
@@ -911,11 +961,24 @@ tp_term_entry_cmp(const void *a, const void *b)
 	return strcmp(ea->term, eb->term);
 }
 
+static int
+tp_position_cmp(const void *a, const void *b)
+{
+	uint32 pa = *(const uint32 *)a;
+	uint32 pb = *(const uint32 *)b;
+
+	return (pa > pb) - (pa < pb);
+}
+
 /*
  * Merge accumulated (term, freq) entries by sorting then collapsing
  * adjacent duplicates. Output arrays are palloc'd in the current
  * memory context. Frees `entries` itself; per-entry term strings are
  * either reassigned into the output or pfree'd as duplicates.
+ *
+ * positions_out may be NULL; otherwise every entry carries positions
+ * and duplicates have theirs concatenated and re-sorted (qsort does
+ * not keep the chunks in order).
  */
 static void
 tp_merge_term_entries(
@@ -923,18 +986,23 @@ tp_merge_term_entries(
 		int			 entry_count,
 		char	  ***terms_out,
 		int32	   **frequencies_out,
+		uint32	  ***positions_out,
 		int			*term_count_out)
 {
-	int	   out;
-	int	   i;
-	char **terms;
-	int32 *freqs;
+	int		 out;
+	int		 i;
+	char   **terms;
+	int32	*freqs;
+	uint32 **positions = NULL;
+	bool	 merged	   = false;
 
 	if (entry_count == 0)
 	{
 		*terms_out		 = NULL;
 		*frequencies_out = NULL;
-		*term_count_out	 = 0;
+		if (positions_out != NULL)
+			*positions_out = NULL;
+		*term_count_out = 0;
 		if (entries != NULL)
 			pfree(entries);
 		return;
@@ -944,14 +1012,29 @@ tp_merge_term_entries(
 
 	terms = palloc(entry_count * sizeof(char *));
 	freqs = palloc(entry_count * sizeof(int32));
+	if (positions_out != NULL)
+		positions = palloc(entry_count * sizeof(uint32 *));
 
 	out		   = 0;
 	terms[out] = entries[0].term;
 	freqs[out] = entries[0].freq;
+	if (positions != NULL)
+		positions[out] = entries[0].positions;
 	for (i = 1; i < entry_count; i++)
 	{
 		if (strcmp(entries[i].term, terms[out]) == 0)
 		{
+			if (positions != NULL)
+			{
+				positions[out] = repalloc(
+						positions[out],
+						(freqs[out] + entries[i].freq) * sizeof(uint32));
+				memcpy(positions[out] + freqs[out],
+					   entries[i].positions,
+					   entries[i].freq * sizeof(uint32));
+				pfree(entries[i].positions);
+				merged = true;
+			}
 			freqs[out] += entries[i].freq;
 			pfree(entries[i].term);
 		}
@@ -960,28 +1043,40 @@ tp_merge_term_entries(
 			out++;
 			terms[out] = entries[i].term;
 			freqs[out] = entries[i].freq;
+			if (positions != NULL)
+				positions[out] = entries[i].positions;
 		}
 	}
 	out++;
 
+	if (merged)
+	{
+		for (i = 0; i < out; i++)
+			qsort(positions[i], freqs[i], sizeof(uint32), tp_position_cmp);
+	}
+
 	pfree(entries);
 
 	*terms_out		 = terms;
 	*frequencies_out = freqs;
-	*term_count_out	 = out;
+	if (positions_out != NULL)
+		*positions_out = positions;
+	*term_count_out = out;
 }
 
-int
-tp_tokenize_text(
-		text   *document_text,
-		Oid		text_config_oid,
-		char ***terms_out,
-		int32 **frequencies_out,
-		int	   *term_count_out)
+static int
+tp_tokenize_text_internal(
+		text	 *document_text,
+		Oid		  text_config_oid,
+		char	***terms_out,
+		int32	**frequencies_out,
+		uint32 ***positions_out,
+		int		 *term_count_out)
 {
 	const char	*data		= VARDATA_ANY(document_text);
 	int			 len		= VARSIZE_ANY_EXHDR(document_text);
 	int			 doc_length = 0;
+	uint32		 position_base = 0;
 	int			 offset;
 	int			 cap;
 	int			 used;
@@ -1004,7 +1099,11 @@ tp_tokenize_text(
 				PointerGetDatum(document_text));
 		tsvector = DatumGetTSVector(tsvector_datum);
 		return tp_extract_terms_from_tsvector(
-				tsvector, terms_out, frequencies_out, term_count_out);
+				tsvector,
+				terms_out,
+				frequencies_out,
+				positions_out,
+				term_count_out);
 	}
 
 	/* Chunked path: accumulate per-chunk (term, freq) into acc[]. */
@@ -1015,15 +1114,17 @@ tp_tokenize_text(
 	offset = 0;
 	while (offset < len)
 	{
-		int	   remaining = len - offset;
-		int	   take		 = remaining <= TP_TSVECTOR_CHUNK_BYTES
-								 ? remaining
-								 : tp_find_chunk_boundary(
-								   data + offset, TP_TSVECTOR_CHUNK_BYTES);
-		char **chunk_terms;
-		int32 *chunk_freqs;
-		int	   chunk_term_count;
-		int	   i;
+		int		 remaining = len - offset;
+		int		 take	   = remaining <= TP_TSVECTOR_CHUNK_BYTES
+									? remaining
+									: tp_find_chunk_boundary(
+									  data + offset, TP_TSVECTOR_CHUNK_BYTES);
+		char   **chunk_terms;
+		int32	*chunk_freqs;
+		uint32 **chunk_positions = NULL;
+		uint32	 chunk_max_pos	 = 0;
+		int		 chunk_term_count;
+		int		 i;
 
 		doc_length += tp_tokenize_chunk(
 				data + offset,
@@ -1031,6 +1132,7 @@ tp_tokenize_text(
 				text_config_oid,
 				&chunk_terms,
 				&chunk_freqs,
+				positions_out != NULL ? &chunk_positions : NULL,
 				&chunk_term_count);
 
 		if (used + chunk_term_count > cap)
@@ -1041,23 +1143,83 @@ tp_tokenize_text(
 		}
 		for (i = 0; i < chunk_term_count; i++)
 		{
-			acc[used].term = chunk_terms[i]; /* takes ownership */
-			acc[used].freq = chunk_freqs[i];
+			acc[used].term		= chunk_terms[i]; /* takes ownership */
+			acc[used].freq		= chunk_freqs[i];
+			acc[used].positions = NULL;
+
+			/*
+			 * Every chunk numbers its positions from 1; shift them past
+			 * the previous chunks so positions stay document-wide.
+			 */
+			if (chunk_positions != NULL)
+			{
+				int j;
+
+				for (j = 0; j < chunk_freqs[i]; j++)
+				{
+					chunk_max_pos = Max(chunk_max_pos, chunk_positions[i][j]);
+					chunk_positions[i][j] += position_base;
+				}
+				acc[used].positions = chunk_positions[i];
+			}
 			used++;
 		}
 		if (chunk_terms != NULL)
 			pfree(chunk_terms);
 		if (chunk_freqs != NULL)
 			pfree(chunk_freqs);
+		if (chunk_positions != NULL)
+			pfree(chunk_positions);
 
+		position_base += chunk_max_pos;
 		offset += take;
 	}
 
 	tp_merge_term_entries(
-			acc, used, terms_out, frequencies_out, term_count_out);
+			acc,
+			used,
+			terms_out,
+			frequencies_out,
+			positions_out,
+			term_count_out);
 	return doc_length;
 }
 
+int
+tp_tokenize_text(
+		text   *document_text,
+		Oid		text_config_oid,
+		char ***terms_out,
+		int32 **frequencies_out,
+		int	   *term_count_out)
+{
+	return tp_tokenize_text_internal(
+			document_text,
+			text_config_oid,
+			terms_out,
+			frequencies_out,
+			NULL,
+			term_count_out);
+}
+
+int
+tp_tokenize_text_with_positions(
+		text	 *document_text,
+		Oid		  text_config_oid,
+		char	***terms_out,
+		int32	**frequencies_out,
+		uint32 ***positions_out,
+		int		 *term_count_out)
+{
+	return tp_tokenize_text_internal(
+			document_text,
+			text_config_oid,
+			terms_out,
+			frequencies_out,
+			positions_out,
+			term_count_out);
+}
+
 /*
  * Core document processing: convert text to terms and add to posting lists.
  * This is shared between CREATE INDEX build (heap scan) and DML inserts
@@ -1181,12 +1343,12 @@ tp_build_callback(
 	text				 *document_text;
 	char				**terms;
 	int32				 *frequencies;
+	uint32				**positions = NULL;
 	int					  term_count;
 	int					  doc_length;
 	MemoryContext		  oldctx;
 
 	/* Suppress unused parameter warnings for callback signature */
-	(void)index;
 	(void)tupleIsAlive;
 
 	if (isnull[0])
@@ -1208,24 +1370,40 @@ tp_build_callback(
 	else
 		document_text = DatumGetTextPP(values[0]);
 
-	doc_length = tp_tokenize_text(
-			document_text,
-			bs->text_config_oid,
-			&terms,
-			&frequencies,
-			&term_count);
+	if (bs->build_ctx->store_positions)
+		doc_length = tp_tokenize_text_with_positions(
+				document_text,
+				bs->text_config_oid,
+				&terms,
+				&frequencies,
+				&positions,
+				&term_count);
+	else
+		doc_length = tp_tokenize_text(
+				document_text,
+				bs->text_config_oid,
+				&terms,
+				&frequencies,
+				&term_count);
 
 	MemoryContextSwitchTo(oldctx);
 
 	if (term_count > 0)
 	{
-		tp_build_context_add_document(
+		uint32 doc_id = tp_build_context_add_document(
 				bs->build_ctx,
 				terms,
 				frequencies,
+				positions,
 				term_count,
 				doc_length,
 				ctid);
+
+		if (tp_index_has_prior(index))
+			tp_build_context_set_prior(
+					bs->build_ctx,
+					doc_id,
+					tp_index_prior_value(index, values, isnull));
 	}
 
 	/* Reset per-doc context (frees tsvector, terms) */
@@ -1315,6 +1493,9 @@ tp_build(Relation heap, Relation index, IndexInfo *indexInfo)
 		elog(NOTICE, "Using index options: k1=%.2f, b=%.2f", k1, b);
 	}
 
+	/* Reject an INCLUDE column that cannot be a prior */
+	tp_index_check_prior(index);
+
 	/* Initialize metapage */
 	tp_build_init_metapage(index, text_config_oid, k1, b);
 
@@ -1469,6 +1650,7 @@ tp_build(Relation heap, Relation index, IndexInfo *indexInfo)
 		TpBuildCallbackState bs;
 		TpBuildContext		*build_ctx;
 		Size				 budget;
+		TpImpactParams		 impacts;
 		double				 reltuples;
 
 		/*
@@ -1481,8 +1663,10 @@ tp_build(Relation heap, Relation index, IndexInfo *indexInfo)
 				RelationGetRelid(index), RelationGetRelid(heap));
 
 		/* Budget: maintenance_work_mem (in KB) -> bytes */
-		budget	  = (Size)maintenance_work_mem * 1024L;
-		build_ctx = tp_build_context_create(budget);
+		budget = (Size)maintenance_work_mem * 1024L;
+		tp_index_impact_params(index, &impacts);
+		build_ctx = tp_build_context_create(
+				budget, tp_index_has_positions(index), &impacts);
 
 		/* Initialize callback state */
 		bs.build_ctx	   = build_ctx;
@@ -1743,6 +1927,11 @@ tp_insert(
 	}
 	tpvec = (TpVector *)DatumGetPointer(vector_datum);
 
+	/* The memtable chain carries the static prior inside the vector */
+	if (tp_index_has_prior(index))
+		tpvec = tpvector_with_prior(
+				tpvec, tp_index_prior_value(index, values, isnull));
+
 	/* Extract terms and frequencies */
 	term_count = tpvec->entry_count;
 	if (term_count > 0)
@@ -21,10 +21,14 @@
 #include "memtable/expull.h"
 #include "segment/alive_bitset.h"
 #include "segment/compression.h"
+#include "segment/dictionary.h"
 #include "segment/fieldnorm.h"
 #include "segment/io.h"
 #include "segment/pagemapper.h"
+#include "segment/positions.h"
+#include "segment/prior.h"
 #include "segment/segment.h"
+#include "types/vector.h"
 
 /* Forward declarations for hash table support */
 static uint32 build_term_hash(const void *key, Size keysize);
@@ -40,7 +44,8 @@ extern bool tp_compress_segments;
  * Create a new build context.
  */
 TpBuildContext *
-tp_build_context_create(Size budget)
+tp_build_context_create(
+		Size budget, bool store_positions, const TpImpactParams *impacts)
 {
 	TpBuildContext *ctx;
 	HASHCTL			info;
@@ -70,6 +75,14 @@ tp_build_context_create(Size budget)
 	ctx->total_len	   = 0;
 	ctx->budget		   = budget;
 
+	ctx->store_positions = store_positions;
+	ctx->impacts		 = *impacts;
+	if (store_positions)
+		ctx->positions_cxt = AllocSetContextCreate(
+				CurrentMemoryContext,
+				"build positions",
+				ALLOCSET_DEFAULT_SIZES);
+
 	return ctx;
 }
 
@@ -108,9 +121,50 @@ build_context_grow_docs(TpBuildContext *ctx)
 
 	ctx->fieldnorms = repalloc(ctx->fieldnorms, new_capacity * sizeof(uint8));
 	ctx->ctids = repalloc(ctx->ctids, new_capacity * sizeof(ItemPointerData));
+	if (ctx->priors != NULL)
+		ctx->priors = repalloc(ctx->priors, new_capacity * sizeof(float4));
 	ctx->docs_capacity = new_capacity;
 }
 
+/*
+ * Append one posting's positions to a term's positions stream.
+ */
+static void
+build_term_append_positions(
+		TpBuildContext	 *ctx,
+		TpBuildTermEntry *entry,
+		const uint32	 *positions,
+		uint32			  count)
+{
+	/* Worst case: 5 bytes per varint, count included */
+	uint32 needed = entry->positions_len + (count + 1) * 5;
+	uint32 prev	  = 0;
+	uint32 i;
+
+	if (needed > entry->positions_cap)
+	{
+		uint32 new_cap = Max(entry->positions_cap * 2, 32);
+
+		while (new_cap < needed)
+			new_cap *= 2;
+		if (entry->positions == NULL)
+			entry->positions = MemoryContextAlloc(ctx->positions_cxt, new_cap);
+		else
+			entry->positions = repalloc(entry->positions, new_cap);
+		ctx->positions_bytes += new_cap - entry->positions_cap;
+		entry->positions_cap = new_cap;
+	}
+
+	entry->positions_len += tpvector_varint_encode(
+			count, entry->positions + entry->positions_len);
+	for (i = 0; i < count; i++)
+	{
+		entry->positions_len += tpvector_varint_encode(
+				positions[i] - prev, entry->positions + entry->positions_len);
+		prev = positions[i];
+	}
+}
+
 /*
  * Add a single document's terms to the build context.
  */
@@ -119,6 +173,7 @@ tp_build_context_add_document(
 		TpBuildContext *ctx,
 		char		  **terms,
 		int32		   *frequencies,
+		uint32		  **positions,
 		int				term_count,
 		int32			doc_length,
 		ItemPointer		ctid)
@@ -129,6 +184,7 @@ tp_build_context_add_document(
 
 	Assert(ctx != NULL);
 	Assert(ctid != NULL);
+	Assert(!ctx->store_positions || positions != NULL || term_count == 0);
 
 	/* Assign sequential doc_id (UINT32_MAX reserved as sentinel) */
 	if (ctx->num_docs >= UINT32_MAX - 1)
@@ -176,8 +232,11 @@ tp_build_context_add_document(
 			memcpy(arena_str, terms[i], len + 1);
 
 			/* Update entry to point to arena copy */
-			entry->term		= arena_str;
-			entry->term_len = len;
+			entry->term			 = arena_str;
+			entry->term_len		 = len;
+			entry->positions	 = NULL;
+			entry->positions_len = 0;
+			entry->positions_cap = 0;
 			tp_expull_init(&entry->expull);
 		}
 
@@ -188,11 +247,29 @@ tp_build_context_add_document(
 				doc_id,
 				(uint16)frequencies[i],
 				norm);
+
+		if (ctx->store_positions)
+			build_term_append_positions(
+					ctx, entry, positions[i], (uint32)frequencies[i]);
 	}
 
 	return doc_id;
 }
 
+/*
+ * Set a document's static prior.  The array is allocated on first use,
+ * zeroed for documents added before it.
+ */
+void
+tp_build_context_set_prior(TpBuildContext *ctx, uint32 doc_id, float4 prior)
+{
+	Assert(doc_id < ctx->num_docs);
+
+	if (ctx->priors == NULL)
+		ctx->priors = palloc0(ctx->docs_capacity * sizeof(float4));
+	ctx->priors[doc_id] = prior;
+}
+
 /*
  * Comparison function for sorting TpBuildTermInfo by term string.
  */
@@ -233,8 +310,10 @@ tp_build_context_get_sorted_terms(TpBuildContext *ctx, uint32 *num_terms)
 		Assert(i < count);
 		terms[i].term	  = entry->term;
 		terms[i].term_len = entry->term_len;
-		terms[i].expull	  = &entry->expull;
-		terms[i].doc_freq = entry->expull.num_entries;
+		terms[i].expull		   = &entry->expull;
+		terms[i].doc_freq	   = entry->expull.num_entries;
+		terms[i].positions	   = entry->positions;
+		terms[i].positions_len = entry->positions_len;
 		i++;
 	}
 
@@ -263,12 +342,10 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 	BlockNumber		 page_index_root;
 	TpSegmentWriter	 writer;
 	TpSegmentHeader	 header;
-	TpDictionary	 dict;
+	TpDictBuilder	 dict;
 
-	uint32 *string_offsets;
-	uint32	string_pos;
-	uint32	i;
-	Buffer	header_buf;
+	uint32 i;
+	Buffer header_buf;
 	Page	header_page;
 
 	/*
@@ -289,6 +366,13 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 	uint32		 skip_entries_count;
 	uint32		 skip_entries_capacity;
 
+	/* Per-block max impacts, parallel to skip entries (if stored) */
+	float4 impact_avg_doc_len;
+	uint8 *all_block_impacts = NULL;
+
+	/* Per-block max priors, parallel to skip entries (if stored) */
+	float4 *all_block_priors = NULL;
+
 	/* Get sorted terms */
 	terms = tp_build_context_get_sorted_terms(ctx, &num_terms);
 	if (num_terms == 0)
@@ -322,35 +406,16 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 	/* Write placeholder header */
 	tp_segment_writer_write(&writer, &header, sizeof(TpSegmentHeader));
 
-	/* Write dictionary section */
-	dict.num_terms = num_terms;
-	tp_segment_writer_write(
-			&writer, &dict, offsetof(TpDictionary, string_offsets));
-
-	/* Build string offsets */
-	string_offsets = palloc0(num_terms * sizeof(uint32));
-	string_pos	   = 0;
+	/* Write dictionary section: term index, then front-coded blocks */
+	tp_dict_builder_init(&dict, num_terms);
 	for (i = 0; i < num_terms; i++)
-	{
-		string_offsets[i] = string_pos;
-		string_pos += sizeof(uint32) + terms[i].term_len + sizeof(uint32);
-	}
-
-	/* Write string offsets array */
-	tp_segment_writer_write(
-			&writer, string_offsets, num_terms * sizeof(uint32));
+		tp_dict_builder_add(&dict, terms[i].term, terms[i].term_len);
+	tp_dict_builder_finish(&dict);
+	tp_segment_writer_write(&writer, dict.index.data, dict.index.len);
 
-	/* Write string pool */
 	header.strings_offset = writer.current_offset;
-	for (i = 0; i < num_terms; i++)
-	{
-		uint32 length	   = terms[i].term_len;
-		uint32 dict_offset = i * sizeof(TpDictEntry);
-
-		tp_segment_writer_write(&writer, &length, sizeof(uint32));
-		tp_segment_writer_write(&writer, terms[i].term, length);
-		tp_segment_writer_write(&writer, &dict_offset, sizeof(uint32));
-	}
+	tp_segment_writer_write(&writer, dict.blocks.data, dict.blocks.len);
+	tp_dict_builder_free(&dict);
 
 	/* Record entries offset */
 	header.entries_offset = writer.current_offset;
@@ -375,6 +440,13 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 	skip_entries_count	  = 0;
 	all_skip_entries = palloc(skip_entries_capacity * sizeof(TpSkipEntry));
 
+	impact_avg_doc_len = tp_impact_segment_avg_doc_len(
+			&ctx->impacts, ctx->total_len, ctx->num_docs);
+	if (impact_avg_doc_len > 0.0f)
+		all_block_impacts = palloc(skip_entries_capacity * sizeof(uint8));
+	if (ctx->priors != NULL)
+		all_block_priors = palloc(skip_entries_capacity * sizeof(float4));
+
 	/*
 	 * Streaming pass: for each term, read postings from EXPULL
 	 * and write compressed blocks.
@@ -385,6 +457,8 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 		uint32		   doc_count;
 		uint32		   block_idx;
 		uint32		   num_blocks;
+		const uint8	  *pos_cursor = terms[i].positions;
+		const uint8	  *pos_end = pos_cursor + terms[i].positions_len;
 
 		/* Record where this term's postings start */
 		term_blocks[i].posting_offset	= writer.current_offset;
@@ -413,9 +487,12 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 			TpSkipEntry	   skip;
 			uint32		   nread;
 			uint32		   j;
-			uint16		   max_tf	  = 0;
-			uint8		   min_norm	  = 255;
-			uint32		   last_docid = 0;
+			uint16		   max_tf		= 0;
+			uint8		   min_norm		= 255;
+			uint32		   last_docid	= 0;
+			uint8		   block_impact = 0;
+			uint8		   impact_flag	= 0;
+			float4		   block_prior	= 0.0f;
 
 			/* Read a block of entries from EXPULL */
 			nread = tp_expull_reader_read(&reader, entries, TP_BLOCK_SIZE);
@@ -427,7 +504,7 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 				block_postings[j].doc_id	= entries[j].doc_id;
 				block_postings[j].frequency = entries[j].frequency;
 				block_postings[j].fieldnorm = entries[j].fieldnorm;
-				block_postings[j].reserved	= 0;
+				block_postings[j].impact	= 0;
 
 				/* Track block stats */
 				if (entries[j].doc_id > last_docid)
@@ -446,26 +523,53 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 			skip.posting_offset = writer.current_offset;
 			memset(skip.reserved, 0, sizeof(skip.reserved));
 
+			if (all_block_impacts)
+			{
+				block_impact = tp_impact_fill_block(
+						block_postings,
+						nread,
+						&ctx->impacts,
+						impact_avg_doc_len);
+				impact_flag = TP_BLOCK_FLAG_IMPACTS;
+			}
+			if (all_block_priors)
+				block_prior = tp_prior_block_max(
+						ctx->priors, block_postings, nread);
+
 			/* Write posting block */
 			if (tp_compress_segments)
 			{
-				uint8  compressed[TP_MAX_COMPRESSED_BLOCK_SIZE];
+				uint8  compressed[TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE];
 				uint32 compressed_size;
 
-				compressed_size =
-						tp_compress_block(block_postings, nread, compressed);
-				skip.flags = TP_BLOCK_FLAG_DELTA;
+				compressed_size = tp_compress_block(
+						block_postings, nread, impact_flag != 0, compressed);
+				skip.flags = TP_BLOCK_FLAG_DELTA | impact_flag;
 				tp_segment_writer_write(&writer, compressed, compressed_size);
 			}
 			else
 			{
-				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED;
+				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED | impact_flag;
 				tp_segment_writer_write(
 						&writer,
 						block_postings,
 						nread * sizeof(TpBlockPosting));
 			}
 
+			/* This block's slice of the term's positions stream */
+			if (pos_cursor != NULL)
+			{
+				const uint8 *next = tp_positions_skip(pos_cursor, pos_end, nread);
+				uint32		 len  = (uint32)(next - pos_cursor);
+
+				tp_skip_set_positions(
+						&skip,
+						(uint32)(writer.current_offset - skip.posting_offset));
+				tp_segment_writer_write(&writer, &len, sizeof(uint32));
+				tp_segment_writer_write(&writer, pos_cursor, len);
+				pos_cursor = next;
+			}
+
 			/* Accumulate skip entry */
 			if (skip_entries_count >= skip_entries_capacity)
 			{
@@ -473,7 +577,19 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 				all_skip_entries = repalloc(
 						all_skip_entries,
 						skip_entries_capacity * sizeof(TpSkipEntry));
+				if (all_block_impacts)
+					all_block_impacts = repalloc(
+							all_block_impacts,
+							skip_entries_capacity * sizeof(uint8));
+				if (all_block_priors)
+					all_block_priors = repalloc(
+							all_block_priors,
+							skip_entries_capacity * sizeof(float4));
 			}
+			if (all_block_impacts)
+				all_block_impacts[skip_entries_count] = block_impact;
+			if (all_block_priors)
+				all_block_priors[skip_entries_count] = block_prior;
 			all_skip_entries[skip_entries_count++] = skip;
 		}
 	}
@@ -486,12 +602,65 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 				all_skip_entries,
 				skip_entries_count * sizeof(TpSkipEntry));
 
+	/* Write per-term bounds, parallel to the dict entries */
+	header.term_bounds_offset = writer.current_offset;
+	{
+		TpTermBounds *bounds = palloc(num_terms * sizeof(TpTermBounds));
+
+		for (i = 0; i < num_terms; i++)
+		{
+			uint32 start = term_blocks[i].skip_entry_start;
+
+			tp_term_bounds_from_skip(
+					&all_skip_entries[start],
+					all_block_impacts ? &all_block_impacts[start] : NULL,
+					term_blocks[i].block_count,
+					&bounds[i]);
+		}
+		tp_segment_writer_write(
+				&writer, bounds, num_terms * sizeof(TpTermBounds));
+		pfree(bounds);
+	}
+
+	/* Write per-block max impacts, parallel to the skip index */
+	if (all_block_impacts)
+	{
+		header.block_impacts_offset = writer.current_offset;
+		header.impact_avg_doc_len	= impact_avg_doc_len;
+		if (skip_entries_count > 0)
+			tp_segment_writer_write(
+					&writer, all_block_impacts, skip_entries_count);
+		pfree(all_block_impacts);
+	}
+
+	/* Write per-block max priors, parallel to the skip index */
+	if (all_block_priors)
+	{
+		header.block_priors_offset = writer.current_offset;
+		if (skip_entries_count > 0)
+			tp_segment_writer_write(
+					&writer,
+					all_block_priors,
+					skip_entries_count * sizeof(float4));
+		pfree(all_block_priors);
+	}
+
 	/* Write fieldnorm table */
 	header.fieldnorm_offset = writer.current_offset;
 	if (ctx->num_docs > 0)
 		tp_segment_writer_write(
 				&writer, ctx->fieldnorms, ctx->num_docs * sizeof(uint8));
 
+	/* Write prior table, parallel to the fieldnorm table */
+	if (ctx->priors != NULL)
+	{
+		header.prior_offset = writer.current_offset;
+		header.max_prior	= tp_prior_max(ctx->priors, ctx->num_docs);
+		if (ctx->num_docs > 0)
+			tp_segment_writer_write(
+					&writer, ctx->priors, ctx->num_docs * sizeof(float4));
+	}
+
 	/* Write CTID pages array (BlockNumber per doc) */
 	header.ctid_pages_offset = writer.current_offset;
 	{
@@ -681,6 +850,12 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 			hdr->entries_offset		 = header.entries_offset;
 			hdr->postings_offset	 = header.postings_offset;
 			hdr->skip_index_offset	 = header.skip_index_offset;
+			hdr->term_bounds_offset	 = header.term_bounds_offset;
+			hdr->block_impacts_offset = header.block_impacts_offset;
+			hdr->impact_avg_doc_len	  = header.impact_avg_doc_len;
+			hdr->prior_offset		  = header.prior_offset;
+			hdr->block_priors_offset  = header.block_priors_offset;
+			hdr->max_prior			  = header.max_prior;
 			hdr->fieldnorm_offset	 = header.fieldnorm_offset;
 			hdr->ctid_pages_offset	 = header.ctid_pages_offset;
 			hdr->ctid_offsets_offset = header.ctid_offsets_offset;
@@ -700,7 +875,6 @@ tp_write_segment_from_build_ctx(TpBuildContext *ctx, Relation index)
 	/* Cleanup */
 	pfree(term_blocks);
 	pfree(all_skip_entries);
-	pfree(string_offsets);
 	pfree(terms);
 	if (writer.pages)
 		pfree(writer.pages);
@@ -721,7 +895,7 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	TpBuildTermInfo *terms;
 	uint32			 num_terms;
 	TpSegmentHeader	 header;
-	TpDictionary	 dict;
+	TpDictBuilder	 dict;
 
 	/*
 	 * BufFile position tracking. BufFile uses (fileno, offset)
@@ -732,9 +906,7 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	int	  base_fileno;
 	off_t base_file_offset;
 
-	uint32 *string_offsets;
-	uint32	string_pos;
-	uint32	i;
+	uint32 i;
 
 	/* Current write position in the flat stream */
 	uint64 current_offset;
@@ -755,6 +927,13 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	uint32		 skip_entries_count;
 	uint32		 skip_entries_capacity;
 
+	/* Per-block max impacts, parallel to skip entries (if stored) */
+	float4 impact_avg_doc_len;
+	uint8 *all_block_impacts = NULL;
+
+	/* Per-block max priors, parallel to skip entries (if stored) */
+	float4 *all_block_priors = NULL;
+
 	/* Get sorted terms */
 	terms = tp_build_context_get_sorted_terms(ctx, &num_terms);
 	if (num_terms == 0)
@@ -785,36 +964,18 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	BufFileWrite(file, &header, sizeof(TpSegmentHeader));
 	current_offset += sizeof(TpSegmentHeader);
 
-	/* Write dictionary section */
-	dict.num_terms = num_terms;
-	BufFileWrite(file, &dict, offsetof(TpDictionary, string_offsets));
-	current_offset += offsetof(TpDictionary, string_offsets);
-
-	/* Build string offsets */
-	string_offsets = palloc0(num_terms * sizeof(uint32));
-	string_pos	   = 0;
+	/* Write dictionary section: term index, then front-coded blocks */
+	tp_dict_builder_init(&dict, num_terms);
 	for (i = 0; i < num_terms; i++)
-	{
-		string_offsets[i] = string_pos;
-		string_pos += sizeof(uint32) + terms[i].term_len + sizeof(uint32);
-	}
-
-	/* Write string offsets array */
-	BufFileWrite(file, string_offsets, num_terms * sizeof(uint32));
-	current_offset += num_terms * sizeof(uint32);
+		tp_dict_builder_add(&dict, terms[i].term, terms[i].term_len);
+	tp_dict_builder_finish(&dict);
+	BufFileWrite(file, dict.index.data, dict.index.len);
+	current_offset += dict.index.len;
 
-	/* Write string pool */
 	header.strings_offset = current_offset;
-	for (i = 0; i < num_terms; i++)
-	{
-		uint32 length	   = terms[i].term_len;
-		uint32 dict_offset = i * sizeof(TpDictEntry);
-
-		BufFileWrite(file, &length, sizeof(uint32));
-		BufFileWrite(file, terms[i].term, length);
-		BufFileWrite(file, &dict_offset, sizeof(uint32));
-		current_offset += sizeof(uint32) + length + sizeof(uint32);
-	}
+	BufFileWrite(file, dict.blocks.data, dict.blocks.len);
+	current_offset += dict.blocks.len;
+	tp_dict_builder_free(&dict);
 
 	/* Record entries offset */
 	header.entries_offset = current_offset;
@@ -841,6 +1002,13 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	skip_entries_count	  = 0;
 	all_skip_entries = palloc(skip_entries_capacity * sizeof(TpSkipEntry));
 
+	impact_avg_doc_len = tp_impact_segment_avg_doc_len(
+			&ctx->impacts, ctx->total_len, ctx->num_docs);
+	if (impact_avg_doc_len > 0.0f)
+		all_block_impacts = palloc(skip_entries_capacity * sizeof(uint8));
+	if (ctx->priors != NULL)
+		all_block_priors = palloc(skip_entries_capacity * sizeof(float4));
+
 	/* Streaming pass: write posting blocks */
 	for (i = 0; i < num_terms; i++)
 	{
@@ -848,6 +1016,8 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 		uint32		   doc_count;
 		uint32		   block_idx;
 		uint32		   num_blocks;
+		const uint8	  *pos_cursor = terms[i].positions;
+		const uint8	  *pos_end = pos_cursor + terms[i].positions_len;
 
 		term_blocks[i].posting_offset	= current_offset;
 		term_blocks[i].skip_entry_start = skip_entries_count;
@@ -873,9 +1043,12 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 			TpSkipEntry	   skip;
 			uint32		   nread;
 			uint32		   j;
-			uint16		   max_tf	  = 0;
-			uint8		   min_norm	  = 255;
-			uint32		   last_docid = 0;
+			uint16		   max_tf		= 0;
+			uint8		   min_norm		= 255;
+			uint32		   last_docid	= 0;
+			uint8		   block_impact = 0;
+			uint8		   impact_flag	= 0;
+			float4		   block_prior	= 0.0f;
 
 			nread = tp_expull_reader_read(&reader, entries, TP_BLOCK_SIZE);
 			Assert(nread > 0);
@@ -885,7 +1058,7 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 				block_postings[j].doc_id	= entries[j].doc_id;
 				block_postings[j].frequency = entries[j].frequency;
 				block_postings[j].fieldnorm = entries[j].fieldnorm;
-				block_postings[j].reserved	= 0;
+				block_postings[j].impact	= 0;
 
 				if (entries[j].doc_id > last_docid)
 					last_docid = entries[j].doc_id;
@@ -902,32 +1075,71 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 			skip.posting_offset = current_offset;
 			memset(skip.reserved, 0, sizeof(skip.reserved));
 
+			if (all_block_impacts)
+			{
+				block_impact = tp_impact_fill_block(
+						block_postings,
+						nread,
+						&ctx->impacts,
+						impact_avg_doc_len);
+				impact_flag = TP_BLOCK_FLAG_IMPACTS;
+			}
+			if (all_block_priors)
+				block_prior = tp_prior_block_max(
+						ctx->priors, block_postings, nread);
+
 			if (tp_compress_segments)
 			{
-				uint8  compressed[TP_MAX_COMPRESSED_BLOCK_SIZE];
+				uint8  compressed[TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE];
 				uint32 compressed_size;
 
-				compressed_size =
-						tp_compress_block(block_postings, nread, compressed);
-				skip.flags = TP_BLOCK_FLAG_DELTA;
+				compressed_size = tp_compress_block(
+						block_postings, nread, impact_flag != 0, compressed);
+				skip.flags = TP_BLOCK_FLAG_DELTA | impact_flag;
 				BufFileWrite(file, compressed, compressed_size);
 				current_offset += compressed_size;
 			}
 			else
 			{
-				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED;
+				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED | impact_flag;
 				BufFileWrite(
 						file, block_postings, nread * sizeof(TpBlockPosting));
 				current_offset += nread * sizeof(TpBlockPosting);
 			}
 
+			/* This block's slice of the term's positions stream */
+			if (pos_cursor != NULL)
+			{
+				const uint8 *next = tp_positions_skip(pos_cursor, pos_end, nread);
+				uint32		 len  = (uint32)(next - pos_cursor);
+
+				tp_skip_set_positions(
+						&skip, (uint32)(current_offset - skip.posting_offset));
+				BufFileWrite(file, &len, sizeof(uint32));
+				BufFileWrite(file, pos_cursor, len);
+				current_offset += sizeof(uint32) + len;
+				pos_cursor = next;
+			}
+
 			if (skip_entries_count >= skip_entries_capacity)
 			{
 				skip_entries_capacity *= 2;
 				all_skip_entries = repalloc(
 						all_skip_entries,
 						skip_entries_capacity * sizeof(TpSkipEntry));
+				if (all_block_impacts)
+					all_block_impacts = repalloc(
+							all_block_impacts,
+							skip_entries_capacity * sizeof(uint8));
+				if (all_block_priors)
+					all_block_priors = repalloc(
+							all_block_priors,
+							skip_entries_capacity * sizeof(float4));
 			}
+			if (all_block_impacts)
+				all_block_impacts[skip_entries_count] = block_impact;
+			if (all_block_priors)
+				all_block_priors[skip_entries_count] = block_prior;
 			all_skip_entries[skip_entries_count++] = skip;
 		}
 	}
@@ -943,6 +1155,46 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 		current_offset += skip_entries_count * sizeof(TpSkipEntry);
 	}
 
+	/* Write per-term bounds, parallel to the dict entries */
+	header.term_bounds_offset = current_offset;
+	{
+		TpTermBounds *bounds = palloc(num_terms * sizeof(TpTermBounds));
+
+		for (i = 0; i < num_terms; i++)
+		{
+			uint32 start = term_blocks[i].skip_entry_start;
+
+			tp_term_bounds_from_skip(
+					&all_skip_entries[start],
+					all_block_impacts ? &all_block_impacts[start] : NULL,
+					term_blocks[i].block_count,
+					&bounds[i]);
+		}
+		BufFileWrite(file, bounds, num_terms * sizeof(TpTermBounds));
+		current_offset += num_terms * sizeof(TpTermBounds);
+		pfree(bounds);
+	}
+
+	/* Write per-block max impacts, parallel to the skip index */
+	if (all_block_impacts)
+	{
+		header.block_impacts_offset = current_offset;
+		header.impact_avg_doc_len	= impact_avg_doc_len;
+		BufFileWrite(file, all_block_impacts, skip_entries_count);
+		current_offset += skip_entries_count;
+		pfree(all_block_impacts);
+	}
+
+	/* Write per-block max priors, parallel to the skip index */
+	if (all_block_priors)
+	{
+		header.block_priors_offset = current_offset;
+		BufFileWrite(
+				file, all_block_priors, skip_entries_count * sizeof(float4));
+		current_offset += skip_entries_count * sizeof(float4);
+		pfree(all_block_priors);
+	}
+
 	/* Write fieldnorm table */
 	header.fieldnorm_offset = current_offset;
 	if (ctx->num_docs > 0)
@@ -951,6 +1203,15 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 		current_offset += ctx->num_docs * sizeof(uint8);
 	}
 
+	/* Write prior table, parallel to the fieldnorm table */
+	if (ctx->priors != NULL)
+	{
+		header.prior_offset = current_offset;
+		header.max_prior	= tp_prior_max(ctx->priors, ctx->num_docs);
+		BufFileWrite(file, ctx->priors, ctx->num_docs * sizeof(float4));
+		current_offset += ctx->num_docs * sizeof(float4);
+	}
+
 	/* Write CTID pages array */
 	header.ctid_pages_offset = current_offset;
 	{
@@ -1033,7 +1294,6 @@ tp_write_segment_to_buffile(TpBuildContext *ctx, BufFile *file)
 	/* Cleanup */
 	pfree(term_blocks);
 	pfree(all_skip_entries);
-	pfree(string_offsets);
 	pfree(terms);
 
 	return current_offset;
@@ -1071,6 +1331,10 @@ tp_build_context_reset(TpBuildContext *ctx)
 	/* Reset document arrays (keep allocated memory) */
 	ctx->num_docs  = 0;
 	ctx->total_len = 0;
+
+	if (ctx->positions_cxt != NULL)
+		MemoryContextReset(ctx->positions_cxt);
+	ctx->positions_bytes = 0;
 }
 
 /*
@@ -1084,7 +1348,11 @@ tp_build_context_destroy(TpBuildContext *ctx)
 
 	tp_arena_destroy(ctx->arena);
 	hash_destroy(ctx->terms_ht);
+	if (ctx->positions_cxt != NULL)
+		MemoryContextDelete(ctx->positions_cxt);
 	pfree(ctx->fieldnorms);
 	pfree(ctx->ctids);
+	if (ctx->priors != NULL)
+		pfree(ctx->priors);
 	pfree(ctx);
 }
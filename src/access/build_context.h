@@ -23,6 +23,7 @@
 
 #include "memtable/arena.h"
 #include "memtable/expull.h"
+#include "segment/impact.h"
 #include "segment/segment.h"
 
 /*
@@ -35,6 +36,15 @@ typedef struct TpBuildTermEntry
 	char	*term; /* Key: pointer to arena-stored null-terminated string */
 	uint32	 term_len;
 	TpExpull expull; /* Inline EXPULL posting list header */
+
+	/*
+	 * Positions stream (positional indexes only): one entry per posting
+	 * in doc_id order, encoded as in segment/positions.h.  Lives in
+	 * the context's positions_cxt.
+	 */
+	uint8 *positions;
+	uint32 positions_len;
+	uint32 positions_cap;
 } TpBuildTermEntry;
 
 /*
@@ -57,6 +67,7 @@ typedef struct TpBuildContext
 	/* Flat arrays indexed by doc_id (sequential assignment) */
 	uint8			*fieldnorms; /* Encoded fieldnorm per doc */
 	ItemPointerData *ctids;		 /* Heap CTID per doc */
+	float4			*priors;	 /* Static prior per doc, NULL if none */
 	uint32			 num_docs;	 /* Documents in current batch */
 	uint32			 docs_capacity;
 
@@ -65,13 +76,24 @@ typedef struct TpBuildContext
 
 	/* Budget for flush decisions */
 	Size budget; /* Max arena bytes before flush */
+
+	/* Token positions, if the index stores them */
+	bool		  store_positions;
+	MemoryContext positions_cxt;   /* Per-term position streams */
+	Size		  positions_bytes; /* Bytes used by those streams */
+
+	/* Quantized impacts, if the index stores them */
+	TpImpactParams impacts;
 } TpBuildContext;
 
 /*
  * Create a new build context.
  * budget: max arena bytes before caller should flush (0 = no limit).
+ * store_positions: record token positions (index WITH positions).
+ * impacts: quantized impact parameters (see tp_index_impact_params).
  */
-extern TpBuildContext *tp_build_context_create(Size budget);
+extern TpBuildContext *tp_build_context_create(
+		Size budget, bool store_positions, const TpImpactParams *impacts);
 
 /*
  * Add a single document's terms to the build context.
@@ -80,6 +102,8 @@ extern TpBuildContext *tp_build_context_create(Size budget);
  * terms: array of null-terminated term strings
  * frequencies: parallel array of term frequencies
  * term_count: number of terms
+ * positions: per term, frequencies[i] ascending positions; required
+ *            if the context stores positions, ignored otherwise
  * doc_length: sum of all frequencies (for fieldnorm encoding)
  * ctid: heap tuple ID
  *
@@ -89,10 +113,19 @@ extern uint32 tp_build_context_add_document(
 		TpBuildContext *ctx,
 		char		  **terms,
 		int32		   *frequencies,
+		uint32		  **positions,
 		int				term_count,
 		int32			doc_length,
 		ItemPointer		ctid);
 
+/*
+ * Set the static prior of a document added to the build context (an
+ * index with an INCLUDE column; see segment/prior.h).  A context whose
+ * priors are never set writes segments without a prior table.
+ */
+extern void
+tp_build_context_set_prior(TpBuildContext *ctx, uint32 doc_id, float4 prior);
+
 /*
  * Check if the build context should be flushed (budget exceeded).
  */
@@ -101,7 +134,8 @@ tp_build_context_should_flush(TpBuildContext *ctx)
 {
 	if (ctx->budget == 0)
 		return false;
-	return tp_arena_mem_usage(ctx->arena) >= ctx->budget;
+	return tp_arena_mem_usage(ctx->arena) + ctx->positions_bytes >=
+		   ctx->budget;
 }
 
 /*
@@ -113,13 +147,17 @@ tp_build_context_should_flush(TpBuildContext *ctx)
  *   - term, term_len: from the hash table entry
  *   - expull: pointer to the TpExpull in the hash table entry
  *   - doc_freq: number of distinct documents for the term
+ *   - positions, positions_len: the term's positions stream (NULL/0
+ *     unless the context stores positions)
  */
 typedef struct TpBuildTermInfo
 {
-	char	 *term;
-	uint32	  term_len;
-	TpExpull *expull;	/* Points into HTAB entry */
-	uint32	  doc_freq; /* Number of documents for this term */
+	char		*term;
+	uint32		 term_len;
+	TpExpull	*expull;   /* Points into HTAB entry */
+	uint32		 doc_freq; /* Number of documents for this term */
+	const uint8 *positions;
+	uint32		 positions_len;
 } TpBuildTermInfo;
 
 extern TpBuildTermInfo *
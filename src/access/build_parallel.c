@@ -189,6 +189,7 @@ tp_parallel_build_worker_main(dsm_segment *seg, shm_toc *toc)
 	MemoryContext			build_tmpctx;
 	MemoryContext			oldctx;
 	Size					budget;
+	TpImpactParams			impacts;
 	int						worker_id;
 	BufFile				   *buffile;
 	char					file_name[64];
@@ -265,7 +266,9 @@ tp_parallel_build_worker_main(dsm_segment *seg, shm_toc *toc)
 	if (budget < 64L * 1024 * 1024)
 		budget = 64L * 1024 * 1024;
 
-	build_ctx = tp_build_context_create(budget);
+	tp_index_impact_params(index, &impacts);
+	build_ctx = tp_build_context_create(
+			budget, tp_index_has_positions(index), &impacts);
 	tracker_init(&tracker);
 
 	build_tmpctx = AllocSetContextCreate(
@@ -281,6 +284,7 @@ tp_parallel_build_worker_main(dsm_segment *seg, shm_toc *toc)
 		ItemPointer ctid;
 		char	  **terms;
 		int32	   *frequencies;
+		uint32	  **positions = NULL;
 		int			term_count;
 		int			doc_length;
 
@@ -312,24 +316,40 @@ tp_parallel_build_worker_main(dsm_segment *seg, shm_toc *toc)
 		else
 			document_text = DatumGetTextPP(idx_values[0]);
 
-		doc_length = tp_tokenize_text(
-				document_text,
-				shared->text_config_oid,
-				&terms,
-				&frequencies,
-				&term_count);
+		if (build_ctx->store_positions)
+			doc_length = tp_tokenize_text_with_positions(
+					document_text,
+					shared->text_config_oid,
+					&terms,
+					&frequencies,
+					&positions,
+					&term_count);
+		else
+			doc_length = tp_tokenize_text(
+					document_text,
+					shared->text_config_oid,
+					&terms,
+					&frequencies,
+					&term_count);
 
 		MemoryContextSwitchTo(oldctx);
 
 		if (term_count > 0)
 		{
-			tp_build_context_add_document(
+			uint32 doc_id = tp_build_context_add_document(
 					build_ctx,
 					terms,
 					frequencies,
+					positions,
 					term_count,
 					doc_length,
 					ctid);
+
+			if (tp_index_has_prior(index))
+				tp_build_context_set_prior(
+						build_ctx,
+						doc_id,
+						tp_index_prior_value(index, idx_values, idx_isnull));
 		}
 
 		/* Reset per-doc context */
@@ -12,10 +12,19 @@
 #include <catalog/pg_opclass.h>
 #include <catalog/pg_type.h>
 #include <commands/vacuum.h>
+#include <datatype/timestamp.h>
+#include <float.h>
+#include <math.h>
+#include <utils/builtins.h>
+#include <utils/date.h>
+#include <utils/rel.h>
 #include <utils/syscache.h>
+#include <utils/timestamp.h>
 
 #include "access/am.h"
+#include "index/metapage.h"
 #include "planner/cost.h"
+#include "segment/impact.h"
 
 /* Relation options - initialized in mod.c */
 extern relopt_kind tp_relopt_kind;
@@ -61,7 +70,7 @@ tp_handler(PG_FUNCTION_ARGS)
 
 	amroutine = makeNode(IndexAmRoutine);
 
-	amroutine->amstrategies	  = 0; /* No search strategies - ORDER BY only */
+	amroutine->amstrategies	  = 0; /* <@> ORDER BY (1), @@ match (2) */
 	amroutine->amsupport	  = 8; /* 8 for distance */
 	amroutine->amoptsprocnum  = 0;
 	amroutine->amcanorder	  = false;
@@ -81,9 +90,9 @@ tp_handler(PG_FUNCTION_ARGS)
 	amroutine->amstorage		  = false; /* No separate storage type */
 	amroutine->amclusterable	  = false; /* Cannot cluster on this index */
 	amroutine->ampredlocks		  = false; /* No predicate locking */
-	amroutine->amcanparallel	  = false; /* No parallel scan support yet */
+	amroutine->amcanparallel	  = true;  /* Segments split across workers */
 	amroutine->amcanbuildparallel = true;
-	amroutine->amcaninclude		  = false; /* No INCLUDE columns */
+	amroutine->amcaninclude		  = true;  /* One INCLUDE column: the prior */
 	amroutine->amusemaintenanceworkmem =
 			false; /* Vacuum does not use maintenance work mem */
 	amroutine->amsummarizing		   = false;
@@ -107,13 +116,13 @@ tp_handler(PG_FUNCTION_ARGS)
 	amroutine->ambeginscan		= tp_beginscan;
 	amroutine->amrescan			= tp_rescan;
 	amroutine->amgettuple		= tp_gettuple;
-	amroutine->amgetbitmap		= NULL; /* No bitmap scans - ORDER BY only */
+	amroutine->amgetbitmap		= tp_getbitmap;
 	amroutine->amendscan		= tp_endscan;
 	amroutine->ammarkpos		= NULL; /* No mark/restore support */
 	amroutine->amrestrpos		= NULL;
-	amroutine->amestimateparallelscan = NULL; /* No parallel support yet */
-	amroutine->aminitparallelscan	  = NULL;
-	amroutine->amparallelrescan		  = NULL;
+	amroutine->amestimateparallelscan = tp_estimateparallelscan;
+	amroutine->aminitparallelscan	  = tp_initparallelscan;
+	amroutine->amparallelrescan		  = tp_parallelrescan;
 
 #if PG_VERSION_NUM >= 180000
 	amroutine->amtranslatestrategy = NULL;
@@ -138,7 +147,13 @@ tp_options(Datum reloptions, bool validate)
 			  .offset  = offsetof(TpOptions, k1)},
 			 {.optname = "b",
 			  .opttype = RELOPT_TYPE_REAL,
-			  .offset  = offsetof(TpOptions, b)}};
+			  .offset  = offsetof(TpOptions, b)},
+			 {.optname = "positions",
+			  .opttype = RELOPT_TYPE_BOOL,
+			  .offset  = offsetof(TpOptions, positions)},
+			 {.optname = "impacts",
+			  .opttype = RELOPT_TYPE_BOOL,
+			  .offset  = offsetof(TpOptions, impacts)}};
 
 	return (bytea *)build_reloptions(
 			reloptions,
@@ -149,6 +164,173 @@ tp_options(Datum reloptions, bool validate)
 			lengthof(tab));
 }
 
+/*
+ * Was the index created WITH (positions = true)?
+ */
+bool
+tp_index_has_positions(Relation index)
+{
+	TpOptions *options = (TpOptions *)index->rd_options;
+
+	return options != NULL && options->positions;
+}
+
+/*
+ * Was the index created WITH (impacts = true)?  Segment writers then
+ * quantize impacts with the k1 and b queries score with, which are
+ * the metapage's.
+ */
+void
+tp_index_impact_params(Relation index, TpImpactParams *params)
+{
+	TpOptions	   *options = (TpOptions *)index->rd_options;
+	TpIndexMetaPage metap;
+
+	memset(params, 0, sizeof(TpImpactParams));
+	if (options == NULL || !options->impacts)
+		return;
+
+	metap			= tp_get_metapage(index);
+	params->enabled = true;
+	params->k1		= metap->k1;
+	params->b		= metap->b;
+	pfree(metap);
+}
+
+/*
+ * Does the index store a static prior per document?  The prior is the
+ * value of its INCLUDE column, if it has one (see segment/prior.h).
+ */
+bool
+tp_index_has_prior(Relation index)
+{
+	return IndexRelationGetNumberOfAttributes(index) >
+		   IndexRelationGetNumberOfKeyAttributes(index);
+}
+
+/*
+ * Check the INCLUDE column of a new index: at most one, of a type with
+ * an order-preserving conversion to float4.
+ */
+void
+tp_index_check_prior(Relation index)
+{
+	int nkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
+	int natts	 = IndexRelationGetNumberOfAttributes(index);
+	Oid typid;
+
+	if (natts == nkeyatts)
+		return;
+
+	if (natts - nkeyatts > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("bm25 indexes support at most one INCLUDE column"),
+				 errhint("The INCLUDE column is stored as each document's "
+						 "static prior.")));
+
+	typid = TupleDescAttr(RelationGetDescr(index), nkeyatts)->atttypid;
+	switch (typid)
+	{
+	case FLOAT4OID:
+	case FLOAT8OID:
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case NUMERICOID:
+	case DATEOID:
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		break;
+	default:
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("INCLUDE column of a bm25 index must be numeric, "
+						"date or timestamp, not %s",
+						format_type_be(typid))));
+	}
+}
+
+/* Seconds since the Unix epoch of a (finite) timestamp */
+double
+tp_epoch_seconds(Timestamp ts)
+{
+	return (double)ts / USECS_PER_SEC +
+		   (double)(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY;
+}
+
+/*
+ * The static prior of a document: its INCLUDE column as float4, dates
+ * and timestamps as seconds since the Unix epoch.  NULL and NaN map to
+ * 0, infinities and out-of-range values to +-FLT_MAX.  float4 keeps 24
+ * bits, so present-day timestamps resolve to about two minutes.
+ */
+float4
+tp_index_prior_value(Relation index, Datum *values, bool *isnull)
+{
+	int	   attno = IndexRelationGetNumberOfKeyAttributes(index);
+	Oid	   typid;
+	double v;
+
+	if (isnull[attno])
+		return 0.0f;
+
+	typid = TupleDescAttr(RelationGetDescr(index), attno)->atttypid;
+	switch (typid)
+	{
+	case FLOAT4OID:
+		v = DatumGetFloat4(values[attno]);
+		break;
+	case FLOAT8OID:
+		v = DatumGetFloat8(values[attno]);
+		break;
+	case INT2OID:
+		v = DatumGetInt16(values[attno]);
+		break;
+	case INT4OID:
+		v = DatumGetInt32(values[attno]);
+		break;
+	case INT8OID:
+		v = (double)DatumGetInt64(values[attno]);
+		break;
+	case NUMERICOID:
+		v = DatumGetFloat8(DirectFunctionCall1(numeric_float8, values[attno]));
+		break;
+	case DATEOID:
+	{
+		DateADT date = DatumGetDateADT(values[attno]);
+
+		if (DATE_NOT_FINITE(date))
+			v = DATE_IS_NOBEGIN(date) ? -INFINITY : INFINITY;
+		else
+			v = tp_epoch_seconds((Timestamp)date * USECS_PER_DAY);
+		break;
+	}
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+	{
+		Timestamp ts = DatumGetTimestamp(values[attno]);
+
+		if (TIMESTAMP_NOT_FINITE(ts))
+			v = TIMESTAMP_IS_NOBEGIN(ts) ? -INFINITY : INFINITY;
+		else
+			v = tp_epoch_seconds(ts);
+		break;
+	}
+	default:
+		elog(ERROR, "unsupported bm25 prior type %u", typid);
+		v = 0.0; /* keep compiler quiet */
+	}
+
+	if (isnan(v))
+		return 0.0f;
+	if (v > FLT_MAX)
+		return FLT_MAX;
+	if (v < -FLT_MAX)
+		return -FLT_MAX;
+	return (float4)v;
+}
+
 /*
  * Validate BM25 index definition
  */
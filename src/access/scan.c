@@ -7,10 +7,12 @@
 #include <postgres.h>
 
 #include <access/genam.h>
+#include <access/parallel.h>
 #include <access/relscan.h>
 #include <access/sdir.h>
 #include <access/table.h>
 #include <catalog/namespace.h>
+#include <miscadmin.h>
 #include <pgstat.h>
 #include <storage/bufmgr.h>
 #include <utils/builtins.h>
@@ -27,6 +29,11 @@
 #include "index/resolve.h"
 #include "index/state.h"
 #include "memtable/scan.h"
+#include "scoring/bm25.h"
+#include "scoring/expand.h"
+#include "scoring/parallel.h"
+#include "scoring/partition.h"
+#include "scoring/phrase.h"
 #include "types/query.h"
 #include "types/vector.h"
 
@@ -45,6 +52,25 @@ tp_get_cached_score(void)
 	return tp_cached_score;
 }
 
+/*
+ * Backend-local flag: the last ranked scan returned a partial top-k
+ * because its scoring budget ran out.  Reset by each rescan and
+ * reported by bm25_last_scan_partial().
+ */
+static bool tp_scan_partial = false;
+
+bool
+tp_get_scan_partial(void)
+{
+	return tp_scan_partial;
+}
+
+void
+tp_note_scan_partial(void)
+{
+	tp_scan_partial = true;
+}
+
 /* Track CTIDs already emitted by this scan. */
 static bool
 tp_ctid_seen_or_mark(TpScanOpaque so, ItemPointer tid)
@@ -114,96 +140,191 @@ tp_rescan_cleanup_results(TpScanOpaque so)
 		so->result_scores = NULL;
 		MemoryContextSwitchTo(oldcontext);
 	}
+
+	/* Clean up the allowed set of the @@ keys */
+	if (so->allowed_tids)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
+		pfree(so->allowed_tids);
+		so->allowed_tids = NULL;
+		MemoryContextSwitchTo(oldcontext);
+	}
+	so->allowed_count = 0;
 }
 
 /*
- * Process ORDER BY scan keys for <@> operator
+ * The <@> ORDER BY key a scan ranks by, or NULL
+ */
+static ScanKey
+tp_ranking_key(ScanKey orderbys, int norderbys)
+{
+	for (int i = 0; i < norderbys && orderbys; i++)
+	{
+		if (orderbys[i].sk_strategy == TP_STRATEGY_SCORE)
+			return &orderbys[i];
+	}
+	return NULL;
+}
+
+/*
+ * Set the scan's query from a scan key: an ORDER BY key of the <@>
+ * operator or a WHERE key of the @@ match operator.
  *
  * Handles both bm25query and plain text arguments to support:
  * - ORDER BY content <@> 'query'::bm25query (explicit bm25query)
  * - ORDER BY content <@> 'query' (plain text, implicit index resolution)
  */
 static void
-tp_rescan_process_orderby(
-		IndexScanDesc	scan,
-		ScanKey			orderbys,
-		int				norderbys,
-		TpIndexMetaPage metap)
+tp_rescan_set_query(IndexScanDesc scan, ScanKey key, TpIndexMetaPage metap)
 {
-	TpScanOpaque so = (TpScanOpaque)scan->opaque;
+	TpScanOpaque so				  = (TpScanOpaque)scan->opaque;
+	Datum		 query_datum	  = key->sk_argument;
+	char		*query_cstr;
+	Oid			 query_index_oid  = InvalidOid;
+	int32		 min_should_match = 0;
+
+	so->has_prior = false;
+
+	/*
+	 * Use sk_subtype to determine the argument type.
+	 * sk_subtype contains the right-hand operand's type OID.
+	 */
+	if (key->sk_subtype == TEXTOID)
+	{
+		/* Plain text - use text directly */
+		text *query_text = (text *)DatumGetPointer(query_datum);
 
-	for (int i = 0; i < norderbys; i++)
+		query_cstr = text_to_cstring(query_text);
+	}
+	else
 	{
-		ScanKey orderby = &orderbys[i];
+		/* bm25query - extract query text and index OID */
+		TpQuery *query = (TpQuery *)DatumGetPointer(query_datum);
+
+		query_cstr		 = pstrdup(get_tpquery_text(query));
+		query_index_oid	 = get_tpquery_index_oid(query);
+		min_should_match = get_tpquery_min_should_match(query);
 
-		/* Check for <@> operator strategy */
-		if (orderby->sk_strategy == 1) /* Strategy 1: <@> operator */
+		/* Validate index OID if provided in query */
+		if (tpquery_has_index(query))
 		{
-			Datum query_datum = orderby->sk_argument;
-			char *query_cstr;
-			Oid	  query_index_oid = InvalidOid;
+			tp_validate_query_index(query_index_oid, scan->indexRelation);
+		}
 
-			/*
-			 * Use sk_subtype to determine the argument type.
-			 * sk_subtype contains the right-hand operand's type OID.
-			 */
-			if (orderby->sk_subtype == TEXTOID)
-			{
-				/* Plain text - use text directly */
-				text *query_text = (text *)DatumGetPointer(query_datum);
+		/*
+		 * A ranking query with a search-after position starts below
+		 * it.  The position holds the <@> value, the negated score.
+		 */
+		if (key->sk_strategy == TP_STRATEGY_SCORE && so->cursor != NULL)
+		{
+			float4			after_score;
+			ItemPointerData after_ctid;
 
-				query_cstr = text_to_cstring(query_text);
-			}
-			else
-			{
-				/* bm25query - extract query text and index OID */
-				TpQuery *query = (TpQuery *)DatumGetPointer(query_datum);
+			if (get_tpquery_search_after(query, &after_score, &after_ctid))
+				tp_score_cursor_start_after(
+						so->cursor, -after_score, &after_ctid);
+		}
 
-				query_cstr		= pstrdup(get_tpquery_text(query));
-				query_index_oid = get_tpquery_index_oid(query);
+		/* Only ranking adds the static prior */
+		if (key->sk_strategy == TP_STRATEGY_SCORE)
+			so->has_prior = get_tpquery_prior(query, &so->prior);
+		if (so->has_prior && !tp_index_has_prior(scan->indexRelation))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("index \"%s\" stores no static prior",
+							RelationGetRelationName(scan->indexRelation)),
+					 errhint("Create the index with an INCLUDE column "
+							 "holding each document's prior.")));
+	}
 
-				/* Validate index OID if provided in query */
-				if (tpquery_has_index(query))
-				{
-					tp_validate_query_index(
-							query_index_oid, scan->indexRelation);
-				}
-			}
+	/* Clear query vector since we're using text directly */
+	if (so->query_vector)
+	{
+		pfree(so->query_vector);
+		so->query_vector = NULL;
+	}
+	so->required_vector = NULL;
+	so->excluded_vector = NULL;
+	so->phrases			= NIL;
+	so->term_weights	= NULL;
 
-			/* Clear query vector since we're using text directly */
-			if (so->query_vector)
-			{
-				pfree(so->query_vector);
-				so->query_vector = NULL;
-			}
+	/* Free old query text if it exists */
+	if (so->query_text)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
+		pfree(so->query_text);
+		MemoryContextSwitchTo(oldcontext);
+	}
 
-			/* Free old query text if it exists */
-			if (so->query_text)
-			{
-				MemoryContext oldcontext = MemoryContextSwitchTo(
-						so->scan_context);
-				pfree(so->query_text);
-				MemoryContextSwitchTo(oldcontext);
-			}
+	/* Allocate new query text in scan context */
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
+		so->query_text			 = pstrdup(query_cstr);
+		MemoryContextSwitchTo(oldcontext);
+	}
 
-			/* Allocate new query text in scan context */
-			{
-				MemoryContext oldcontext = MemoryContextSwitchTo(
-						so->scan_context);
-				so->query_text = pstrdup(query_cstr);
-				MemoryContextSwitchTo(oldcontext);
-			}
+	/* Store index OID and match constraint for this scan */
+	so->index_oid		 = RelationGetRelid(scan->indexRelation);
+	so->min_should_match = min_should_match;
 
-			/* Store index OID for this scan */
-			so->index_oid = RelationGetRelid(scan->indexRelation);
+	/* Mark all docs as candidates for ORDER BY operation */
+	if (metap && metap->total_docs > 0)
+		so->result_count = metap->total_docs;
 
-			/* Mark all docs as candidates for ORDER BY operation */
-			if (metap && metap->total_docs > 0)
-				so->result_count = metap->total_docs;
+	pfree(query_cstr);
+}
 
-			pfree(query_cstr);
-		}
-	}
+/*
+ * Locate our shared state inside the executor's parallel scan descriptor
+ */
+static TpParallelScanShared *
+tp_parallel_shared(IndexScanDesc scan)
+{
+	ParallelIndexScanDesc pscan = scan->parallel_scan;
+
+#if PG_VERSION_NUM >= 180000
+	return (TpParallelScanShared *)OffsetToPointer(pscan, pscan->ps_offset_am);
+#else
+	return (TpParallelScanShared *)OffsetToPointer(pscan, pscan->ps_offset);
+#endif
+}
+
+/*
+ * Size of the AM-specific part of the parallel scan descriptor
+ */
+#if PG_VERSION_NUM >= 180000
+Size
+tp_estimateparallelscan(Relation index, int nkeys, int norderbys)
+#else
+Size
+tp_estimateparallelscan(int nkeys, int norderbys)
+#endif
+{
+#if PG_VERSION_NUM >= 180000
+	(void)index;
+#endif
+	(void)nkeys;
+	(void)norderbys;
+
+	return sizeof(TpParallelScanShared);
+}
+
+/*
+ * Initialize the shared parallel scan state (leader, before launch)
+ */
+void
+tp_initparallelscan(void *target)
+{
+	tp_parallel_scan_init_shared((TpParallelScanShared *)target);
+}
+
+/*
+ * Reset the shared parallel scan state for a rescan
+ */
+void
+tp_parallelrescan(IndexScanDesc scan)
+{
+	tp_parallel_scan_reset_shared(tp_parallel_shared(scan));
 }
 
 /*
@@ -227,6 +348,18 @@ tp_beginscan(Relation index, int nkeys, int norderbys)
 	so->max_results_used = 0;
 	scan->opaque		 = so;
 
+	/* Ranked scans fetch their results in resumable batches */
+	if (norderbys > 0)
+	{
+		so->cursor = MemoryContextAllocZero(
+				so->scan_context, sizeof(TpScoreCursor));
+		so->cursor->mcxt = so->scan_context;
+
+		if (index->rd_rel->relispartition)
+			so->partition = MemoryContextAllocZero(
+					so->scan_context, sizeof(TpPartitionScanState));
+	}
+
 	/*
 	 * Custom index AMs must allocate ORDER BY arrays themselves.
 	 */
@@ -247,8 +380,8 @@ tp_beginscan(Relation index, int nkeys, int norderbys)
 void
 tp_rescan(
 		IndexScanDesc scan,
-		ScanKey		  keys __attribute__((unused)),
-		int			  nkeys __attribute__((unused)),
+		ScanKey		  keys,
+		int			  nkeys,
 		ScanKey		  orderbys,
 		int			  norderbys)
 {
@@ -261,12 +394,36 @@ tp_rescan(
 	if (!so)
 		return;
 
+	tp_scan_partial = false;
+
 	/* Retrieve query LIMIT, if available */
 	{
 		int query_limit = tp_get_query_limit(scan->indexRelation);
 		so->limit		= (query_limit > 0) ? query_limit : -1;
 	}
 
+	/*
+	 * Parallel scan: the LIMIT is only known in the leader (workers
+	 * never plan), so the leader hands it to workers through shared
+	 * state.  Leader rescan always runs before workers launch.
+	 */
+	if (scan->parallel_scan != NULL)
+	{
+		TpParallelScanShared *shared = tp_parallel_shared(scan);
+		MemoryContext		  oldcontext;
+
+		if (IsParallelWorker())
+			so->limit = shared->limit;
+		else
+			shared->limit = so->limit;
+
+		if (so->parallel)
+			tp_parallel_scan_end(so->parallel);
+		oldcontext	 = MemoryContextSwitchTo(so->scan_context);
+		so->parallel = tp_parallel_scan_begin(shared);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
 	/* Reset scan state */
 	if (so)
 	{
@@ -275,25 +432,50 @@ tp_rescan(
 
 		/* Drop the emitted-CTID dedup set from any prior scan */
 		tp_returned_ctids_reset(so);
+		if (so->cursor)
+			tp_score_cursor_reset(so->cursor);
+		if (so->partition)
+			tp_partition_scan_reset(so->partition);
 
 		/* Reset scan position and state */
-		so->current_pos	 = 0;
-		so->result_count = 0;
-		so->eof_reached	 = false;
-		so->query_vector = NULL;
+		so->current_pos		= 0;
+		so->result_count	= 0;
+		so->eof_reached		= false;
+		so->query_vector	= NULL;
+		so->required_vector = NULL;
+		so->excluded_vector = NULL;
+		so->phrases			= NIL;
+		so->term_weights	= NULL;
 	}
 
-	/* Process ORDER BY scan keys for <@> operator */
-	if (norderbys > 0 && orderbys && so)
+	/*
+	 * Keys are read again when the scan executes: every @@ key is
+	 * matched first, and the <@> key is then reset as the query.
+	 */
+	if (keys && nkeys > 0)
+		memmove(scan->keyData, keys, nkeys * sizeof(ScanKeyData));
+	if (orderbys && norderbys > 0)
+		memmove(scan->orderByData, orderbys, norderbys * sizeof(ScanKeyData));
+
+	/*
+	 * An index scan ranks by the <@> ORDER BY key, or by the first @@
+	 * key if there is none.
+	 */
+	if ((norderbys > 0 && orderbys) || (nkeys > 0 && keys))
 	{
-		/* Get index metadata to check if we have documents */
-		if (!metap)
-			metap = tp_get_metapage(scan->indexRelation);
+		ScanKey query_key = tp_ranking_key(orderbys, norderbys);
 
-		tp_rescan_process_orderby(scan, orderbys, norderbys, metap);
+		if (query_key == NULL && nkeys > 0 && keys)
+			query_key = &keys[0];
 
-		if (metap)
-			pfree(metap);
+		if (query_key != NULL)
+		{
+			/* Get index metadata to check if we have documents */
+			metap = tp_get_metapage(scan->indexRelation);
+			tp_rescan_set_query(scan, query_key, metap);
+			if (metap)
+				pfree(metap);
+		}
 	}
 }
 
@@ -329,46 +511,28 @@ tp_endscan(IndexScanDesc scan)
 }
 
 /*
- * Execute BM25 scoring query to get ordered results
+ * Tokenize query text into a TpVector with the index's configuration
  */
-static bool
-tp_execute_scoring_query(IndexScanDesc scan)
+static TpVector *
+text_to_query_vector(const char *query_text, text *index_name_text)
 {
-	TpScanOpaque	   so = (TpScanOpaque)scan->opaque;
-	TpIndexMetaPage	   metap;
-	bool			   success	   = false;
-	TpLocalIndexState *index_state = NULL;
-	TpVector		  *query_vector;
-
-	if (!so || !so->query_text)
-		return false;
-
-	Assert(so->scan_context != NULL);
+	Datum query_vec_datum = DirectFunctionCall2(
+			to_tpvector,
+			PointerGetDatum(cstring_to_text(query_text)),
+			PointerGetDatum(index_name_text));
 
-	/* Clean up previous results */
-	if (so->result_ctids || so->result_scores)
-	{
-		MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
-
-		if (so->result_ctids)
-		{
-			pfree(so->result_ctids);
-			so->result_ctids = NULL;
-		}
-		if (so->result_scores)
-		{
-			pfree(so->result_scores);
-			so->result_scores = NULL;
-		}
-
-		MemoryContextSwitchTo(oldcontext);
-	}
-
-	so->result_count = 0;
-	so->current_pos	 = 0;
+	return (TpVector *)DatumGetPointer(query_vec_datum);
+}
 
+/*
+ * Take the per-index lock in shared mode and read the metapage under
+ * it.  The caller releases the lock once it has extracted its results.
+ */
+static TpLocalIndexState *
+tp_begin_index_read(IndexScanDesc scan, TpIndexMetaPage *metap)
+{
 	/* Get the index state with posting lists */
-	index_state = tp_get_local_index_state(
+	TpLocalIndexState *index_state = tp_get_local_index_state(
 			RelationGetRelid(scan->indexRelation));
 
 	if (!index_state)
@@ -388,8 +552,8 @@ tp_execute_scoring_query(IndexScanDesc scan)
 	tp_acquire_index_lock(index_state, LW_SHARED);
 
 	/* Now read metapage under the lock */
-	metap = tp_get_metapage(scan->indexRelation);
-	if (!metap)
+	*metap = tp_get_metapage(scan->indexRelation);
+	if (!*metap)
 	{
 		tp_release_index_lock(index_state);
 		ereport(ERROR,
@@ -398,25 +562,148 @@ tp_execute_scoring_query(IndexScanDesc scan)
 						RelationGetRelationName(scan->indexRelation))));
 	}
 
-	/* Use the original query vector or create one from text */
-	query_vector = so->query_vector;
+	return index_state;
+}
+
+/*
+ * Add the expansions of the query's "word*" and "word~N" patterns to
+ * its query vector, and set the scan's term weights: the best few of
+ * each for a ranked scan, every one with all_matches.  Returns a new
+ * vector, or query_vector if none was added.
+ */
+static TpVector *
+expand_query_patterns(
+		IndexScanDesc	   scan,
+		TpIndexMetaPage	   metap,
+		TpLocalIndexState *index_state,
+		TpVector		  *query_vector,
+		List			  *patterns,
+		bool			   all_matches)
+{
+	TpScanOpaque   so		   = (TpScanOpaque)scan->opaque;
+	int			   term_count  = query_vector->entry_count;
+	char		 **terms	   = palloc(Max(term_count, 1) * sizeof(char *));
+	int32		  *frequencies = palloc(Max(term_count, 1) * sizeof(int32));
+	TpVectorEntry *entry	   = get_tpvector_first_entry(query_vector);
+	int			   count;
+
+	for (int i = 0; i < term_count; i++)
+	{
+		TpVectorEntryView v;
+
+		entry		   = tpvector_entry_decode_advance(entry, &v);
+		terms[i]	   = pnstrdup(v.lexeme, v.lexeme_len);
+		frequencies[i] = (int32)v.frequency;
+	}
+
+	count = tp_expand_patterns(
+			index_state,
+			scan->indexRelation,
+			metap->text_config_oid,
+			patterns,
+			all_matches,
+			&terms,
+			&frequencies,
+			&so->term_weights,
+			term_count);
+	if (count == term_count)
+		return query_vector;
+
+	return create_tpvector_from_strings(
+			get_tpvector_index_name(query_vector),
+			count,
+			(const char **)terms,
+			frequencies);
+}
+
+/*
+ * Turn the scan's query text into the query vector, analyzing the
+ * "+word" / "-word" / "phrase" operators into the scan state and
+ * expanding "word*" and "word~N" patterns.  A match (@@) scan expands
+ * each pattern to every term it matches, as the operator itself does;
+ * a ranked scan keeps the prefix_expansions / fuzzy_expansions best.
+ * Called with the per-index lock held; releases it before raising an
+ * error.
+ */
+static TpVector *
+tp_prepare_query(
+		IndexScanDesc	   scan,
+		TpIndexMetaPage	   metap,
+		TpLocalIndexState *index_state,
+		bool			   match)
+{
+	TpScanOpaque so			  = (TpScanOpaque)scan->opaque;
+	TpVector	*query_vector = so->query_vector;
 
 	if (!query_vector && so->query_text)
 	{
 		/*
 		 * We have a text query - convert it to a vector using the index.
+		 * "+word" / "-word" operators are split off first and become
+		 * separate required / excluded vectors; "phrases" are analyzed
+		 * with the index's text config.
 		 */
 		char *index_name = tp_get_qualified_index_name(scan->indexRelation);
 
-		text *index_name_text  = cstring_to_text(index_name);
-		text *query_text_datum = cstring_to_text(so->query_text);
+		text *index_name_text = cstring_to_text(index_name);
+		bool  positions;
+		char *query_text;
+		char *scoring_text;
+		char *required_text;
+		char *excluded_text;
+		List *phrases;
+		List *patterns;
+
+		/* "word*" and "word~N" are expanded once the rest is analyzed */
+		if (!tpquery_split_patterns(so->query_text, &query_text, &patterns))
+			query_text = so->query_text;
+
+		positions = tp_index_has_positions(scan->indexRelation);
+
+		if (tpquery_split_boolean(
+					query_text,
+					positions,
+					&scoring_text,
+					&required_text,
+					&excluded_text,
+					&phrases))
+		{
+			ListCell *lc;
+
+			/* Without positions, a phrase's words are scored on their own */
+			if (phrases != NIL && !positions)
+			{
+				ereport(NOTICE,
+						(errmsg("index \"%s\" stores no positions: phrases "
+								"are matched as separate words",
+								RelationGetRelationName(scan->indexRelation)),
+						 errhint("Recreate the index WITH (positions = true) "
+								 "to match phrases.")));
+				phrases = NIL;
+			}
+
+			query_vector = text_to_query_vector(
+					scoring_text, index_name_text);
+			so->required_vector = text_to_query_vector(
+					required_text, index_name_text);
+			so->excluded_vector = text_to_query_vector(
+					excluded_text, index_name_text);
+
+			foreach (lc, phrases)
+			{
+				TpPhrase *phrase = (TpPhrase *)lfirst(lc);
 
-		Datum query_vec_datum = DirectFunctionCall2(
-				to_tpvector,
-				PointerGetDatum(query_text_datum),
-				PointerGetDatum(index_name_text));
+				tp_phrase_analyze(phrase, metap->text_config_oid);
+				if (phrase->length >= 2)
+					so->phrases = lappend(so->phrases, phrase);
+			}
+		}
+		else
+			query_vector = text_to_query_vector(query_text, index_name_text);
 
-		query_vector = (TpVector *)DatumGetPointer(query_vec_datum);
+		if (patterns != NIL)
+			query_vector = expand_query_patterns(
+					scan, metap, index_state, query_vector, patterns, match);
 
 		/* Free existing query vector if present */
 		if (so->query_vector)
@@ -434,6 +721,52 @@ tp_execute_scoring_query(IndexScanDesc scan)
 				 errmsg("no query vector available in scan state")));
 	}
 
+	return query_vector;
+}
+
+/*
+ * Execute BM25 scoring query to get ordered results
+ */
+static bool
+tp_execute_scoring_query(IndexScanDesc scan)
+{
+	TpScanOpaque	   so = (TpScanOpaque)scan->opaque;
+	TpIndexMetaPage	   metap;
+	bool			   success	   = false;
+	TpLocalIndexState *index_state = NULL;
+	TpVector		  *query_vector;
+
+	if (!so || !so->query_text)
+		return false;
+
+	Assert(so->scan_context != NULL);
+
+	/* Clean up previous results */
+	if (so->result_ctids || so->result_scores)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
+
+		if (so->result_ctids)
+		{
+			pfree(so->result_ctids);
+			so->result_ctids = NULL;
+		}
+		if (so->result_scores)
+		{
+			pfree(so->result_scores);
+			so->result_scores = NULL;
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	so->result_count = 0;
+	so->current_pos	 = 0;
+
+	index_state = tp_begin_index_read(scan, &metap);
+
+	query_vector = tp_prepare_query(scan, metap, index_state, false);
+
 	/* Find documents matching the query using posting lists */
 	success = tp_memtable_search(scan, index_state, query_vector, metap);
 
@@ -444,6 +777,112 @@ tp_execute_scoring_query(IndexScanDesc scan)
 	return success;
 }
 
+/*
+ * Collect every document matching the query of one @@ scan key into
+ * the sink.  Returns the number of CTIDs added.
+ */
+static int64
+tp_execute_match_query(IndexScanDesc scan, ScanKey key, TpMatchSink *sink)
+{
+	TpIndexMetaPage	   metap;
+	TpLocalIndexState *index_state;
+	TpVector		  *query_vector;
+	int64			   ntids;
+
+	tp_rescan_set_query(scan, key, NULL);
+
+	index_state	 = tp_begin_index_read(scan, &metap);
+	query_vector = tp_prepare_query(scan, metap, index_state, true);
+
+	ntids = tp_memtable_match(scan, index_state, query_vector, sink);
+
+	tp_release_index_lock(index_state);
+
+	pfree(metap);
+	return ntids;
+}
+
+/*
+ * Intersect the matches of all @@ scan keys into a sorted CTID array
+ * allocated in the scan context.  Returns the number of CTIDs, and
+ * stops matching keys once the intersection is empty.
+ */
+static int
+tp_collect_key_matches(IndexScanDesc scan, ItemPointer *tids)
+{
+	TpScanOpaque  so		 = (TpScanOpaque)scan->opaque;
+	MemoryContext oldcontext = MemoryContextSwitchTo(so->scan_context);
+	ItemPointer	  result	 = NULL;
+	int			  count		 = 0;
+	int			  i;
+
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		TpMatchSink sink;
+
+		memset(&sink, 0, sizeof(sink));
+		(void)tp_execute_match_query(scan, &scan->keyData[i], &sink);
+		sink.ntids = tp_tids_sort_unique(sink.tids, sink.ntids);
+
+		if (i == 0)
+		{
+			result = sink.tids;
+			count  = sink.ntids;
+		}
+		else
+		{
+			count = tp_tids_intersect(result, count, sink.tids, sink.ntids);
+			if (sink.tids)
+				pfree(sink.tids);
+		}
+
+		if (count == 0)
+			break;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	*tids = result;
+	return count;
+}
+
+/*
+ * Get all matching tuples as a bitmap.  Several @@ keys on the index
+ * are intersected.
+ */
+int64
+tp_getbitmap(IndexScanDesc scan, TIDBitmap *tbm)
+{
+	int64		ntids = 0;
+	TpMatchSink sink;
+	int			i;
+
+	Assert(scan->opaque != NULL);
+
+	/* Count index scan for pg_stat_user_indexes */
+	pgstat_count_index_scan(scan->indexRelation);
+#if PG_VERSION_NUM >= 180000
+	if (scan->instrument)
+		scan->instrument->nsearches++;
+#endif
+
+	memset(&sink, 0, sizeof(sink));
+
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		sink.tbm = (i == 0) ? tbm : tbm_create(work_mem * 1024L, NULL);
+
+		ntids += tp_execute_match_query(scan, &scan->keyData[i], &sink);
+
+		if (i > 0)
+		{
+			tbm_intersect(tbm, sink.tbm);
+			tbm_free(sink.tbm);
+		}
+	}
+
+	return ntids;
+}
+
 /*
  * Get next tuple from scan
  */
@@ -470,7 +909,56 @@ tp_gettuple(IndexScanDesc scan, ScanDirection dir)
 			scan->instrument->nsearches++;
 #endif
 
-		if (!tp_execute_scoring_query(scan))
+		/*
+		 * The @@ keys are matched exactly, all of them intersected.
+		 * Without an ORDER BY that is the result, unranked and
+		 * unbounded by the top-k limit.  With one, only documents in
+		 * the set may enter the top-k, so a selective filter is
+		 * answered by one scoring pass instead of re-scoring with a
+		 * doubled limit until enough rows survive the filter.
+		 */
+		if (scan->numberOfKeys > 0)
+		{
+			ItemPointer tids  = NULL;
+			int			count = 0;
+
+			/*
+			 * Unranked matches are not partitioned: in a parallel scan
+			 * the first participant returns them all and the others
+			 * none.  Ranking participants each need the whole set.
+			 */
+			if (scan->numberOfOrderBys > 0 || so->parallel == NULL ||
+				tp_parallel_scan_claim_snapshot(so->parallel))
+				count = tp_collect_key_matches(scan, &tids);
+
+			if (count == 0)
+			{
+				if (tids)
+					pfree(tids);
+				so->eof_reached = true;
+				return false;
+			}
+
+			if (scan->numberOfOrderBys == 0)
+			{
+				so->result_ctids	 = tids;
+				so->result_count	 = count;
+				so->current_pos		 = 0;
+				so->max_results_used = TP_MAX_QUERY_LIMIT;
+			}
+			else
+			{
+				so->allowed_tids  = tids;
+				so->allowed_count = count;
+				tp_rescan_set_query(
+						scan,
+						tp_ranking_key(
+								scan->orderByData, scan->numberOfOrderBys),
+						NULL);
+			}
+		}
+
+		if (scan->numberOfOrderBys > 0 && !tp_execute_scoring_query(scan))
 		{
 			so->eof_reached = true;
 			return false;
@@ -490,12 +978,24 @@ tp_gettuple(IndexScanDesc scan, ScanDirection dir)
 		{
 			/*
 			 * If result_count hit the internal limit, there may be
-			 * more documents.  Double the limit and re-execute the
-			 * scoring query.
+			 * more documents.  A serial ranked scan resumes below the
+			 * batch it has returned, with a doubled batch size, so no
+			 * document is scored into the top-k twice.  A parallel
+			 * scan's participants claim different segments on every
+			 * pass, so it re-executes with a doubled limit instead.
+			 *
+			 * A batch cut short by the threshold shared across
+			 * partitions has only deferred the documents below it, so
+			 * it is resumed as well.
 			 */
+			bool resumable = so->parallel == NULL && so->cursor != NULL;
+			bool pruned	   = so->partition != NULL &&
+						  so->partition->threshold_used;
+
 			if (!so->eof_reached && so->result_count > 0 &&
-				so->result_count >= so->max_results_used &&
-				so->max_results_used < TP_MAX_QUERY_LIMIT)
+				(so->result_count >= so->max_results_used ||
+				 (resumable && pruned)) &&
+				(resumable || so->max_results_used < TP_MAX_QUERY_LIMIT))
 			{
 				int old_count = so->result_count;
 				int new_limit = so->max_results_used * 2;
@@ -504,8 +1004,24 @@ tp_gettuple(IndexScanDesc scan, ScanDirection dir)
 					new_limit = TP_MAX_QUERY_LIMIT;
 
 				so->limit = new_limit;
-				if (tp_execute_scoring_query(scan) &&
-					so->result_count > old_count)
+				elog(tp_log_bmw_stats ? NOTICE : DEBUG1,
+					 "BM25 index scan: next batch of up to %d results",
+					 new_limit);
+				if (resumable)
+				{
+					tp_score_cursor_advance(
+							so->cursor,
+							so->result_ctids,
+							so->result_scores,
+							so->result_count);
+					if (tp_execute_scoring_query(scan))
+					{
+						so->current_pos = 0;
+						continue;
+					}
+				}
+				else if (tp_execute_scoring_query(scan) &&
+						 so->result_count > old_count)
 				{
 					/*
 					 * Re-scoring can reorder concurrent results, so
@@ -514,11 +1030,8 @@ tp_gettuple(IndexScanDesc scan, ScanDirection dir)
 					so->current_pos = 0;
 					continue;
 				}
-				else
-				{
-					so->eof_reached = true;
-					return false;
-				}
+				so->eof_reached = true;
+				return false;
 			}
 			else
 				return false;
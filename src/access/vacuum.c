@@ -35,6 +35,8 @@
 #include "index/metapage.h"
 #include "index/state.h"
 #include "memtable/page.h"
+#include "scoring/doc_freq_cache.h"
+#include "scoring/result_cache.h"
 #include "segment/alive_bitset.h"
 #include "segment/io.h"
 #include "segment/merge.h"
@@ -451,6 +453,7 @@ tp_vacuum_rebuild_segment(
 {
 	TpSegmentReader *reader;
 	TpBuildContext	*build_ctx;
+	TpImpactParams	 impacts;
 	BlockNumber		 new_root;
 	Oid				 text_config_oid;
 	IndexInfo		*indexInfo;
@@ -496,7 +499,9 @@ tp_vacuum_rebuild_segment(
 				ExecPrepareQual(indexInfo->ii_Predicate, estate);
 
 	/* Create build context (no budget limit for VACUUM rebuild) */
-	build_ctx = tp_build_context_create(0);
+	tp_index_impact_params(index, &impacts);
+	build_ctx = tp_build_context_create(
+			0, tp_index_has_positions(index), &impacts);
 
 	per_doc_ctx = AllocSetContextCreate(
 			CurrentMemoryContext,
@@ -514,6 +519,7 @@ tp_vacuum_rebuild_segment(
 		text		   *document_text;
 		char		  **terms;
 		int32		   *frequencies;
+		uint32		  **positions = NULL;
 		int				term_count;
 		int				doc_length;
 
@@ -563,24 +569,40 @@ tp_vacuum_rebuild_segment(
 
 		document_text = DatumGetTextPP(idx_values[0]);
 
-		doc_length = tp_tokenize_text(
-				document_text,
-				text_config_oid,
-				&terms,
-				&frequencies,
-				&term_count);
+		if (build_ctx->store_positions)
+			doc_length = tp_tokenize_text_with_positions(
+					document_text,
+					text_config_oid,
+					&terms,
+					&frequencies,
+					&positions,
+					&term_count);
+		else
+			doc_length = tp_tokenize_text(
+					document_text,
+					text_config_oid,
+					&terms,
+					&frequencies,
+					&term_count);
 
 		MemoryContextSwitchTo(old_ctx);
 
 		if (term_count > 0)
 		{
-			tp_build_context_add_document(
+			uint32 doc_id = tp_build_context_add_document(
 					build_ctx,
 					terms,
 					frequencies,
+					positions,
 					term_count,
 					doc_length,
 					&ctid);
+
+			if (tp_index_has_prior(index))
+				tp_build_context_set_prior(
+						build_ctx,
+						doc_id,
+						tp_index_prior_value(index, idx_values, idx_isnull));
 			docs_added++;
 			len_added += doc_length;
 		}
@@ -733,12 +755,12 @@ tp_vacuum_replace_segment(
 			/*
 			 * The previous segment may still be on an older on-disk
 			 * format.  V3 uses uint32 offsets and places next_segment
-			 * at byte 28; V4/V5 use uint64 offsets with 4 bytes of
+			 * at byte 28; V4+ use uint64 offsets with 4 bytes of
 			 * padding before data_size, placing next_segment at byte
 			 * 36.  Write at the offset matching the on-disk version
 			 * so we don't clobber adjacent fields.  magic/version
 			 * live at the same bytes in every version, so reading
-			 * version via the V5 struct is safe.
+			 * version via the current struct is safe.
 			 */
 			prev_content = PageGetContents(prev_page);
 			prev_version = ((TpSegmentHeader *)prev_content)->version;
@@ -1058,6 +1080,18 @@ tp_bulkdelete(
 				info->index, docs_shrinkage, tokens_shrinkage);
 	}
 
+	/*
+	 * Cached query results may include the docs just marked dead.
+	 * Bump the epoch before dropping the lock so a scan that captured
+	 * the old version cannot store a stale entry afterwards.  Cached
+	 * doc_freqs of rebuilt or dropped segments are already stale by
+	 * generation; dropping them just frees the memory early.
+	 */
+	if (index_state != NULL)
+		pg_atomic_fetch_add_u64(&index_state->shared->result_cache_epoch, 1);
+	tp_result_cache_invalidate_index(RelationGetRelid(info->index));
+	tp_doc_freq_cache_invalidate_index(RelationGetRelid(info->index));
+
 	/* Identify + mark complete; drop the shared lock. */
 	if (index_state != NULL)
 		tp_release_index_lock(index_state);
@@ -128,6 +128,7 @@
 #define TP_HIGH_STARTUP_COST		 1000000.0
 #define TP_INDEX_SCAN_COST_FACTOR	 0.1
 #define TP_DEFAULT_INDEX_SELECTIVITY 0.1
+#define TP_DEFAULT_MATCH_SELECTIVITY 0.005 /* @@ without doc_freq */
 #define TP_DEFAULT_INDEX_PAGES		 1000.0
 
 /*
@@ -171,6 +172,21 @@
  */
 #define TP_TRANCHE_EVICTION_MUTEX 1012
 
+/*
+ * Shared query result cache (scoring/result_cache.c): the dshash
+ * partition locks, and the control lock that serializes table
+ * creation and LRU eviction.
+ */
+#define TP_TRANCHE_RESULT_CACHE		 1013
+#define TP_TRANCHE_RESULT_CACHE_LOCK 1014
+
+/*
+ * Shared segment doc_freq cache (scoring/doc_freq_cache.c), laid out
+ * like the result cache's.
+ */
+#define TP_TRANCHE_DOC_FREQ_CACHE	   1015
+#define TP_TRANCHE_DOC_FREQ_CACHE_LOCK 1016
+
 /*
  * Global GUC variables declared in mod.c
  * Note: tp_relopt_kind is declared in index.c as it requires
@@ -23,8 +23,10 @@ tp_alloc_posting_data(int32 capacity)
 	data->ctids = (ItemPointerData *)palloc(
 			capacity * sizeof(ItemPointerData));
 	data->frequencies = (int32 *)palloc(capacity * sizeof(int32));
-	data->count		  = 0;
-	data->doc_freq	  = 0;
+	data->count			  = 0;
+	data->doc_freq		  = 0;
+	data->positions		  = NULL;
+	data->position_starts = NULL;
 
 	return data;
 }
@@ -41,6 +43,10 @@ tp_free_posting_data(TpPostingData *data)
 			pfree(data->ctids);
 		if (data->frequencies)
 			pfree(data->frequencies);
+		if (data->positions)
+			pfree(data->positions);
+		if (data->position_starts)
+			pfree(data->position_starts);
 		pfree(data);
 	}
 }
@@ -16,13 +16,20 @@
 /*
  * Columnar posting data for a term.
  * Arrays are parallel - ctids[i] corresponds to frequencies[i].
+ *
+ * Sources that have token positions for every posting also fill
+ * positions/position_starts: entry i's positions are
+ * positions[position_starts[i] .. position_starts[i + 1]).  Both are
+ * NULL otherwise.
  */
 typedef struct TpPostingData
 {
-	ItemPointerData *ctids;		  /* Array of document CTIDs */
-	int32			*frequencies; /* Array of term frequencies */
-	int32			 count;		  /* Number of entries */
-	int32			 doc_freq;	  /* Document frequency (for IDF) */
+	ItemPointerData *ctids;			  /* Array of document CTIDs */
+	int32			*frequencies;	  /* Array of term frequencies */
+	int32			 count;			  /* Number of entries */
+	int32			 doc_freq;		  /* Document frequency (for IDF) */
+	uint32			*positions;		  /* Concatenated positions, or NULL */
+	uint32			*position_starts; /* count + 1 offsets, or NULL */
 } TpPostingData;
 
 /*
@@ -31,6 +38,9 @@ typedef struct TpPostingData
  */
 typedef struct TpDataSource TpDataSource;
 
+/* Called with each term of a dictionary range and its doc_freq */
+typedef void (*TpTermCallback)(const char *term, uint32 doc_freq, void *arg);
+
 typedef struct TpDataSourceOps
 {
 	/*
@@ -51,6 +61,12 @@ typedef struct TpDataSourceOps
 	 */
 	int32 (*get_doc_length)(TpDataSource *source, ItemPointer ctid);
 
+	/*
+	 * Get the static prior for a CTID (see segment/prior.h).
+	 * Optional; returns 0 if not found or the source has none.
+	 */
+	float4 (*get_doc_prior)(TpDataSource *source, ItemPointer ctid);
+
 	/*
 	 * Get the per-term document frequency without materializing
 	 * the posting list.  Returns 0 if the term is unknown.
@@ -60,6 +76,17 @@ typedef struct TpDataSourceOps
 	 */
 	uint32 (*get_doc_freq)(TpDataSource *source, const char *term);
 
+	/*
+	 * Call fn for every term starting with prefix that some document
+	 * contains, in no particular order.  Optional.  A source created
+	 * for a list of query terms knows only those.
+	 */
+	void (*foreach_prefix)(
+			TpDataSource  *source,
+			const char	  *prefix,
+			TpTermCallback fn,
+			void		  *arg);
+
 	/*
 	 * Close and free the data source.
 	 */
@@ -82,8 +109,17 @@ struct TpDataSource
 	((src)->ops->free_postings((src), (data)))
 #define tp_source_get_doc_length(src, ctid) \
 	((src)->ops->get_doc_length((src), (ctid)))
+#define tp_source_get_doc_prior(src, ctid)                                \
+	((src)->ops->get_doc_prior ? (src)->ops->get_doc_prior((src), (ctid)) \
+							   : 0.0f)
 #define tp_source_get_doc_freq(src, term) \
 	((src)->ops->get_doc_freq((src), (term)))
+#define tp_source_foreach_prefix(src, prefix, fn, arg)                \
+	do                                                                \
+	{                                                                 \
+		if ((src)->ops->foreach_prefix)                               \
+			(src)->ops->foreach_prefix((src), (prefix), (fn), (arg)); \
+	} while (0)
 #define tp_source_close(src) ((src)->ops->close((src)))
 
 /*
@@ -367,6 +367,7 @@ tp_create_shared_index_state(Oid index_oid, Oid heap_oid, bool reuse_if_exists)
 	 */
 	LWLockInitialize(&shared_state->lock, TP_TRANCHE_INDEX_LOCK);
 	pg_atomic_init_u64(&shared_state->spill_generation, 0);
+	pg_atomic_init_u64(&shared_state->result_cache_epoch, 0);
 	memtable_dp = dsa_allocate(dsa, sizeof(TpMemtable));
 	if (!DsaPointerIsValid(memtable_dp))
 		elog(ERROR, "Failed to allocate memtable in DSA");
@@ -518,6 +519,7 @@ tp_create_build_index_state(Oid index_oid, Oid heap_oid)
 	 */
 	LWLockInitialize(&shared_state->lock, TP_TRANCHE_INDEX_LOCK);
 	pg_atomic_init_u64(&shared_state->spill_generation, 0);
+	pg_atomic_init_u64(&shared_state->result_cache_epoch, 0);
 
 	/* Check if index already registered (rebuild case) */
 	if (tp_registry_lookup(index_oid) != NULL)
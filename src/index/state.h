@@ -199,6 +199,14 @@ typedef struct TpSharedIndexState
 	 * generation tracking is sufficient.
 	 */
 	pg_atomic_uint64 spill_generation;
+
+	/*
+	 * Bumped by VACUUM after it marks dead docs in segments.  Those
+	 * in-place alive-bitset writes leave the metapage and memtable
+	 * untouched, so the query result cache needs this extra token
+	 * (see scoring/result_cache.h).
+	 */
+	pg_atomic_uint64 result_cache_epoch;
 } TpSharedIndexState;
 
 /*
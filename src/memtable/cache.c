@@ -434,6 +434,7 @@ typedef struct DecodedDoc
 	char **terms;		/* term_count entries, NUL-terminated */
 	int32 *frequencies; /* term_count entries */
 	int	   term_count;
+	float4 prior;		   /* static prior, 0 if the record has none */
 	uint64 estimated_size; /* upper bound to charge to estimated_bytes */
 } DecodedDoc;
 
@@ -477,6 +478,7 @@ decode_record(const char *vector_bytes, uint32 vector_len, DecodedDoc *out)
 		out->terms			= NULL;
 		out->frequencies	= NULL;
 		out->term_count		= 0;
+		out->prior			= 0.0f;
 		out->estimated_size = sizeof(TpDocLengthEntry);
 		return;
 	}
@@ -485,6 +487,7 @@ decode_record(const char *vector_bytes, uint32 vector_len, DecodedDoc *out)
 	n	= vec->entry_count;
 
 	out->term_count	 = n;
+	out->prior		 = tpvector_get_prior(vec);
 	out->terms		 = (n > 0) ? palloc(sizeof(char *) * n) : NULL;
 	out->frequencies = (n > 0) ? palloc(sizeof(int32) * n) : NULL;
 
@@ -561,7 +564,8 @@ apply_one_record(
 			doc->terms,
 			doc->frequencies,
 			doc->term_count,
-			doc_length);
+			doc_length,
+			doc->prior);
 
 	account_bytes_add(memtable, doc->estimated_size);
 	return true;
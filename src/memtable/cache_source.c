@@ -147,6 +147,14 @@ cache_get_doc_length(TpDataSource *source, ItemPointer ctid)
 	return tp_get_document_length_attached(cs->doclength_table, ctid);
 }
 
+static float4
+cache_get_doc_prior(TpDataSource *source, ItemPointer ctid)
+{
+	TpMemtableCacheSource *cs = (TpMemtableCacheSource *)source;
+
+	return tp_get_document_prior_attached(cs->doclength_table, ctid);
+}
+
 static uint32
 cache_get_doc_freq(TpDataSource *source, const char *term)
 {
@@ -176,6 +184,48 @@ cache_get_doc_freq(TpDataSource *source, const char *term)
 	return doc_freq;
 }
 
+/*
+ * Walk the whole string table: the cache holds every memtable term.
+ * The callback runs under a dshash partition lock and must not touch
+ * the table.
+ */
+static void
+cache_foreach_prefix(
+		TpDataSource  *source,
+		const char	  *prefix,
+		TpTermCallback fn,
+		void		  *arg)
+{
+	TpMemtableCacheSource *cs		  = (TpMemtableCacheSource *)source;
+	size_t				   prefix_len = strlen(prefix);
+	dshash_seq_status	   seq;
+	TpStringHashEntry	  *entry;
+
+	dshash_seq_init(&seq, cs->string_table, false);
+	while ((entry = (TpStringHashEntry *)dshash_seq_next(&seq)) != NULL)
+	{
+		const char	  *term;
+		TpPostingList *posting_list;
+		uint32		   doc_freq;
+
+		if (!DsaPointerIsValid(entry->key.posting_list))
+			continue;
+		term = tp_get_key_str(cs->state->dsa, &entry->key);
+		if (strncmp(term, prefix, prefix_len) != 0)
+			continue;
+
+		posting_list = (TpPostingList *)
+				dsa_get_address(cs->state->dsa, entry->key.posting_list);
+		LWLockAcquire(&posting_list->lock, LW_SHARED);
+		doc_freq = (uint32)posting_list->doc_freq;
+		LWLockRelease(&posting_list->lock);
+
+		if (doc_freq > 0)
+			fn(term, doc_freq, arg);
+	}
+	dshash_seq_term(&seq);
+}
+
 static void
 cache_close(TpDataSource *source)
 {
@@ -212,7 +262,9 @@ static const TpDataSourceOps cache_source_ops = {
 		.get_postings	= cache_get_postings,
 		.free_postings	= cache_free_postings,
 		.get_doc_length = cache_get_doc_length,
+		.get_doc_prior	= cache_get_doc_prior,
 		.get_doc_freq	= cache_get_doc_freq,
+		.foreach_prefix = cache_foreach_prefix,
 		.close			= cache_close,
 };
 
@@ -31,6 +31,7 @@
 #include <utils/rel.h>
 #include <utils/relcache.h>
 
+#include "access/am.h"
 #include "constants.h"
 #include "index/metapage.h"
 #include "index/resolve.h"
@@ -46,20 +47,31 @@
  * NUL-terminated lexeme C string copied into the source memory
  * context; the value carries parallel (ctid, freq) arrays plus
  * the rolling doc_freq.  Arrays grow geometrically.
+ *
+ * For indexes WITH (positions = true) the entry also pools every
+ * posting's token positions; position_starts[i] is where posting
+ * i's run begins (count + 1 slots).  A record written without
+ * positions (e.g. before the option was turned on) sets
+ * positions_missing and the term then reports none.
  */
 typedef struct ChainTermEntry
 {
-	const char		*term;		  /* hash key; pointer into source mcxt */
-	ItemPointerData *ctids;		  /* count slots; in source mcxt */
-	int32			*frequencies; /* count slots; in source mcxt */
-	int32			 count;		  /* records in this term */
-	int32			 capacity;	  /* allocated array capacity */
-	int32			 doc_freq;	  /* documents containing the term */
+	const char		*term;			  /* hash key; pointer into source mcxt */
+	ItemPointerData *ctids;			  /* count slots; in source mcxt */
+	int32			*frequencies;	  /* count slots; in source mcxt */
+	int32			 count;			  /* records in this term */
+	int32			 capacity;		  /* allocated array capacity */
+	int32			 doc_freq;		  /* documents containing the term */
+	uint32			*positions;		  /* pooled positions; in source mcxt */
+	uint32			*position_starts; /* capacity + 1 slots */
+	uint32			 positions_len;
+	uint32			 positions_cap;
+	bool			 positions_missing;
 } ChainTermEntry;
 
 /*
  * One row in the per-ctid doc-length hash table.  Keyed by raw
- * ItemPointerData (HASH_BLOBS).  Records (ctid → doc_length);
+ * ItemPointerData (HASH_BLOBS).  Records (ctid → doc_length, prior);
  * duplicate ctids are an invariant violation (each heap tuple
  * writes exactly one chain record) and we surface them as
  * DATA_CORRUPTED at open time.
@@ -68,6 +80,7 @@ typedef struct ChainDocLenEntry
 {
 	ItemPointerData ctid;
 	int32			doc_length;
+	float4			prior; /* Static prior, 0 if the record has none */
 } ChainDocLenEntry;
 
 typedef struct TpMemtableChainSource
@@ -94,6 +107,13 @@ typedef struct TpMemtableChainSource
 									* LWLock on (NULL if the lock was
 									* already held by an outer caller
 									* before this source was created). */
+	bool	want_positions;		   /* index stores positions: pool
+									* them per term during the walk */
+	bool	has_priors;			   /* some record carried a static
+									* prior (index with an INCLUDE
+									* column) */
+	uint32 *position_buf;		   /* one record's decoded positions */
+	uint32	position_buf_cap;
 } TpMemtableChainSource;
 
 /* ---------- hash helpers ---------- */
@@ -170,12 +190,17 @@ lookup_or_create_term(
 		memcpy(copy, term, term_len);
 		copy[term_len] = '\0';
 
-		entry->term		   = copy; /* overwrites the HTAB key slot */
-		entry->ctids	   = NULL;
-		entry->frequencies = NULL;
-		entry->count	   = 0;
-		entry->capacity	   = 0;
-		entry->doc_freq	   = 0;
+		entry->term				 = copy; /* overwrites the HTAB key slot */
+		entry->ctids			 = NULL;
+		entry->frequencies		 = NULL;
+		entry->count			 = 0;
+		entry->capacity			 = 0;
+		entry->doc_freq			 = 0;
+		entry->positions		 = NULL;
+		entry->position_starts	 = NULL;
+		entry->positions_len	 = 0;
+		entry->positions_cap	 = 0;
+		entry->positions_missing = false;
 
 		MemoryContextSwitchTo(old);
 	}
@@ -183,12 +208,18 @@ lookup_or_create_term(
 	return entry;
 }
 
+/*
+ * positions is NULL if the record carried none; only consulted when
+ * the source pools positions.
+ */
 static void
 term_entry_append(
 		TpMemtableChainSource *src,
 		ChainTermEntry		  *entry,
 		ItemPointer			   ctid,
-		int32				   frequency)
+		int32				   frequency,
+		const uint32		  *positions,
+		uint32				   npositions)
 {
 	if (entry->count == entry->capacity)
 	{
@@ -199,6 +230,12 @@ term_entry_append(
 		{
 			entry->ctids	   = palloc(new_cap * sizeof(ItemPointerData));
 			entry->frequencies = palloc(new_cap * sizeof(int32));
+			if (src->want_positions)
+			{
+				entry->position_starts =
+						palloc((new_cap + 1) * sizeof(uint32));
+				entry->position_starts[0] = 0;
+			}
 		}
 		else
 		{
@@ -206,27 +243,77 @@ term_entry_append(
 					repalloc(entry->ctids, new_cap * sizeof(ItemPointerData));
 			entry->frequencies =
 					repalloc(entry->frequencies, new_cap * sizeof(int32));
+			if (entry->position_starts != NULL)
+				entry->position_starts =
+						repalloc(entry->position_starts,
+								 (new_cap + 1) * sizeof(uint32));
 		}
 		entry->capacity = new_cap;
 		MemoryContextSwitchTo(old);
 	}
 
+	if (src->want_positions && !entry->positions_missing)
+	{
+		if (positions == NULL)
+			entry->positions_missing = true;
+		else
+		{
+			if (entry->positions_len + npositions > entry->positions_cap)
+			{
+				MemoryContext old = MemoryContextSwitchTo(src->mcxt);
+				uint32		  new_cap = Max(entry->positions_cap * 2, 16);
+
+				while (new_cap < entry->positions_len + npositions)
+					new_cap *= 2;
+				if (entry->positions == NULL)
+					entry->positions = palloc(new_cap * sizeof(uint32));
+				else
+					entry->positions = repalloc(
+							entry->positions, new_cap * sizeof(uint32));
+				entry->positions_cap = new_cap;
+				MemoryContextSwitchTo(old);
+			}
+			memcpy(entry->positions + entry->positions_len,
+				   positions,
+				   npositions * sizeof(uint32));
+			entry->positions_len += npositions;
+			entry->position_starts[entry->count + 1] = entry->positions_len;
+		}
+	}
+
 	entry->ctids[entry->count]		 = *ctid;
 	entry->frequencies[entry->count] = frequency;
 	entry->count++;
 	entry->doc_freq++;
 }
 
+/*
+ * Does the entry have positions for every posting?
+ */
+static inline bool
+term_entry_has_positions(
+		const TpMemtableChainSource *src, const ChainTermEntry *entry)
+{
+	return src->want_positions && !entry->positions_missing &&
+		   entry->count > 0;
+}
+
 /* ---------- record ingestion ---------- */
 
 /*
- * Record one (ctid → doc_length) row in the source's
- * doc-length HTAB.  Duplicate ctids in the chain would indicate
- * a corrupt write (each heap tuple writes exactly one chain
- * record); ereport on collision.
+ * Record one (ctid → doc_length, prior) row in the source's
+ * doc-length HTAB.  The prior is read from the record's vector
+ * (TPVECTOR_FLAG_PRIOR).  Duplicate ctids in the chain would
+ * indicate a corrupt write (each heap tuple writes exactly one
+ * chain record); ereport on collision.
  */
 static void
-ingest_doclen(TpMemtableChainSource *src, ItemPointer ctid, int32 doc_length)
+ingest_doclen(
+		TpMemtableChainSource *src,
+		ItemPointer			   ctid,
+		int32				   doc_length,
+		const char			  *vector_bytes,
+		uint32				   vector_len)
 {
 	bool			  found;
 	ChainDocLenEntry *dle;
@@ -240,6 +327,13 @@ ingest_doclen(TpMemtableChainSource *src, ItemPointer ctid, int32 doc_length)
 						ItemPointerGetBlockNumber(ctid),
 						ItemPointerGetOffsetNumber(ctid))));
 	dle->doc_length = doc_length;
+	dle->prior		= 0.0f;
+	if (vector_len > 0 &&
+		(((const TpVector *)vector_bytes)->flags & TPVECTOR_FLAG_PRIOR) != 0)
+	{
+		dle->prior		= tpvector_get_prior((TpVector *)vector_bytes);
+		src->has_priors = true;
+	}
 }
 
 /*
@@ -256,6 +350,8 @@ ingest_terms(
 {
 	TpVector	  *vec;
 	TpVectorEntry *entry;
+	const uint8	  *pos_cursor = NULL;
+	const uint8	  *pos_end	  = NULL;
 
 	if (vector_len == 0)
 		return;
@@ -275,6 +371,13 @@ ingest_terms(
 #endif
 	vec = (TpVector *)vector_bytes;
 
+	/* The positions section is decoded in lockstep with the entries */
+	if (src->want_positions)
+	{
+		pos_cursor = tpvector_positions_start(vec);
+		pos_end	   = (const uint8 *)vector_bytes + vector_len;
+	}
+
 	entry = get_tpvector_first_entry(vec);
 	for (int i = 0; i < vec->entry_count; i++)
 	{
@@ -282,6 +385,7 @@ ingest_terms(
 		ChainTermEntry	 *te;
 		char			  stackbuf[256];
 		char			 *term_cstr;
+		uint32			  npositions = 0;
 
 		/*
 		 * Decode-and-advance in a single pass: returns the next
@@ -295,6 +399,23 @@ ingest_terms(
 		 */
 		entry = tpvector_entry_decode_advance(entry, &v);
 
+		if (pos_cursor != NULL)
+		{
+			if (v.frequency > src->position_buf_cap)
+			{
+				MemoryContext old = MemoryContextSwitchTo(src->mcxt);
+
+				if (src->position_buf != NULL)
+					pfree(src->position_buf);
+				src->position_buf_cap = Max(v.frequency, 64);
+				src->position_buf =
+						palloc(src->position_buf_cap * sizeof(uint32));
+				MemoryContextSwitchTo(old);
+			}
+			npositions = tpvector_positions_decode_advance(
+					&pos_cursor, pos_end, src->position_buf, v.frequency);
+		}
+
 		/*
 		 * Stack-allocate the lookup key for short lexemes
 		 * (the common case in English / European text after
@@ -312,7 +433,13 @@ ingest_terms(
 
 		te = lookup_or_create_term(src, term_cstr, (int)v.lexeme_len);
 		if (te != NULL)
-			term_entry_append(src, te, ctid, (int32)v.frequency);
+			term_entry_append(
+					src,
+					te,
+					ctid,
+					(int32)v.frequency,
+					pos_cursor != NULL ? src->position_buf : NULL,
+					npositions);
 
 		if (term_cstr != stackbuf)
 			pfree(term_cstr);
@@ -343,7 +470,12 @@ walk_chain(TpMemtableChainSource *src, Relation rel)
 
 	while (tp_chain_walker_next(walker, &rec))
 	{
-		ingest_doclen(src, &rec.ctid, rec.doc_length);
+		ingest_doclen(
+				src,
+				&rec.ctid,
+				rec.doc_length,
+				rec.vector_bytes,
+				rec.vector_len);
 		ingest_terms(src, &rec.ctid, rec.vector_bytes, rec.vector_len);
 
 		/*
@@ -386,6 +518,18 @@ chain_get_postings(TpDataSource *source, const char *term)
 	memcpy(data->frequencies,
 		   entry->frequencies,
 		   entry->count * sizeof(int32));
+	if (term_entry_has_positions(src, entry))
+	{
+		data->positions = palloc(Max(entry->positions_len, 1) *
+								 sizeof(uint32));
+		memcpy(data->positions,
+			   entry->positions,
+			   entry->positions_len * sizeof(uint32));
+		data->position_starts = palloc((entry->count + 1) * sizeof(uint32));
+		memcpy(data->position_starts,
+			   entry->position_starts,
+			   (entry->count + 1) * sizeof(uint32));
+	}
 	return data;
 }
 
@@ -410,6 +554,20 @@ chain_get_doc_length(TpDataSource *source, ItemPointer ctid)
 	return dle->doc_length;
 }
 
+static float4
+chain_get_doc_prior(TpDataSource *source, ItemPointer ctid)
+{
+	TpMemtableChainSource *src = (TpMemtableChainSource *)source;
+	ChainDocLenEntry	  *dle;
+	bool				   found;
+
+	dle = (ChainDocLenEntry *)
+			hash_search(src->doclen_ht, ctid, HASH_FIND, &found);
+	if (!found)
+		return 0.0f;
+	return dle->prior;
+}
+
 static uint32
 chain_get_doc_freq(TpDataSource *source, const char *term)
 {
@@ -429,6 +587,27 @@ chain_get_doc_freq(TpDataSource *source, const char *term)
 	return (uint32)entry->doc_freq;
 }
 
+static void
+chain_foreach_prefix(
+		TpDataSource  *source,
+		const char	  *prefix,
+		TpTermCallback fn,
+		void		  *arg)
+{
+	TpMemtableChainSource *src		  = (TpMemtableChainSource *)source;
+	size_t				   prefix_len = strlen(prefix);
+	HASH_SEQ_STATUS		   seq;
+	ChainTermEntry		  *entry;
+
+	hash_seq_init(&seq, src->term_ht);
+	while ((entry = (ChainTermEntry *)hash_seq_search(&seq)) != NULL)
+	{
+		if (entry->doc_freq > 0 &&
+			strncmp(entry->term, prefix, prefix_len) == 0)
+			fn(entry->term, (uint32)entry->doc_freq, arg);
+	}
+}
+
 static void
 chain_close(TpDataSource *source)
 {
@@ -445,7 +624,9 @@ static const TpDataSourceOps chain_source_ops = {
 		.get_postings	= chain_get_postings,
 		.free_postings	= chain_free_postings,
 		.get_doc_length = chain_get_doc_length,
+		.get_doc_prior	= chain_get_doc_prior,
 		.get_doc_freq	= chain_get_doc_freq,
+		.foreach_prefix = chain_foreach_prefix,
 		.close			= chain_close,
 };
 
@@ -549,6 +730,7 @@ tp_memtable_chain_source_create(
 	src->base.ops	  = &chain_source_ops;
 	src->lock_state	  = lock_state_to_release;
 	src->filter_terms = (query_term_count > 0);
+	src->want_positions = tp_index_has_positions(rel);
 
 	{
 		MemoryContext old = MemoryContextSwitchTo(mcxt);
@@ -633,12 +815,17 @@ tp_memtable_chain_source_create(
 			src->filter_terms = true;
 			if (!found)
 			{
-				entry->term		   = copy;
-				entry->ctids	   = NULL;
-				entry->frequencies = NULL;
-				entry->count	   = 0;
-				entry->capacity	   = 0;
-				entry->doc_freq	   = 0;
+				entry->term				 = copy;
+				entry->ctids			 = NULL;
+				entry->frequencies		 = NULL;
+				entry->count			 = 0;
+				entry->capacity			 = 0;
+				entry->doc_freq			 = 0;
+				entry->positions		 = NULL;
+				entry->position_starts	 = NULL;
+				entry->positions_len	 = 0;
+				entry->positions_cap	 = 0;
+				entry->positions_missing = false;
 			}
 			else
 			{
@@ -746,7 +933,11 @@ tp_memtable_chain_source_extract(
 	docmap = tp_docmap_create();
 	hash_seq_init(&seq, src->doclen_ht);
 	while ((dle = (ChainDocLenEntry *)hash_seq_search(&seq)) != NULL)
+	{
 		tp_docmap_add(docmap, &dle->ctid, (uint32)dle->doc_length);
+		if (src->has_priors)
+			tp_docmap_set_prior(docmap, &dle->ctid, dle->prior);
+	}
 	tp_docmap_finalize(docmap);
 
 	/* Materialize the term dictionary. */
@@ -782,6 +973,20 @@ tp_memtable_chain_source_extract(
 			memcpy(terms[i].freqs, te->frequencies, c * sizeof(int32));
 		}
 
+		if (term_entry_has_positions(src, te))
+		{
+			terms[i].positions =
+					(uint32 *)palloc(Max(te->positions_len, 1) * sizeof(uint32));
+			memcpy(terms[i].positions,
+				   te->positions,
+				   te->positions_len * sizeof(uint32));
+			terms[i].position_starts =
+					(uint32 *)palloc((c + 1) * sizeof(uint32));
+			memcpy(terms[i].position_starts,
+				   te->position_starts,
+				   (c + 1) * sizeof(uint32));
+		}
+
 		i++;
 	}
 	Assert(i == num_terms);
@@ -291,7 +291,10 @@ tp_doclength_table_attach(dsa_area *area, dshash_table_handle handle)
  */
 bool
 tp_store_document_length(
-		TpLocalIndexState *local_state, ItemPointer ctid, int32 doc_length)
+		TpLocalIndexState *local_state,
+		ItemPointer		   ctid,
+		int32			   doc_length,
+		float4			   prior)
 {
 	TpMemtable		 *memtable;
 	dshash_table	 *doclength_table;
@@ -324,6 +327,7 @@ tp_store_document_length(
 	{
 		entry->ctid		  = *ctid;
 		entry->doc_length = doc_length;
+		entry->prior	  = prior;
 	}
 
 	dshash_release_lock(doclength_table, entry);
@@ -354,4 +358,22 @@ tp_get_document_length_attached(
 		return doc_length;
 	}
 	return -1; /* Not found */
+}
+
+float4
+tp_get_document_prior_attached(dshash_table *doclength_table, ItemPointer ctid)
+{
+	TpDocLengthEntry *entry;
+
+	Assert(doclength_table != NULL);
+	Assert(ctid != NULL);
+
+	entry = (TpDocLengthEntry *)dshash_find(doclength_table, ctid, false);
+	if (entry)
+	{
+		float4 prior = entry->prior;
+		dshash_release_lock(doclength_table, entry);
+		return prior;
+	}
+	return 0.0f;
 }
\ No newline at end of file
@@ -48,6 +48,7 @@ typedef struct TpDocLengthEntry
 	ItemPointerData ctid;		/* Key: Document heap tuple ID */
 	int32			doc_length; /* Value: Document length (sum of term
 								 * frequencies) */
+	float4			prior;		/* Value: Static prior, 0 if none */
 } TpDocLengthEntry;
 
 /* Array growth multiplier */
@@ -75,7 +76,10 @@ extern void tp_add_document_to_posting_list(
  * that concurrent appliers cannot double-add the same CTID.
  */
 extern bool tp_store_document_length(
-		TpLocalIndexState *local_state, ItemPointer ctid, int32 doc_length);
+		TpLocalIndexState *local_state,
+		ItemPointer		   ctid,
+		int32			   doc_length,
+		float4			   prior);
 
 /*
  * Get document length using a pre-attached doclength table.
@@ -85,6 +89,10 @@ extern bool tp_store_document_length(
 extern int32 tp_get_document_length_attached(
 		dshash_table *doclength_table, ItemPointer ctid);
 
+/* Static prior of a document in a pre-attached table; 0 if not found */
+extern float4 tp_get_document_prior_attached(
+		dshash_table *doclength_table, ItemPointer ctid);
+
 extern dshash_table *tp_doclength_table_create(dsa_area *area);
 extern dshash_table *
 tp_doclength_table_attach(dsa_area *area, dshash_table_handle handle);
@@ -17,8 +17,148 @@
 #include "index/state.h"
 #include "memtable/scan.h"
 #include "scoring/bm25.h"
+#include "scoring/bmw.h"
+#include "scoring/partition.h"
+#include "scoring/result_cache.h"
 #include "types/vector.h"
 
+/*
+ * Does `vec` contain `lexeme`?
+ */
+static bool
+vector_has_lexeme(TpVector *vec, const char *lexeme)
+{
+	TpVectorEntry *entry = get_tpvector_first_entry(vec);
+	size_t		   len	 = strlen(lexeme);
+
+	for (int i = 0; i < vec->entry_count; i++)
+	{
+		TpVectorEntryView v;
+
+		entry = tpvector_entry_decode_advance(entry, &v);
+		if ((size_t)v.lexeme_len == len && memcmp(v.lexeme, lexeme, len) == 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Copy the lexemes and frequencies of a query vector into palloc'd
+ * arrays.  Returns the number of terms.
+ */
+static int
+query_vector_terms(
+		TpVector *query_vector, char ***terms_out, int32 **frequencies_out)
+{
+	int			   entry_count = query_vector->entry_count;
+	char		 **terms	   = palloc(Max(entry_count, 1) * sizeof(char *));
+	int32		  *frequencies = palloc(Max(entry_count, 1) * sizeof(int32));
+	TpVectorEntry *entry	   = get_tpvector_first_entry(query_vector);
+
+	for (int i = 0; i < entry_count; i++)
+	{
+		TpVectorEntryView v;
+
+		entry		   = tpvector_entry_decode_advance(entry, &v);
+		terms[i]	   = pnstrdup(v.lexeme, v.lexeme_len);
+		frequencies[i] = (int32)v.frequency;
+	}
+
+	*terms_out		 = terms;
+	*frequencies_out = frequencies;
+	return entry_count;
+}
+
+/*
+ * Resolve the scan's "+word" / "-word" vectors against the query
+ * terms and pick up min_should_match and the phrases.  Returns false
+ * if the query has no boolean constraints (filter is still zeroed).
+ */
+static bool
+build_boolean_filter(
+		TpScanOpaque	 so,
+		char		   **query_terms,
+		int				 term_count,
+		TpBooleanFilter *filter)
+{
+	bool has_filter = false;
+
+	memset(filter, 0, sizeof(TpBooleanFilter));
+	if (so->min_should_match > 0)
+	{
+		filter->min_should_match = so->min_should_match;
+		has_filter				 = true;
+	}
+	if (so->required_vector != NULL && so->required_vector->entry_count > 0)
+	{
+		filter->required = palloc0(Max(term_count, 1) * sizeof(bool));
+		for (int i = 0; i < term_count; i++)
+		{
+			if (vector_has_lexeme(so->required_vector, query_terms[i]))
+			{
+				filter->required[i] = true;
+				filter->required_count++;
+			}
+		}
+		has_filter = true;
+	}
+	if (so->excluded_vector != NULL && so->excluded_vector->entry_count > 0)
+	{
+		TpVector	  *excluded = so->excluded_vector;
+		TpVectorEntry *entry	= get_tpvector_first_entry(excluded);
+
+		filter->excluded_count = excluded->entry_count;
+		filter->excluded = palloc(filter->excluded_count * sizeof(char *));
+		for (int i = 0; i < filter->excluded_count; i++)
+		{
+			TpVectorEntryView v;
+
+			entry = tpvector_entry_decode_advance(entry, &v);
+			filter->excluded[i] = pnstrdup(v.lexeme, v.lexeme_len);
+		}
+		has_filter = true;
+	}
+
+	if (so->phrases != NIL)
+	{
+		ListCell *lc;
+
+		filter->phrases = palloc(
+				list_length(so->phrases) * sizeof(TpPhrase *));
+		foreach (lc, so->phrases)
+			filter->phrases[filter->phrase_count++] = (TpPhrase *)lfirst(lc);
+		has_filter = true;
+	}
+
+	if (so->allowed_tids != NULL)
+	{
+		filter->allowed		  = so->allowed_tids;
+		filter->allowed_count = so->allowed_count;
+		has_filter			  = true;
+	}
+
+	if (so->term_weights != NULL)
+	{
+		filter->term_weights = so->term_weights;
+		has_filter			 = true;
+	}
+
+	return has_filter;
+}
+
+static void
+free_boolean_filter(TpBooleanFilter *filter)
+{
+	for (int i = 0; i < filter->excluded_count; i++)
+		pfree(filter->excluded[i]);
+	if (filter->excluded)
+		pfree(filter->excluded);
+	if (filter->required)
+		pfree(filter->required);
+	if (filter->phrases)
+		pfree(filter->phrases);
+}
+
 /*
  * Search the memtable (and segments) for documents matching the query vector.
  * Returns true on success (results stored in scan opaque), false on failure.
@@ -38,13 +178,16 @@ tp_memtable_search(
 	float4		  k1_value;
 	float4		  b_value;
 	MemoryContext oldcontext;
+	bool		  use_result_cache;
+	bool		  partial;
+	TpResultCacheVersion cache_version;
 
 	/* Extract terms and frequencies from query vector */
-	char		 **query_terms;
-	int32		  *query_frequencies;
-	TpVectorEntry *entries_ptr;
-	int			   entry_count;
-	char		  *ptr;
+	char		  **query_terms;
+	int32		   *query_frequencies;
+	int				entry_count;
+	TpBooleanFilter filter;
+	bool			has_filter;
 
 	if (!so)
 		return false;
@@ -55,29 +198,6 @@ tp_memtable_search(
 	else
 		max_results = tp_default_limit;
 
-	entry_count		  = query_vector->entry_count;
-	query_terms		  = palloc(entry_count * sizeof(char *));
-	query_frequencies = palloc(entry_count * sizeof(int32));
-	entries_ptr		  = TPVECTOR_ENTRIES_PTR(query_vector);
-
-	/* Parse the query vector entries */
-	ptr = (char *)entries_ptr;
-	for (int i = 0; i < entry_count; i++)
-	{
-		TpVectorEntry	 *entry = (TpVectorEntry *)ptr;
-		TpVectorEntryView v;
-		char			 *term_str;
-
-		ptr = (char *)tpvector_entry_decode_advance(entry, &v);
-
-		term_str = palloc(v.lexeme_len + 1);
-		memcpy(term_str, v.lexeme, v.lexeme_len);
-		term_str[v.lexeme_len] = '\0';
-
-		query_terms[i]		 = term_str;
-		query_frequencies[i] = (int32)v.frequency;
-	}
-
 	/* Allocate result arrays in scan context */
 	oldcontext		 = MemoryContextSwitchTo(so->scan_context);
 	so->result_ctids = palloc(max_results * sizeof(ItemPointerData));
@@ -85,6 +205,39 @@ tp_memtable_search(
 	memset(so->result_ctids, 0, max_results * sizeof(ItemPointerData));
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * Serve repeated queries from the shared result cache.  The version
+	 * is captured before scoring opens the memtable, so an insert that
+	 * races with us makes the stored entry stale rather than wrong.
+	 */
+	use_result_cache = tp_result_cache_applicable(so, scan->indexRelation) &&
+					   tp_result_cache_get_version(
+							   scan->indexRelation,
+							   index_state,
+							   &cache_version);
+	if (use_result_cache &&
+		tp_result_cache_lookup(
+				RelationGetRelid(scan->indexRelation),
+				query_vector,
+				so->required_vector,
+				so->excluded_vector,
+				so->min_should_match,
+				max_results,
+				&cache_version,
+				so->result_ctids,
+				&so->result_scores,
+				&result_count))
+	{
+		so->result_count	 = result_count;
+		so->current_pos		 = 0;
+		so->max_results_used = max_results;
+		return result_count > 0;
+	}
+
+	entry_count = query_vector_terms(
+			query_vector, &query_terms, &query_frequencies);
+	has_filter = build_boolean_filter(so, query_terms, entry_count, &filter);
+
 	/* Extract values from metap */
 	Assert(metap != NULL);
 	k1_value = metap->k1;
@@ -102,22 +255,118 @@ tp_memtable_search(
 			query_terms,
 			query_frequencies,
 			entry_count,
+			has_filter ? &filter : NULL,
 			k1_value,
 			b_value,
 			max_results,
+			so->parallel,
+			so->parallel == NULL ? so->partition : NULL,
+			so->cursor,
+			so->has_prior ? &so->prior : NULL,
 			so->result_ctids,
 			&so->result_scores);
+	partial = tp_score_was_partial();
+
+	/*
+	 * Nothing here reached the threshold another partition published:
+	 * score again without it rather than end the scan.
+	 */
+	if (result_count == 0 && so->partition != NULL &&
+		so->partition->threshold_used)
+	{
+		result_count = tp_score_documents(
+				index_state,
+				scan->indexRelation,
+				query_terms,
+				query_frequencies,
+				entry_count,
+				has_filter ? &filter : NULL,
+				k1_value,
+				b_value,
+				max_results,
+				NULL,
+				so->partition,
+				so->cursor,
+				so->has_prior ? &so->prior : NULL,
+				so->result_ctids,
+				&so->result_scores);
+		partial = partial || tp_score_was_partial();
+	}
 
 	so->result_count	 = result_count;
 	so->current_pos		 = 0;
 	so->max_results_used = max_results;
 
+	/* A top-k cut short by the scoring budget is never cached */
+	if (partial)
+	{
+		tp_note_scan_partial();
+		use_result_cache = false;
+	}
+
+	if (use_result_cache)
+		tp_result_cache_store(
+				RelationGetRelid(scan->indexRelation),
+				query_vector,
+				so->required_vector,
+				so->excluded_vector,
+				so->min_should_match,
+				max_results,
+				&cache_version,
+				so->result_ctids,
+				so->result_scores,
+				result_count);
+
 	/* Free the query terms array and individual term strings */
 	for (int i = 0; i < entry_count; i++)
 		pfree(query_terms[i]);
 
 	pfree(query_terms);
 	pfree(query_frequencies);
+	free_boolean_filter(&filter);
 
 	return result_count > 0;
 }
+
+/*
+ * Add the documents matching the query vector (and the scan's boolean
+ * constraints) to a match sink.  Returns the number of CTIDs added.
+ *
+ * This is the unranked counterpart of tp_memtable_search, called with
+ * the per-index lock held.
+ */
+int64
+tp_memtable_match(
+		IndexScanDesc	   scan,
+		TpLocalIndexState *index_state,
+		TpVector		  *query_vector,
+		TpMatchSink		  *sink)
+{
+	TpScanOpaque	so = (TpScanOpaque)scan->opaque;
+	char		  **query_terms;
+	int32		   *query_frequencies;
+	int				entry_count;
+	TpBooleanFilter filter;
+	bool			has_filter;
+	int64			ntids;
+
+	entry_count = query_vector_terms(
+			query_vector, &query_terms, &query_frequencies);
+	has_filter = build_boolean_filter(so, query_terms, entry_count, &filter);
+
+	ntids = tp_match_documents(
+			index_state,
+			scan->indexRelation,
+			query_terms,
+			entry_count,
+			has_filter ? &filter : NULL,
+			sink);
+
+	for (int i = 0; i < entry_count; i++)
+		pfree(query_terms[i]);
+	pfree(query_terms);
+	pfree(query_frequencies);
+	free_boolean_filter(&filter);
+
+	return ntids;
+}
@@ -13,6 +13,7 @@
 #include "access/am.h"
 #include "index/metapage.h"
 #include "index/state.h"
+#include "scoring/bm25.h"
 #include "types/vector.h"
 
 /*
@@ -26,3 +27,14 @@ bool tp_memtable_search(
 		TpLocalIndexState *index_state,
 		TpVector		  *query_vector,
 		TpIndexMetaPage	   metap);
+
+/*
+ * Add every document matching the query vector to a match sink
+ * (bitmap scans, and index scans without ORDER BY).  Returns the
+ * number of CTIDs added.
+ */
+int64 tp_memtable_match(
+		IndexScanDesc	   scan,
+		TpLocalIndexState *index_state,
+		TpVector		  *query_vector,
+		TpMatchSink		  *sink);
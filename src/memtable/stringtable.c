@@ -392,8 +392,8 @@ tp_get_or_create_posting_list(TpLocalIndexState *local_state, const char *term)
  *
  * Used by the cache apply protocol to bring the cache up to
  * date with the on-disk chain. The caller has already parsed a
- * (ctid, terms[], frequencies[], doc_length) tuple out of a
- * chain doc record.
+ * (ctid, terms[], frequencies[], doc_length, prior) tuple out of
+ * a chain doc record.
  *
  * Idempotent by CTID: tp_store_document_length is the single
  * check-and-add gate.  If the CTID is already in the doclength
@@ -412,11 +412,12 @@ tp_cache_apply_document(
 		char			 **terms,
 		int32			  *frequencies,
 		int				   term_count,
-		int32			   doc_length)
+		int32			   doc_length,
+		float4			   prior)
 {
 	int i;
 
-	if (!tp_store_document_length(local_state, ctid, doc_length))
+	if (!tp_store_document_length(local_state, ctid, doc_length, prior))
 		return;
 
 	for (i = 0; i < term_count; i++)
@@ -75,7 +75,7 @@ extern void tp_ensure_string_table_initialized(TpLocalIndexState *local_state);
  * on-disk version appends a doc record to the on-disk chain
  * (source of truth).
  * This version applies an already-parsed record (terms +
- * frequencies + doc_length for a CTID) into the in-memory cache
+ * frequencies + doc_length + prior for a CTID) into the in-memory cache
  * structures (string interning table, posting lists, doclength
  * table).  Used by the cache apply protocol to bring the cache
  * up to date with the chain. */
@@ -85,7 +85,8 @@ extern void tp_cache_apply_document(
 		char			 **terms,
 		int32			  *frequencies,
 		int				   term_count,
-		int32			   doc_length);
+		int32			   doc_length,
+		float4			   prior);
 
 /* LWLock tranche for string table locking */
 #define TP_STRING_HASH_TRANCHE_ID LWTRANCHE_FIRST_USER_DEFINED
@@ -29,6 +29,13 @@
 #include "index/state.h"
 #include "planner/hooks.h"
 #include "scoring/bm25.h"
+#include "scoring/bmw.h"
+#include "scoring/doc_freq_cache.h"
+#include "scoring/expand.h"
+#include "scoring/partition.h"
+#include "scoring/result_cache.h"
+#include "segment/reader_cache.h"
+#include "types/query.h"
 
 #if PG_VERSION_NUM >= 180000
 PG_MODULE_MAGIC_EXT(.name = "pg_textsearch", .version = "1.4.0-dev");
@@ -51,6 +58,25 @@ bool tp_log_scores = false;
 /* Global variable for BMW stats logging - declared in query/score.c */
 bool tp_log_bmw_stats = false;
 
+/* Factor BMW inflates the top-k threshold by when pruning (1 = exact) */
+double tp_threshold_inflation = TP_DEFAULT_THRESHOLD_INFLATION;
+
+/* Largest score change low-IDF term pruning may cause (0 = off) */
+double tp_term_pruning_epsilon = 0.0;
+
+/* Work a ranking may spend before returning a partial top-k (0 = any) */
+int tp_scoring_time_budget	= 0;
+int tp_scoring_block_budget = 0;
+
+/* Evaluator for multi-term segments (auto = chosen per segment) */
+int tp_multi_term_evaluator = TP_EVALUATOR_AUTO;
+
+static const struct config_enum_entry multi_term_evaluator_options[] = {
+		{"auto", TP_EVALUATOR_AUTO, false},
+		{"wand", TP_EVALUATOR_WAND, false},
+		{"maxscore", TP_EVALUATOR_MAXSCORE, false},
+		{NULL, 0, false}};
+
 /* Global variable for bulk load spill threshold (0 = disabled) */
 int tp_bulk_load_threshold = TP_DEFAULT_BULK_LOAD_THRESHOLD;
 
@@ -211,7 +237,8 @@ _PG_init(void)
 			"pg_textsearch.log_bmw_stats",
 			"Log Block-Max WAND statistics during queries",
 			"When enabled, logs blocks scanned/skipped and documents scored "
-			"for each query. Useful for understanding BMW optimization.",
+			"for each query, and notes each further batch a ranked scan "
+			"fetches. Useful for understanding BMW optimization.",
 			&tp_log_bmw_stats,
 			false,	   /* default off */
 			PGC_SUSET, /* superuser-only: prevents GUC persistence
@@ -221,6 +248,21 @@ _PG_init(void)
 			NULL,
 			NULL);
 
+	DefineCustomEnumVariable(
+			"pg_textsearch.multi_term_evaluator",
+			"Evaluator for multi-term queries without required terms",
+			"auto picks WAND or Block-Max MaxScore for each segment from "
+			"its term count and doc_freq skew; wand and maxscore force "
+			"one for testing.  Probe-only terms always use MaxScore.",
+			&tp_multi_term_evaluator,
+			TP_EVALUATOR_AUTO,
+			multi_term_evaluator_options,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
 	DefineCustomIntVariable(
 			"pg_textsearch.bulk_load_threshold",
 			"Terms per transaction to trigger memtable spill",
@@ -353,6 +395,212 @@ _PG_init(void)
 			NULL,
 			NULL);
 
+	DefineCustomBoolVariable(
+			"pg_textsearch.result_cache",
+			"Cache top-k results of repeated BM25 queries.",
+			"When enabled, the final (ctid, score) results of a "
+			"non-parallel index scan are kept in shared memory, keyed "
+			"by index, query, and LIMIT, and reused until the index "
+			"changes.",
+			&tp_result_cache_enabled,
+			false,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomBoolVariable(
+			"pg_textsearch.doc_freq_cache",
+			"Cache the segment document frequencies of query terms.",
+			"When enabled, the document frequency of a term summed "
+			"over an index's segments is kept in shared memory and "
+			"reused until a spill, merge, or VACUUM changes the "
+			"segments, so scoring skips the segment dictionaries.",
+			&tp_doc_freq_cache_enabled,
+			true,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomBoolVariable(
+			"pg_textsearch.segment_reader_cache",
+			"Cache segment page maps in each backend.",
+			"When enabled, a backend keeps the page map and "
+			"dictionary header of each segment it opens and reuses "
+			"them on later opens of the same segment, so queries "
+			"read only its header and data pages.",
+			&tp_segment_reader_cache_enabled,
+			true,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomBoolVariable(
+			"pg_textsearch.partition_global_stats",
+			"Score partitions with the partitioned index's statistics.",
+			"When enabled, a ranked scan of one partition of a "
+			"partitioned BM25 index computes IDF and average document "
+			"length over all partitions, so scores are comparable "
+			"across partitions, and the partitions' scans share a "
+			"top-k threshold.",
+			&tp_partition_global_stats,
+			false,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.result_cache_size",
+			"Maximum shared memory used by the query result cache.",
+			"Least-recently-used entries are evicted beyond this "
+			"size.  Cached results also count against "
+			"pg_textsearch.memory_limit.  A value of 0 disables "
+			"the cache.",
+			&tp_result_cache_size_kb,
+			TP_DEFAULT_RESULT_CACHE_SIZE_KB,
+			0,
+			INT_MAX,
+			PGC_SIGHUP,
+			GUC_UNIT_KB,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.doc_freq_cache_size",
+			"Maximum shared memory used by the doc_freq cache.",
+			"Least-recently-used entries are evicted beyond this "
+			"size.  Cached entries also count against "
+			"pg_textsearch.memory_limit.  A value of 0 disables "
+			"the cache.",
+			&tp_doc_freq_cache_size_kb,
+			TP_DEFAULT_DOC_FREQ_CACHE_SIZE_KB,
+			0,
+			INT_MAX,
+			PGC_SIGHUP,
+			GUC_UNIT_KB,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomRealVariable(
+			"pg_textsearch.threshold_inflation",
+			"Factor by which top-k pruning inflates its threshold.",
+			"Block-Max WAND skips blocks and segments whose score "
+			"bound is below the current top-k threshold times this "
+			"factor.  Values above 1 return approximate results "
+			"faster; 1 keeps them exact.",
+			&tp_threshold_inflation,
+			TP_DEFAULT_THRESHOLD_INFLATION,
+			1.0,
+			TP_MAX_THRESHOLD_INFLATION,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomRealVariable(
+			"pg_textsearch.term_pruning_epsilon",
+			"Largest score change pruning weak query terms may cause.",
+			"Optional query terms whose bounds sum to at most this are "
+			"dropped; others bounded by it only add to documents the "
+			"remaining terms find.  0 disables pruning.",
+			&tp_term_pruning_epsilon,
+			0.0,
+			0.0,
+			TP_MAX_TERM_PRUNING_EPSILON,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.scoring_time_budget",
+			"Time a ranked scan may spend scoring before it stops.",
+			"Once exceeded, scoring stops between blocks or segments "
+			"and the best documents found so far are returned; see "
+			"bm25_last_scan_partial().  0 disables the limit.",
+			&tp_scoring_time_budget,
+			0,
+			0,
+			INT_MAX,
+			PGC_USERSET,
+			GUC_UNIT_MS,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.scoring_block_budget",
+			"Posting blocks a ranked scan may decode before it stops.",
+			"Once reached, scoring stops between blocks or segments "
+			"and the best documents found so far are returned; see "
+			"bm25_last_scan_partial().  0 disables the limit.",
+			&tp_scoring_block_budget,
+			0,
+			0,
+			INT_MAX,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomBoolVariable(
+			"pg_textsearch.query_operators",
+			"Interpret +word, -word and \"phrases\" in query text.",
+			"When off, query text is a plain list of words, as before "
+			"1.4.0: signs and double quotes are left to the tokenizer, "
+			"which drops them.",
+			&tp_query_operators,
+			true,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.prefix_expansions",
+			"Maximum number of terms a prefix term expands to.",
+			"A query word ending in * stands for the indexed terms "
+			"starting with its lexeme; the ones in the most documents "
+			"are searched.",
+			&tp_prefix_expansions,
+			TP_DEFAULT_PREFIX_EXPANSIONS,
+			1,
+			TP_MAX_TERM_EXPANSIONS,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
+	DefineCustomIntVariable(
+			"pg_textsearch.fuzzy_expansions",
+			"Maximum number of terms a fuzzy term expands to.",
+			"A query word ending in ~N stands for the indexed terms "
+			"within N edits of its lexeme; the nearest ones, and of "
+			"those the ones in the most documents, are searched.",
+			&tp_fuzzy_expansions,
+			TP_DEFAULT_FUZZY_EXPANSIONS,
+			1,
+			TP_MAX_TERM_EXPANSIONS,
+			PGC_USERSET,
+			0,
+			NULL,
+			NULL,
+			NULL);
+
 	/*
 	 * Reserve the pg_textsearch.* GUC prefix so unknown settings
 	 * (typos, or GUCs removed in a future release) produce a
@@ -387,6 +635,18 @@ _PG_init(void)
 			0.0,
 			1.0,
 			NoLock);
+	add_bool_reloption(
+			tp_relopt_kind,
+			"positions",
+			"Store token positions for phrase queries",
+			false,
+			AccessExclusiveLock);
+	add_bool_reloption(
+			tp_relopt_kind,
+			"impacts",
+			"Store quantized BM25 impacts for faster top-k scoring",
+			false,
+			AccessExclusiveLock);
 
 	/*
 	 * Install shared memory hooks (needed for registry)
@@ -447,7 +707,9 @@ tp_object_access(
 		if (!tp_registry_is_registered(objectId))
 			return;
 
-		/* Cleanup shared memory and unregister from registry */
+		/* Drop cached results, then shared memory and registry entry */
+		tp_result_cache_invalidate_index(objectId);
+		tp_doc_freq_cache_invalidate_index(objectId);
 		tp_cleanup_index_shared_memory(objectId);
 	}
 }
@@ -464,6 +726,10 @@ tp_shmem_request(void)
 
 	/* Request shared memory for registry (includes DSA control) */
 	tp_registry_init();
+
+	/* Result and doc_freq cache control blocks */
+	tp_result_cache_shmem_request();
+	tp_doc_freq_cache_shmem_request();
 }
 
 /*
@@ -478,6 +744,9 @@ tp_shmem_startup(void)
 
 	/* Initialize the registry in shared memory (includes DSA control) */
 	tp_registry_shmem_startup();
+
+	tp_result_cache_shmem_startup();
+	tp_doc_freq_cache_shmem_startup();
 }
 
 /*
@@ -505,6 +774,7 @@ tp_xact_callback(XactEvent event, void *arg __attribute__((unused)))
 		tp_release_all_index_locks();
 		/* Reset bulk load counters for next transaction */
 		tp_reset_bulk_load_counters();
+		tp_partition_stats_reset();
 		break;
 
 	case XACT_EVENT_ABORT:
@@ -515,11 +785,15 @@ tp_xact_callback(XactEvent event, void *arg __attribute__((unused)))
 		tp_release_all_index_locks();
 		/* Reset bulk load counters for next transaction */
 		tp_reset_bulk_load_counters();
+		tp_partition_stats_reset();
 		break;
 
 	case XACT_EVENT_PRE_PREPARE:
+		/* Nothing to do for this event */
+		break;
+
 	case XACT_EVENT_PREPARE:
-		/* Nothing to do for these events */
+		tp_partition_stats_reset();
 		break;
 	}
 }
@@ -7,14 +7,131 @@
 #include <postgres.h>
 
 #include <access/genam.h>
+#include <catalog/pg_class.h>
+#include <fmgr.h>
+#include <tsearch/ts_type.h>
+#include <utils/builtins.h>
 #include <utils/float.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
 #include <utils/rel.h>
 #include <utils/selfuncs.h>
 
+#include "access/am.h"
 #include "constants.h"
 #include "index/limit.h"
 #include "index/metapage.h"
+#include "index/state.h"
 #include "planner/cost.h"
+#include "scoring/bm25.h"
+#include "scoring/expand.h"
+#include "types/query.h"
+
+PG_FUNCTION_INFO_V1(bm25_match_sel);
+
+/*
+ * What the planner call in progress has read of each bm25 index, so
+ * that costing several paths and estimating several clauses reads an
+ * index's metapage once and each term's doc_freq once.  The planner
+ * hook brackets every planner call with tp_planner_stats_begin/end;
+ * outside a planner call nothing is kept.
+ */
+typedef struct TpPlannerTermFreq
+{
+	char  *term;
+	uint32 doc_freq;
+} TpPlannerTermFreq;
+
+typedef struct TpPlannerIndexStats
+{
+	Oid	   index_oid;
+	Oid	   text_config_oid;
+	bool   positions;	 /* The index stores positions */
+	double segment_docs; /* Metapage total_docs */
+	int32  corpus_docs;	 /* With the memtable; 0 until counted */
+	List  *term_freqs;	 /* TpPlannerTermFreq of each term looked up */
+} TpPlannerIndexStats;
+
+static MemoryContext planner_stats_context = NULL;
+static List			*planner_stats		   = NIL;
+static int			 planner_depth		   = 0;
+
+static void
+reset_planner_stats(void)
+{
+	if (planner_stats_context != NULL)
+		MemoryContextReset(planner_stats_context);
+	planner_stats = NIL;
+}
+
+void
+tp_planner_stats_begin(void)
+{
+	if (planner_depth++ == 0)
+		reset_planner_stats();
+}
+
+void
+tp_planner_stats_end(void)
+{
+	Assert(planner_depth > 0);
+	if (--planner_depth == 0)
+		reset_planner_stats();
+}
+
+/*
+ * This planner call's statistics of an index, or NULL if it has not
+ * read them yet
+ */
+static TpPlannerIndexStats *
+find_planner_stats(Oid index_oid)
+{
+	ListCell *lc;
+
+	foreach (lc, planner_stats)
+	{
+		TpPlannerIndexStats *stats = (TpPlannerIndexStats *)lfirst(lc);
+
+		if (stats->index_oid == index_oid)
+			return stats;
+	}
+	return NULL;
+}
+
+/*
+ * Read the metapage of an open index into statistics kept for the rest
+ * of the planner call
+ */
+static TpPlannerIndexStats *
+load_planner_stats(Relation index_rel)
+{
+	TpPlannerIndexStats *stats;
+	TpIndexMetaPage		 metap;
+	MemoryContext		 oldcontext = CurrentMemoryContext;
+
+	if (planner_depth > 0)
+	{
+		if (planner_stats_context == NULL)
+			planner_stats_context = AllocSetContextCreate(
+					TopMemoryContext,
+					"pg_textsearch planner stats",
+					ALLOCSET_SMALL_SIZES);
+		oldcontext = MemoryContextSwitchTo(planner_stats_context);
+	}
+
+	metap				   = tp_get_metapage(index_rel);
+	stats				   = palloc0(sizeof(TpPlannerIndexStats));
+	stats->index_oid	   = RelationGetRelid(index_rel);
+	stats->text_config_oid = metap->text_config_oid;
+	stats->positions	   = tp_index_has_positions(index_rel);
+	stats->segment_docs	   = (double)metap->total_docs;
+	pfree(metap);
+
+	if (planner_depth > 0)
+		planner_stats = lappend(planner_stats, stats);
+	MemoryContextSwitchTo(oldcontext);
+	return stats;
+}
 
 /*
  * Estimate cost of BM25 index scan
@@ -30,18 +147,36 @@ tp_costestimate(
 		double		*indexCorrelation,
 		double		*indexPages)
 {
-	GenericCosts	costs;
-	TpIndexMetaPage metap;
-	double			num_tuples = TP_DEFAULT_TUPLE_ESTIMATE;
+	GenericCosts costs;
+	double		 num_tuples = TP_DEFAULT_TUPLE_ESTIMATE;
 
-	/* Never use index without ORDER BY clause */
-	if (!path->indexorderbys || list_length(path->indexorderbys) == 0)
+	/* Never use index without ORDER BY or @@ clause */
+	if (path->indexorderbys == NIL && path->indexclauses == NIL)
 	{
 		*indexStartupCost = get_float8_infinity();
 		*indexTotalCost	  = get_float8_infinity();
 		return;
 	}
 
+	/*
+	 * A match-only scan (bitmap, or plain without ORDER BY) returns
+	 * every match: its selectivity is that of the @@ clauses, which
+	 * bm25_match_sel estimates from doc_freq.
+	 */
+	if (path->indexorderbys == NIL)
+	{
+		MemSet (&costs, 0, sizeof(costs))
+			;
+		genericcostestimate(root, path, loop_count, &costs);
+
+		*indexStartupCost = costs.indexStartupCost;
+		*indexTotalCost	  = costs.indexTotalCost * TP_INDEX_SCAN_COST_FACTOR;
+		*indexSelectivity = costs.indexSelectivity;
+		*indexCorrelation = 0.0;
+		*indexPages		  = costs.numIndexPages;
+		return;
+	}
+
 	/* Check for LIMIT clause and verify it can be safely pushed down */
 	if (root && root->limit_tuples > 0 && root->limit_tuples < INT_MAX)
 	{
@@ -54,20 +189,19 @@ tp_costestimate(
 	/* Try to get actual statistics from the index */
 	if (path->indexinfo && path->indexinfo->indexoid != InvalidOid)
 	{
-		Relation index_rel =
-				index_open(path->indexinfo->indexoid, AccessShareLock);
+		TpPlannerIndexStats *stats =
+				find_planner_stats(path->indexinfo->indexoid);
 
-		if (index_rel)
+		if (stats == NULL)
 		{
-			metap = tp_get_metapage(index_rel);
-			if (metap && metap->total_docs > 0)
-				num_tuples = (double)metap->total_docs;
-
-			if (metap)
-				pfree(metap);
+			Relation index_rel =
+					index_open(path->indexinfo->indexoid, AccessShareLock);
 
+			stats = load_planner_stats(index_rel);
 			index_close(index_rel, AccessShareLock);
 		}
+		if (stats->segment_docs > 0)
+			num_tuples = stats->segment_docs;
 	}
 
 	/* Initialize generic costs */
@@ -97,3 +231,363 @@ tp_costestimate(
 	*indexCorrelation = 0.0; /* No correlation assumptions */
 	*indexPages		  = Max(1.0, num_tuples / 100.0); /* Rough page estimate */
 }
+
+/*
+ * Lexemes of query words, with the index's text search configuration
+ */
+static char **
+match_sel_lexemes(Oid text_config_oid, const char *words, int *count)
+{
+	TSVector   tsv;
+	WordEntry *entries;
+	char	 **lexemes;
+	int		   i;
+
+	tsv = DatumGetTSVector(DirectFunctionCall2Coll(
+			to_tsvector_byid,
+			InvalidOid,
+			ObjectIdGetDatum(text_config_oid),
+			PointerGetDatum(cstring_to_text(words))));
+	entries = ARRPTR(tsv);
+	lexemes = palloc(Max(tsv->size, 1) * sizeof(char *));
+
+	for (i = 0; i < tsv->size; i++)
+		lexemes[i] = pnstrdup(STRPTR(tsv) + entries[i].pos, entries[i].len);
+
+	*count = tsv->size;
+	return lexemes;
+}
+
+static bool
+match_sel_contains(char **lexemes, int count, const char *lexeme)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (strcmp(lexemes[i], lexeme) == 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Fraction of documents matching a bm25query, treating terms as
+ * independent: every required term, at least `min_hits` optional
+ * ones, and none of the excluded ones.
+ */
+static Selectivity
+match_sel_combine(
+		const uint32 *doc_freqs,
+		const bool	 *required,
+		int			  term_count,
+		const uint32 *excluded_freqs,
+		int			  excluded_count,
+		int			  min_hits,
+		int32		  total_docs)
+{
+	Selectivity sel = 1.0;
+	double	   *hits; /* hits[j]: P(exactly j optional terms present) */
+	int			optional = 0;
+	int			i;
+	int			j;
+
+	hits	= palloc0((term_count + 1) * sizeof(double));
+	hits[0] = 1.0;
+
+	for (i = 0; i < term_count; i++)
+	{
+		double p = Min(1.0, (double)doc_freqs[i] / total_docs);
+
+		if (required[i])
+		{
+			sel *= p;
+			continue;
+		}
+
+		/* Fold one more optional term into the hit-count distribution */
+		optional++;
+		for (j = optional; j > 0; j--)
+			hits[j] = hits[j] * (1.0 - p) + hits[j - 1] * p;
+		hits[0] *= 1.0 - p;
+	}
+
+	if (min_hits > 0)
+	{
+		double p_hits = 0.0;
+
+		for (j = min_hits; j <= optional; j++)
+			p_hits += hits[j];
+		sel *= p_hits;
+	}
+
+	for (i = 0; i < excluded_count; i++)
+		sel *= 1.0 - Min(1.0, (double)excluded_freqs[i] / total_docs);
+
+	pfree(hits);
+	return sel;
+}
+
+/*
+ * Unified doc_freq of each term, from this planner call's statistics
+ * where it has them, reading the rest (opening *index_rel if it is
+ * NULL).  Returns the corpus size the doc_freqs are counted over.
+ */
+static int32
+planner_doc_freqs(
+		TpPlannerIndexStats *stats,
+		TpLocalIndexState	*index_state,
+		Relation			*index_rel,
+		char			   **terms,
+		int					 term_count,
+		uint32				*doc_freqs)
+{
+	char		**missing = palloc(term_count * sizeof(char *));
+	int			 *slots	  = palloc(term_count * sizeof(int));
+	uint32		 *missing_freqs;
+	int			  missing_count = 0;
+	int32		  total_docs	= 0;
+	bool		  acquired_lock = false;
+	MemoryContext oldcontext;
+	ListCell	 *lc;
+	int			  i;
+
+	for (i = 0; i < term_count; i++)
+	{
+		bool found = false;
+
+		foreach (lc, stats->term_freqs)
+		{
+			TpPlannerTermFreq *tf = (TpPlannerTermFreq *)lfirst(lc);
+
+			if (strcmp(tf->term, terms[i]) == 0)
+			{
+				doc_freqs[i] = tf->doc_freq;
+				found		 = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			missing[missing_count] = terms[i];
+			slots[missing_count++] = i;
+		}
+	}
+
+	if (missing_count == 0)
+		return stats->corpus_docs;
+
+	if (*index_rel == NULL)
+		*index_rel = index_open(stats->index_oid, AccessShareLock);
+	missing_freqs = palloc0(missing_count * sizeof(uint32));
+
+	if (!index_state->lock_held)
+	{
+		tp_acquire_index_lock(index_state, LW_SHARED);
+		acquired_lock = true;
+	}
+	PG_TRY();
+	{
+		total_docs = tp_get_doc_freqs(
+				index_state,
+				*index_rel,
+				missing,
+				missing_count,
+				missing_freqs);
+	}
+	PG_FINALLY();
+	{
+		if (acquired_lock)
+			tp_release_index_lock(index_state);
+	}
+	PG_END_TRY();
+
+	/* Every estimate of the planner call counts over the same corpus */
+	if (stats->corpus_docs <= 0)
+		stats->corpus_docs = total_docs;
+
+	oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(stats));
+	for (i = 0; i < missing_count; i++)
+	{
+		TpPlannerTermFreq *tf = palloc(sizeof(TpPlannerTermFreq));
+
+		tf->term			= pstrdup(missing[i]);
+		tf->doc_freq		= missing_freqs[i];
+		doc_freqs[slots[i]] = missing_freqs[i];
+		stats->term_freqs	= lappend(stats->term_freqs, tf);
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	return stats->corpus_docs;
+}
+
+/*
+ * Estimate the selectivity of a bm25query on one index
+ *
+ * The query text is split the way a scan splits it: "word*" and
+ * "word~N" patterns first, then +required, -excluded and optional
+ * words.  A pattern adds its expansions as optional terms, capped at
+ * pg_textsearch.prefix_expansions / fuzzy_expansions as for a ranked
+ * scan: a match takes every expansion, but those past the cap are the
+ * rarest and barely move the estimate.
+ */
+static Selectivity
+match_selectivity(Oid index_oid, TpQuery *query)
+{
+	TpLocalIndexState	*index_state;
+	TpPlannerIndexStats *stats;
+	Relation			 index_rel	= NULL;
+	char				*query_text = get_tpquery_text(query);
+	char				*rest_text;
+	char				*scoring_text;
+	char				*required_text = "";
+	char				*excluded_text = "";
+	List				*phrases	   = NIL;
+	List				*patterns	   = NIL;
+	char			   **terms;
+	char			   **required_terms;
+	char			   **excluded_terms;
+	char			   **lookup_terms;
+	int					 term_count;
+	int					 required_count;
+	int					 excluded_count;
+	uint32				*doc_freqs;
+	bool				*required;
+	int32				 total_docs;
+	int					 min_hits;
+	Selectivity			 sel;
+	int					 i;
+
+	index_state = tp_get_local_index_state(index_oid);
+	if (index_state == NULL)
+		return TP_DEFAULT_MATCH_SELECTIVITY;
+
+	stats = find_planner_stats(index_oid);
+	if (stats == NULL)
+	{
+		index_rel = index_open(index_oid, AccessShareLock);
+		stats	  = load_planner_stats(index_rel);
+	}
+
+	if (tpquery_split_patterns(query_text, &rest_text, &patterns))
+		query_text = rest_text;
+
+	if (tpquery_split_boolean(
+				query_text,
+				stats->positions,
+				&scoring_text,
+				&required_text,
+				&excluded_text,
+				&phrases))
+		query_text = scoring_text;
+
+	terms = match_sel_lexemes(stats->text_config_oid, query_text, &term_count);
+	required_terms = match_sel_lexemes(
+			stats->text_config_oid, required_text, &required_count);
+	excluded_terms = match_sel_lexemes(
+			stats->text_config_oid, excluded_text, &excluded_count);
+
+	if (patterns != NIL)
+	{
+		int32  *frequencies = palloc0(Max(term_count, 1) * sizeof(int32));
+		float4 *weights;
+
+		if (index_rel == NULL)
+			index_rel = index_open(index_oid, AccessShareLock);
+		term_count = tp_expand_patterns(
+				index_state,
+				index_rel,
+				stats->text_config_oid,
+				patterns,
+				false,
+				&terms,
+				&frequencies,
+				&weights,
+				term_count);
+	}
+
+	if (term_count == 0)
+	{
+		if (index_rel != NULL)
+			index_close(index_rel, AccessShareLock);
+		return TP_DEFAULT_MATCH_SELECTIVITY;
+	}
+
+	/* One lookup for the query terms and the excluded ones */
+	lookup_terms = palloc((term_count + excluded_count) * sizeof(char *));
+	memcpy(lookup_terms, terms, term_count * sizeof(char *));
+	memcpy(lookup_terms + term_count,
+		   excluded_terms,
+		   excluded_count * sizeof(char *));
+	doc_freqs = palloc0((term_count + excluded_count) * sizeof(uint32));
+
+	total_docs = planner_doc_freqs(
+			stats,
+			index_state,
+			&index_rel,
+			lookup_terms,
+			term_count + excluded_count,
+			doc_freqs);
+	if (index_rel != NULL)
+		index_close(index_rel, AccessShareLock);
+
+	if (total_docs <= 0)
+		return TP_DEFAULT_MATCH_SELECTIVITY;
+
+	required = palloc(term_count * sizeof(bool));
+	for (i = 0; i < term_count; i++)
+		required[i] =
+				match_sel_contains(required_terms, required_count, terms[i]);
+
+	/* Without required terms, some query term must be present */
+	min_hits = get_tpquery_min_should_match(query);
+	if (min_hits == 0 && required_count == 0)
+		min_hits = 1;
+
+	sel = match_sel_combine(
+			doc_freqs,
+			required,
+			term_count,
+			doc_freqs + term_count,
+			excluded_count,
+			min_hits,
+			total_docs);
+
+	return Max(sel, 1.0 / total_docs);
+}
+
+/*
+ * Restriction selectivity estimator for the @@ match operators
+ *
+ * A constant bm25query naming a (non-partitioned) bm25 index is
+ * estimated from the unified doc_freq of its terms; anything else
+ * gets TP_DEFAULT_MATCH_SELECTIVITY.
+ */
+Datum
+bm25_match_sel(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *)PG_GETARG_POINTER(0);
+	List		*args = (List *)PG_GETARG_POINTER(2);
+	Node		*right;
+	Const		*query_const;
+	TpQuery		*query;
+	Oid			 index_oid;
+
+	if (list_length(args) != 2)
+		PG_RETURN_FLOAT8(TP_DEFAULT_MATCH_SELECTIVITY);
+
+	right = estimate_expression_value(root, (Node *)lsecond(args));
+	if (!IsA(right, Const) || ((Const *)right)->constisnull)
+		PG_RETURN_FLOAT8(TP_DEFAULT_MATCH_SELECTIVITY);
+
+	query_const = (Const *)right;
+	query		= (TpQuery *)PG_DETOAST_DATUM(query_const->constvalue);
+	if (!tpquery_has_index(query))
+		PG_RETURN_FLOAT8(TP_DEFAULT_MATCH_SELECTIVITY);
+
+	index_oid = get_tpquery_index_oid(query);
+	if (get_rel_relkind(index_oid) != RELKIND_INDEX)
+		PG_RETURN_FLOAT8(TP_DEFAULT_MATCH_SELECTIVITY);
+
+	PG_RETURN_FLOAT8(match_selectivity(index_oid, query));
+}
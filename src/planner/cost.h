@@ -8,6 +8,7 @@
 
 #include <postgres.h>
 
+#include <fmgr.h>
 #include <nodes/pathnodes.h>
 #include <optimizer/optimizer.h>
 
@@ -23,3 +24,15 @@ void tp_costestimate(
 		Selectivity *indexSelectivity,
 		double		*indexCorrelation,
 		double		*indexPages);
+
+/*
+ * Restriction selectivity of the @@ match operators
+ */
+Datum bm25_match_sel(PG_FUNCTION_ARGS);
+
+/*
+ * Bracket a planner call: the bm25 index statistics read while
+ * estimating are kept until the outermost call ends
+ */
+void tp_planner_stats_begin(void);
+void tp_planner_stats_end(void);
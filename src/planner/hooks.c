@@ -44,6 +44,7 @@
 #include <utils/rel.h>
 #include <utils/syscache.h>
 
+#include "planner/cost.h"
 #include "planner/hooks.h"
 #include "scoring/bm25.h"
 #include "types/query.h"
@@ -64,6 +65,8 @@ typedef struct BM25OidCache
 	Oid text_text_operator_oid;
 	Oid textarray_tpquery_operator_oid;
 	Oid textarray_text_operator_oid;
+	Oid text_match_operator_oid;
+	Oid textarray_match_operator_oid;
 } BM25OidCache;
 
 /*
@@ -185,6 +188,14 @@ lookup_bm25_oids_internal(BM25OidCache *cache)
 			OpernameGetOprid(opname, TEXTARRAYOID, TEXTOID);
 	list_free(opname);
 
+	/* Look up the @@ match operators for (text, bm25query), (text[], ...) */
+	opname = list_make1(makeString("@@"));
+	cache->text_match_operator_oid =
+			OpernameGetOprid(opname, TEXTOID, cache->tpquery_type_oid);
+	cache->textarray_match_operator_oid =
+			OpernameGetOprid(opname, TEXTARRAYOID, cache->tpquery_type_oid);
+	list_free(opname);
+
 	return true;
 }
 
@@ -250,7 +261,7 @@ index_is_on_column(Oid index_oid, Oid relid, AttrNumber attnum)
 	if (idx_form->indrelid == relid)
 	{
 		/* Check if index is on the correct column */
-		int nkeys = idx_form->indnatts;
+		int nkeys = idx_form->indnkeyatts;
 		for (int i = 0; i < nkeys; i++)
 		{
 			if (idx_form->indkey.values[i] == attnum)
@@ -311,7 +322,7 @@ find_bm25_index_for_column(Oid relid, AttrNumber attnum, Oid bm25_am_oid)
 		{
 			bool  predNull;
 			Datum predDatum;
-			int	  nkeys = indexForm->indnatts;
+			int	  nkeys = indexForm->indnkeyatts;
 
 			/*
 			 * Skip partial indexes for implicit
@@ -612,7 +623,20 @@ create_resolved_tpquery_const(Const *original, Oid index_oid)
 {
 	TpQuery *old_tpquery = (TpQuery *)DatumGetPointer(original->constvalue);
 	char	*query_text	 = get_tpquery_text(old_tpquery);
-	TpQuery *new_tpquery = create_tpquery(query_text, index_oid);
+	TpQuery *new_tpquery = create_tpquery_full(
+			query_text,
+			index_oid,
+			false,
+			get_tpquery_min_should_match(old_tpquery));
+	float4			after_score;
+	ItemPointerData after_ctid;
+	TpQueryPrior	prior;
+
+	if (get_tpquery_search_after(old_tpquery, &after_score, &after_ctid))
+		new_tpquery = tpquery_set_search_after(
+				new_tpquery, after_score, &after_ctid);
+	if (get_tpquery_prior(old_tpquery, &prior))
+		new_tpquery = tpquery_set_prior(new_tpquery, &prior);
 
 	return makeConst(
 			original->consttype,
@@ -661,7 +685,9 @@ transform_tpquery_opexpr(OpExpr *opexpr, ResolveIndexContext *context)
 	Const		 *new_const;
 
 	if (opexpr->opno != oids->text_tpquery_operator_oid &&
-		opexpr->opno != oids->textarray_tpquery_operator_oid)
+		opexpr->opno != oids->textarray_tpquery_operator_oid &&
+		opexpr->opno != oids->text_match_operator_oid &&
+		opexpr->opno != oids->textarray_match_operator_oid)
 		return NULL;
 
 	/* Mark that we found a BM25 operator for later optimization */
@@ -693,12 +719,16 @@ transform_tpquery_opexpr(OpExpr *opexpr, ResolveIndexContext *context)
 	 */
 	if (!IsA(left, Var) && !contain_var_clause(left))
 	{
+		const char *opname = get_opname(opexpr->opno);
+
 		ereport(ERROR,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-				 errmsg("left operand of <@> must reference "
-						"a table column"),
-				 errhint("Use column_name <@> bm25query, not "
-						 "a constant.")));
+				 errmsg("left operand of %s must reference "
+						"a table column",
+						opname),
+				 errhint("Use column_name %s bm25query, not "
+						 "a constant.",
+						 opname)));
 	}
 
 	/*
@@ -1137,8 +1167,11 @@ plan_has_bm25_indexscan(Plan *plan, BM25OidCache *oids)
 	if (plan == NULL)
 		return false;
 
-	/* Check if this is a BM25 IndexScan */
-	if (IsA(plan, IndexScan))
+	/*
+	 * Check if this is a BM25 IndexScan ranking by <@>.  One with only
+	 * @@ keys returns its matches unscored.
+	 */
+	if (IsA(plan, IndexScan) && ((IndexScan *)plan)->indexorderby != NIL)
 	{
 		IndexScan *indexscan = (IndexScan *)plan;
 		Oid		   indexamid;
@@ -1973,6 +2006,7 @@ tp_planner_hook(
 	}
 
 	/* Call previous hook or standard planner */
+	tp_planner_stats_begin();
 	PG_TRY();
 	{
 		if (prev_planner_hook)
@@ -1984,6 +2018,8 @@ tp_planner_hook(
 	}
 	PG_FINALLY();
 	{
+		tp_planner_stats_end();
+
 		/* Restore previous context and clean up if we set one up */
 		if (explicit_indexes != NIL)
 		{
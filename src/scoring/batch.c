@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * batch.c - Multi-query batch scoring (bm25_search_batch)
+ *
+ * A re-ranking request sends many queries against one index.  Scoring
+ * them as separate index scans reads the metapage, builds a memtable
+ * source and searches every segment's dictionary once per query;
+ * bm25_search_batch does each of those once for the whole batch (see
+ * tp_score_batch) and returns every query's top-k.
+ *
+ * The index still holds deleted and not yet visible rows, so each
+ * query's results are checked against the active snapshot as an index
+ * scan's would be, and a query left short of k resumes below them.
+ */
+#include <postgres.h>
+
+#include <access/genam.h>
+#include <access/table.h>
+#include <access/tableam.h>
+#include <catalog/objectaddress.h>
+#include <catalog/pg_class.h>
+#include <commands/defrem.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/rls.h>
+#include <utils/snapmgr.h>
+
+#include "access/am.h"
+#include "constants.h"
+#include "index/metapage.h"
+#include "index/resolve.h"
+#include "index/state.h"
+#include "scoring/bm25.h"
+#include "scoring/expand.h"
+#include "scoring/phrase.h"
+#include "types/query.h"
+
+/* Settings of the batch's index needed to analyze its queries */
+typedef struct BatchIndexInfo
+{
+	Relation		   index;
+	TpLocalIndexState *state; /* to expand term patterns */
+	Oid				   text_config_oid;
+	bool			   positions;
+} BatchIndexInfo;
+
+/* One query's rows visible to the snapshot, best first */
+typedef struct BatchVisible
+{
+	ItemPointer ctids;	/* [k] */
+	float4	   *scores; /* [k] raw BM25 scores */
+	int			count;
+} BatchVisible;
+
+/*
+ * Tokenize query text with the index's configuration.  Returns the
+ * number of lexemes; *terms is NULL when there are none.
+ */
+static int
+batch_tokenize(
+		const char *query_text, Oid text_config_oid, char ***terms, int32 **freqs)
+{
+	int term_count = 0;
+
+	*terms = NULL;
+	*freqs = NULL;
+	(void)tp_tokenize_text(
+			cstring_to_text(query_text),
+			text_config_oid,
+			terms,
+			freqs,
+			&term_count);
+	return term_count;
+}
+
+/*
+ * Analyze one bm25query of the batch the way an index scan would
+ * (see tp_prepare_query in access/scan.c): the scoring terms, the
+ * +required / -excluded / "phrase" constraints, the expansions of
+ * word* and word~N patterns, min_should_match, a search-after position and a
+ * static prior weighting.
+ */
+static void
+batch_prepare_query(
+		TpQuery *query, const BatchIndexInfo *info, TpBatchQuery *batch_query)
+{
+	TpBooleanFilter *filter;
+	char			*query_text = get_tpquery_text(query);
+	char			*scoring_text;
+	char			*required_text;
+	char			*excluded_text;
+	List			*phrases	  = NIL;
+	List			*patterns;
+	char		   **required	  = NULL;
+	int32			*required_freqs;
+	int32			*excluded_freqs;
+	int				 required_count = 0;
+	bool			 has_filter		= false;
+	float4			 after_score;
+	ItemPointerData	 after_ctid;
+	TpQueryPrior	 prior;
+	TpQueryPrior	*prior_copy;
+	ListCell		*lc;
+	int				 i;
+	int				 j;
+
+	if (tpquery_has_index(query))
+		tp_validate_query_index(get_tpquery_index_oid(query), info->index);
+
+	filter = palloc0(sizeof(TpBooleanFilter));
+
+	if (tpquery_split_patterns(query_text, &scoring_text, &patterns))
+		query_text = scoring_text;
+
+	if (tpquery_split_boolean(
+				query_text,
+				info->positions,
+				&scoring_text,
+				&required_text,
+				&excluded_text,
+				&phrases))
+	{
+		/* Without positions, a phrase's words are scored on their own */
+		if (phrases != NIL && !info->positions)
+		{
+			ereport(NOTICE,
+					(errmsg("index \"%s\" stores no positions: phrases are "
+							"matched as separate words",
+							RelationGetRelationName(info->index)),
+					 errhint("Recreate the index WITH (positions = true) to "
+							 "match phrases.")));
+			phrases = NIL;
+		}
+
+		required_count = batch_tokenize(
+				required_text,
+				info->text_config_oid,
+				&required,
+				&required_freqs);
+		filter->excluded_count = batch_tokenize(
+				excluded_text,
+				info->text_config_oid,
+				&filter->excluded,
+				&excluded_freqs);
+		has_filter = required_count > 0 || filter->excluded_count > 0;
+
+		foreach (lc, phrases)
+		{
+			TpPhrase *phrase = (TpPhrase *)lfirst(lc);
+
+			tp_phrase_analyze(phrase, info->text_config_oid);
+			if (phrase->length < 2)
+				continue;
+			if (filter->phrases == NULL)
+				filter->phrases = palloc(
+						list_length(phrases) * sizeof(TpPhrase *));
+			filter->phrases[filter->phrase_count++] = phrase;
+			has_filter								= true;
+		}
+	}
+	else
+		scoring_text = query_text;
+
+	batch_query->term_count = batch_tokenize(
+			scoring_text,
+			info->text_config_oid,
+			&batch_query->terms,
+			&batch_query->frequencies);
+	if (patterns != NIL)
+	{
+		float4 *weights;
+
+		batch_query->term_count = tp_expand_patterns(
+				info->state,
+				info->index,
+				info->text_config_oid,
+				patterns,
+				false,
+				&batch_query->terms,
+				&batch_query->frequencies,
+				&weights,
+				batch_query->term_count);
+		if (weights != NULL)
+		{
+			filter->term_weights = weights;
+			has_filter			 = true;
+		}
+	}
+
+	if (required_count > 0)
+	{
+		filter->required = palloc0(
+				Max(batch_query->term_count, 1) * sizeof(bool));
+		for (i = 0; i < batch_query->term_count; i++)
+		{
+			for (j = 0; j < required_count; j++)
+			{
+				if (strcmp(batch_query->terms[i], required[j]) == 0)
+				{
+					filter->required[i] = true;
+					filter->required_count++;
+					break;
+				}
+			}
+		}
+	}
+
+	filter->min_should_match = get_tpquery_min_should_match(query);
+	if (filter->min_should_match > 0)
+		has_filter = true;
+
+	batch_query->filter = has_filter ? filter : NULL;
+
+	/*
+	 * Every query gets a cursor, so one short of visible rows can resume
+	 * below its first batch.  The position holds the <@> value, the
+	 * negated score.
+	 */
+	batch_query->cursor		  = palloc0(sizeof(TpScoreCursor));
+	batch_query->cursor->mcxt = CurrentMemoryContext;
+	if (get_tpquery_search_after(query, &after_score, &after_ctid))
+		tp_score_cursor_start_after(
+				batch_query->cursor, -after_score, &after_ctid);
+
+	if (get_tpquery_prior(query, &prior))
+	{
+		if (!tp_index_has_prior(info->index))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("index \"%s\" stores no static prior",
+							RelationGetRelationName(info->index))));
+		prior_copy		   = palloc(sizeof(TpQueryPrior));
+		*prior_copy		   = prior;
+		batch_query->prior = prior_copy;
+	}
+}
+
+/*
+ * Open the batch's index, checking that it is a BM25 index on a table
+ * the caller may read in full
+ */
+static Relation
+batch_open_index(const char *index_name)
+{
+	Oid		 index_oid = tp_resolve_index_name_shared(index_name);
+	Relation index;
+	Oid		 heap_oid;
+
+	if (!OidIsValid(index_oid))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_TABLE),
+				 errmsg("index \"%s\" not found", index_name)));
+
+	index = index_open(index_oid, AccessShareLock);
+	if (index->rd_rel->relam != get_am_oid("bm25", false))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a BM25 index", index_name)));
+	if (index->rd_rel->relkind != RELKIND_INDEX)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("bm25_search_batch does not support partitioned "
+						"indexes"),
+				 errhint("Pass the index of one partition.")));
+
+	/*
+	 * The function reads the index directly, so it checks what a scan
+	 * of the table would: the privilege to read it and, since results
+	 * are not filtered per row, the absence of row-level security.
+	 */
+	heap_oid = index->rd_index->indrelid;
+	if (pg_class_aclcheck(heap_oid, GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+		aclcheck_error(
+				ACLCHECK_NO_PRIV,
+				get_relkind_objtype(get_rel_relkind(heap_oid)),
+				get_rel_name(heap_oid));
+	if (check_enable_rls(heap_oid, InvalidOid, false) == RLS_ENABLED)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("bm25_search_batch does not support tables with "
+						"row-level security")));
+
+	return index;
+}
+
+/*
+ * Append the query's scored rows the snapshot can see to *visible, up
+ * to k, as the heap TIDs of the visible versions
+ */
+static void
+batch_filter_visible(
+		Relation			heap,
+		Snapshot			snapshot,
+		const TpBatchQuery *query,
+		BatchVisible	   *visible,
+		int					k)
+{
+	IndexFetchTableData *fetch = table_index_fetch_begin(heap);
+	TupleTableSlot		*slot  = table_slot_create(heap, NULL);
+	int					 i;
+
+	for (i = 0; i < query->result_count && visible->count < k; i++)
+	{
+		ItemPointerData tid		   = query->result_ctids[i];
+		bool			call_again = false;
+		bool			all_dead   = false;
+
+		if (!table_index_fetch_tuple(
+					fetch, &tid, snapshot, slot, &call_again, &all_dead))
+			continue;
+
+		visible->ctids[visible->count]	= slot->tts_tid;
+		visible->scores[visible->count] = query->result_scores[i];
+		visible->count++;
+		ExecClearTuple(slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_index_fetch_end(fetch);
+}
+
+PG_FUNCTION_INFO_V1(bm25_search_batch);
+
+/*
+ * SQL-callable: bm25_search_batch(index_name text, queries bm25query[],
+ * k integer) → SETOF (query_ordinal, ctid, score)
+ *
+ * Returns the top k documents of every query, by query ordinal (1-based
+ * position in the array) and then rank.  score is the value <@> gives
+ * the document, i.e. the negated BM25 score.  Only rows visible to the
+ * active snapshot are returned.  NULL array elements and queries
+ * without terms return no rows.
+ */
+Datum
+bm25_search_batch(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo  *rsinfo		= (ReturnSetInfo *)fcinfo->resultinfo;
+	char		   *index_name	= text_to_cstring(PG_GETARG_TEXT_PP(0));
+	ArrayType	   *query_array	= PG_GETARG_ARRAYTYPE_P(1);
+	int32			k			= PG_GETARG_INT32(2);
+	BatchIndexInfo	info;
+	TpIndexMetaPage	metap;
+	TpBatchQuery   *queries;
+	BatchVisible   *visible;
+	Relation		heap;
+	Snapshot		snapshot = GetActiveSnapshot();
+	int				limit	 = k;
+	int				pending;
+	Datum		   *elems;
+	bool		   *elem_nulls;
+	int				nelems;
+	int16			elmlen;
+	bool			elmbyval;
+	char			elmalign;
+	float4			k1;
+	float4			b;
+	int				q;
+	int				i;
+
+	if (k < 1 || k > TP_MAX_QUERY_LIMIT)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("k must be between 1 and %d", TP_MAX_QUERY_LIMIT)));
+
+	info.index = batch_open_index(index_name);
+
+	metap = tp_get_metapage(info.index);
+	info.text_config_oid = metap->text_config_oid;
+	k1					 = metap->k1;
+	b					 = metap->b;
+	pfree(metap);
+	if (!OidIsValid(info.text_config_oid))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("index \"%s\" has no text search configuration",
+						index_name)));
+	info.positions = tp_index_has_positions(info.index);
+
+	info.state = tp_get_local_index_state(RelationGetRelid(info.index));
+	if (!info.state)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not get index state for BM25 search")));
+
+	get_typlenbyvalalign(
+			ARR_ELEMTYPE(query_array), &elmlen, &elmbyval, &elmalign);
+	deconstruct_array(
+			query_array,
+			ARR_ELEMTYPE(query_array),
+			elmlen,
+			elmbyval,
+			elmalign,
+			&elems,
+			&elem_nulls,
+			&nelems);
+
+	/* Analyze every query before taking the index lock */
+	queries = palloc0(Max(nelems, 1) * sizeof(TpBatchQuery));
+	for (q = 0; q < nelems; q++)
+	{
+		if (!elem_nulls[q])
+			batch_prepare_query(
+					(TpQuery *)PG_DETOAST_DATUM(elems[q]), &info, &queries[q]);
+	}
+
+	visible = palloc0(Max(nelems, 1) * sizeof(BatchVisible));
+	for (q = 0; q < nelems; q++)
+	{
+		visible[q].ctids  = palloc(k * sizeof(ItemPointerData));
+		visible[q].scores = palloc(k * sizeof(float4));
+	}
+
+	heap = table_open(info.index->rd_index->indrelid, AccessShareLock);
+
+	/*
+	 * Score every query, keep the rows the snapshot sees, and rescore
+	 * the queries left short of k below what they have returned, with a
+	 * doubled limit, as an index scan does.  A query is done once it has
+	 * k rows or a batch came back short; tp_score_batch skips those
+	 * without terms, so a finished query's terms are dropped.
+	 */
+	do
+	{
+		tp_acquire_index_lock(info.state, LW_SHARED);
+		tp_score_batch(info.state, info.index, queries, nelems, k1, b, limit);
+		tp_release_index_lock(info.state);
+
+		pending = 0;
+		for (q = 0; q < nelems; q++)
+		{
+			TpBatchQuery *query = &queries[q];
+
+			if (query->term_count == 0)
+				continue;
+
+			batch_filter_visible(heap, snapshot, query, &visible[q], k);
+			if (visible[q].count < k && query->result_count == limit &&
+				limit < TP_MAX_QUERY_LIMIT)
+			{
+				tp_score_cursor_advance(
+						query->cursor,
+						query->result_ctids,
+						query->result_scores,
+						query->result_count);
+				pending++;
+			}
+			else
+				query->term_count = 0;
+		}
+		limit = Min(limit * 2, TP_MAX_QUERY_LIMIT);
+	} while (pending > 0);
+
+	table_close(heap, AccessShareLock);
+
+	InitMaterializedSRF(fcinfo, 0);
+	for (q = 0; q < nelems; q++)
+	{
+		for (i = 0; i < visible[q].count; i++)
+		{
+			Datum  values[3];
+			bool   nulls[3] = {false, false, false};
+			float4 score	= visible[q].scores[i];
+
+			values[0] = Int32GetDatum(q + 1);
+			values[1] = PointerGetDatum(&visible[q].ctids[i]);
+			values[2] = Float8GetDatum((float8)(score > 0 ? -score : score));
+			tuplestore_putvalues(
+					rsinfo->setResult, rsinfo->setDesc, values, nulls);
+		}
+	}
+
+	index_close(info.index, AccessShareLock);
+	return (Datum)0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * block_score.c - Whole-block BM25 scoring for one term
+ *
+ * Scores a decoded posting block against a per-query fieldnorm table
+ * and filters it against the top-k threshold in bulk.  Uses SSE2 on
+ * x86-64 and NEON on ARM64 for four postings at a time, following
+ * segment/compression.c; other platforms use the scalar loop.
+ */
+#include <postgres.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TP_SIMD_SSE2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TP_SIMD_NEON 1
+#endif
+
+#include "scoring/block_score.h"
+#include "segment/fieldnorm.h"
+
+/*
+ * Precompute the length normalization of every fieldnorm.  Lengths are
+ * truncated to uint16 as the segment iterator reports them
+ * (TpSegmentPosting.doc_length), which per-posting scoring uses.
+ */
+void
+tp_block_scorer_init(
+		TpBlockScorer *scorer,
+		float4		   idf,
+		float4		   k1,
+		float4		   b,
+		float4		   avg_doc_len)
+{
+	int i;
+
+	scorer->idf		  = idf;
+	scorer->k1_plus_1 = k1 + 1.0f;
+
+	for (i = 0; i < 256; i++)
+	{
+		int32  doc_len	= (uint16)decode_fieldnorm((uint8)i);
+		float4 len_norm = 1.0f - b + b * ((float4)doc_len / avg_doc_len);
+
+		scorer->length_norm[i] = k1 * len_norm;
+	}
+}
+
+/* Score one posting: idf * tf * (k1 + 1) / (tf + length_norm) */
+static inline float4
+block_score_one(const TpBlockScorer *scorer, const TpBlockPosting *posting)
+{
+	float4 tf = (float4)posting->frequency;
+
+	return scorer->idf *
+		   ((tf * scorer->k1_plus_1) /
+			(tf + scorer->length_norm[posting->fieldnorm]));
+}
+
+uint32
+tp_block_scorer_score(
+		const TpBlockScorer	 *scorer,
+		const TpBlockPosting *postings,
+		uint32				  count,
+		float4				  threshold,
+		float4				 *scores,
+		uint8				 *candidates)
+{
+	uint32 ncandidates = 0;
+	uint32 i		   = 0;
+
+	Assert(count <= TP_BLOCK_SIZE);
+
+#if defined(TP_SIMD_SSE2)
+	{
+		__m128 vidf		  = _mm_set1_ps(scorer->idf);
+		__m128 vk1_plus_1 = _mm_set1_ps(scorer->k1_plus_1);
+		__m128 vthreshold = _mm_set1_ps(threshold);
+		uint32 simd_end	  = count & ~3U;
+
+		for (; i < simd_end; i += 4)
+		{
+			const TpBlockPosting *p = &postings[i];
+			__m128				  tf;
+			__m128				  norm;
+			__m128				  score;
+			int					  mask;
+			int					  j;
+
+			tf = _mm_setr_ps(
+					(float4)p[0].frequency,
+					(float4)p[1].frequency,
+					(float4)p[2].frequency,
+					(float4)p[3].frequency);
+			norm = _mm_setr_ps(
+					scorer->length_norm[p[0].fieldnorm],
+					scorer->length_norm[p[1].fieldnorm],
+					scorer->length_norm[p[2].fieldnorm],
+					scorer->length_norm[p[3].fieldnorm]);
+			score = _mm_mul_ps(
+					vidf,
+					_mm_div_ps(
+							_mm_mul_ps(tf, vk1_plus_1), _mm_add_ps(tf, norm)));
+			_mm_storeu_ps(scores + i, score);
+
+			/* Branchless compaction of the lanes at or above threshold */
+			mask = _mm_movemask_ps(_mm_cmpge_ps(score, vthreshold));
+			for (j = 0; j < 4; j++)
+			{
+				candidates[ncandidates] = (uint8)(i + j);
+				ncandidates += (mask >> j) & 1;
+			}
+		}
+	}
+#elif defined(TP_SIMD_NEON)
+	{
+		float32x4_t vidf	   = vdupq_n_f32(scorer->idf);
+		float32x4_t vk1_plus_1 = vdupq_n_f32(scorer->k1_plus_1);
+		float32x4_t vthreshold = vdupq_n_f32(threshold);
+		uint32		simd_end   = count & ~3U;
+
+		for (; i < simd_end; i += 4)
+		{
+			const TpBlockPosting *p = &postings[i];
+			float4				  tf_vals[4];
+			float4				  norm_vals[4];
+			uint32				  above[4];
+			float32x4_t			  tf;
+			float32x4_t			  score;
+			int					  j;
+
+			for (j = 0; j < 4; j++)
+			{
+				tf_vals[j]	 = (float4)p[j].frequency;
+				norm_vals[j] = scorer->length_norm[p[j].fieldnorm];
+			}
+			tf	  = vld1q_f32(tf_vals);
+			score = vmulq_f32(
+					vidf,
+					vdivq_f32(
+							vmulq_f32(tf, vk1_plus_1),
+							vaddq_f32(tf, vld1q_f32(norm_vals))));
+			vst1q_f32(scores + i, score);
+
+			vst1q_u32(above, vcgeq_f32(score, vthreshold));
+			for (j = 0; j < 4; j++)
+			{
+				candidates[ncandidates] = (uint8)(i + j);
+				ncandidates += above[j] & 1;
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		scores[i]				= block_score_one(scorer, &postings[i]);
+		candidates[ncandidates] = (uint8)i;
+		ncandidates += scores[i] >= threshold;
+	}
+
+	return ncandidates;
+}
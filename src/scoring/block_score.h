@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * block_score.h - Whole-block BM25 scoring for one term
+ *
+ * A segment block holds up to TP_BLOCK_SIZE postings whose lengths are
+ * one-byte fieldnorms, so the length part of BM25,
+ *
+ *   k1 * (1 - b + b * dl / avgdl)
+ *
+ * takes at most 256 values per query term.  TpBlockScorer precomputes
+ * them once; scoring a block is then a table lookup, one add, one
+ * multiply and one divide per posting, done four at a time with SIMD
+ * where available.  Scores are bit-identical to compute_bm25_score in
+ * bmw.c: the same float operations run in the same order.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "segment/format.h"
+
+/* Per-query-term scoring state */
+typedef struct TpBlockScorer
+{
+	float4 idf;
+	float4 k1_plus_1;
+	float4 length_norm[256]; /* k1 * (1 - b + b * dl / avgdl), by fieldnorm */
+} TpBlockScorer;
+
+extern void tp_block_scorer_init(
+		TpBlockScorer *scorer,
+		float4		   idf,
+		float4		   k1,
+		float4		   b,
+		float4		   avg_doc_len);
+
+/*
+ * Score count (<= TP_BLOCK_SIZE) postings into scores[] and store, in
+ * block order, the indexes of those scoring at least threshold into
+ * candidates[].  Returns the number of candidates.
+ */
+extern uint32 tp_block_scorer_score(
+		const TpBlockScorer	 *scorer,
+		const TpBlockPosting *postings,
+		uint32				  count,
+		float4				  threshold,
+		float4				 *scores,
+		uint8				 *candidates);
@@ -6,6 +6,10 @@
  */
 #include <postgres.h>
 
+#include <access/htup_details.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <lib/stringinfo.h>
 #include <math.h>
 #include <storage/itemptr.h>
 #include <utils/memutils.h>
@@ -17,6 +21,8 @@
 #include "memtable/chain_source.h"
 #include "scoring/bm25.h"
 #include "scoring/bmw.h"
+#include "scoring/doc_freq_cache.h"
+#include "scoring/partition.h"
 #include "segment/segment.h"
 
 /*
@@ -35,49 +41,40 @@ tp_calculate_idf(int32 doc_freq, int32 total_docs)
 }
 
 /*
- * Get unified doc_freq for a term (memtable + all segments).
- * Returns 0 if term not found in any source.
- *
- * Per issue #374: `memtable_src` is a (possibly NULL) chain
- * source; we read the per-term doc_freq via the source op without
- * materializing the full posting list (which would be O(count) and
- * is wasteful for IDF lookup).
+ * Add each term's doc_freq in every segment level to doc_freqs
  */
-static uint32
-tp_get_unified_doc_freq(
-		TpDataSource *memtable_src,
-		Relation	  index,
-		const char	 *term,
-		BlockNumber	 *level_heads)
+static void
+add_segment_doc_freqs(
+		Relation	 index,
+		char	   **terms,
+		int			 term_count,
+		BlockNumber *level_heads,
+		uint32		*doc_freqs)
 {
-	uint32 doc_freq = 0;
-	int	   level;
-
-	/* Get doc_freq from memtable chain source */
-	if (memtable_src != NULL)
-		doc_freq = tp_source_get_doc_freq(memtable_src, term);
+	int level;
 
-	/* Add doc_freq from all segment levels */
+	/* Batch lookup: opens each segment once for all terms */
 	for (level = 0; level < TP_MAX_LEVELS; level++)
 	{
 		if (level_heads[level] != InvalidBlockNumber)
 		{
-			doc_freq +=
-					tp_segment_get_doc_freq(index, level_heads[level], term);
+			tp_batch_get_segment_doc_freq(
+					index, level_heads[level], terms, term_count, doc_freqs);
 		}
 	}
-
-	return doc_freq;
 }
 
 /*
  * Batch get unified doc_freq for multiple terms (memtable + all segments).
- * Much faster than calling tp_get_unified_doc_freq in a loop because
- * it opens each segment only once instead of once per term.
+ * Opens each segment only once instead of once per term.
  *
  * Per issue #374: `memtable_src` is a (possibly NULL) chain
  * source; we read each term's doc_freq via the source op without
  * materializing posting lists.
+ *
+ * The segment part comes from the shared doc_freq cache when it was
+ * computed against the current segment set, so hot terms skip the
+ * dictionaries; only the terms it misses are probed, then stored.
  */
 static void
 tp_batch_get_unified_doc_freq(
@@ -88,77 +85,186 @@ tp_batch_get_unified_doc_freq(
 		BlockNumber	 *level_heads,
 		uint32		 *doc_freqs)
 {
-	int level;
-	int i;
+	TpDocFreqGeneration generation;
+	int					i;
 
-	/* Initialize doc_freqs with memtable counts */
-	for (i = 0; i < term_count; i++)
+	if (term_count > 0 &&
+		tp_doc_freq_cache_get_generation(index, level_heads, &generation))
 	{
-		doc_freqs[i] = 0;
-		if (memtable_src != NULL)
-			doc_freqs[i] = tp_source_get_doc_freq(memtable_src, terms[i]);
-	}
+		Oid		index_oid	= RelationGetRelid(index);
+		uint32 *segment_dfs = palloc0(term_count * sizeof(uint32));
+		bool   *found		= palloc0(term_count * sizeof(bool));
+		int		hits;
 
-	/* Add doc_freq from all segment levels (batch lookup) */
-	for (level = 0; level < TP_MAX_LEVELS; level++)
-	{
-		if (level_heads[level] != InvalidBlockNumber)
+		hits = tp_doc_freq_cache_lookup(
+				index_oid, &generation, terms, term_count, segment_dfs, found);
+		if (hits < term_count)
 		{
-			tp_batch_get_segment_doc_freq(
-					index, level_heads[level], terms, term_count, doc_freqs);
+			char  **missed	   = palloc(term_count * sizeof(char *));
+			uint32 *missed_dfs = palloc0(term_count * sizeof(uint32));
+			int		miss_count = 0;
+			int		j		   = 0;
+
+			for (i = 0; i < term_count; i++)
+			{
+				if (!found[i])
+					missed[miss_count++] = terms[i];
+			}
+			add_segment_doc_freqs(
+					index, missed, miss_count, level_heads, missed_dfs);
+			for (i = 0; i < term_count; i++)
+			{
+				if (!found[i])
+					segment_dfs[i] = missed_dfs[j++];
+			}
+			tp_doc_freq_cache_store(
+					index_oid,
+					&generation,
+					terms,
+					term_count,
+					segment_dfs,
+					found);
+			pfree(missed);
+			pfree(missed_dfs);
 		}
+
+		for (i = 0; i < term_count; i++)
+			doc_freqs[i] = segment_dfs[i];
+		pfree(segment_dfs);
+		pfree(found);
+	}
+	else
+	{
+		for (i = 0; i < term_count; i++)
+			doc_freqs[i] = 0;
+		add_segment_doc_freqs(
+				index, terms, term_count, level_heads, doc_freqs);
+	}
+
+	/* Add memtable counts */
+	if (memtable_src != NULL)
+	{
+		for (i = 0; i < term_count; i++)
+			doc_freqs[i] += tp_source_get_doc_freq(memtable_src, terms[i]);
 	}
 }
 
 /*
- * Score documents using BM25 algorithm
- * Returns number of documents scored
+ * Nothing can match if a required term occurs nowhere, if fewer
+ * optional terms occur anywhere than min_should_match asks for, or if
+ * the allowed set is empty
  */
-int
-tp_score_documents(
+static bool
+filter_unsatisfiable(
+		const TpBooleanFilter *filter, const uint32 *doc_freqs, int term_count)
+{
+	int optional_present = 0;
+	int i;
+
+	if (filter == NULL)
+		return false;
+	if (filter->allowed != NULL && filter->allowed_count == 0)
+		return true;
+
+	for (i = 0; i < term_count; i++)
+	{
+		bool required = filter->required != NULL && filter->required[i];
+
+		if (required && doc_freqs[i] == 0)
+			return true;
+		if (!required && doc_freqs[i] > 0)
+			optional_present++;
+	}
+	return optional_present < filter->min_should_match;
+}
+
+/*
+ * Open the memtable source over the given terms.  Only the chain
+ * source carries token positions, so phrase queries bypass the
+ * memtable cache.
+ */
+static TpDataSource *
+open_memtable_source_for_terms(
 		TpLocalIndexState *local_state,
 		Relation		   index_relation,
-		char			 **query_terms,
-		int32			  *query_frequencies,
-		int				   query_term_count,
-		float4			   k1,
-		float4			   b,
-		int				   max_results,
-		ItemPointer		   result_ctids,
-		float4			 **result_scores)
+		char			 **terms,
+		int				   term_count,
+		bool			   positions)
 {
-	float4			avg_doc_len;
-	int64			total_docs64;
-	int64			total_len64;
-	int32			total_docs;
-	TpIndexMetaPage metap;
-	BlockNumber		level_heads[TP_MAX_LEVELS];
-	TpDataSource   *memtable_src = NULL;
-	int				i;
-	int				result_count = 0;
-
-	/* Basic sanity checks */
-	Assert(local_state != NULL);
-	Assert(query_terms != NULL);
-	Assert(result_ctids != NULL);
-	Assert(result_scores != NULL);
+	if (positions)
+		return tp_memtable_chain_source_create(
+				local_state,
+				index_relation,
+				(const char *const *)terms,
+				term_count);
+	return tp_memtable_source_create_for_read(
+			local_state,
+			index_relation,
+			(const char *const *)terms,
+			term_count);
+}
 
-	if (query_term_count <= 0 || max_results <= 0)
-		return 0;
+/*
+ * Open the memtable for a query.  The source only materializes
+ * postings for the terms it is given, so excluded terms are passed
+ * along with the query terms.
+ */
+static TpDataSource *
+open_memtable_source(
+		TpLocalIndexState	  *local_state,
+		Relation			   index_relation,
+		char				 **query_terms,
+		int					   query_term_count,
+		const TpBooleanFilter *filter)
+{
+	TpDataSource *source;
+	char		**source_terms		= query_terms;
+	int			  source_term_count = query_term_count;
 
-	if (!local_state->shared)
+	if (filter != NULL && filter->excluded_count > 0)
 	{
-		elog(ERROR, "tp_score_documents: shared state is NULL!");
-		return 0;
+		source_term_count += filter->excluded_count;
+		source_terms = palloc(source_term_count * sizeof(char *));
+		memcpy(source_terms, query_terms, query_term_count * sizeof(char *));
+		memcpy(source_terms + query_term_count,
+			   filter->excluded,
+			   filter->excluded_count * sizeof(char *));
 	}
 
-	/*
-	 * Per issue #374: totals come from `metap` (persisted
-	 * segments) + the chain source (active memtable on disk).
-	 * The shmem atomic is still bumped on the primary for vacuum's
-	 * shrinkage protocol but is not authoritative for queries (it
-	 * would drift on standbys and freshly-opened backends).
-	 */
+	source = open_memtable_source_for_terms(
+			local_state,
+			index_relation,
+			source_terms,
+			source_term_count,
+			filter != NULL && filter->phrase_count > 0);
+
+	if (source_terms != query_terms)
+		pfree(source_terms);
+	return source;
+}
+
+/*
+ * Read the segment set and corpus totals of a serial scan.
+ *
+ * Per issue #374: totals come from `metap` (persisted segments) + the
+ * chain source (active memtable on disk).  The shmem atomic is still
+ * bumped on the primary for vacuum's shrinkage protocol but is not
+ * authoritative for queries (it would drift on standbys and
+ * freshly-opened backends).
+ */
+static void
+read_corpus_stats(
+		Relation	  index_relation,
+		TpDataSource *memtable_src,
+		BlockNumber	 *level_heads,
+		int32		 *total_docs,
+		float4		 *avg_doc_len)
+{
+	TpIndexMetaPage metap;
+	int64			total_docs64;
+	int64			total_len64;
+	int				i;
+
 	metap = tp_get_metapage(index_relation);
 	for (i = 0; i < TP_MAX_LEVELS; i++)
 		level_heads[i] = metap->level_heads[i];
@@ -166,65 +272,422 @@ tp_score_documents(
 	total_len64	 = (int64)metap->total_len;
 	pfree(metap);
 
-	memtable_src = tp_memtable_source_create_for_read(
-			local_state,
-			index_relation,
-			(const char *const *)query_terms,
-			query_term_count);
 	if (memtable_src != NULL)
 	{
 		total_docs64 += memtable_src->total_docs;
 		total_len64 += memtable_src->total_len;
 	}
 
-	total_docs	= (total_docs64 > PG_INT32_MAX) ? PG_INT32_MAX
-												: (int32)total_docs64;
-	avg_doc_len = total_docs > 0
-						? (float4)((double)total_len64 / (double)total_docs)
-						: 0.0f;
+	*total_docs	 = (total_docs64 > PG_INT32_MAX) ? PG_INT32_MAX
+												 : (int32)total_docs64;
+	*avg_doc_len = *total_docs > 0
+						   ? (float4)((double)total_len64 / (double)*total_docs)
+						   : 0.0f;
+}
+
+/* Did the last score_query stop at its scoring budget? */
+static bool last_score_partial = false;
+
+bool
+tp_score_was_partial(void)
+{
+	return last_score_partial;
+}
+
+/* Segments this backend scored with each multi-term evaluator */
+static uint64 segments_wand		   = 0;
+static uint64 segments_maxscore	   = 0;
+static uint64 segments_conjunctive = 0;
+
+/*
+ * Log BMW statistics for one query (tp_log_bmw_stats)
+ */
+static void
+log_bmw_stats(TpBMWStats *stats)
+{
+	elog(LOG,
+		 "BMW stats: memtable=%lu docs, segments=%lu docs "
+		 "(blocks: %lu scanned, %lu skipped, %.1f%% skip), "
+		 "seeks=%lu, results=%lu, "
+		 "segments: %lu wand, %lu maxscore, %lu conjunctive, %lu pruned, "
+		 "excluded=%lu, filtered=%lu, returned_earlier=%lu, "
+		 "below_threshold=%lu, approximate_skips=%lu, "
+		 "unvisited_segments=%lu%s, "
+		 "terms: %lu dropped, %lu probe-only",
+		 (unsigned long)stats->memtable_docs,
+		 (unsigned long)stats->segment_docs_scored,
+		 (unsigned long)stats->blocks_scanned,
+		 (unsigned long)stats->blocks_skipped,
+		 (stats->blocks_scanned + stats->blocks_skipped) > 0
+				 ? 100.0 * stats->blocks_skipped /
+						   (stats->blocks_scanned + stats->blocks_skipped)
+				 : 0.0,
+		 (unsigned long)stats->seeks_performed,
+		 (unsigned long)stats->docs_in_results,
+		 (unsigned long)stats->segments_wand,
+		 (unsigned long)stats->segments_maxscore,
+		 (unsigned long)stats->segments_conjunctive,
+		 (unsigned long)stats->segments_pruned,
+		 (unsigned long)stats->docs_excluded,
+		 (unsigned long)stats->docs_filtered,
+		 (unsigned long)stats->docs_returned_earlier,
+		 (unsigned long)stats->postings_pruned,
+		 (unsigned long)stats->blocks_skipped_approx,
+		 (unsigned long)stats->segments_unvisited,
+		 stats->budget_exhausted ? " (budget exhausted)" : "",
+		 (unsigned long)stats->terms_dropped,
+		 (unsigned long)stats->terms_probe_only);
+}
+
+/*
+ * Low-IDF term pruning (pg_textsearch.term_pruning_epsilon)
+ *
+ * A term adds at most idf * (k1 + 1) * its query frequency to any
+ * score, the limit of the BM25 tf factor.  Long natural-language
+ * queries carry near-stopwords whose bound is close to 0 but whose
+ * long posting lists still drive WAND.  Optional terms are taken by
+ * ascending bound: they are dropped while their bounds sum to at most
+ * epsilon, so no score moves by more than epsilon, and the rest whose
+ * own bound is at most epsilon become probe-only (see
+ * TpBooleanFilter).  Without required terms the strongest optional
+ * term always drives; with min_should_match nothing is pruned, since
+ * every term counts toward it.
+ */
+typedef struct TpTermPruning
+{
+	char		  **terms; /* Terms kept, in query order */
+	int32		   *frequencies;
+	float4		   *idfs;
+	int				term_count;
+	TpBooleanFilter filter; /* The query's, per-term arrays compacted */
+	int				dropped;
+	int				probed;
+	StringInfoData	decisions; /* For tp_log_bmw_stats */
+} TpTermPruning;
+
+typedef struct TpTermBound
+{
+	int	   idx;
+	float4 bound;
+} TpTermBound;
+
+static int
+compare_term_bounds(const void *a, const void *b)
+{
+	const TpTermBound *ta = (const TpTermBound *)a;
+	const TpTermBound *tb = (const TpTermBound *)b;
+
+	if (ta->bound != tb->bound)
+		return ta->bound < tb->bound ? -1 : 1;
+	return ta->idx - tb->idx;
+}
+
+#define TP_TERM_KEPT	0
+#define TP_TERM_PROBED	1
+#define TP_TERM_DROPPED 2
+
+/*
+ * Decide which terms of a query to drop or demote.  Returns false if
+ * every term stays as it is.
+ */
+static bool
+prune_weak_terms(
+		char				 **terms,
+		int32				  *frequencies,
+		const float4		  *idfs,
+		int					   term_count,
+		const TpBooleanFilter *filter,
+		float4				   k1,
+		TpTermPruning		  *pruning)
+{
+	const bool	*required = filter != NULL ? filter->required : NULL;
+	TpTermBound *optional;
+	uint8		*fate;
+	bool		*probe_only;
+	bool		*kept_required	= NULL;
+	float4		*kept_weights	= NULL;
+	double		 dropped_sum	= 0.0;
+	int			 optional_count = 0;
+	int			 candidates;
+	int			 i;
+	int			 j;
+
+	memset(pruning, 0, sizeof(TpTermPruning));
+	if (tp_term_pruning_epsilon <= 0.0 || term_count < 2 ||
+		(filter != NULL && filter->min_should_match > 0))
+		return false;
+
+	optional = palloc(term_count * sizeof(TpTermBound));
+	for (i = 0; i < term_count; i++)
+	{
+		if (required != NULL && required[i])
+			continue;
+		optional[optional_count].idx   = i;
+		optional[optional_count].bound = idfs[i] * (k1 + 1.0f) *
+										 frequencies[i];
+		optional_count++;
+	}
+	qsort(optional, optional_count, sizeof(TpTermBound), compare_term_bounds);
+
+	candidates = optional_count;
+	if (filter == NULL || filter->required_count == 0)
+		candidates--; /* The strongest drives */
 
-	if (total_docs <= 0 || avg_doc_len <= 0.0f)
+	fate = palloc0(term_count * sizeof(uint8));
+	for (j = 0; j < candidates; j++)
 	{
-		if (memtable_src != NULL)
-			tp_source_close(memtable_src);
-		return 0;
+		float4 bound = optional[j].bound;
+
+		if (dropped_sum + bound <= tp_term_pruning_epsilon)
+		{
+			dropped_sum += bound;
+			fate[optional[j].idx] = TP_TERM_DROPPED;
+			pruning->dropped++;
+		}
+		else if (bound <= tp_term_pruning_epsilon)
+		{
+			fate[optional[j].idx] = TP_TERM_PROBED;
+			pruning->probed++;
+		}
+		else
+			break; /* Bounds only grow from here */
 	}
+	pfree(optional);
+
+	if (pruning->dropped == 0 && pruning->probed == 0)
+	{
+		pfree(fate);
+		return false;
+	}
+
+	/* Compact the query to the terms kept */
+	pruning->terms		 = palloc(term_count * sizeof(char *));
+	pruning->frequencies = palloc(term_count * sizeof(int32));
+	pruning->idfs		 = palloc(term_count * sizeof(float4));
+	probe_only			 = palloc0(term_count * sizeof(bool));
+	if (required != NULL)
+		kept_required = palloc(term_count * sizeof(bool));
+	if (filter != NULL && filter->term_weights != NULL)
+		kept_weights = palloc(term_count * sizeof(float4));
+	if (tp_log_bmw_stats)
+		initStringInfo(&pruning->decisions);
+
+	pruning->term_count = 0;
+	for (i = 0; i < term_count; i++)
+	{
+		int n = pruning->term_count;
+
+		if (tp_log_bmw_stats && fate[i] != TP_TERM_KEPT)
+			appendStringInfo(
+					&pruning->decisions,
+					"%s%s %s (bound %.4f)",
+					pruning->decisions.len > 0 ? ", " : "",
+					fate[i] == TP_TERM_DROPPED ? "dropped" : "probe-only",
+					terms[i],
+					idfs[i] * (k1 + 1.0f) * frequencies[i]);
+		if (fate[i] == TP_TERM_DROPPED)
+			continue;
+
+		pruning->terms[n]		= terms[i];
+		pruning->frequencies[n] = frequencies[i];
+		pruning->idfs[n]		= idfs[i];
+		probe_only[n]			= fate[i] == TP_TERM_PROBED;
+		if (kept_required != NULL)
+			kept_required[n] = required[i];
+		if (kept_weights != NULL)
+			kept_weights[n] = filter->term_weights[i];
+		pruning->term_count++;
+	}
+	pfree(fate);
+
+	if (filter != NULL)
+		pruning->filter = *filter;
+	else
+		memset(&pruning->filter, 0, sizeof(TpBooleanFilter));
+	if (pruning->probed == 0)
+	{
+		pfree(probe_only);
+		probe_only = NULL;
+	}
+	pruning->filter.required	 = kept_required;
+	pruning->filter.term_weights = kept_weights;
+	pruning->filter.probe_only	 = probe_only;
+
+	return true;
+}
+
+/*
+ * Free what prune_weak_terms allocated, except the idfs the caller
+ * scored with.  Cursor batches and parallel passes prune once each in
+ * the scan's long-lived context.
+ */
+static void
+free_term_pruning(TpTermPruning *pruning)
+{
+	pfree(pruning->terms);
+	pfree(pruning->frequencies);
+	if (pruning->filter.required)
+		pfree(pruning->filter.required);
+	if (pruning->filter.term_weights)
+		pfree((void *)pruning->filter.term_weights);
+	if (pruning->filter.probe_only)
+		pfree((void *)pruning->filter.probe_only);
+	if (pruning->decisions.data)
+		pfree(pruning->decisions.data);
+}
+
+/*
+ * Rank one query against corpus statistics the caller has already
+ * gathered: `doc_freqs` are the query terms' unified document
+ * frequencies over `level_heads` plus `memtable_src`.  Returns the
+ * number of results, leaving *result_scores untouched when nothing
+ * can match.  `shared_threshold` (may be NULL) is the top-k threshold
+ * shared with other scans of the query.  `prior` (may be NULL) adds a
+ * static prior bonus to every score (see scoring/prior.h).
+ */
+static int
+score_query(
+		TpLocalIndexState	  *local_state,
+		Relation			   index_relation,
+		TpDataSource		  *memtable_src,
+		const BlockNumber	  *level_heads,
+		TpParallelScanState	  *parallel,
+		TpScoreCursor		  *cursor,
+		pg_atomic_uint32	  *shared_threshold,
+		const TpQueryPrior	  *prior,
+		char				 **query_terms,
+		int32				  *query_frequencies,
+		int					   query_term_count,
+		const TpBooleanFilter *filter,
+		const uint32		  *doc_freqs,
+		int32				   total_docs,
+		float4				   avg_doc_len,
+		float4				   k1,
+		float4				   b,
+		int					   max_results,
+		ItemPointer			   result_ctids,
+		float4				 **result_scores)
+{
+	float4		 *idfs;
+	float4		 *scores;
+	TpBMWStats	  stats;
+	TpTermPruning pruning;
+	bool		  pruned;
+	int			  i;
+	int			  result_count = 0;
+
+	last_score_partial = false;
+
+	if (total_docs <= 0 || avg_doc_len <= 0.0f ||
+		(query_term_count == 1 && doc_freqs[0] == 0) ||
+		filter_unsatisfiable(filter, doc_freqs, query_term_count))
+		return 0;
 
 	/*
-	 * BMW fast path for single-term queries.
-	 * Uses Block-Max WAND to skip blocks that can't contribute to top-k.
+	 * Convert doc_freqs to IDFs.  Later batches of a serial cursor
+	 * reuse the first batch's statistics: a document must score the
+	 * same in every batch for the floor to separate returned documents
+	 * from the rest, even if inserts have changed the corpus since.
 	 */
-	if (query_term_count == 1)
-	{
-		const char *term = query_terms[0];
-		uint32		doc_freq;
-		float4		idf;
-		float4	   *scores;
-		TpBMWStats	stats;
-
-		/* Get unified doc_freq across memtable and segments */
-		doc_freq = tp_get_unified_doc_freq(
-				memtable_src, index_relation, term, level_heads);
-		if (doc_freq == 0)
+	idfs = palloc(query_term_count * sizeof(float4));
+	if (cursor != NULL && cursor->idfs != NULL)
+	{
+		memcpy(idfs, cursor->idfs, query_term_count * sizeof(float4));
+		avg_doc_len = cursor->avg_doc_len;
+	}
+	else
+	{
+		for (i = 0; i < query_term_count; i++)
 		{
-			if (memtable_src != NULL)
-				tp_source_close(memtable_src);
-			return 0;
+			idfs[i] = (doc_freqs[i] > 0)
+							? tp_calculate_idf(doc_freqs[i], total_docs)
+							: 0.0f;
+			if (filter != NULL && filter->term_weights != NULL)
+				idfs[i] *= filter->term_weights[i];
+		}
+		if (cursor != NULL && parallel == NULL)
+		{
+			cursor->idfs = MemoryContextAlloc(
+					cursor->mcxt, query_term_count * sizeof(float4));
+			memcpy(cursor->idfs, idfs, query_term_count * sizeof(float4));
+			cursor->avg_doc_len		 = avg_doc_len;
+			cursor->spill_generation = pg_atomic_read_u64(
+					&local_state->shared->spill_generation);
 		}
+	}
 
-		/* Calculate IDF */
-		idf = tp_calculate_idf(doc_freq, total_docs);
+	/* Drop or demote the terms too weak to reorder the top-k */
+	pruned = prune_weak_terms(
+			query_terms,
+			query_frequencies,
+			idfs,
+			query_term_count,
+			filter,
+			k1,
+			&pruning);
+	if (pruned)
+	{
+		pfree(idfs);
+		query_terms		  = pruning.terms;
+		query_frequencies = pruning.frequencies;
+		idfs			  = pruning.idfs;
+		query_term_count  = pruning.term_count;
+		filter			  = &pruning.filter;
+	}
 
-		/* Allocate scores array */
-		scores = (float4 *)palloc(max_results * sizeof(float4));
+	/* Allocate scores array */
+	scores = (float4 *)palloc(max_results * sizeof(float4));
 
-		/* Run BMW scoring */
+	if (query_term_count == 1 &&
+		(filter == NULL ||
+		 (filter->excluded_count == 0 && filter->phrase_count == 0 &&
+		  filter->allowed == NULL)))
+	{
+		/*
+		 * BMW fast path for single-term queries.  A lone required
+		 * term needs no special handling.
+		 * Uses Block-Max WAND to skip blocks that can't contribute to top-k.
+		 */
 		result_count = tp_score_single_term_bmw(
 				local_state,
 				index_relation,
 				memtable_src,
-				term,
-				idf,
+				level_heads,
+				parallel,
+				cursor,
+				shared_threshold,
+				prior,
+				query_terms[0],
+				idfs[0],
+				k1,
+				b,
+				avg_doc_len,
+				max_results,
+				result_ctids,
+				scores,
+				&stats);
+	}
+	else
+	{
+		/*
+		 * BMW fast path for multi-term queries and for any query with
+		 * excluded terms, phrases or an allowed set.  Uses block-level upper bounds to
+		 * skip non-contributing blocks.
+		 */
+		result_count = tp_score_multi_term_bmw(
+				local_state,
+				index_relation,
+				memtable_src,
+				level_heads,
+				parallel,
+				cursor,
+				shared_threshold,
+				prior,
+				query_terms,
+				query_term_count,
+				query_frequencies,
+				idfs,
+				filter,
 				k1,
 				b,
 				avg_doc_len,
@@ -232,108 +695,734 @@ tp_score_documents(
 				result_ctids,
 				scores,
 				&stats);
+	}
 
-		/* Log BMW stats if enabled */
-		if (tp_log_bmw_stats)
-		{
+	pfree(idfs);
+	last_score_partial = stats.budget_exhausted;
+	segments_wand += stats.segments_wand;
+	segments_maxscore += stats.segments_maxscore;
+	segments_conjunctive += stats.segments_conjunctive;
+
+	if (pruned)
+	{
+		stats.terms_dropped	   = pruning.dropped;
+		stats.terms_probe_only = pruning.probed;
+	}
+
+	/* Log BMW stats if enabled */
+	if (tp_log_bmw_stats)
+	{
+		if (pruned)
 			elog(LOG,
-				 "BMW stats: memtable=%lu docs, segments=%lu docs "
-				 "(blocks: %lu scanned, %lu skipped, %.1f%% skip), "
-				 "seeks=%lu, results=%lu",
-				 (unsigned long)stats.memtable_docs,
-				 (unsigned long)stats.segment_docs_scored,
-				 (unsigned long)stats.blocks_scanned,
-				 (unsigned long)stats.blocks_skipped,
-				 (stats.blocks_scanned + stats.blocks_skipped) > 0
-						 ? 100.0 * stats.blocks_skipped /
-								   (stats.blocks_scanned +
-									stats.blocks_skipped)
-						 : 0.0,
-				 (unsigned long)stats.seeks_performed,
-				 (unsigned long)stats.docs_in_results);
-		}
+				 "BMW term pruning (epsilon %g): %s",
+				 tp_term_pruning_epsilon,
+				 pruning.decisions.data);
+		log_bmw_stats(&stats);
+	}
+
+	if (pruned)
+		free_term_pruning(&pruning);
 
-		*result_scores = scores;
-		if (memtable_src != NULL)
-			tp_source_close(memtable_src);
-		return result_count;
+	*result_scores = scores;
+	return result_count;
+}
+
+/*
+ * Return the cursor to where its scan started, dropping the floor and
+ * statistics of the batches returned since
+ */
+static void
+restart_score_cursor(TpScoreCursor *cursor)
+{
+	if (cursor->has_start)
+		tp_score_cursor_start_after(
+				cursor, cursor->start_score, &cursor->start_after);
+	else
+		tp_score_cursor_reset(cursor);
+}
+
+/*
+ * Score documents using BM25 algorithm
+ * Returns number of documents scored
+ *
+ * `parallel` is NULL for a serial scan.  In a parallel scan the
+ * corpus statistics and segment set come from the shared snapshot
+ * (see scoring/parallel.h) so that every participant produces
+ * comparable scores; only the snapshot owner scores the memtable.
+ *
+ * `filter` carries +required / -excluded terms, min_should_match and
+ * the IDF weights of fuzzy expansions (NULL for a plain disjunctive
+ * query).
+ *
+ * `cursor` (may be NULL) admits only documents after its position.
+ * Parallel scans use it for a search-after position only: their
+ * participants claim different segments on every pass, so they never
+ * resume batches.
+ *
+ * `partition` is NULL unless this is a ranked scan of one partition of
+ * a partitioned index.  With pg_textsearch.partition_global_stats on,
+ * such a scan scores with the whole partitioned index's statistics and
+ * its first pass prunes against the threshold shared by the scans of
+ * the other partitions (see scoring/partition.h).
+ *
+ * `prior` (may be NULL) is the query's static prior weighting.
+ */
+int
+tp_score_documents(
+		TpLocalIndexState	*local_state,
+		Relation			 index_relation,
+		char			   **query_terms,
+		int32				*query_frequencies,
+		int					 query_term_count,
+		const TpBooleanFilter *filter,
+		float4				 k1,
+		float4				 b,
+		int					 max_results,
+		TpParallelScanState *parallel,
+		TpPartitionScanState *partition,
+		TpScoreCursor		*cursor,
+		const TpQueryPrior	*prior,
+		ItemPointer			 result_ctids,
+		float4			   **result_scores)
+{
+	float4			  avg_doc_len;
+	int32			  total_docs;
+	BlockNumber		  level_heads[TP_MAX_LEVELS];
+	TpDataSource	 *memtable_src = NULL;
+	uint32			 *doc_freqs;
+	TpPartitionStats  partition_stats;
+	pg_atomic_uint32 *shared_threshold	  = NULL;
+	pg_atomic_uint32 *partition_threshold = NULL;
+	int				  i;
+	int				  result_count;
+
+	/* Basic sanity checks */
+	Assert(local_state != NULL);
+	Assert(query_terms != NULL);
+	Assert(result_ctids != NULL);
+	Assert(result_scores != NULL);
+
+	if (query_term_count <= 0 || max_results <= 0)
+		return 0;
+
+	if (!local_state->shared)
+	{
+		elog(ERROR, "tp_score_documents: shared state is NULL!");
+		return 0;
 	}
 
 	/*
-	 * BMW fast path for multi-term queries (query_term_count >= 2).
-	 * Uses block-level upper bounds to skip non-contributing blocks.
+	 * A spill since the cursor's first batch may have changed the
+	 * scores of the documents it moved, so the floor no longer
+	 * separates returned documents from the rest.  Start over; the
+	 * scan drops the documents it has already returned.
 	 */
+	if (cursor != NULL && cursor->idfs != NULL &&
+		cursor->spill_generation !=
+				pg_atomic_read_u64(&local_state->shared->spill_generation))
 	{
-		uint32	  *doc_freqs;
-		float4	  *idfs;
-		float4	  *scores;
-		TpBMWStats stats;
+		elog(DEBUG1, "bm25 scan restarting after a spill between batches");
+		restart_score_cursor(cursor);
+	}
 
-		/* Batch lookup doc_freqs for all terms (opens each segment once) */
-		doc_freqs = palloc(query_term_count * sizeof(uint32));
-		tp_batch_get_unified_doc_freq(
-				memtable_src,
+	/* Non-owners wait for the owner's corpus snapshot */
+	if (parallel != NULL && !tp_parallel_scan_claim_snapshot(parallel))
+		tp_parallel_scan_wait_snapshot(parallel);
+
+	/* The memtable is scored by exactly one participant */
+	if (parallel == NULL || parallel->snapshot_owner)
+		memtable_src = open_memtable_source(
+				local_state,
 				index_relation,
 				query_terms,
 				query_term_count,
+				filter);
+
+	doc_freqs = palloc(query_term_count * sizeof(uint32));
+
+	if (parallel != NULL &&
+		pg_atomic_read_u32(&parallel->shared->snapshot_state) ==
+				TP_PARALLEL_SNAPSHOT_READY)
+	{
+		TpParallelScanShared *shared = parallel->shared;
+
+		for (i = 0; i < TP_MAX_LEVELS; i++)
+			level_heads[i] = shared->level_heads[i];
+		total_docs	= shared->total_docs;
+		avg_doc_len = shared->avg_doc_len;
+
+		if (tp_parallel_scan_shares_terms(
+					parallel, query_terms, query_term_count))
+			memcpy(doc_freqs,
+				   shared->doc_freqs,
+				   query_term_count * sizeof(uint32));
+		else if (!parallel->snapshot_owner)
+		{
+			/*
+			 * Without the owner's doc_freqs for our very terms we would
+			 * score on other statistics, or another query: claim
+			 * nothing, so the owner scores every segment as a serial
+			 * scan would.  Our terms are fixed for the whole scan, so
+			 * this is our first pass; segments we had claimed would be
+			 * scored by nobody.
+			 */
+			if (tp_parallel_scan_has_claims(parallel))
+				elog(ERROR,
+					 "parallel bm25 scan participant lost the statistics "
+					 "of its claimed segments");
+			elog(DEBUG1,
+				 "parallel bm25 scan: query terms differ from the "
+				 "snapshot owner's, leaving every segment to it");
+			pfree(doc_freqs);
+			tp_parallel_scan_end_pass(parallel);
+			return 0;
+		}
+		else
+		{
+			/*
+			 * The owner re-executing a query too long for the shared
+			 * snapshot: look doc_freqs up again against the same
+			 * segment set.
+			 */
+			tp_batch_get_unified_doc_freq(
+					memtable_src,
+					index_relation,
+					query_terms,
+					query_term_count,
+					level_heads,
+					doc_freqs);
+		}
+	}
+	else
+	{
+		read_corpus_stats(
+				index_relation,
+				memtable_src,
 				level_heads,
-				doc_freqs);
+				&total_docs,
+				&avg_doc_len);
 
-		/* Convert doc_freqs to IDFs */
-		idfs = palloc(query_term_count * sizeof(float4));
-		for (i = 0; i < query_term_count; i++)
+		if (tp_partition_stats_get(
+					index_relation,
+					query_terms,
+					query_term_count,
+					&partition_stats))
 		{
-			idfs[i] = (doc_freqs[i] > 0)
-							? tp_calculate_idf(doc_freqs[i], total_docs)
-							: 0.0f;
+			/* Score as if all partitions were one index */
+			total_docs	= partition_stats.total_docs;
+			avg_doc_len = partition_stats.avg_doc_len;
+			memcpy(doc_freqs,
+				   partition_stats.doc_freqs,
+				   query_term_count * sizeof(uint32));
+			if (parallel == NULL)
+				partition_threshold = partition_stats.threshold;
 		}
-		pfree(doc_freqs);
+		/* Batch lookup doc_freqs for all terms (opens each segment once) */
+		else if (total_docs > 0)
+			tp_batch_get_unified_doc_freq(
+					memtable_src,
+					index_relation,
+					query_terms,
+					query_term_count,
+					level_heads,
+					doc_freqs);
+		else
+			memset(doc_freqs, 0, query_term_count * sizeof(uint32));
 
-		/* Allocate scores array */
-		scores = (float4 *)palloc(max_results * sizeof(float4));
+		/* Publish before any early exit so waiters are released */
+		if (parallel != NULL)
+			tp_parallel_scan_publish_snapshot(
+					parallel,
+					level_heads,
+					total_docs,
+					avg_doc_len,
+					query_terms,
+					doc_freqs,
+					query_term_count);
+	}
 
-		/* Run multi-term BMW scoring */
-		result_count = tp_score_multi_term_bmw(
+	if (parallel != NULL && parallel->share_threshold)
+		shared_threshold = &parallel->shared->threshold;
+	else if (partition != NULL && partition->share_threshold)
+		shared_threshold = partition_threshold;
+
+	result_count = score_query(
+			local_state,
+			index_relation,
+			memtable_src,
+			level_heads,
+			parallel,
+			cursor,
+			shared_threshold,
+			prior,
+			query_terms,
+			query_frequencies,
+			query_term_count,
+			filter,
+			doc_freqs,
+			total_docs,
+			avg_doc_len,
+			k1,
+			b,
+			max_results,
+			result_ctids,
+			result_scores);
+
+	pfree(doc_freqs);
+	if (parallel != NULL)
+		tp_parallel_scan_end_pass(parallel);
+	if (partition != NULL)
+	{
+		/*
+		 * Only the first pass shares the threshold.  Note whether it
+		 * pruned anything, so a short batch is resumed without it.
+		 */
+		partition->threshold_used =
+				shared_threshold != NULL &&
+				shared_threshold == partition_threshold &&
+				tp_shared_threshold_get(shared_threshold) > 0.0f;
+		partition->share_threshold = false;
+	}
+	if (memtable_src != NULL)
+		tp_source_close(memtable_src);
+	return result_count;
+}
+
+/*
+ * Score a batch of queries.  The memtable source is opened once over
+ * the union of the queries' terms (and excluded terms), and each
+ * segment's dictionary is searched once for all of them; every query
+ * is then ranked against those shared statistics, so a query scores
+ * exactly as it would in its own index scan.
+ */
+void
+tp_score_batch(
+		TpLocalIndexState *local_state,
+		Relation		   index_relation,
+		TpBatchQuery	  *queries,
+		int				   query_count,
+		float4			   k1,
+		float4			   b,
+		int				   max_results)
+{
+	BlockNumber	  level_heads[TP_MAX_LEVELS];
+	TpDataSource *memtable_src;
+	char		**terms;
+	uint32		 *term_doc_freqs;
+	int			  term_count = 0;
+	bool		  positions	 = false;
+	int32		  total_docs;
+	float4		  avg_doc_len;
+	int			  q;
+	int			  i;
+
+	Assert(local_state != NULL);
+
+	for (q = 0; q < query_count; q++)
+	{
+		queries[q].result_count = 0;
+		term_count += queries[q].term_count;
+		if (queries[q].filter != NULL)
+			term_count += queries[q].filter->excluded_count;
+	}
+	if (term_count == 0 || max_results <= 0)
+		return;
+
+	/* Sorted, unique union of all terms the queries look up */
+	terms	   = palloc(term_count * sizeof(char *));
+	term_count = 0;
+	for (q = 0; q < query_count; q++)
+	{
+		const TpBooleanFilter *filter = queries[q].filter;
+
+		for (i = 0; i < queries[q].term_count; i++)
+			terms[term_count++] = queries[q].terms[i];
+		if (filter == NULL)
+			continue;
+		for (i = 0; i < filter->excluded_count; i++)
+			terms[term_count++] = filter->excluded[i];
+		if (filter->phrase_count > 0)
+			positions = true;
+	}
+	qsort(terms, term_count, sizeof(char *), pg_qsort_strcmp);
+	for (i = 1, q = 1; i < term_count; i++)
+	{
+		if (strcmp(terms[i], terms[q - 1]) != 0)
+			terms[q++] = terms[i];
+	}
+	term_count = q;
+
+	memtable_src = open_memtable_source_for_terms(
+			local_state, index_relation, terms, term_count, positions);
+	read_corpus_stats(
+			index_relation,
+			memtable_src,
+			level_heads,
+			&total_docs,
+			&avg_doc_len);
+
+	term_doc_freqs = palloc0(term_count * sizeof(uint32));
+	if (total_docs > 0)
+		tp_batch_get_unified_doc_freq(
+				memtable_src,
+				index_relation,
+				terms,
+				term_count,
+				level_heads,
+				term_doc_freqs);
+
+	for (q = 0; q < query_count; q++)
+	{
+		TpBatchQuery *query = &queries[q];
+		uint32		 *doc_freqs;
+
+		if (query->term_count == 0)
+			continue;
+
+		doc_freqs = palloc(query->term_count * sizeof(uint32));
+		for (i = 0; i < query->term_count; i++)
+		{
+			char **found = bsearch(
+					&query->terms[i],
+					terms,
+					term_count,
+					sizeof(char *),
+					pg_qsort_strcmp);
+
+			Assert(found != NULL);
+			doc_freqs[i] = term_doc_freqs[found - terms];
+		}
+
+		query->result_ctids = palloc(max_results * sizeof(ItemPointerData));
+		query->result_count = score_query(
 				local_state,
 				index_relation,
 				memtable_src,
-				query_terms,
-				query_term_count,
-				query_frequencies,
-				idfs,
+				level_heads,
+				NULL,
+				query->cursor,
+				NULL,
+				query->prior,
+				query->terms,
+				query->frequencies,
+				query->term_count,
+				query->filter,
+				doc_freqs,
+				total_docs,
+				avg_doc_len,
 				k1,
 				b,
-				avg_doc_len,
 				max_results,
-				result_ctids,
-				scores,
-				&stats);
+				query->result_ctids,
+				&query->result_scores);
+		pfree(doc_freqs);
+	}
 
-		pfree(idfs);
+	pfree(term_doc_freqs);
+	pfree(terms);
+	if (memtable_src != NULL)
+		tp_source_close(memtable_src);
+}
 
-		/* Log BMW stats if enabled */
-		if (tp_log_bmw_stats)
+/*
+ * Add every document matching the query to a match sink.  Returns the
+ * number of CTIDs added.
+ *
+ * The caller holds the per-index lock, as for tp_score_documents.
+ * Matching needs no corpus statistics: the segment set is read from
+ * the metapage and documents are only tested against the terms and
+ * `filter` (see tp_match_multi_term).
+ */
+int64
+tp_match_documents(
+		TpLocalIndexState	  *local_state,
+		Relation			   index_relation,
+		char				 **query_terms,
+		int					   query_term_count,
+		const TpBooleanFilter *filter,
+		TpMatchSink			  *sink)
+{
+	TpDataSource   *memtable_src;
+	TpIndexMetaPage metap;
+	BlockNumber		level_heads[TP_MAX_LEVELS];
+	int64			ntids;
+	int				i;
+
+	Assert(local_state != NULL);
+
+	if (query_term_count <= 0)
+		return 0;
+
+	metap = tp_get_metapage(index_relation);
+	for (i = 0; i < TP_MAX_LEVELS; i++)
+		level_heads[i] = metap->level_heads[i];
+	pfree(metap);
+
+	memtable_src = open_memtable_source(
+			local_state,
+			index_relation,
+			query_terms,
+			query_term_count,
+			filter);
+
+	ntids = tp_match_multi_term(
+			index_relation,
+			memtable_src,
+			level_heads,
+			query_terms,
+			query_term_count,
+			filter,
+			sink);
+
+	if (memtable_src != NULL)
+		tp_source_close(memtable_src);
+	return ntids;
+}
+
+/*
+ * Unified doc_freq (memtable + all segments) of each term, and the
+ * number and total length of the documents they are counted over.
+ * The caller holds the per-index lock.
+ */
+void
+tp_get_corpus_stats(
+		TpLocalIndexState *local_state,
+		Relation		   index_relation,
+		char			 **terms,
+		int				   term_count,
+		uint32			  *doc_freqs,
+		int64			  *total_docs,
+		int64			  *total_len)
+{
+	TpDataSource   *memtable_src;
+	TpIndexMetaPage metap;
+	BlockNumber		level_heads[TP_MAX_LEVELS];
+	int				i;
+
+	Assert(local_state != NULL);
+
+	metap = tp_get_metapage(index_relation);
+	for (i = 0; i < TP_MAX_LEVELS; i++)
+		level_heads[i] = metap->level_heads[i];
+	*total_docs = metap->total_docs;
+	*total_len	= metap->total_len;
+	pfree(metap);
+
+	memtable_src = tp_memtable_source_create_for_read(
+			local_state,
+			index_relation,
+			(const char *const *)terms,
+			term_count);
+	if (memtable_src != NULL)
+	{
+		*total_docs += memtable_src->total_docs;
+		*total_len += memtable_src->total_len;
+	}
+
+	tp_batch_get_unified_doc_freq(
+			memtable_src,
+			index_relation,
+			terms,
+			term_count,
+			level_heads,
+			doc_freqs);
+
+	if (memtable_src != NULL)
+		tp_source_close(memtable_src);
+}
+
+/*
+ * Unified doc_freq (memtable + all segments) of each term and the
+ * number of documents they are counted over, for planner estimates.
+ * The caller holds the per-index lock.
+ */
+int32
+tp_get_doc_freqs(
+		TpLocalIndexState *local_state,
+		Relation		   index_relation,
+		char			 **terms,
+		int				   term_count,
+		uint32			  *doc_freqs)
+{
+	int64 total_docs;
+	int64 total_len;
+
+	tp_get_corpus_stats(
+			local_state,
+			index_relation,
+			terms,
+			term_count,
+			doc_freqs,
+			&total_docs,
+			&total_len);
+	return (int32)Min(total_docs, PG_INT32_MAX);
+}
+
+static int
+tid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer)a, (ItemPointer)b);
+}
+
+int
+tp_tids_sort_unique(ItemPointer tids, int count)
+{
+	int kept = 0;
+	int i;
+
+	if (count <= 1)
+		return count;
+
+	qsort(tids, count, sizeof(ItemPointerData), tid_cmp);
+	for (i = 1; i < count; i++)
+	{
+		if (!ItemPointerEquals(&tids[kept], &tids[i]))
+			tids[++kept] = tids[i];
+	}
+	return kept + 1;
+}
+
+int
+tp_tids_intersect(
+		ItemPointer a, int a_count, const ItemPointerData *b, int b_count)
+{
+	int i	 = 0;
+	int j	 = 0;
+	int kept = 0;
+
+	while (i < a_count && j < b_count)
+	{
+		int32 cmp = ItemPointerCompare(&a[i], (ItemPointer)&b[j]);
+
+		if (cmp < 0)
+			i++;
+		else if (cmp > 0)
+			j++;
+		else
 		{
-			elog(LOG,
-				 "BMW stats: memtable=%lu docs, segments=%lu docs "
-				 "(blocks: %lu scanned, %lu skipped, %.1f%% skip), "
-				 "seeks=%lu, results=%lu",
-				 (unsigned long)stats.memtable_docs,
-				 (unsigned long)stats.segment_docs_scored,
-				 (unsigned long)stats.blocks_scanned,
-				 (unsigned long)stats.blocks_skipped,
-				 (stats.blocks_scanned + stats.blocks_skipped) > 0
-						 ? 100.0 * stats.blocks_skipped /
-								   (stats.blocks_scanned +
-									stats.blocks_skipped)
-						 : 0.0,
-				 (unsigned long)stats.seeks_performed,
-				 (unsigned long)stats.docs_in_results);
+			a[kept++] = a[i++];
+			j++;
 		}
+	}
+	return kept;
+}
+
+bool
+tp_tids_contains(const ItemPointerData *tids, int count, ItemPointer ctid)
+{
+	return count > 0 &&
+		   bsearch(ctid, tids, count, sizeof(ItemPointerData), tid_cmp) !=
+				   NULL;
+}
+
+void
+tp_score_cursor_advance(
+		TpScoreCursor		  *cursor,
+		const ItemPointerData *ctids,
+		const float4		  *scores,
+		int					   count)
+{
+	MemoryContext oldcontext;
+	float4		  floor;
+	int			  first;
+	int			  ties;
 
-		*result_scores = scores;
-		if (memtable_src != NULL)
-			tp_source_close(memtable_src);
-		return result_count;
+	if (count <= 0)
+		return;
+
+	/* The batch's lowest-scoring documents, all at the new floor */
+	floor = scores[count - 1];
+	first = count - 1;
+	while (first > 0 && scores[first - 1] == floor)
+		first--;
+	ties = count - first;
+
+	oldcontext = MemoryContextSwitchTo(cursor->mcxt);
+	if (cursor->active && cursor->floor_score == floor)
+	{
+		/* A run of equal scores spanning batches */
+		cursor->floor_tids = repalloc_huge(
+				cursor->floor_tids,
+				(cursor->floor_count + ties) * sizeof(ItemPointerData));
 	}
+	else
+	{
+		if (cursor->floor_tids != NULL)
+			pfree(cursor->floor_tids);
+		cursor->floor_tids	= palloc(ties * sizeof(ItemPointerData));
+		cursor->floor_count = 0;
+		ItemPointerSetInvalid(&cursor->floor_after);
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	memcpy(&cursor->floor_tids[cursor->floor_count],
+		   &ctids[first],
+		   ties * sizeof(ItemPointerData));
+	cursor->floor_count = tp_tids_sort_unique(
+			cursor->floor_tids, cursor->floor_count + ties);
+	cursor->floor_score = floor;
+	cursor->active		= true;
+}
+
+void
+tp_score_cursor_reset(TpScoreCursor *cursor)
+{
+	if (cursor->floor_tids != NULL)
+		pfree(cursor->floor_tids);
+	if (cursor->idfs != NULL)
+		pfree(cursor->idfs);
+	cursor->active		= false;
+	cursor->floor_score = 0.0f;
+	ItemPointerSetInvalid(&cursor->floor_after);
+	cursor->floor_tids		 = NULL;
+	cursor->floor_count		 = 0;
+	cursor->idfs			 = NULL;
+	cursor->avg_doc_len		 = 0.0f;
+	cursor->spill_generation = 0;
+	cursor->has_start		 = false;
+}
+
+void
+tp_score_cursor_start_after(
+		TpScoreCursor *cursor, float4 score, ItemPointer ctid)
+{
+	ItemPointerData after = *ctid;
+
+	tp_score_cursor_reset(cursor);
+	cursor->active		= true;
+	cursor->floor_score = score;
+	cursor->floor_after = after;
+	cursor->has_start	= true;
+	cursor->start_score = score;
+	cursor->start_after = after;
+}
+
+/*
+ * bm25_evaluator_stats() -> (wand, maxscore, conjunctive)
+ *
+ * Segments this backend has scored with WAND, Block-Max MaxScore, and
+ * the conjunctive evaluator for required terms.  Parallel workers count
+ * their own segments.
+ */
+PG_FUNCTION_INFO_V1(bm25_evaluator_stats);
+
+Datum
+bm25_evaluator_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum	  values[3];
+	bool	  nulls[3] = {false, false, false};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	values[0] = Int64GetDatum((int64)segments_wand);
+	values[1] = Int64GetDatum((int64)segments_maxscore);
+	values[2] = Int64GetDatum((int64)segments_conjunctive);
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
 }
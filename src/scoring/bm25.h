@@ -8,9 +8,14 @@
 
 #include <postgres.h>
 
+#include <nodes/tidbitmap.h>
 #include <storage/itemptr.h>
 
-typedef struct TpLocalIndexState TpLocalIndexState;
+typedef struct TpLocalIndexState	  TpLocalIndexState;
+typedef struct TpParallelScanState  TpParallelScanState;
+typedef struct TpPartitionScanState TpPartitionScanState;
+typedef struct TpPhrase				TpPhrase;
+typedef struct TpQueryPrior			TpQueryPrior;
 
 /*
  * Document score entry for query result accumulation.
@@ -21,22 +26,225 @@ typedef struct DocumentScoreEntry
 	ItemPointerData ctid;
 	float4			score;
 	float4			doc_length;
+	int32			required_hits; /* Required query terms matched */
+	int32			optional_hits; /* Other query terms matched */
 } DocumentScoreEntry;
 
+/*
+ * Boolean constraints on a query ("+word" / "-word", "phrases",
+ * min_should_match).
+ *
+ * required[i] marks query term i as mandatory: a document must contain
+ * every required term to match.  Excluded terms are not scored; a
+ * document containing any of them never matches.  A document must
+ * also contain at least min_should_match of the optional (not
+ * required) query terms, and match every phrase.  Phrase lexemes are
+ * always required query terms.
+ *
+ * When allowed is set, only documents whose CTID is in it can enter
+ * the top-k: other keys of the scan have already been evaluated, and
+ * filtering inside scoring keeps rejected documents from taking heap
+ * slots.  allowed_count 0 with allowed set means nothing is allowed.
+ *
+ * probe_only[i] marks optional query term i as too weak to propose
+ * candidates (see pg_textsearch.term_pruning_epsilon): it adds to the
+ * score of documents the other terms find, but a document containing
+ * only such terms is not ranked.  Only set by scoring itself.
+ */
+typedef struct TpBooleanFilter
+{
+	bool  *required;	   /* Per query term; NULL if none required */
+	int	   required_count; /* Number of true entries in required[] */
+	char **excluded;	   /* Excluded lexemes */
+	int	   excluded_count;
+	int	   min_should_match; /* Optional terms to match, 0 if any */
+	TpPhrase **phrases;		 /* Analyzed phrases, length >= 2 */
+	int		   phrase_count;
+	const ItemPointerData *allowed; /* Sorted, unique CTIDs; NULL if any */
+	int					   allowed_count;
+	const float4 *term_weights; /* Per query term IDF scale; NULL if all 1 */
+	const bool	 *probe_only;	/* Per query term; NULL if none */
+} TpBooleanFilter;
+
+/* Sort a CTID array and drop duplicates; returns the new count */
+extern int tp_tids_sort_unique(ItemPointer tids, int count);
+
+/*
+ * Intersect two sorted, unique CTID arrays into a; returns the number
+ * of CTIDs kept.
+ */
+extern int tp_tids_intersect(
+		ItemPointer a, int a_count, const ItemPointerData *b, int b_count);
+
+/* Is ctid in the sorted, unique array? */
+extern bool tp_tids_contains(
+		const ItemPointerData *tids, int count, ItemPointer ctid);
+
+/*
+ * Resume point of a ranked scan fetched in batches, or of a page
+ * requested with a search-after position.  Once active, scoring admits
+ * only documents ranking after that point: scoring below floor_score,
+ * or exactly at it with a CTID after floor_after (if valid) and not
+ * among floor_tids.  The IDFs and average document length of a serial
+ * scan's first batch are kept, so later batches score each document as
+ * it was scored before and the floor stays meaningful.
+ *
+ * A spill moves the memtable's documents into a segment, where they may
+ * not score exactly as before.  A batch that sees the spill generation
+ * change since the first batch starts over from the scan's start, with
+ * fresh statistics; the scan skips the documents it already returned.
+ */
+typedef struct TpScoreCursor
+{
+	MemoryContext	mcxt;		 /* Holds idfs and floor_tids */
+	bool			active;		 /* Admit only documents below the floor */
+	float4			floor_score; /* Raw BM25 score of the floor */
+	ItemPointerData floor_after; /* Search-after CTID, or invalid */
+	ItemPointer		floor_tids;	 /* Sorted CTIDs returned at floor_score */
+	int				floor_count;
+	float4		 *idfs; /* Per query term, NULL until the first batch */
+	float4		  avg_doc_len;
+	uint64		  spill_generation; /* Of the first batch */
+	bool		  has_start;		/* Started at a search-after position */
+	float4		  start_score;
+	ItemPointerData start_after;
+} TpScoreCursor;
+
+/*
+ * Score the query's top max_results documents.  `cursor` (may be
+ * NULL) makes this one batch of a resumable scan; see TpScoreCursor.
+ * `prior` (may be NULL) adds a static prior bonus to every score.
+ */
 extern int tp_score_documents(
+		TpLocalIndexState	*local_state,
+		Relation			 index_relation,
+		char			   **query_terms,
+		int32				*query_frequencies,
+		int					 query_term_count,
+		const TpBooleanFilter *filter,
+		float4				 k1,
+		float4				 b,
+		int					 max_results,
+		TpParallelScanState *parallel,
+		TpPartitionScanState *partition,
+		TpScoreCursor		*cursor,
+		const TpQueryPrior	*prior,
+		ItemPointer			 result_ctids,
+		float4			   **result_scores);
+
+/*
+ * Whether the most recent ranking ran out of its scoring budget
+ * (pg_textsearch.scoring_time_budget or scoring_block_budget) and
+ * returned a partial top-k
+ */
+extern bool tp_score_was_partial(void);
+
+/*
+ * One query of tp_score_batch.  The caller fills in the query; scoring
+ * sets the results, ordered by descending score.
+ */
+typedef struct TpBatchQuery
+{
+	char		  **terms;
+	int32		   *frequencies;
+	int				term_count;
+	TpBooleanFilter *filter; /* NULL for a plain disjunctive query */
+	TpScoreCursor  *cursor;	 /* Search-after position, or NULL */
+	const TpQueryPrior *prior; /* Static prior weighting, or NULL */
+
+	ItemPointer result_ctids;  /* [result_count] */
+	float4	   *result_scores; /* [result_count] raw BM25 scores */
+	int			result_count;
+} TpBatchQuery;
+
+/*
+ * Score the top max_results documents of several queries against one
+ * view of the index: the metapage, the memtable source and the
+ * dictionary lookups for the union of the queries' terms are shared.
+ * The caller holds the per-index lock.
+ */
+extern void tp_score_batch(
 		TpLocalIndexState *local_state,
 		Relation		   index_relation,
-		char			 **query_terms,
-		int32			  *query_frequencies,
-		int				   query_term_count,
+		TpBatchQuery	  *queries,
+		int				   query_count,
 		float4			   k1,
 		float4			   b,
-		int				   max_results,
-		ItemPointer		   result_ctids,
-		float4			 **result_scores);
+		int				   max_results);
+
+/*
+ * Move the cursor past a batch (sorted by descending score) that has
+ * just been returned.
+ */
+extern void tp_score_cursor_advance(
+		TpScoreCursor	  *cursor,
+		const ItemPointerData *ctids,
+		const float4	  *scores,
+		int				   count);
+
+/* Forget the cursor's position and statistics */
+extern void tp_score_cursor_reset(TpScoreCursor *cursor);
+
+/*
+ * Start the cursor at a search-after position: only documents ranking
+ * after (score, ctid) in (score DESC, CTID ASC) order are admitted.
+ */
+extern void tp_score_cursor_start_after(
+		TpScoreCursor *cursor, float4 score, ItemPointer ctid);
+
+/*
+ * Destination of a boolean match: a bitmap (amgetbitmap), or else a
+ * CTID array grown as needed (amgettuple without ORDER BY).
+ */
+typedef struct TpMatchSink
+{
+	TIDBitmap  *tbm;	  /* Bitmap to add to, or NULL */
+	ItemPointer tids;	  /* palloc'd array when tbm is NULL */
+	int			ntids;	  /* CTIDs added */
+	int			capacity; /* Allocated entries of tids */
+} TpMatchSink;
+
+extern int64 tp_match_documents(
+		TpLocalIndexState	  *local_state,
+		Relation			   index_relation,
+		char				 **query_terms,
+		int					   query_term_count,
+		const TpBooleanFilter *filter,
+		TpMatchSink			  *sink);
+
+/*
+ * Unified doc_freq of each term for the planner; returns the corpus
+ * size.  The caller holds the per-index lock.
+ */
+extern int32 tp_get_doc_freqs(
+		TpLocalIndexState *local_state,
+		Relation		   index_relation,
+		char			 **terms,
+		int				   term_count,
+		uint32			  *doc_freqs);
+
+/*
+ * Unified doc_freq of each term, plus the number and total length of
+ * the documents in the index.  The caller holds the per-index lock.
+ */
+extern void tp_get_corpus_stats(
+		TpLocalIndexState *local_state,
+		Relation		   index_relation,
+		char			 **terms,
+		int				   term_count,
+		uint32			  *doc_freqs,
+		int64			  *total_docs,
+		int64			  *total_len);
 
 /* IDF calculation */
 extern float4 tp_calculate_idf(int32 doc_freq, int32 total_docs);
 
 /* GUC variable for BMW stats logging - defined in mod.c */
 extern bool tp_log_bmw_stats;
+
+/*
+ * GUC: largest score change low-IDF term pruning may cause (0 = off) -
+ * defined in mod.c
+ */
+#define TP_MAX_TERM_PRUNING_EPSILON 100.0
+extern double tp_term_pruning_epsilon;
@@ -10,16 +10,21 @@
 #include <miscadmin.h>
 #include <utils/hsearch.h>
 #include <utils/memutils.h>
+#include <utils/timestamp.h>
 
 #include "constants.h"
 #include "index/metapage.h"
 #include "index/source.h"
 #include "memtable/chain_source.h"
+#include "scoring/block_score.h"
 #include "scoring/bm25.h"
 #include "scoring/bmw.h"
+#include "scoring/phrase.h"
+#include "scoring/prior.h"
 #include "segment/alive_bitset.h"
 #include "segment/compression.h"
 #include "segment/fieldnorm.h"
+#include "segment/impact.h"
 #include "segment/io.h"
 
 /*
@@ -40,6 +45,15 @@ tp_topk_init(TpTopKHeap *heap, int k, MemoryContext ctx)
 	heap->capacity	 = k;
 	heap->size		 = 0;
 
+	heap->shared_threshold = NULL;
+	heap->allowed		   = NULL;
+	heap->allowed_count	   = 0;
+	heap->cursor		   = NULL;
+	heap->prior			   = NULL;
+	heap->prior_bound	   = 0.0f;
+	heap->inflation		   = 1.0f;
+	memset(&heap->budget, 0, sizeof(TpScoreBudget));
+
 	MemoryContextSwitchTo(old_ctx);
 }
 
@@ -193,6 +207,18 @@ heap_beats_root(
 	return false;
 }
 
+/*
+ * Publish our threshold to other parallel participants once the heap
+ * is full.  tp_shared_threshold_raise only writes when we improve on
+ * the shared value, so this is a read in the common case.
+ */
+static inline void
+heap_publish_threshold(TpTopKHeap *heap)
+{
+	if (heap->shared_threshold != NULL && heap->size >= heap->capacity)
+		tp_shared_threshold_raise(heap->shared_threshold, heap->scores[0]);
+}
+
 /*
  * Add a memtable result to the top-k heap.
  * CTID is known immediately for memtable entries.
@@ -219,7 +245,10 @@ tp_topk_add_memtable(TpTopKHeap *heap, ItemPointerData ctid, float4 score)
 		heap->scores[0]		= score;
 		heap_sift_down(heap, 0);
 	}
-	/* else: doesn't qualify for top-k, ignore */
+	else
+		return; /* Doesn't qualify for top-k, ignore */
+
+	heap_publish_threshold(heap);
 }
 
 /*
@@ -249,7 +278,10 @@ tp_topk_add_segment(
 		heap->scores[0]		= score;
 		heap_sift_down(heap, 0);
 	}
-	/* else: doesn't qualify for top-k, ignore */
+	else
+		return; /* Doesn't qualify for top-k, ignore */
+
+	heap_publish_threshold(heap);
 }
 
 /*
@@ -294,6 +326,168 @@ tp_topk_resolve_ctids(TpTopKHeap *heap, Relation index)
 	}
 }
 
+/*
+ * Admission checks: the cursor (only documents ranking after those
+ * earlier batches returned, or after a search-after position) and the
+ * allowed set.  Callers test
+ * them only for documents that would enter the heap, and a segment
+ * document's CTID is looked up only when a check needs it, so the cost
+ * is paid once per competitive candidate rather than once per posting.
+ */
+static inline bool
+memtable_doc_admitted(
+		TpTopKHeap *heap, ItemPointer ctid, float4 score, TpBMWStats *stats)
+{
+	const TpScoreCursor *cursor = heap->cursor;
+
+	if (cursor != NULL &&
+		(score > cursor->floor_score ||
+		 (score == cursor->floor_score &&
+		  ((ItemPointerIsValid(&cursor->floor_after) &&
+			ItemPointerCompare(ctid, (ItemPointer)&cursor->floor_after) <=
+					0) ||
+		   tp_tids_contains(
+				   cursor->floor_tids, cursor->floor_count, ctid)))))
+	{
+		if (stats)
+			stats->docs_returned_earlier++;
+		return false;
+	}
+
+	if (heap->allowed != NULL &&
+		!tp_tids_contains(heap->allowed, heap->allowed_count, ctid))
+	{
+		if (stats)
+			stats->docs_filtered++;
+		return false;
+	}
+	return true;
+}
+
+static inline bool
+segment_doc_admitted(
+		TpTopKHeap		*heap,
+		TpSegmentReader *reader,
+		uint32			 doc_id,
+		float4			 score,
+		TpBMWStats		*stats)
+{
+	const TpScoreCursor *cursor = heap->cursor;
+	ItemPointerData		 ctid;
+
+	if (cursor != NULL && score > cursor->floor_score)
+	{
+		if (stats)
+			stats->docs_returned_earlier++;
+		return false;
+	}
+
+	/* Below the floor and unfiltered: no CTID needed */
+	if (heap->allowed == NULL &&
+		(cursor == NULL || score < cursor->floor_score))
+		return true;
+
+	tp_segment_lookup_ctid(reader, doc_id, &ctid);
+	return memtable_doc_admitted(heap, &ctid, score, stats);
+}
+
+/*
+ * Static prior bonuses (see scoring/prior.h).  A document's bonus is
+ * added to its BM25 score before the heap sees it.  While a segment is
+ * scored, its BM25 bounds are compared to the threshold less the bonus
+ * of the segment's largest prior (bound_threshold), so every skip
+ * stays exact.
+ */
+static inline float4
+memtable_doc_bonus(TpTopKHeap *heap, TpDataSource *source, ItemPointer ctid)
+{
+	if (heap->prior == NULL)
+		return 0.0f;
+	return tp_prior_bonus(heap->prior, tp_source_get_doc_prior(source, ctid));
+}
+
+static inline float4
+segment_doc_bonus(TpTopKHeap *heap, TpSegmentReader *reader, uint32 doc_id)
+{
+	if (heap->prior == NULL)
+		return 0.0f;
+	return tp_prior_bonus(heap->prior, tp_segment_doc_prior(reader, doc_id));
+}
+
+static inline void
+heap_begin_segment(TpTopKHeap *heap, TpSegmentReader *reader)
+{
+	heap->prior_bound = tp_prior_bonus(heap->prior, reader->header->max_prior);
+}
+
+static inline float4
+bound_threshold(TpTopKHeap *heap)
+{
+	return tp_topk_prune_threshold(heap) - heap->prior_bound;
+}
+
+/*
+ * Count `blocks` skipped against an inflated threshold that an exact
+ * one would have scanned.  `bound` includes the prior bonus bound, as
+ * the top-k threshold does.
+ */
+static inline void
+count_inflated_skip(
+		TpTopKHeap *heap, float4 bound, uint64 blocks, TpBMWStats *stats)
+{
+	if (stats != NULL && heap->inflation > 1.0f &&
+		bound > tp_topk_threshold(heap))
+		stats->blocks_skipped_approx += blocks;
+}
+
+/*
+ * Scoring work budgets.  The clock is read once every
+ * TP_BUDGET_CLOCK_INTERVAL checks; the block count is exact.
+ */
+#define TP_BUDGET_CLOCK_INTERVAL 32
+
+static void
+budget_start(TpScoreBudget *budget)
+{
+	memset(budget, 0, sizeof(TpScoreBudget));
+	if (tp_scoring_time_budget > 0)
+		budget->deadline = TimestampTzPlusMilliseconds(
+				GetCurrentTimestamp(), tp_scoring_time_budget);
+	if (tp_scoring_block_budget > 0)
+		budget->block_limit = tp_segment_blocks_loaded +
+							  (uint64)tp_scoring_block_budget;
+}
+
+static inline bool
+budget_exhausted(TpScoreBudget *budget)
+{
+	if (budget->exhausted)
+		return true;
+	if (budget->block_limit != 0 &&
+		tp_segment_blocks_loaded >= budget->block_limit)
+		budget->exhausted = true;
+	else if (budget->deadline != 0 && --budget->countdown <= 0)
+	{
+		budget->countdown = TP_BUDGET_CLOCK_INTERVAL;
+		budget->exhausted = GetCurrentTimestamp() >= budget->deadline;
+	}
+	return budget->exhausted;
+}
+
+/*
+ * Stop visiting the plan's segments once the budget is spent, noting
+ * the `remaining` ones left unscored
+ */
+static bool
+budget_stops_plan(TpTopKHeap *heap, int remaining, TpBMWStats *stats)
+{
+	if (!budget_exhausted(&heap->budget))
+		return false;
+	if (stats)
+		stats->segments_unvisited += remaining;
+	return true;
+}
+
 /*
  * Compare function for qsort: sort by (score DESC, CTID ASC).
  * This matches the exhaustive path's tie-breaking for deterministic results.
@@ -362,20 +556,150 @@ tp_topk_extract(TpTopKHeap *heap, ItemPointerData *ctids, float4 *scores)
  * ------------------------------------------------------------
  */
 
-float4
-tp_compute_block_max_score(
-		TpSkipEntry *skip, float4 idf, float4 k1, float4 b, float4 avg_doc_len)
+/*
+ * BM25 upper bound from a max TF and a min fieldnorm
+ */
+static inline float4
+compute_max_score(
+		uint16 max_tf,
+		uint8  min_norm,
+		float4 idf,
+		float4 k1,
+		float4 b,
+		float4 avg_doc_len)
 {
-	float4 tf = (float4)skip->block_max_tf;
-	float4 dl = (float4)decode_fieldnorm(skip->block_max_norm);
+	float4 tf = (float4)max_tf;
+	float4 dl = (float4)decode_fieldnorm(min_norm);
 
-	/* BM25 formula with max TF and min doc length in block */
+	/* BM25 formula with max TF and min doc length */
 	float4 len_norm		= 1.0f - b + b * (dl / avg_doc_len);
 	float4 tf_component = (tf * (k1 + 1.0f)) / (tf + k1 * len_norm);
 
 	return idf * tf_component;
 }
 
+float4
+tp_compute_block_max_score(
+		TpSkipEntry *skip, float4 idf, float4 k1, float4 b, float4 avg_doc_len)
+{
+	return compute_max_score(
+			skip->block_max_tf, skip->block_max_norm, idf, k1, b, avg_doc_len);
+}
+
+float4
+tp_compute_term_max_score(
+		const TpTermBounds *bounds,
+		float4				idf,
+		float4				k1,
+		float4				b,
+		float4				avg_doc_len)
+{
+	return compute_max_score(
+			bounds->max_tf, bounds->min_fieldnorm, idf, k1, b, avg_doc_len);
+}
+
+/*
+ * Multiplier turning a segment's quantized impacts into score bounds
+ * for one term; 0 if the segment stores no impacts
+ */
+static inline float4
+segment_impact_scale(
+		TpSegmentReader *reader, float4 idf, float4 k1, float4 avg_doc_len)
+{
+	return tp_impact_scale(
+			idf, k1, avg_doc_len, reader->header->impact_avg_doc_len);
+}
+
+/*
+ * Segment-wide bound for a term: its V6 bound, tightened by the
+ * term's largest impact if the segment stores impacts
+ */
+static float4
+segment_term_bound(
+		TpSegmentReader	   *reader,
+		const TpTermBounds *bounds,
+		float4				idf,
+		float4				k1,
+		float4				b,
+		float4				avg_doc_len)
+{
+	return tp_impact_tighten(
+			tp_compute_term_max_score(bounds, idf, k1, b, avg_doc_len),
+			bounds->max_impact,
+			segment_impact_scale(reader, idf, k1, avg_doc_len));
+}
+
+/*
+ * Fill block_max_scores[0..block_count-1] for a term's blocks from
+ * its skip entries, tightened by the blocks' largest impacts if the
+ * segment stores them.  skips may be NULL to read them from disk.
+ */
+static void
+segment_block_max_scores(
+		TpSegmentReader	  *reader,
+		const TpDictEntry *entry,
+		const TpSkipEntry *skips,
+		float4			   idf,
+		float4			   k1,
+		float4			   b,
+		float4			   avg_doc_len,
+		float4			  *block_max_scores)
+{
+	uint32 block_count = entry->block_count;
+	uint8 *impacts	   = palloc(Max(block_count, 1));
+	bool   has_impacts;
+	float4 scale;
+	uint32 i;
+
+	has_impacts = tp_segment_read_block_impacts(reader, entry, impacts);
+	scale		= segment_impact_scale(reader, idf, k1, avg_doc_len);
+
+	for (i = 0; i < block_count; i++)
+	{
+		TpSkipEntry skip;
+
+		if (skips)
+			skip = skips[i];
+		else
+			tp_segment_read_skip_entry(
+					reader, entry->skip_index_offset, i, &skip);
+		block_max_scores[i] =
+				tp_compute_block_max_score(&skip, idf, k1, b, avg_doc_len);
+		if (has_impacts)
+			block_max_scores[i] = tp_impact_tighten(
+					block_max_scores[i], impacts[i], scale);
+	}
+
+	pfree(impacts);
+}
+
+/*
+ * Prior bonus bound of each of a term's blocks, from the blocks'
+ * largest priors (the segment's if it stores none per block), or NULL
+ * without a prior weighting
+ */
+static float4 *
+segment_block_bonuses(
+		TpTopKHeap *heap, TpSegmentReader *reader, const TpDictEntry *entry)
+{
+	uint32	block_count = entry->block_count;
+	float4 *bonuses;
+	uint32	i;
+
+	if (heap->prior == NULL)
+		return NULL;
+
+	bonuses = palloc(Max(block_count, 1) * sizeof(float4));
+	if (!tp_segment_read_block_priors(reader, entry, bonuses))
+	{
+		for (i = 0; i < block_count; i++)
+			bonuses[i] = reader->header->max_prior;
+	}
+	for (i = 0; i < block_count; i++)
+		bonuses[i] = tp_prior_bonus(heap->prior, bonuses[i]);
+	return bonuses;
+}
+
 /*
  * Compute BM25 score for a single posting.
  */
@@ -395,6 +719,200 @@ compute_bm25_score(
 	return idf * tf_component;
 }
 
+/*
+ * ------------------------------------------------------------
+ * Segment Planning
+ * ------------------------------------------------------------
+ *
+ * Segments are scored from the highest query upper bound to the
+ * lowest, so the heap threshold rises on the segments most likely to
+ * hold top-k documents and the weak tail can be skipped outright.
+ */
+
+/*
+ * A segment queued for scoring
+ */
+typedef struct TpSegmentPlanEntry
+{
+	BlockNumber root_block;
+	uint32		ordinal;	 /* Position in chain order (tie-breaker) */
+	bool		bounded;	 /* False if any term lacks V6 bounds */
+	float4		bound;		 /* Sum of term bounds (if bounded) */
+	uint64		block_count; /* Posting blocks of the query terms */
+} TpSegmentPlanEntry;
+
+/*
+ * Order plan entries: unbounded segments first (they cannot be
+ * pruned), then by descending bound, then in chain order.
+ */
+static int
+compare_plan_entries(const void *a, const void *b)
+{
+	const TpSegmentPlanEntry *pa = (const TpSegmentPlanEntry *)a;
+	const TpSegmentPlanEntry *pb = (const TpSegmentPlanEntry *)b;
+
+	if (pa->bounded != pb->bounded)
+		return pa->bounded ? 1 : -1;
+	if (pa->bound > pb->bound)
+		return -1;
+	if (pa->bound < pb->bound)
+		return 1;
+	if (pa->ordinal < pb->ordinal)
+		return -1;
+	if (pa->ordinal > pb->ordinal)
+		return 1;
+	return 0;
+}
+
+/*
+ * Build the scoring order for the segments in `level_heads`.
+ *
+ * Each segment's query upper bound is the sum over query terms of
+ * the term's segment-wide max score (from the V6 term bounds) times
+ * its query frequency.  Only the dictionary is read.  Segments that
+ * contain none of the terms are left out of the plan.
+ *
+ * Every parallel participant scores with the same snapshot, so they
+ * all plan the same segments, though not necessarily in one order;
+ * each claims its share by root block (see scoring/parallel.h).
+ *
+ * A segment missing any term flagged in `required`, or containing
+ * fewer than `min_should_match` of the other terms, cannot match
+ * either and is left out as well.
+ *
+ * With a `prior` weighting (may be NULL), the bound also includes the
+ * bonus of the segment's largest prior.
+ *
+ * `query_freqs` and `required` may be NULL (all frequencies 1, no
+ * required terms).  Returns a palloc'd array sorted with
+ * compare_plan_entries, or NULL if it is empty.
+ */
+static TpSegmentPlanEntry *
+plan_segments(
+		Relation		   index,
+		const BlockNumber *level_heads,
+		const char *const *terms,
+		const int32		  *query_freqs,
+		const bool		  *required,
+		int				   min_should_match,
+		const float4	  *idfs,
+		int				   term_count,
+		float4			   k1,
+		float4			   b,
+		float4			   avg_doc_len,
+		const TpQueryPrior *prior,
+		int				  *plan_count)
+{
+	TpSegmentPlanEntry *plan	 = NULL;
+	int					capacity = 0;
+	int					count	 = 0;
+	uint32				ordinal	 = 0;
+	int					level;
+
+	for (level = 0; level < TP_MAX_LEVELS; level++)
+	{
+		BlockNumber seg_head = level_heads[level];
+
+		while (seg_head != InvalidBlockNumber)
+		{
+			TpSegmentReader	  *reader = tp_segment_open(index, seg_head);
+			TpSegmentPlanEntry entry;
+			bool			   found			= false;
+			bool			   missing_required = false;
+			int				   optional_found	= 0;
+			int				   i;
+
+			CHECK_FOR_INTERRUPTS();
+
+			entry.root_block  = seg_head;
+			entry.ordinal	  = ordinal;
+			entry.bounded	  = true;
+			entry.bound		  = 0.0f;
+			entry.block_count = 0;
+
+			for (i = 0; i < term_count; i++)
+			{
+				TpSegmentPostingIterator iter;
+				TpTermBounds			 bounds;
+
+				if (!tp_segment_posting_iterator_init(
+							&iter, reader, terms[i]))
+				{
+					if (required && required[i])
+						missing_required = true;
+					continue;
+				}
+
+				found = true;
+				if (!required || !required[i])
+					optional_found++;
+				entry.block_count += iter.dict_entry.block_count;
+
+				if (tp_segment_read_term_bounds(
+							reader, iter.dict_entry_idx, &bounds))
+				{
+					float4 term_bound = segment_term_bound(
+							reader, &bounds, idfs[i], k1, b, avg_doc_len);
+
+					if (query_freqs)
+						term_bound *= query_freqs[i];
+					entry.bound += term_bound;
+				}
+				else
+					entry.bounded = false;
+
+				tp_segment_posting_iterator_free(&iter);
+			}
+			entry.bound += tp_prior_bonus(prior, reader->header->max_prior);
+
+			if (found && !missing_required &&
+				optional_found >= min_should_match)
+			{
+				if (count >= capacity)
+				{
+					capacity = Max(8, capacity * 2);
+					if (plan)
+						plan = repalloc(
+								plan, capacity * sizeof(TpSegmentPlanEntry));
+					else
+						plan = palloc(capacity * sizeof(TpSegmentPlanEntry));
+				}
+				plan[count++] = entry;
+			}
+			ordinal++;
+
+			seg_head = reader->header->next_segment;
+			tp_segment_close(reader);
+		}
+	}
+
+	if (count > 1)
+		qsort(plan, count, sizeof(TpSegmentPlanEntry), compare_plan_entries);
+
+	*plan_count = count;
+	return plan;
+}
+
+/*
+ * Skip a planned segment whose upper bound cannot beat the threshold.
+ * Unbounded (pre-V6) segments are never skipped here.
+ */
+static bool
+plan_entry_pruned(
+		TpTopKHeap *heap, TpSegmentPlanEntry *entry, TpBMWStats *stats)
+{
+	if (!entry->bounded || entry->bound >= tp_topk_prune_threshold(heap))
+		return false;
+
+	if (stats)
+	{
+		stats->segments_pruned++;
+		stats->blocks_skipped += entry->block_count;
+	}
+	count_inflated_skip(heap, entry->bound, entry->block_count, stats);
+	return true;
+}
+
 /*
  * ------------------------------------------------------------
  * Single-Term BMW Scoring
@@ -451,9 +969,11 @@ score_memtable_single_term(
 		if (doc_len <= 0)
 			doc_len = 1; /* Fallback for missing entries */
 
-		score = compute_bm25_score(idf, tf, doc_len, k1, b, avg_doc_len);
+		score = compute_bm25_score(idf, tf, doc_len, k1, b, avg_doc_len) +
+				memtable_doc_bonus(heap, source, ctid);
 
-		if (!tp_topk_dominated(heap, score))
+		if (!tp_topk_dominated(heap, score) &&
+			memtable_doc_admitted(heap, ctid, score, stats))
 			tp_topk_add_memtable(heap, *ctid, score);
 
 		if (stats)
@@ -478,11 +998,17 @@ score_segment_single_term_bmw(
 		TpBMWStats		*stats)
 {
 	TpSegmentPostingIterator iter;
-	TpSegmentPosting		*posting;
 	TpDictEntry				*dict_entry;
 	uint32					 block_count;
 	float4					*block_max_scores;
+	float4					*block_bonuses;
+	TpBlockScorer			 scorer;
+	float4					 scores[TP_BLOCK_SIZE];
+	uint8					 candidates[TP_BLOCK_SIZE];
+	uint32					 ncandidates;
+	uint32					 count;
 	uint32					 i;
+	uint32					 j;
 
 	/* Initialize iterator for this term */
 	if (!tp_segment_posting_iterator_init(&iter, reader, term))
@@ -491,53 +1017,106 @@ score_segment_single_term_bmw(
 	/* Get dictionary entry for block count and skip index */
 	dict_entry	= &iter.dict_entry;
 	block_count = dict_entry->block_count;
+	heap_begin_segment(heap, reader);
 
-	/* Pre-compute block max scores */
-	block_max_scores = palloc(block_count * sizeof(float4));
-	for (i = 0; i < block_count; i++)
+	/*
+	 * V6 segments carry a segment-wide bound for the term: if it
+	 * cannot beat the threshold, skip the segment without touching
+	 * the skip index.
+	 */
 	{
-		TpSkipEntry skip;
-		tp_segment_read_skip_entry(
-				reader, dict_entry->skip_index_offset, i, &skip);
-		block_max_scores[i] =
-				tp_compute_block_max_score(&skip, idf, k1, b, avg_doc_len);
+		TpTermBounds bounds;
+		float4		 bound;
+
+		if (tp_segment_read_term_bounds(reader, iter.dict_entry_idx, &bounds))
+		{
+			bound = segment_term_bound(
+					reader, &bounds, idf, k1, b, avg_doc_len);
+			if (bound < bound_threshold(heap))
+			{
+				if (stats)
+					stats->blocks_skipped += block_count;
+				count_inflated_skip(
+						heap, bound + heap->prior_bound, block_count, stats);
+				tp_segment_posting_iterator_free(&iter);
+				return;
+			}
+		}
 	}
 
+	/* Pre-compute block max scores */
+	block_max_scores = palloc(block_count * sizeof(float4));
+	segment_block_max_scores(
+			reader,
+			dict_entry,
+			NULL,
+			idf,
+			k1,
+			b,
+			avg_doc_len,
+			block_max_scores);
+	block_bonuses = segment_block_bonuses(heap, reader, dict_entry);
+	tp_block_scorer_init(&scorer, idf, k1, b, avg_doc_len);
+
 	/* Process blocks with BMW */
 	for (i = 0; i < block_count; i++)
 	{
-		float4 threshold = tp_topk_threshold(heap);
-		float4 block_max = block_max_scores[i];
+		float4 threshold   = tp_topk_prune_threshold(heap);
+		float4 block_bonus = block_bonuses ? block_bonuses[i] : 0.0f;
+		float4 block_max   = block_max_scores[i] + block_bonus;
 
 		CHECK_FOR_INTERRUPTS();
 
+		if (budget_exhausted(&heap->budget))
+			break;
+
 		/* Skip block if it can't beat threshold */
 		if (block_max < threshold)
 		{
 			if (stats)
 				stats->blocks_skipped++;
+			count_inflated_skip(heap, block_max, 1, stats);
 			continue;
 		}
 
 		if (stats)
 			stats->blocks_scanned++;
 
-		/* Load and score this block */
+		/* Load this block and score it whole */
 		iter.current_block = i;
-		iter.finished	   = false; /* Reset so we can process this block */
-		tp_segment_posting_iterator_load_block(&iter);
+		iter.finished	   = false;
+		if (!tp_segment_posting_iterator_load_block(&iter))
+			break; /* Corrupted segment data */
+
+		count		= iter.skip_entry.doc_count;
+		ncandidates = tp_block_scorer_score(
+				&scorer,
+				iter.block_postings,
+				count,
+				threshold - block_bonus,
+				scores,
+				candidates);
 
-		while (tp_segment_posting_iterator_next(&iter, &posting))
+		if (stats)
 		{
-			float4 score;
+			stats->segment_docs_scored += count;
+			stats->postings_pruned += count - ncandidates;
+		}
 
-			/*
-			 * Break if iterator auto-advanced to next block.
-			 * This ensures we only process block i, allowing the outer
-			 * for loop to apply threshold checks to subsequent blocks.
-			 */
-			if (iter.current_block != i)
-				break;
+		/*
+		 * The bulk compare used the threshold at the start of the
+		 * block, less the block's bonus bound; candidates are checked
+		 * again, with their own bonus, as the heap fills.
+		 */
+		for (j = 0; j < ncandidates; j++)
+		{
+			TpBlockPosting *posting = &iter.block_postings[candidates[j]];
+			float4			score	= scores[candidates[j]];
+
+			if (block_bonuses != NULL)
+				score += segment_doc_bonus(heap, reader, posting->doc_id);
+			if (tp_topk_dominated(heap, score))
+				continue;
 
 			/* Skip dead docs */
 			if (!tp_segment_is_alive(reader, posting->doc_id))
@@ -547,49 +1126,44 @@ score_segment_single_term_bmw(
 				continue;
 			}
 
-			score = compute_bm25_score(
-					idf,
-					posting->frequency,
-					posting->doc_length,
-					k1,
-					b,
-					avg_doc_len);
-
-			if (!tp_topk_dominated(heap, score))
-			{
+			if (segment_doc_admitted(
+						heap, reader, posting->doc_id, score, stats))
 				tp_topk_add_segment(
 						heap, reader->root_block, posting->doc_id, score);
-			}
-
-			if (stats)
-				stats->segment_docs_scored++;
 		}
 	}
 
 	pfree(block_max_scores);
+	if (block_bonuses)
+		pfree(block_bonuses);
 	tp_segment_posting_iterator_free(&iter);
 }
 
 int
 tp_score_single_term_bmw(
-		TpLocalIndexState *local_state,
-		Relation		   index,
-		TpDataSource	  *memtable_src,
-		const char		  *term,
-		float4			   idf,
-		float4			   k1,
-		float4			   b,
-		float4			   avg_doc_len,
-		int				   max_results,
-		ItemPointerData	  *result_ctids,
-		float4			  *result_scores,
-		TpBMWStats		  *stats)
+		TpLocalIndexState	*local_state,
+		Relation			 index,
+		TpDataSource		*memtable_src,
+		const BlockNumber	*level_heads,
+		TpParallelScanState *parallel,
+		const TpScoreCursor *cursor,
+		pg_atomic_uint32	*shared_threshold,
+		const TpQueryPrior	*prior,
+		const char			*term,
+		float4				 idf,
+		float4				 k1,
+		float4				 b,
+		float4				 avg_doc_len,
+		int					 max_results,
+		ItemPointerData		*result_ctids,
+		float4				*result_scores,
+		TpBMWStats			*stats)
 {
-	TpTopKHeap		heap;
-	TpIndexMetaPage metap;
-	BlockNumber		level_heads[TP_MAX_LEVELS];
-	int				level;
-	int				result_count;
+	TpTopKHeap			heap;
+	TpSegmentPlanEntry *plan;
+	int					plan_count;
+	int					i;
+	int					result_count;
 
 	(void)local_state; /* reserved for future use */
 
@@ -599,36 +1173,66 @@ tp_score_single_term_bmw(
 
 	/* Initialize top-k heap */
 	tp_topk_init(&heap, max_results, CurrentMemoryContext);
+	heap.shared_threshold = shared_threshold;
+	heap.prior			  = prior;
+	heap.inflation		  = (float4)tp_threshold_inflation;
+	budget_start(&heap.budget);
+	if (cursor != NULL && cursor->active)
+		heap.cursor = cursor;
 
 	/* Score memtable (exhaustive - no skip index) */
 	score_memtable_single_term(
 			&heap, memtable_src, term, idf, k1, b, avg_doc_len, stats);
 
-	/* Get segment level heads from metapage */
-	metap = tp_get_metapage(index);
-	for (level = 0; level < TP_MAX_LEVELS; level++)
-		level_heads[level] = metap->level_heads[level];
-	pfree(metap);
-
-	/* Score each segment level with BMW */
-	for (level = 0; level < TP_MAX_LEVELS; level++)
+	/* Score segments with BMW, highest upper bound first */
+	plan = plan_segments(
+			index,
+			level_heads,
+			&term,
+			NULL,
+			NULL,
+			0,
+			&idf,
+			1,
+			k1,
+			b,
+			avg_doc_len,
+			prior,
+			&plan_count);
+
+	for (i = 0; i < plan_count; i++)
 	{
-		BlockNumber seg_head = level_heads[level];
+		TpSegmentReader *reader;
 
-		while (seg_head != InvalidBlockNumber)
-		{
-			TpSegmentReader *reader = tp_segment_open(index, seg_head);
+		CHECK_FOR_INTERRUPTS();
 
-			CHECK_FOR_INTERRUPTS();
+		/* The most promising segments come first: stop at the budget */
+		if (budget_stops_plan(&heap, plan_count - i, stats))
+			break;
+
+		/*
+		 * In a parallel scan, only score segments we claimed.  Claim
+		 * before pruning so that every segment stays in someone's
+		 * partition for a re-execution with a larger limit.
+		 */
+		if (parallel != NULL &&
+			!tp_parallel_scan_claim_segment(parallel, plan[i].root_block))
+			continue;
 
-			score_segment_single_term_bmw(
-					&heap, reader, term, idf, k1, b, avg_doc_len, stats);
+		if (plan_entry_pruned(&heap, &plan[i], stats))
+			continue;
 
-			seg_head = reader->header->next_segment;
-			tp_segment_close(reader);
-		}
+		reader = tp_segment_open(index, plan[i].root_block);
+		score_segment_single_term_bmw(
+				&heap, reader, term, idf, k1, b, avg_doc_len, stats);
+		tp_segment_close(reader);
 	}
 
+	if (plan)
+		pfree(plan);
+	if (stats)
+		stats->budget_exhausted = heap.budget.exhausted;
+
 	/* Resolve CTIDs for segment results before extraction */
 	tp_topk_resolve_ctids(&heap, index);
 
@@ -655,6 +1259,8 @@ typedef struct TpTermState
 	const char *term;
 	float4		idf;
 	int32		query_freq; /* Query term frequency (for boosting) */
+	bool		required;	/* "+term": every match must contain it */
+	bool		probe_only; /* Never proposes candidates (term pruning) */
 
 	/* Global maximum score across all blocks (for WAND pivot) */
 	float4 max_score;
@@ -667,6 +1273,29 @@ typedef struct TpTermState
 	uint32	cur_doc_id;				/* Cached current doc ID */
 } TpTermState;
 
+/*
+ * A query phrase bound to the term states of its lexemes.  Phrase
+ * lexemes are required terms, so in a conjunctive segment walk their
+ * cursors all sit on the candidate when it is verified.
+ */
+typedef struct TpPhraseCheck
+{
+	const TpPhrase *phrase;
+	int			   *term_idx;  /* Per phrase lexeme: query term index */
+	TpTermState	  **states;	   /* Per phrase lexeme: its term state */
+	uint32		  **positions; /* Scratch, per phrase lexeme */
+	uint32		   *counts;	   /* Scratch, per phrase lexeme */
+} TpPhraseCheck;
+
+/*
+ * Memtable posting of a phrase term, found by CTID
+ */
+typedef struct MemtablePostingRef
+{
+	ItemPointerData ctid;
+	int				idx; /* Index into the term's TpPostingData */
+} MemtablePostingRef;
+
 /*
  * Refresh cached doc ID from iterator state.
  */
@@ -689,28 +1318,209 @@ term_current_doc_id(TpTermState *ts)
 	return ts->cur_doc_id;
 }
 
+/*
+ * Collect the CTIDs of memtable docs containing any excluded term.
+ * Returns NULL if there are none.
+ */
+static HTAB *
+collect_memtable_excluded(
+		TpDataSource *source, char **excluded, int excluded_count)
+{
+	HTAB   *ctids = NULL;
+	HASHCTL hash_ctl;
+	int		i;
+
+	for (i = 0; i < excluded_count; i++)
+	{
+		TpPostingData *postings = tp_source_get_postings(source, excluded[i]);
+		int			   j;
+
+		if (postings && postings->count > 0)
+		{
+			if (ctids == NULL)
+			{
+				memset(&hash_ctl, 0, sizeof(hash_ctl));
+				hash_ctl.keysize   = sizeof(ItemPointerData);
+				hash_ctl.entrysize = sizeof(ItemPointerData);
+				hash_ctl.hcxt	   = CurrentMemoryContext;
+				ctids			   = hash_create(
+						  "Memtable Excluded Docs",
+						  postings->count,
+						  &hash_ctl,
+						  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+			}
+			for (j = 0; j < postings->count; j++)
+				(void)hash_search(
+						ctids, &postings->ctids[j], HASH_ENTER, NULL);
+		}
+		if (postings)
+			tp_source_free_postings(source, postings);
+	}
+
+	return ctids;
+}
+
+/*
+ * Do the memtable postings of the phrase terms place every phrase in
+ * the document at ctid?  postings[i] / refs[i] are kept for each query
+ * term i that occurs in a phrase.
+ */
+static bool
+memtable_doc_matches_phrases(
+		TpPhraseCheck  *phrases,
+		int				phrase_count,
+		TpPostingData **postings,
+		HTAB		  **refs,
+		ItemPointer		ctid)
+{
+	int i;
+
+	for (i = 0; i < phrase_count; i++)
+	{
+		TpPhraseCheck *check = &phrases[i];
+		int			   t;
+
+		for (t = 0; t < check->phrase->nterms; t++)
+		{
+			int					term = check->term_idx[t];
+			TpPostingData	   *pd	 = postings[term];
+			MemtablePostingRef *ref;
+
+			ref = hash_search(refs[term], ctid, HASH_FIND, NULL);
+			if (ref == NULL)
+				return false;
+			if (pd->positions == NULL)
+				tp_phrase_missing_positions();
+
+			check->positions[t] = pd->positions +
+								  pd->position_starts[ref->idx];
+			check->counts[t] = pd->position_starts[ref->idx + 1] -
+							   pd->position_starts[ref->idx];
+		}
+
+		if (!tp_phrase_matches(
+					check->phrase, check->positions, check->counts))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * One CTID -> posting index map per query term that occurs in a
+ * phrase; NULL for the other terms
+ */
+static HTAB **
+create_memtable_phrase_refs(
+		TpPhraseCheck *phrases, int phrase_count, int term_count)
+{
+	HTAB  **refs = palloc0(term_count * sizeof(HTAB *));
+	HASHCTL hash_ctl;
+	int		i;
+	int		t;
+
+	for (i = 0; i < phrase_count; i++)
+	{
+		for (t = 0; t < phrases[i].phrase->nterms; t++)
+		{
+			int term = phrases[i].term_idx[t];
+
+			if (refs[term] != NULL)
+				continue;
+			memset(&hash_ctl, 0, sizeof(hash_ctl));
+			hash_ctl.keysize   = sizeof(ItemPointerData);
+			hash_ctl.entrysize = sizeof(MemtablePostingRef);
+			hash_ctl.hcxt	   = CurrentMemoryContext;
+			refs[term]		   = hash_create(
+					"Memtable Phrase Postings",
+					1024,
+					&hash_ctl,
+					HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		}
+	}
+	return refs;
+}
+
+static void
+add_memtable_phrase_refs(HTAB *refs, TpPostingData *postings)
+{
+	int i;
+
+	for (i = 0; i < postings->count; i++)
+	{
+		MemtablePostingRef *ref = hash_search(
+				refs, &postings->ctids[i], HASH_ENTER, NULL);
+
+		ref->idx = i;
+	}
+}
+
+static void
+free_memtable_phrase_refs(
+		TpDataSource   *source,
+		HTAB		  **refs,
+		TpPostingData **postings,
+		int				term_count)
+{
+	int i;
+
+	for (i = 0; i < term_count; i++)
+	{
+		if (refs[i] != NULL)
+			hash_destroy(refs[i]);
+		if (postings[i] != NULL)
+			tp_source_free_postings(source, postings[i]);
+	}
+	pfree(refs);
+	pfree(postings);
+}
+
 /*
  * Score memtable postings for multiple terms.
  * Memtable has no skip index, so we score all postings exhaustively.
+ *
+ * A doc must contain all `required_count` terms flagged required, at
+ * least `min_should_match` of the others, and none of the `excluded`
+ * terms to reach the heap.  It must also match every phrase; that is
+ * checked last, only for docs that would enter the heap.
  */
 static void
 score_memtable_multi_term(
-		TpTopKHeap	 *heap,
-		TpDataSource *source,
-		TpTermState **terms,
-		int			  term_count,
-		float4		  k1,
-		float4		  b,
-		float4		  avg_doc_len,
-		TpBMWStats	 *stats)
+		TpTopKHeap	  *heap,
+		TpDataSource  *source,
+		TpTermState	 **terms,
+		int			   term_count,
+		int			   required_count,
+		int			   min_should_match,
+		char		 **excluded,
+		int			   excluded_count,
+		TpPhraseCheck *phrases,
+		int			   phrase_count,
+		float4		   k1,
+		float4		   b,
+		float4		   avg_doc_len,
+		TpBMWStats	  *stats)
 {
-	HTAB   *doc_accum;
-	HASHCTL hash_ctl;
-	int		term_idx;
+	HTAB		   *doc_accum;
+	HTAB		   *excluded_ctids;
+	HASHCTL			hash_ctl;
+	int				step;
+	TpPostingData **phrase_postings = NULL;
+	HTAB		  **phrase_refs		= NULL;
 
 	if (!source)
 		return;
 
+	excluded_ctids = collect_memtable_excluded(
+			source, excluded, excluded_count);
+
+	/* Keep the postings of phrase terms for the position check */
+	if (phrase_count > 0)
+	{
+		phrase_postings = palloc0(term_count * sizeof(TpPostingData *));
+		phrase_refs		= create_memtable_phrase_refs(
+				phrases, phrase_count, term_count);
+	}
+
 	/* Create hash table for document score accumulation */
 	memset(&hash_ctl, 0, sizeof(hash_ctl));
 	hash_ctl.keysize   = sizeof(ItemPointerData);
@@ -719,13 +1529,20 @@ score_memtable_multi_term(
 	doc_accum		   = hash_create(
 			 "Memtable Doc Accum", 1024, &hash_ctl, HASH_ELEM | HASH_BLOBS);
 
-	/* Process each term */
-	for (term_idx = 0; term_idx < term_count; term_idx++)
+	/*
+	 * Process each term.  Probe-only terms take a second pass, once
+	 * the others have entered every document they can add to.
+	 */
+	for (step = 0; step < 2 * term_count; step++)
 	{
-		TpTermState	  *ts = terms[term_idx];
+		int			   term_idx = step % term_count;
+		TpTermState	  *ts		= terms[term_idx];
 		TpPostingData *postings;
 		int			   i;
 
+		if (ts->probe_only != (step >= term_count))
+			continue;
+
 		postings = tp_source_get_postings(source, ts->term);
 		if (!postings || postings->count == 0)
 		{
@@ -750,6 +1567,14 @@ score_memtable_multi_term(
 			if ((i & 0xFFF) == 0)
 				CHECK_FOR_INTERRUPTS();
 
+			if (excluded_ctids != NULL &&
+				hash_search(excluded_ctids, ctid, HASH_FIND, NULL) != NULL)
+				continue;
+
+			if (ts->probe_only &&
+				hash_search(doc_accum, ctid, HASH_FIND, NULL) == NULL)
+				continue;
+
 			/* Get document length */
 			doc_len = tp_source_get_doc_length(source, ctid);
 			if (doc_len <= 0)
@@ -766,17 +1591,29 @@ score_memtable_multi_term(
 
 			if (!found)
 			{
-				entry->ctid		  = *ctid;
-				entry->score	  = term_score;
-				entry->doc_length = (float4)doc_len;
+				entry->ctid			 = *ctid;
+				entry->score		 = term_score;
+				entry->doc_length	 = (float4)doc_len;
+				entry->required_hits = 0;
+				entry->optional_hits = 0;
 			}
 			else
 			{
 				entry->score += term_score;
 			}
+			if (ts->required)
+				entry->required_hits++;
+			else
+				entry->optional_hits++;
 		}
 
-		tp_source_free_postings(source, postings);
+		if (phrase_refs != NULL && phrase_refs[term_idx] != NULL)
+		{
+			add_memtable_phrase_refs(phrase_refs[term_idx], postings);
+			phrase_postings[term_idx] = postings;
+		}
+		else
+			tp_source_free_postings(source, postings);
 	}
 
 	/* Add accumulated documents to heap */
@@ -787,7 +1624,21 @@ score_memtable_multi_term(
 		hash_seq_init(&seq, doc_accum);
 		while ((entry = hash_seq_search(&seq)) != NULL)
 		{
-			if (!tp_topk_dominated(heap, entry->score))
+			if (entry->required_hits < required_count ||
+				entry->optional_hits < min_should_match)
+				continue;
+
+			entry->score += memtable_doc_bonus(heap, source, &entry->ctid);
+
+			if (!tp_topk_dominated(heap, entry->score) &&
+				memtable_doc_admitted(heap, &entry->ctid, entry->score, stats) &&
+				(phrase_count == 0 ||
+				 memtable_doc_matches_phrases(
+						 phrases,
+						 phrase_count,
+						 phrase_postings,
+						 phrase_refs,
+						 &entry->ctid)))
 				tp_topk_add_memtable(heap, entry->ctid, entry->score);
 
 			if (stats)
@@ -796,6 +1647,11 @@ score_memtable_multi_term(
 	}
 
 	hash_destroy(doc_accum);
+	if (excluded_ctids != NULL)
+		hash_destroy(excluded_ctids);
+	if (phrase_refs != NULL)
+		free_memtable_phrase_refs(
+				source, phrase_refs, phrase_postings, term_count);
 }
 
 /*
@@ -855,6 +1711,7 @@ seek_term_to_doc(TpTermState *ts, uint32 target_doc_id)
 {
 	uint32 block_count;
 	int	   left, right, mid;
+	int	   step;
 	uint32 target_block;
 
 	if (!ts->found || ts->iter.finished)
@@ -888,13 +1745,27 @@ seek_term_to_doc(TpTermState *ts, uint32 target_doc_id)
 	else
 	{
 		/*
-		 * Target is past current block's cached last_doc_id. Binary
-		 * search the per-term skip cache to find the first block whose
-		 * last_doc_id >= target.
+		 * Target is past current block's cached last_doc_id.  Gallop
+		 * over the per-term skip cache (1, 2, 4, ... blocks ahead) to
+		 * bracket the first block whose last_doc_id >= target, then
+		 * binary search inside the bracket.  Intersections and MaxScore
+		 * probes mostly land a few blocks ahead, so this is O(log
+		 * distance) rather than O(log blocks).
 		 */
 		block_count = ts->iter.dict_entry.block_count;
 		left		= ts->iter.current_block + 1;
-		right		= (int)block_count - 1;
+		right		= left;
+		step		= 1;
+
+		while (right < (int)block_count - 1 &&
+			   ts->block_last_doc_ids[right] < target_doc_id)
+		{
+			left = right + 1;
+			right += step;
+			step *= 2;
+		}
+		if (right > (int)block_count - 1)
+			right = (int)block_count - 1;
 
 		while (left < right)
 		{
@@ -982,26 +1853,101 @@ seek_term_to_doc(TpTermState *ts, uint32 target_doc_id)
 	}
 }
 
+/*
+ * Pre-load a found term's skip entries (block maxima for BMW checks,
+ * last doc IDs for seeking) and position it on its first posting.
+ * Returns false if the first block cannot be loaded.
+ */
+static bool
+load_term_cursor(
+		TpTermState		*ts,
+		TpSegmentReader *reader,
+		float4			 k1,
+		float4			 b,
+		float4			 avg_doc_len)
+{
+	if (ts->iter.dict_entry.block_count > 0)
+	{
+		uint32		 block_idx;
+		uint32		 block_count = ts->iter.dict_entry.block_count;
+		TpSkipEntry *skip_cache;
+
+		ts->block_max_scores   = palloc(block_count * sizeof(float4));
+		ts->block_last_doc_ids = palloc(block_count * sizeof(uint32));
+
+		/* Allocate and populate skip entry cache for the iterator */
+		skip_cache = palloc(block_count * sizeof(TpSkipEntry));
+
+		for (block_idx = 0; block_idx < block_count; block_idx++)
+		{
+			tp_segment_read_skip_entry(
+					reader,
+					ts->iter.dict_entry.skip_index_offset,
+					block_idx,
+					&skip_cache[block_idx]);
+			ts->block_last_doc_ids[block_idx] =
+					skip_cache[block_idx].last_doc_id;
+		}
+
+		segment_block_max_scores(
+				reader,
+				&ts->iter.dict_entry,
+				skip_cache,
+				ts->idf,
+				k1,
+				b,
+				avg_doc_len,
+				ts->block_max_scores);
+		for (block_idx = 0; block_idx < block_count; block_idx++)
+		{
+			if (ts->block_max_scores[block_idx] > ts->max_score)
+				ts->max_score = ts->block_max_scores[block_idx];
+		}
+
+		ts->max_score *= ts->query_freq;
+
+		/* Set caches on iterator for load_block to use */
+		ts->iter.cached_skip_entries  = skip_cache;
+		ts->iter.compressed_buf_cache = palloc(
+				TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE);
+	}
+
+	if (!tp_segment_posting_iterator_load_block(&ts->iter))
+		return false;
+
+	refresh_cur_doc_id(ts);
+	return true;
+}
+
 /*
  * Initialize term states for a segment.
  * Returns count of active iterators (terms found in segment).
- * Terms array is sorted by doc ID after initialization.
+ *
+ * On V6 segments the per-term bounds give each term's max_score from
+ * the dictionary alone.  If even the sum of those bounds cannot beat
+ * the heap threshold, no document in the segment can enter the top-k:
+ * return 0 before any skip index is read.
  */
 static int
 init_segment_term_states(
+		TpTopKHeap		*heap,
 		TpTermState	   **terms,
 		int				 term_count,
 		TpSegmentReader *reader,
 		float4			 k1,
 		float4			 b,
-		float4			 avg_doc_len)
+		float4			 avg_doc_len,
+		TpBMWStats		*stats)
 {
-	int active_count = 0;
-	int term_idx;
+	int	   active_count = 0;
+	int	   term_idx;
+	bool   all_bounded	= true;
+	float4 bound_sum	= 0.0f;
 
 	for (term_idx = 0; term_idx < term_count; term_idx++)
 	{
 		TpTermState *ts = terms[term_idx];
+		TpTermBounds bounds;
 
 		ts->found			   = false;
 		ts->max_score		   = 0.0f;
@@ -1014,48 +1960,37 @@ init_segment_term_states(
 
 		ts->found = true;
 
-		/* Pre-load skip entries for BMW threshold checks and fast seeking */
-		if (ts->iter.dict_entry.block_count > 0)
-		{
-			uint32		 block_idx;
-			uint32		 block_count = ts->iter.dict_entry.block_count;
-			TpSkipEntry *skip_cache;
-
-			ts->block_max_scores   = palloc(block_count * sizeof(float4));
-			ts->block_last_doc_ids = palloc(block_count * sizeof(uint32));
-
-			/* Allocate and populate skip entry cache for the iterator */
-			skip_cache = palloc(block_count * sizeof(TpSkipEntry));
-
-			for (block_idx = 0; block_idx < block_count; block_idx++)
-			{
-				tp_segment_read_skip_entry(
-						reader,
-						ts->iter.dict_entry.skip_index_offset,
-						block_idx,
-						&skip_cache[block_idx]);
-				ts->block_max_scores[block_idx] = tp_compute_block_max_score(
-						&skip_cache[block_idx], ts->idf, k1, b, avg_doc_len);
-				ts->block_last_doc_ids[block_idx] =
-						skip_cache[block_idx].last_doc_id;
-
-				if (ts->block_max_scores[block_idx] > ts->max_score)
-					ts->max_score = ts->block_max_scores[block_idx];
-			}
+		if (tp_segment_read_term_bounds(
+					reader, ts->iter.dict_entry_idx, &bounds))
+			bound_sum += segment_term_bound(
+								 reader, &bounds, ts->idf, k1, b, avg_doc_len) *
+						 ts->query_freq;
+		else
+			all_bounded = false;
+	}
 
-			ts->max_score *= ts->query_freq;
+	if (all_bounded && bound_sum < bound_threshold(heap))
+	{
+		uint64 blocks = 0;
 
-			/* Set caches on iterator for load_block to use */
-			ts->iter.cached_skip_entries  = skip_cache;
-			ts->iter.compressed_buf_cache = palloc(
-					TP_MAX_COMPRESSED_BLOCK_SIZE);
+		for (term_idx = 0; term_idx < term_count; term_idx++)
+		{
+			if (terms[term_idx]->found)
+				blocks += terms[term_idx]->iter.dict_entry.block_count;
 		}
+		if (stats)
+			stats->blocks_skipped += blocks;
+		count_inflated_skip(
+				heap, bound_sum + heap->prior_bound, blocks, stats);
+		return 0;
+	}
 
-		if (tp_segment_posting_iterator_load_block(&ts->iter))
-		{
-			refresh_cur_doc_id(ts);
+	for (term_idx = 0; term_idx < term_count; term_idx++)
+	{
+		TpTermState *ts = terms[term_idx];
+
+		if (ts->found && load_term_cursor(ts, reader, k1, b, avg_doc_len))
 			active_count++;
-		}
 	}
 
 	return active_count;
@@ -1091,6 +2026,75 @@ cleanup_segment_term_states(TpTermState **terms, int term_count)
 	}
 }
 
+/*
+ * Position cursors for a segment without any threshold pruning: the
+ * excluded ("-term") cursors, which are never scored and only moved
+ * forward to candidates by doc_is_excluded(), and the cursors of a
+ * boolean match.
+ */
+static void
+init_term_cursors(
+		TpTermState		**terms,
+		int				  term_count,
+		TpSegmentReader *reader,
+		float4			  k1,
+		float4			  b,
+		float4			  avg_doc_len)
+{
+	int i;
+
+	for (i = 0; i < term_count; i++)
+	{
+		TpTermState *ts = terms[i];
+
+		ts->found			   = false;
+		ts->max_score		   = 0.0f;
+		ts->cur_doc_id		   = UINT32_MAX;
+		ts->block_max_scores   = NULL;
+		ts->block_last_doc_ids = NULL;
+
+		if (!tp_segment_posting_iterator_init(&ts->iter, reader, ts->term))
+			continue;
+
+		ts->found = true;
+		load_term_cursor(ts, reader, k1, b, avg_doc_len);
+	}
+}
+
+/*
+ * Does any excluded term contain `doc_id`?  Callers visit candidates
+ * in ascending doc ID order, so the cursors only ever move forward
+ * and skip whole blocks through the cached skip entries.
+ */
+static bool
+doc_is_excluded(
+		TpTermState **excluded,
+		int			  excluded_count,
+		uint32		  doc_id,
+		TpBMWStats	 *stats)
+{
+	int i;
+
+	for (i = 0; i < excluded_count; i++)
+	{
+		TpTermState *ts = excluded[i];
+
+		if (term_current_doc_id(ts) < doc_id)
+		{
+			seek_term_to_doc(ts, doc_id);
+			if (stats)
+				stats->seeks_performed++;
+		}
+		if (term_current_doc_id(ts) == doc_id)
+		{
+			if (stats)
+				stats->docs_excluded++;
+			return true;
+		}
+	}
+	return false;
+}
+
 /*
  * Compare terms by current doc_id for initial sort.
  * Exhausted terms (UINT32_MAX) sort to the end.
@@ -1156,6 +2160,11 @@ restore_ordering(TpTermState **terms, int term_count, int ord)
  * accumulating each term's max_score. When the sum exceeds
  * threshold, we've found the pivot.
  *
+ * With min_should_match, a doc before terms[min_should_match - 1]
+ * can only be in fewer than min_should_match lists, so the pivot is
+ * never taken before that position: once every pre-pivot cursor has
+ * aligned on the pivot, the doc is known to match enough terms.
+ *
  * Returns true if a pivot was found, false if no term combination
  * can beat threshold. Sets *pivot_len_out to the number of terms
  * participating (terms[0..pivot_len-1]) and *pivot_doc_id_out to
@@ -1166,6 +2175,7 @@ find_wand_pivot(
 		TpTermState **terms,
 		int			  term_count,
 		float4		  threshold,
+		int			  min_should_match,
 		int			 *pivot_len_out,
 		uint32		 *pivot_doc_id_out)
 {
@@ -1179,7 +2189,7 @@ find_wand_pivot(
 			break; /* No more active terms */
 
 		accumulated += terms[i]->max_score;
-		if (accumulated > threshold)
+		if (accumulated > threshold && i + 1 >= min_should_match)
 		{
 			/*
 			 * Found pivot: terms[i] is the pivot term.
@@ -1418,6 +2428,25 @@ verify_pivot_alignment(TpTermState **terms, int pivot_len, uint32 pivot_doc_id)
 	return true;
 }
 
+/*
+ * BM25 contribution of a term's current posting, boosted by the
+ * term's query frequency.
+ */
+static inline float4
+term_posting_score(TpTermState *ts, float4 k1, float4 b, float4 avg_doc_len)
+{
+	TpBlockPosting *bp = &ts->iter.block_postings[ts->iter.current_in_block];
+
+	return compute_bm25_score(
+				   ts->idf,
+				   bp->frequency,
+				   (int32)decode_fieldnorm(bp->fieldnorm),
+				   k1,
+				   b,
+				   avg_doc_len) *
+		   ts->query_freq;
+}
+
 /*
  * Score pivot document by accumulating BM25 contributions from
  * all confirmed pivot terms.
@@ -1439,23 +2468,12 @@ score_pivot_document(
 
 	for (i = 0; i < pivot_len; i++)
 	{
-		TpTermState	   *ts = terms[i];
-		TpBlockPosting *bp;
-		float4			term_score;
+		TpTermState *ts = terms[i];
 
 		if (!ts->found || ts->iter.finished)
 			continue;
 
-		bp		   = &ts->iter.block_postings[ts->iter.current_in_block];
-		term_score = compute_bm25_score(
-							 ts->idf,
-							 bp->frequency,
-							 (int32)decode_fieldnorm(bp->fieldnorm),
-							 k1,
-							 b,
-							 avg_doc_len) *
-					 ts->query_freq;
-		doc_score += term_score;
+		doc_score += term_posting_score(ts, k1, b, avg_doc_len);
 	}
 
 	return doc_score;
@@ -1472,34 +2490,32 @@ score_pivot_document(
  * Block-max refinement then checks if block-level upper bounds
  * at the pivot still beat the threshold, and uses Tantivy-style
  * skip advancement when they don't.
+ *
+ * Expects term states already initialized for this segment.  Pivots
+ * found in an `excluded` list are skipped without scoring, and
+ * pivots reached by fewer than `min_should_match` lists are never
+ * taken (see find_wand_pivot).
  */
 static void
-score_segment_multi_term_bmw(
+score_segment_wand(
 		TpTopKHeap		*heap,
 		TpSegmentReader *reader,
 		TpTermState	   **terms,
 		int				 term_count,
+		int				 active_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
 		float4			 k1,
 		float4			 b,
 		float4			 avg_doc_len,
 		TpBMWStats		*stats)
 {
-	int active_count;
-
-	active_count = init_segment_term_states(
-			terms, term_count, reader, k1, b, avg_doc_len);
-
-	if (active_count == 0)
-	{
-		cleanup_segment_term_states(terms, term_count);
-		return;
-	}
-
 	/* Sort terms by current doc_id for WAND traversal */
 	sort_terms_by_doc_id(terms, term_count);
 
-	/* WAND main loop */
-	while (active_count > 0)
+	/* WAND main loop; stops once too few lists remain to match */
+	while (active_count > 0 && active_count >= min_should_match)
 	{
 		int	   pivot_len;
 		uint32 pivot_doc_id;
@@ -1510,11 +2526,19 @@ score_segment_multi_term_bmw(
 
 		CHECK_FOR_INTERRUPTS();
 
-		threshold = tp_topk_threshold(heap);
+		if (budget_exhausted(&heap->budget))
+			break;
+
+		threshold = bound_threshold(heap);
 
 		/* Step 1: Find WAND pivot */
 		if (!find_wand_pivot(
-					terms, term_count, threshold, &pivot_len, &pivot_doc_id))
+					terms,
+					term_count,
+					threshold,
+					min_should_match,
+					&pivot_len,
+					&pivot_doc_id))
 			break; /* No term combination can beat threshold */
 
 		/* Step 2: Seek pre-pivot terms to pivot_doc_id */
@@ -1566,6 +2590,11 @@ score_segment_multi_term_bmw(
 			{
 				block_max_skip_advance(
 						terms, term_count, pivot_len, &active_count, stats);
+				count_inflated_skip(
+						heap,
+						block_upper + non_pivot_max + heap->prior_bound,
+						1,
+						stats);
 				continue;
 			}
 		}
@@ -1577,19 +2606,23 @@ score_segment_multi_term_bmw(
 		if (!verify_pivot_alignment(terms, pivot_len, pivot_doc_id))
 			continue; /* Re-pivot with new positions */
 
-		/* Skip dead docs */
+		/* Skip dead and excluded docs */
 		if (!tp_segment_is_alive(reader, pivot_doc_id))
 		{
 			if (stats)
 				stats->dead_docs_skipped++;
 		}
-		else
+		else if (!doc_is_excluded(excluded, excluded_count, pivot_doc_id, stats))
 		{
 			/* Step 5: Score the pivot document */
 			doc_score =
 					score_pivot_document(terms, pivot_len, k1, b, avg_doc_len);
+			if (doc_score > 0.0f)
+				doc_score += segment_doc_bonus(heap, reader, pivot_doc_id);
 
-			if (doc_score > 0.0f && !tp_topk_dominated(heap, doc_score))
+			if (doc_score > 0.0f && !tp_topk_dominated(heap, doc_score) &&
+				segment_doc_admitted(
+						heap, reader, pivot_doc_id, doc_score, stats))
 				tp_topk_add_segment(
 						heap, reader->root_block, pivot_doc_id, doc_score);
 
@@ -1612,105 +2645,1463 @@ score_segment_multi_term_bmw(
 			}
 		}
 	}
-
-	cleanup_segment_term_states(terms, term_count);
 }
 
 /*
- * Score documents using multi-term Block-Max WAND.
+ * ------------------------------------------------------------
+ * Block-Max MaxScore
+ * ------------------------------------------------------------
+ *
+ * WAND re-sorts term cursors around every pivot, which gets expensive
+ * once a query has many terms.  MaxScore instead orders terms once by
+ * max_score and splits them at the threshold: the longest prefix whose
+ * summed max_score cannot beat the threshold is "non-essential".  A
+ * document matching only non-essential terms cannot enter the top-k,
+ * so candidates are drawn from the essential lists alone and the
+ * non-essential lists are only probed (seeked) for those candidates.
+ * As the threshold rises, terms migrate into the non-essential set.
+ *
+ * The block-max refinement bounds every doc up to the nearest
+ * essential block boundary by the essential terms' current block
+ * maxima plus the non-essential prefix, and skips the whole range
+ * when that cannot beat the threshold.
  */
-int
-tp_score_multi_term_bmw(
-		TpLocalIndexState *local_state,
-		Relation		   index,
-		TpDataSource	  *memtable_src,
-		char			 **query_terms,
-		int				   term_count,
-		int32			  *query_freqs,
-		float4			  *idfs,
-		float4			   k1,
-		float4			   b,
-		float4			   avg_doc_len,
-		int				   max_results,
-		ItemPointerData	  *result_ctids,
-		float4			  *result_scores,
-		TpBMWStats		  *stats)
-{
-	TpTopKHeap		heap;
-	TpIndexMetaPage metap;
-	BlockNumber		level_heads[TP_MAX_LEVELS];
-	TpTermState	  **terms;
-	int				level;
-	int				result_count;
-	int				i;
 
-	(void)local_state; /* reserved for future use */
+/*
+ * Heuristics for picking MaxScore over WAND for a segment.  MaxScore
+ * wins on long queries (WAND's per-pivot re-sort is O(terms)) and on
+ * queries whose posting lists differ widely in length: the long,
+ * low-IDF lists drop into the non-essential set and are only probed.
+ */
+#define TP_MAXSCORE_MIN_TERMS		 8 /* Always MaxScore at this many */
+#define TP_MAXSCORE_MIN_SKEWED_TERMS 3 /* Smallest query to test skew */
+#define TP_MAXSCORE_DF_SKEW			 8 /* max_df / min_df to count as skewed */
 
-	/* Initialize stats */
-	if (stats)
-		memset(stats, 0, sizeof(TpBMWStats));
+/*
+ * Choose the evaluation strategy for one segment from the number of
+ * terms present in it and their segment-local doc_freqs, unless
+ * pg_textsearch.multi_term_evaluator forces one.
+ */
+static bool
+segment_prefers_maxscore(TpTermState **terms, int term_count, int active_count)
+{
+	uint32 min_df = UINT32_MAX;
+	uint32 max_df = 0;
+	int	   i;
 
-	/* Initialize top-k heap */
-	tp_topk_init(&heap, max_results, CurrentMemoryContext);
+	if (tp_multi_term_evaluator != TP_EVALUATOR_AUTO)
+		return tp_multi_term_evaluator == TP_EVALUATOR_MAXSCORE;
+	if (active_count >= TP_MAXSCORE_MIN_TERMS)
+		return true;
+	if (active_count < TP_MAXSCORE_MIN_SKEWED_TERMS)
+		return false;
 
-	/* Initialize term states */
-	terms = palloc(term_count * sizeof(TpTermState *));
 	for (i = 0; i < term_count; i++)
 	{
-		terms[i]			 = palloc(sizeof(TpTermState));
-		terms[i]->term		 = query_terms[i];
-		terms[i]->idf		 = idfs[i];
-		terms[i]->query_freq = query_freqs[i];
+		TpTermState *ts = terms[i];
+
+		if (term_current_doc_id(ts) == UINT32_MAX)
+			continue;
+		min_df = Min(min_df, ts->iter.dict_entry.doc_freq);
+		max_df = Max(max_df, ts->iter.dict_entry.doc_freq);
 	}
 
-	/* Score memtable (exhaustive - no skip index) */
-	score_memtable_multi_term(
-			&heap, memtable_src, terms, term_count, k1, b, avg_doc_len, stats);
+	return (uint64)max_df >= (uint64)min_df * TP_MAXSCORE_DF_SKEW;
+}
 
-	/* Get segment level heads from metapage */
-	metap = tp_get_metapage(index);
-	for (level = 0; level < TP_MAX_LEVELS; level++)
-		level_heads[level] = metap->level_heads[level];
-	pfree(metap);
+/*
+ * Compare terms by max_score, ascending, after the probe-only terms.
+ * Terms absent from the segment have max_score 0 and sort first
+ * (always non-essential).
+ */
+static int
+compare_term_max_score(const void *a, const void *b)
+{
+	TpTermState *const *pa = (TpTermState *const *)a;
+	TpTermState *const *pb = (TpTermState *const *)b;
 
-	/* Score each segment with block-based BMW */
-	for (level = 0; level < TP_MAX_LEVELS; level++)
+	if ((*pa)->probe_only != (*pb)->probe_only)
+		return (*pa)->probe_only ? -1 : 1;
+	if ((*pa)->max_score < (*pb)->max_score)
+		return -1;
+	if ((*pa)->max_score > (*pb)->max_score)
+		return 1;
+	return 0;
+}
+
+/*
+ * Upper bound for any doc in the term's current block, and the last
+ * doc ID that bound covers.
+ */
+static inline float4
+term_current_block_bound(TpTermState *ts, uint32 *block_last_out)
+{
+	uint32 block = ts->iter.current_block;
+
+	if (ts->block_max_scores == NULL ||
+		block >= ts->iter.dict_entry.block_count)
 	{
-		BlockNumber seg_head = level_heads[level];
+		*block_last_out = term_current_doc_id(ts);
+		return ts->max_score;
+	}
 
-		while (seg_head != InvalidBlockNumber)
+	*block_last_out = ts->block_last_doc_ids[block];
+	return ts->block_max_scores[block] * ts->query_freq;
+}
+
+/*
+ * Score segment postings for multiple terms using Block-Max MaxScore.
+ *
+ * Expects term states already initialized for this segment.
+ * Candidates found in an `excluded` list are skipped without scoring.
+ * A candidate must appear in `min_should_match` lists; non-essential
+ * probing stops as soon as the remaining lists cannot make up the
+ * shortfall.  Probe-only terms are never essential.
+ */
+static void
+score_segment_maxscore(
+		TpTopKHeap		*heap,
+		TpSegmentReader *reader,
+		TpTermState	   **terms,
+		int				 term_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
+		float4			 k1,
+		float4			 b,
+		float4			 avg_doc_len,
+		TpBMWStats		*stats)
+{
+	float4 *prefix_ub; /* prefix_ub[i] = sum of max_score, terms[0..i] */
+	float4	accumulated		= 0.0f;
+	int		first_essential = 0;
+	int		i;
+
+	qsort(terms, term_count, sizeof(TpTermState *), compare_term_max_score);
+
+	prefix_ub = palloc(term_count * sizeof(float4));
+	for (i = 0; i < term_count; i++)
+	{
+		accumulated += terms[i]->max_score;
+		prefix_ub[i] = accumulated;
+		if (terms[i]->probe_only)
+			first_essential = i + 1;
+	}
+
+	for (;;)
+	{
+		uint32 candidate	 = UINT32_MAX;
+		uint32 min_block_end = UINT32_MAX;
+		float4 threshold;
+		float4 non_essential_ub;
+		float4 upper;
+		float4 doc_score;
+		int	   matched;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (budget_exhausted(&heap->budget))
+			break;
+
+		threshold = bound_threshold(heap);
+
+		/* The threshold only rises, so the essential set only shrinks */
+		while (first_essential < term_count &&
+			   prefix_ub[first_essential] <= threshold)
+			first_essential++;
+		if (first_essential >= term_count)
+			break; /* No remaining term combination can beat threshold */
+
+		non_essential_ub = first_essential > 0
+								 ? prefix_ub[first_essential - 1]
+								 : 0.0f;
+
+		/*
+		 * Candidate is the smallest doc among the essential lists.  Any
+		 * doc in [candidate, min_block_end] lies in the current block of
+		 * every essential term that contains it, so the block maxima
+		 * bound its essential contribution.
+		 */
+		upper = non_essential_ub;
+		for (i = first_essential; i < term_count; i++)
 		{
-			TpSegmentReader *reader = tp_segment_open(index, seg_head);
+			TpTermState *ts = terms[i];
+			uint32		 doc_id = term_current_doc_id(ts);
+			uint32		 block_last;
 
-			CHECK_FOR_INTERRUPTS();
+			if (doc_id == UINT32_MAX)
+				continue;
+			candidate = Min(candidate, doc_id);
+			upper += term_current_block_bound(ts, &block_last);
+			min_block_end = Min(min_block_end, block_last);
+		}
 
-			score_segment_multi_term_bmw(
-					&heap,
-					reader,
-					terms,
-					term_count,
-					k1,
-					b,
-					avg_doc_len,
-					stats);
+		if (candidate == UINT32_MAX)
+			break; /* Essential lists exhausted */
 
-			seg_head = reader->header->next_segment;
-			tp_segment_close(reader);
+		if (upper <= threshold)
+		{
+			/*
+			 * Nothing up to min_block_end can qualify: move every
+			 * essential term past it.  The term at candidate has
+			 * cur_doc_id <= min_block_end, so this always progresses.
+			 */
+			for (i = first_essential; i < term_count; i++)
+			{
+				TpTermState *ts = terms[i];
+
+				if (term_current_doc_id(ts) > min_block_end)
+					continue;
+				seek_term_to_doc(ts, min_block_end + 1);
+				if (stats)
+					stats->seeks_performed++;
+			}
+			if (stats)
+				stats->blocks_skipped++;
+			count_inflated_skip(heap, upper + heap->prior_bound, 1, stats);
+			continue;
+		}
+
+		if (stats)
+			stats->blocks_scanned++;
+
+		if (!tp_segment_is_alive(reader, candidate))
+		{
+			if (stats)
+				stats->dead_docs_skipped++;
+		}
+		else if (!doc_is_excluded(excluded, excluded_count, candidate, stats))
+		{
+			/* Exact essential contribution */
+			doc_score = 0.0f;
+			matched	  = 0;
+			for (i = first_essential; i < term_count; i++)
+			{
+				if (term_current_doc_id(terms[i]) == candidate)
+				{
+					doc_score += term_posting_score(
+							terms[i], k1, b, avg_doc_len);
+					matched++;
+				}
+			}
+
+			/*
+			 * Probe non-essential terms, most valuable first, until
+			 * the remaining prefix can no longer lift the doc over
+			 * the threshold or supply enough matches.
+			 */
+			for (i = first_essential - 1; i >= 0; i--)
+			{
+				TpTermState *ts = terms[i];
+
+				if (doc_score + prefix_ub[i] <= threshold ||
+					matched + i + 1 < min_should_match)
+					break;
+
+				if (term_current_doc_id(ts) < candidate)
+				{
+					seek_term_to_doc(ts, candidate);
+					if (stats)
+						stats->seeks_performed++;
+				}
+				if (term_current_doc_id(ts) == candidate)
+				{
+					doc_score += term_posting_score(ts, k1, b, avg_doc_len);
+					matched++;
+				}
+			}
+			if (doc_score > 0.0f && matched >= min_should_match)
+				doc_score += segment_doc_bonus(heap, reader, candidate);
+
+			if (doc_score > 0.0f && matched >= min_should_match &&
+				!tp_topk_dominated(heap, doc_score) &&
+				segment_doc_admitted(heap, reader, candidate, doc_score, stats))
+				tp_topk_add_segment(
+						heap, reader->root_block, candidate, doc_score);
+
+			if (stats)
+				stats->segment_docs_scored++;
+		}
+
+		/* Advance essential terms past the candidate */
+		for (i = first_essential; i < term_count; i++)
+		{
+			if (term_current_doc_id(terms[i]) == candidate)
+				advance_term_iterator(terms[i]);
+		}
+	}
+
+	pfree(prefix_ub);
+}
+
+/*
+ * ------------------------------------------------------------
+ * Conjunctive Evaluation (+required terms)
+ * ------------------------------------------------------------
+ *
+ * With required terms a document can only match if it appears in
+ * every required list, so the segment is walked as an intersection
+ * rather than a union.  The rarest required list proposes a candidate
+ * and the others gallop to it through their cached skip entries; a
+ * list that overshoots proposes the next candidate instead.  Optional
+ * terms are only probed for documents that survive the intersection.
+ *
+ * Block-max: every doc up to the nearest required block boundary is
+ * bounded by the required terms' current block maxima plus the
+ * optional terms' max_scores, and that whole range is skipped when
+ * the bound cannot beat the threshold.
+ */
+
+/*
+ * Does the segment doc under the phrase terms' cursors match every
+ * phrase?  Reads the positions of the cursors' current postings.
+ */
+static bool
+segment_doc_matches_phrases(TpPhraseCheck *phrases, int phrase_count)
+{
+	int i;
+
+	for (i = 0; i < phrase_count; i++)
+	{
+		TpPhraseCheck *check = &phrases[i];
+		int			   t;
+
+		for (t = 0; t < check->phrase->nterms; t++)
+		{
+			if (!tp_segment_posting_iterator_positions(
+						&check->states[t]->iter,
+						&check->positions[t],
+						&check->counts[t]))
+				tp_phrase_missing_positions();
 		}
+
+		if (!tp_phrase_matches(
+					check->phrase, check->positions, check->counts))
+			return false;
 	}
+	return true;
+}
 
+/*
+ * Compare terms by segment-local doc_freq, ascending
+ */
+static int
+compare_term_doc_freq(const void *a, const void *b)
+{
+	TpTermState *const *pa = (TpTermState *const *)a;
+	TpTermState *const *pb = (TpTermState *const *)b;
+	uint32				da = (*pa)->iter.dict_entry.doc_freq;
+	uint32				db = (*pb)->iter.dict_entry.doc_freq;
+
+	if (da < db)
+		return -1;
+	if (da > db)
+		return 1;
+	return 0;
+}
+
+/*
+ * Score segment postings by intersecting the required terms.
+ *
+ * Expects term states already initialized for this segment, with every
+ * required term present.  A match must also contain `min_should_match`
+ * of the optional terms and match every phrase.  Positions are read
+ * only for docs whose score would enter the heap.
+ */
+static void
+score_segment_conjunctive(
+		TpTopKHeap		*heap,
+		TpSegmentReader *reader,
+		TpTermState	   **terms,
+		int				 term_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
+		TpPhraseCheck	*phrases,
+		int				 phrase_count,
+		float4			 k1,
+		float4			 b,
+		float4			 avg_doc_len,
+		TpBMWStats		*stats)
+{
+	TpTermState **required;
+	TpTermState **optional;
+	int			  required_count = 0;
+	int			  optional_count = 0;
+	float4		  optional_ub	 = 0.0f;
+	uint32		  candidate;
+	int			  i;
+
+	required = palloc(term_count * sizeof(TpTermState *));
+	optional = palloc(term_count * sizeof(TpTermState *));
 	for (i = 0; i < term_count; i++)
-		pfree(terms[i]);
-	pfree(terms);
+	{
+		TpTermState *ts = terms[i];
 
-	/* Resolve CTIDs for segment results before extraction */
-	tp_topk_resolve_ctids(&heap, index);
+		if (ts->required)
+			required[required_count++] = ts;
+		else if (term_current_doc_id(ts) != UINT32_MAX)
+		{
+			optional[optional_count++] = ts;
+			optional_ub += ts->max_score;
+		}
+	}
+	Assert(required_count > 0);
 
-	/* Extract sorted results */
-	result_count = tp_topk_extract(&heap, result_ctids, result_scores);
+	if (optional_count < min_should_match)
+	{
+		pfree(required);
+		pfree(optional);
+		return;
+	}
 
-	if (stats)
-		stats->docs_in_results = result_count;
+	/* The rarest list drives the intersection */
+	qsort(required,
+		  required_count,
+		  sizeof(TpTermState *),
+		  compare_term_doc_freq);
 
-	return result_count;
+	candidate = term_current_doc_id(required[0]);
+	while (candidate != UINT32_MAX)
+	{
+		uint32 min_block_end = UINT32_MAX;
+		float4 threshold;
+		float4 upper;
+		float4 doc_score;
+		int	   optional_hits;
+		bool   aligned = true;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (budget_exhausted(&heap->budget))
+			break;
+
+		/* Bring every required list to the candidate */
+		for (i = 0; i < required_count; i++)
+		{
+			TpTermState *ts = required[i];
+
+			if (term_current_doc_id(ts) < candidate)
+			{
+				seek_term_to_doc(ts, candidate);
+				if (stats)
+					stats->seeks_performed++;
+			}
+			if (term_current_doc_id(ts) != candidate)
+			{
+				/* Overshot (or exhausted): its doc is the next candidate */
+				candidate = term_current_doc_id(ts);
+				aligned	  = false;
+				break;
+			}
+		}
+		if (!aligned)
+			continue;
+
+		threshold = bound_threshold(heap);
+		upper	  = optional_ub;
+		for (i = 0; i < required_count; i++)
+		{
+			uint32 block_last;
+
+			upper += term_current_block_bound(required[i], &block_last);
+			min_block_end = Min(min_block_end, block_last);
+		}
+
+		if (upper <= threshold)
+		{
+			/* Nothing up to min_block_end can qualify */
+			if (stats)
+				stats->blocks_skipped++;
+			count_inflated_skip(heap, upper + heap->prior_bound, 1, stats);
+			if (min_block_end == UINT32_MAX)
+				break;
+			candidate = Max(min_block_end, candidate) + 1;
+			continue;
+		}
+
+		if (stats)
+			stats->blocks_scanned++;
+
+		if (!tp_segment_is_alive(reader, candidate))
+		{
+			if (stats)
+				stats->dead_docs_skipped++;
+		}
+		else if (!doc_is_excluded(excluded, excluded_count, candidate, stats))
+		{
+			doc_score = 0.0f;
+			for (i = 0; i < required_count; i++)
+				doc_score += term_posting_score(
+						required[i], k1, b, avg_doc_len);
+
+			optional_hits = 0;
+			for (i = 0; i < optional_count; i++)
+			{
+				TpTermState *ts = optional[i];
+
+				if (term_current_doc_id(ts) < candidate)
+				{
+					seek_term_to_doc(ts, candidate);
+					if (stats)
+						stats->seeks_performed++;
+				}
+				if (term_current_doc_id(ts) == candidate)
+				{
+					doc_score += term_posting_score(ts, k1, b, avg_doc_len);
+					optional_hits++;
+				}
+			}
+			if (doc_score > 0.0f && optional_hits >= min_should_match)
+				doc_score += segment_doc_bonus(heap, reader, candidate);
+
+			if (doc_score > 0.0f && optional_hits >= min_should_match &&
+				!tp_topk_dominated(heap, doc_score) &&
+				segment_doc_admitted(heap, reader, candidate, doc_score, stats) &&
+				(phrase_count == 0 ||
+				 segment_doc_matches_phrases(phrases, phrase_count)))
+				tp_topk_add_segment(
+						heap, reader->root_block, candidate, doc_score);
+
+			if (stats)
+				stats->segment_docs_scored++;
+		}
+
+		if (candidate == UINT32_MAX - 1)
+			break;
+		candidate++;
+	}
+
+	pfree(required);
+	pfree(optional);
+}
+
+/*
+ * Score segment postings for multiple terms, choosing WAND or
+ * Block-Max MaxScore for this segment.
+ */
+static void
+score_segment_multi_term_bmw(
+		TpTopKHeap		*heap,
+		TpSegmentReader *reader,
+		TpTermState	   **terms,
+		int				 term_count,
+		bool			 has_required,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
+		TpPhraseCheck	*phrases,
+		int				 phrase_count,
+		float4			 k1,
+		float4			 b,
+		float4			 avg_doc_len,
+		TpBMWStats		*stats)
+{
+	int	 active_count;
+	int	 optional_active  = 0;
+	bool required_present = true;
+	bool probe_present	  = false;
+	int	 i;
+
+	heap_begin_segment(heap, reader);
+	active_count = init_segment_term_states(
+			heap, terms, term_count, reader, k1, b, avg_doc_len, stats);
+
+	/*
+	 * A required list missing (or empty) here rules out the segment,
+	 * as do too few optional lists for min_should_match.
+	 */
+	for (i = 0; i < term_count; i++)
+	{
+		bool present = term_current_doc_id(terms[i]) != UINT32_MAX;
+
+		if (terms[i]->required && !present)
+			required_present = false;
+		else if (!terms[i]->required && present)
+			optional_active++;
+		if (terms[i]->probe_only && present)
+			probe_present = true;
+	}
+
+	if (active_count > 0 && required_present &&
+		optional_active >= min_should_match)
+	{
+		init_term_cursors(
+				excluded, excluded_count, reader, k1, b, avg_doc_len);
+
+		/* Phrase terms are required, so phrases are always conjunctive */
+		Assert(has_required || phrase_count == 0);
+
+		if (has_required)
+		{
+			score_segment_conjunctive(
+					heap,
+					reader,
+					terms,
+					term_count,
+					min_should_match,
+					excluded,
+					excluded_count,
+					phrases,
+					phrase_count,
+					k1,
+					b,
+					avg_doc_len,
+					stats);
+			if (stats)
+				stats->segments_conjunctive++;
+		}
+		else if (probe_present ||
+				 segment_prefers_maxscore(terms, term_count, active_count))
+		{
+			/* MaxScore keeps probe-only terms out of the essential set */
+			score_segment_maxscore(
+					heap,
+					reader,
+					terms,
+					term_count,
+					min_should_match,
+					excluded,
+					excluded_count,
+					k1,
+					b,
+					avg_doc_len,
+					stats);
+			if (stats)
+				stats->segments_maxscore++;
+		}
+		else
+		{
+			score_segment_wand(
+					heap,
+					reader,
+					terms,
+					term_count,
+					active_count,
+					min_should_match,
+					excluded,
+					excluded_count,
+					k1,
+					b,
+					avg_doc_len,
+					stats);
+			if (stats)
+				stats->segments_wand++;
+		}
+
+		cleanup_segment_term_states(excluded, excluded_count);
+	}
+
+	cleanup_segment_term_states(terms, term_count);
+}
+
+/*
+ * Cursors for the filter's excluded terms, or NULL if it has none.
+ * Excluded cursors are never scored.
+ */
+static TpTermState **
+create_excluded_states(const TpBooleanFilter *filter)
+{
+	TpTermState **excluded = NULL;
+	int			  i;
+
+	if (filter->excluded_count > 0)
+		excluded = palloc(filter->excluded_count * sizeof(TpTermState *));
+	for (i = 0; i < filter->excluded_count; i++)
+	{
+		excluded[i]				= palloc0(sizeof(TpTermState));
+		excluded[i]->term		= filter->excluded[i];
+		excluded[i]->query_freq = 1;
+	}
+	return excluded;
+}
+
+/*
+ * Bind each phrase lexeme of the filter to its (required) query term.
+ * Returns NULL if the filter has no phrases.
+ */
+static TpPhraseCheck *
+bind_phrase_checks(
+		const TpBooleanFilter *filter,
+		TpTermState		   **terms,
+		char			   **query_terms,
+		int					 term_count)
+{
+	TpPhraseCheck *phrases = NULL;
+	int			   i;
+
+	if (filter->phrase_count > 0)
+		phrases = palloc(filter->phrase_count * sizeof(TpPhraseCheck));
+	for (i = 0; i < filter->phrase_count; i++)
+	{
+		const TpPhrase *phrase = filter->phrases[i];
+		int				t;
+
+		phrases[i].phrase	 = phrase;
+		phrases[i].term_idx	 = palloc(phrase->nterms * sizeof(int));
+		phrases[i].states	 = palloc(phrase->nterms * sizeof(TpTermState *));
+		phrases[i].positions = palloc(phrase->nterms * sizeof(uint32 *));
+		phrases[i].counts	 = palloc(phrase->nterms * sizeof(uint32));
+		for (t = 0; t < phrase->nterms; t++)
+		{
+			int j;
+
+			for (j = 0; j < term_count; j++)
+			{
+				if (strcmp(query_terms[j], phrase->lexemes[t]) == 0)
+					break;
+			}
+			if (j == term_count || !terms[j]->required)
+				elog(ERROR,
+					 "phrase term \"%s\" is not a required query term",
+					 phrase->lexemes[t]);
+			phrases[i].term_idx[t] = j;
+			phrases[i].states[t]   = terms[j];
+		}
+	}
+	return phrases;
+}
+
+static void
+free_filter_states(
+		TpTermState  **excluded,
+		int			   excluded_count,
+		TpPhraseCheck *phrases,
+		int			   phrase_count)
+{
+	int i;
+
+	for (i = 0; i < excluded_count; i++)
+		pfree(excluded[i]);
+	if (excluded)
+		pfree(excluded);
+	for (i = 0; i < phrase_count; i++)
+	{
+		pfree(phrases[i].term_idx);
+		pfree(phrases[i].states);
+		pfree(phrases[i].positions);
+		pfree(phrases[i].counts);
+	}
+	if (phrases)
+		pfree(phrases);
+}
+
+/*
+ * Score documents using multi-term Block-Max WAND.
+ */
+int
+tp_score_multi_term_bmw(
+		TpLocalIndexState	*local_state,
+		Relation			 index,
+		TpDataSource		*memtable_src,
+		const BlockNumber	*level_heads,
+		TpParallelScanState *parallel,
+		const TpScoreCursor *cursor,
+		pg_atomic_uint32	*shared_threshold,
+		const TpQueryPrior	*prior,
+		char			   **query_terms,
+		int					 term_count,
+		int32				*query_freqs,
+		float4				*idfs,
+		const TpBooleanFilter *filter,
+		float4				 k1,
+		float4				 b,
+		float4				 avg_doc_len,
+		int					 max_results,
+		ItemPointerData		*result_ctids,
+		float4				*result_scores,
+		TpBMWStats			*stats)
+{
+	TpTopKHeap			heap;
+	TpTermState		  **terms;
+	TpTermState		  **excluded		 = NULL;
+	int					excluded_count	 = 0;
+	TpPhraseCheck	   *phrases			 = NULL;
+	int					phrase_count	 = 0;
+	int					required_count	 = 0;
+	int					min_should_match = 0;
+	const bool		   *required		 = NULL;
+	TpSegmentPlanEntry *plan;
+	int					plan_count;
+	int					result_count;
+	int					i;
+
+	(void)local_state; /* reserved for future use */
+
+	/* Initialize stats */
+	if (stats)
+		memset(stats, 0, sizeof(TpBMWStats));
+
+	/* Initialize top-k heap */
+	tp_topk_init(&heap, max_results, CurrentMemoryContext);
+	heap.shared_threshold = shared_threshold;
+	heap.prior			  = prior;
+	heap.inflation		  = (float4)tp_threshold_inflation;
+	budget_start(&heap.budget);
+	if (cursor != NULL && cursor->active)
+		heap.cursor = cursor;
+
+	/* Initialize term states */
+	terms = palloc(term_count * sizeof(TpTermState *));
+	for (i = 0; i < term_count; i++)
+	{
+		terms[i]			 = palloc(sizeof(TpTermState));
+		terms[i]->term		 = query_terms[i];
+		terms[i]->idf		 = idfs[i];
+		terms[i]->query_freq = query_freqs[i];
+		terms[i]->required	 = false;
+		terms[i]->probe_only = false;
+	}
+
+	if (filter != NULL)
+	{
+		required		 = filter->required;
+		required_count	 = filter->required_count;
+		min_should_match = filter->min_should_match;
+		for (i = 0; required != NULL && i < term_count; i++)
+			terms[i]->required = required[i];
+		for (i = 0; filter->probe_only != NULL && i < term_count; i++)
+			terms[i]->probe_only = filter->probe_only[i];
+
+		excluded_count = filter->excluded_count;
+		excluded	   = create_excluded_states(filter);
+		phrase_count   = filter->phrase_count;
+		phrases = bind_phrase_checks(filter, terms, query_terms, term_count);
+
+		heap.allowed	   = filter->allowed;
+		heap.allowed_count = filter->allowed_count;
+	}
+
+	/* Score memtable (exhaustive - no skip index) */
+	score_memtable_multi_term(
+			&heap,
+			memtable_src,
+			terms,
+			term_count,
+			required_count,
+			min_should_match,
+			filter ? filter->excluded : NULL,
+			excluded_count,
+			phrases,
+			phrase_count,
+			k1,
+			b,
+			avg_doc_len,
+			stats);
+
+	/* Score segments with block-based BMW, highest upper bound first */
+	plan = plan_segments(
+			index,
+			level_heads,
+			(const char *const *)query_terms,
+			query_freqs,
+			required,
+			min_should_match,
+			idfs,
+			term_count,
+			k1,
+			b,
+			avg_doc_len,
+			prior,
+			&plan_count);
+
+	for (i = 0; i < plan_count; i++)
+	{
+		TpSegmentReader *reader;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The most promising segments come first: stop at the budget */
+		if (budget_stops_plan(&heap, plan_count - i, stats))
+			break;
+
+		/*
+		 * In a parallel scan, only score segments we claimed.  Claim
+		 * before pruning so that every segment stays in someone's
+		 * partition for a re-execution with a larger limit.
+		 */
+		if (parallel != NULL &&
+			!tp_parallel_scan_claim_segment(parallel, plan[i].root_block))
+			continue;
+
+		if (plan_entry_pruned(&heap, &plan[i], stats))
+			continue;
+
+		reader = tp_segment_open(index, plan[i].root_block);
+		score_segment_multi_term_bmw(
+				&heap,
+				reader,
+				terms,
+				term_count,
+				required_count > 0,
+				min_should_match,
+				excluded,
+				excluded_count,
+				phrases,
+				phrase_count,
+				k1,
+				b,
+				avg_doc_len,
+				stats);
+		tp_segment_close(reader);
+	}
+
+	if (plan)
+		pfree(plan);
+	if (stats)
+		stats->budget_exhausted = heap.budget.exhausted;
+
+	for (i = 0; i < term_count; i++)
+		pfree(terms[i]);
+	pfree(terms);
+	free_filter_states(excluded, excluded_count, phrases, phrase_count);
+
+	/* Resolve CTIDs for segment results before extraction */
+	tp_topk_resolve_ctids(&heap, index);
+
+	/* Extract sorted results */
+	result_count = tp_topk_extract(&heap, result_ctids, result_scores);
+
+	if (stats)
+		stats->docs_in_results = result_count;
+
+	return result_count;
+}
+
+/*
+ * ------------------------------------------------------------
+ * Boolean Matching (bitmap scans)
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Term statistics play no part in matching; cursors are set up with
+ * these neutral BM25 parameters (all bounds come out as 0).
+ */
+#define TP_MATCH_K1			 1.0f
+#define TP_MATCH_B			 0.0f
+#define TP_MATCH_AVG_DOC_LEN 1.0f
+
+/* Matching CTIDs are handed to a bitmap in batches of this size */
+#define TP_MATCH_BATCH_SIZE 1024
+
+typedef struct TpMatchBuffer
+{
+	TpMatchSink	   *sink;
+	int				count;
+	ItemPointerData tids[TP_MATCH_BATCH_SIZE];
+} TpMatchBuffer;
+
+static void
+match_buffer_flush(TpMatchBuffer *buf)
+{
+	TpMatchSink *sink = buf->sink;
+
+	if (buf->count == 0)
+		return;
+
+	if (sink->tbm != NULL)
+		tbm_add_tuples(sink->tbm, buf->tids, buf->count, false);
+	else
+	{
+		if (sink->ntids + buf->count > sink->capacity)
+		{
+			sink->capacity = Max(sink->capacity * 2,
+								 sink->ntids + buf->count);
+			if (sink->tids != NULL)
+				sink->tids = repalloc_huge(
+						sink->tids, sink->capacity * sizeof(ItemPointerData));
+			else
+				sink->tids = palloc_extended(
+						sink->capacity * sizeof(ItemPointerData),
+						MCXT_ALLOC_HUGE);
+		}
+		memcpy(sink->tids + sink->ntids,
+			   buf->tids,
+			   buf->count * sizeof(ItemPointerData));
+	}
+	sink->ntids += buf->count;
+	buf->count = 0;
+}
+
+static void
+match_buffer_add(TpMatchBuffer *buf, ItemPointer tid)
+{
+	if (!ItemPointerIsValid(tid))
+		return;
+
+	buf->tids[buf->count++] = *tid;
+	if (buf->count == TP_MATCH_BATCH_SIZE)
+		match_buffer_flush(buf);
+}
+
+/*
+ * Add the memtable docs matching the query to the sink: the docs
+ * score_memtable_multi_term would consider, without scoring them.
+ */
+static void
+match_memtable(
+		TpMatchBuffer *buf,
+		TpDataSource  *source,
+		TpTermState	 **terms,
+		int			   term_count,
+		int			   required_count,
+		int			   min_should_match,
+		char		 **excluded,
+		int			   excluded_count,
+		TpPhraseCheck *phrases,
+		int			   phrase_count)
+{
+	HTAB				*doc_hits;
+	HTAB				*excluded_ctids;
+	HASHCTL				 hash_ctl;
+	HASH_SEQ_STATUS		 seq;
+	DocumentScoreEntry *entry;
+	TpPostingData	   **phrase_postings = NULL;
+	HTAB			   **phrase_refs	 = NULL;
+	int					 term_idx;
+
+	if (!source)
+		return;
+
+	excluded_ctids = collect_memtable_excluded(
+			source, excluded, excluded_count);
+
+	if (phrase_count > 0)
+	{
+		phrase_postings = palloc0(term_count * sizeof(TpPostingData *));
+		phrase_refs		= create_memtable_phrase_refs(
+				phrases, phrase_count, term_count);
+	}
+
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize   = sizeof(ItemPointerData);
+	hash_ctl.entrysize = sizeof(DocumentScoreEntry);
+	hash_ctl.hcxt	   = CurrentMemoryContext;
+	doc_hits		   = hash_create(
+			"Memtable Doc Matches",
+			1024,
+			&hash_ctl,
+			HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (term_idx = 0; term_idx < term_count; term_idx++)
+	{
+		TpTermState	  *ts = terms[term_idx];
+		TpPostingData *postings;
+		int			   i;
+
+		postings = tp_source_get_postings(source, ts->term);
+		if (!postings || postings->count == 0)
+		{
+			if (postings)
+				tp_source_free_postings(source, postings);
+			continue;
+		}
+
+		for (i = 0; i < postings->count; i++)
+		{
+			ItemPointerData *ctid = &postings->ctids[i];
+			bool			 found;
+
+			if ((i & 0xFFF) == 0)
+				CHECK_FOR_INTERRUPTS();
+
+			if (excluded_ctids != NULL &&
+				hash_search(excluded_ctids, ctid, HASH_FIND, NULL) != NULL)
+				continue;
+
+			entry = (DocumentScoreEntry *)
+					hash_search(doc_hits, ctid, HASH_ENTER, &found);
+			if (!found)
+			{
+				entry->ctid			 = *ctid;
+				entry->score		 = 0.0f;
+				entry->doc_length	 = 0.0f;
+				entry->required_hits = 0;
+				entry->optional_hits = 0;
+			}
+			if (ts->required)
+				entry->required_hits++;
+			else
+				entry->optional_hits++;
+		}
+
+		if (phrase_refs != NULL && phrase_refs[term_idx] != NULL)
+		{
+			add_memtable_phrase_refs(phrase_refs[term_idx], postings);
+			phrase_postings[term_idx] = postings;
+		}
+		else
+			tp_source_free_postings(source, postings);
+	}
+
+	hash_seq_init(&seq, doc_hits);
+	while ((entry = hash_seq_search(&seq)) != NULL)
+	{
+		if (entry->required_hits < required_count ||
+			entry->optional_hits < min_should_match)
+			continue;
+
+		if (phrase_count == 0 ||
+			memtable_doc_matches_phrases(
+					phrases,
+					phrase_count,
+					phrase_postings,
+					phrase_refs,
+					&entry->ctid))
+			match_buffer_add(buf, &entry->ctid);
+	}
+
+	hash_destroy(doc_hits);
+	if (excluded_ctids != NULL)
+		hash_destroy(excluded_ctids);
+	if (phrase_refs != NULL)
+		free_memtable_phrase_refs(
+				source, phrase_refs, phrase_postings, term_count);
+}
+
+/*
+ * A segment doc passed the term checks: add it unless it is dead or
+ * contains an excluded term
+ */
+static void
+match_segment_doc(
+		TpMatchBuffer	*buf,
+		TpSegmentReader *reader,
+		uint32			 doc_id,
+		TpTermState	   **excluded,
+		int				 excluded_count)
+{
+	ItemPointerData ctid;
+
+	if (!tp_segment_is_alive(reader, doc_id) ||
+		doc_is_excluded(excluded, excluded_count, doc_id, NULL))
+		return;
+
+	tp_segment_lookup_ctid(reader, doc_id, &ctid);
+	match_buffer_add(buf, &ctid);
+}
+
+/*
+ * Intersect the required lists in doc ID order, the rarest driving.
+ * Optional lists are probed only to count hits for min_should_match.
+ */
+static void
+match_segment_conjunctive(
+		TpMatchBuffer	*buf,
+		TpSegmentReader *reader,
+		TpTermState	   **required,
+		int				 required_count,
+		TpTermState	   **optional,
+		int				 optional_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
+		TpPhraseCheck	*phrases,
+		int				 phrase_count)
+{
+	uint32 candidate;
+	int	   i;
+
+	qsort(required,
+		  required_count,
+		  sizeof(TpTermState *),
+		  compare_term_doc_freq);
+
+	candidate = term_current_doc_id(required[0]);
+	while (candidate != UINT32_MAX)
+	{
+		int	 optional_hits = 0;
+		bool aligned	   = true;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < required_count; i++)
+		{
+			TpTermState *ts = required[i];
+
+			if (term_current_doc_id(ts) < candidate)
+				seek_term_to_doc(ts, candidate);
+			if (term_current_doc_id(ts) != candidate)
+			{
+				/* Overshot (or exhausted): its doc is the next candidate */
+				candidate = term_current_doc_id(ts);
+				aligned	  = false;
+				break;
+			}
+		}
+		if (!aligned)
+			continue;
+
+		for (i = 0; i < optional_count && min_should_match > 0; i++)
+		{
+			TpTermState *ts = optional[i];
+
+			if (term_current_doc_id(ts) < candidate)
+				seek_term_to_doc(ts, candidate);
+			if (term_current_doc_id(ts) == candidate)
+				optional_hits++;
+		}
+
+		if (optional_hits >= min_should_match &&
+			(phrase_count == 0 ||
+			 segment_doc_matches_phrases(phrases, phrase_count)))
+			match_segment_doc(
+					buf, reader, candidate, excluded, excluded_count);
+
+		if (candidate == UINT32_MAX - 1)
+			break;
+		candidate++;
+	}
+}
+
+/*
+ * Union the optional lists in doc ID order; a doc matches once it is
+ * on min_should_match of them (at least one).
+ */
+static void
+match_segment_disjunctive(
+		TpMatchBuffer	*buf,
+		TpSegmentReader *reader,
+		TpTermState	   **optional,
+		int				 optional_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count)
+{
+	int needed = Max(min_should_match, 1);
+
+	for (;;)
+	{
+		uint32 candidate = UINT32_MAX;
+		int	   hits		 = 0;
+		int	   i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < optional_count; i++)
+			candidate = Min(candidate, term_current_doc_id(optional[i]));
+		if (candidate == UINT32_MAX)
+			break;
+
+		for (i = 0; i < optional_count; i++)
+		{
+			if (term_current_doc_id(optional[i]) == candidate)
+			{
+				hits++;
+				advance_term_iterator(optional[i]);
+			}
+		}
+
+		if (hits >= needed)
+			match_segment_doc(
+					buf, reader, candidate, excluded, excluded_count);
+	}
+}
+
+/*
+ * Add the docs of one segment matching the query to the sink
+ */
+static void
+match_segment(
+		TpMatchBuffer	*buf,
+		TpSegmentReader *reader,
+		TpTermState	   **terms,
+		int				 term_count,
+		int				 min_should_match,
+		TpTermState	   **excluded,
+		int				 excluded_count,
+		TpPhraseCheck	*phrases,
+		int				 phrase_count)
+{
+	TpTermState **required;
+	TpTermState **optional;
+	int			  required_count   = 0;
+	int			  optional_count   = 0;
+	bool		  required_missing = false;
+	int			  i;
+
+	init_term_cursors(
+			terms,
+			term_count,
+			reader,
+			TP_MATCH_K1,
+			TP_MATCH_B,
+			TP_MATCH_AVG_DOC_LEN);
+
+	required = palloc(term_count * sizeof(TpTermState *));
+	optional = palloc(term_count * sizeof(TpTermState *));
+	for (i = 0; i < term_count; i++)
+	{
+		TpTermState *ts		 = terms[i];
+		bool		 present = term_current_doc_id(ts) != UINT32_MAX;
+
+		if (ts->required)
+		{
+			required[required_count++] = ts;
+			if (!present)
+				required_missing = true;
+		}
+		else if (present)
+			optional[optional_count++] = ts;
+	}
+
+	if (!required_missing && optional_count >= min_should_match &&
+		required_count + optional_count > 0)
+	{
+		init_term_cursors(
+				excluded,
+				excluded_count,
+				reader,
+				TP_MATCH_K1,
+				TP_MATCH_B,
+				TP_MATCH_AVG_DOC_LEN);
+
+		if (required_count > 0)
+			match_segment_conjunctive(
+					buf,
+					reader,
+					required,
+					required_count,
+					optional,
+					optional_count,
+					min_should_match,
+					excluded,
+					excluded_count,
+					phrases,
+					phrase_count);
+		else
+			match_segment_disjunctive(
+					buf,
+					reader,
+					optional,
+					optional_count,
+					min_should_match,
+					excluded,
+					excluded_count);
+
+		cleanup_segment_term_states(excluded, excluded_count);
+	}
+
+	pfree(required);
+	pfree(optional);
+	cleanup_segment_term_states(terms, term_count);
+}
+
+/*
+ * Add every document matching the query to a match sink.
+ */
+int64
+tp_match_multi_term(
+		Relation			   index,
+		TpDataSource		  *memtable_src,
+		const BlockNumber	  *level_heads,
+		char				 **query_terms,
+		int					   term_count,
+		const TpBooleanFilter *filter,
+		TpMatchSink			  *sink)
+{
+	TpMatchBuffer	   *buf;
+	TpTermState		  **terms;
+	TpTermState		  **excluded		 = NULL;
+	int					excluded_count	 = 0;
+	TpPhraseCheck	   *phrases			 = NULL;
+	int					phrase_count	 = 0;
+	int					required_count	 = 0;
+	int					min_should_match = 0;
+	const bool		   *required		 = NULL;
+	float4			   *idfs;
+	TpSegmentPlanEntry *plan;
+	int					plan_count;
+	int					start_ntids;
+	int					i;
+
+	buf			= palloc(sizeof(TpMatchBuffer));
+	buf->sink	= sink;
+	buf->count	= 0;
+	start_ntids = sink->ntids;
+
+	terms = palloc(term_count * sizeof(TpTermState *));
+	for (i = 0; i < term_count; i++)
+	{
+		terms[i]			 = palloc0(sizeof(TpTermState));
+		terms[i]->term		 = query_terms[i];
+		terms[i]->query_freq = 1;
+	}
+
+	if (filter != NULL)
+	{
+		required		 = filter->required;
+		required_count	 = filter->required_count;
+		min_should_match = filter->min_should_match;
+		for (i = 0; required != NULL && i < term_count; i++)
+			terms[i]->required = required[i];
+
+		excluded_count = filter->excluded_count;
+		excluded	   = create_excluded_states(filter);
+		phrase_count   = filter->phrase_count;
+		phrases = bind_phrase_checks(filter, terms, query_terms, term_count);
+	}
+
+	match_memtable(
+			buf,
+			memtable_src,
+			terms,
+			term_count,
+			required_count,
+			min_should_match,
+			filter ? filter->excluded : NULL,
+			excluded_count,
+			phrases,
+			phrase_count);
+
+	/* The plan leaves out segments that cannot match; bounds are unused */
+	idfs = palloc0(term_count * sizeof(float4));
+	plan = plan_segments(
+			index,
+			level_heads,
+			(const char *const *)query_terms,
+			NULL,
+			required,
+			min_should_match,
+			idfs,
+			term_count,
+			TP_MATCH_K1,
+			TP_MATCH_B,
+			TP_MATCH_AVG_DOC_LEN,
+			NULL,
+			&plan_count);
+
+	for (i = 0; i < plan_count; i++)
+	{
+		TpSegmentReader *reader;
+
+		CHECK_FOR_INTERRUPTS();
+
+		reader = tp_segment_open(index, plan[i].root_block);
+		match_segment(
+				buf,
+				reader,
+				terms,
+				term_count,
+				min_should_match,
+				excluded,
+				excluded_count,
+				phrases,
+				phrase_count);
+		tp_segment_close(reader);
+	}
+
+	if (plan)
+		pfree(plan);
+	pfree(idfs);
+
+	for (i = 0; i < term_count; i++)
+		pfree(terms[i]);
+	pfree(terms);
+	free_filter_states(excluded, excluded_count, phrases, phrase_count);
+
+	match_buffer_flush(buf);
+	pfree(buf);
+	return sink->ntids - start_ntids;
 }
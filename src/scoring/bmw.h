@@ -11,12 +11,30 @@
 
 #include <postgres.h>
 
+#include <datatype/timestamp.h>
 #include <storage/itemptr.h>
 #include <utils/memutils.h>
 
 #include "index/source.h"
 #include "index/state.h"
+#include "scoring/bm25.h"
+#include "scoring/parallel.h"
 #include "segment/segment.h"
+#include "types/query.h"
+
+/*
+ * Work budget of one ranking (see pg_textsearch.scoring_time_budget and
+ * pg_textsearch.scoring_block_budget).  Once it is spent, scoring stops
+ * between blocks or segments and the heap's contents are returned as a
+ * partial top-k.
+ */
+typedef struct TpScoreBudget
+{
+	TimestampTz deadline;	 /* 0 if the time is unlimited */
+	uint64		block_limit; /* tp_segment_blocks_loaded to stop at, or 0 */
+	int			countdown;	 /* Checks left until the clock is read */
+	bool		exhausted;
+} TpScoreBudget;
 
 /*
  * Top-K min-heap for maintaining threshold during scoring.
@@ -38,8 +56,70 @@ typedef struct TpTopKHeap
 	float4 *scores;				 /* Parallel array of scores */
 	int		capacity;			 /* k - maximum results */
 	int		size;				 /* Current entries (0 to k) */
+
+	/*
+	 * Cross-participant threshold for parallel scans (NULL otherwise).
+	 * Raised whenever our own threshold improves; pruning uses the
+	 * larger of the two.
+	 */
+	pg_atomic_uint32 *shared_threshold;
+
+	/*
+	 * Sorted CTIDs a document must have to enter the heap, or NULL to
+	 * admit any (see TpBooleanFilter.allowed).
+	 */
+	const ItemPointerData *allowed;
+	int					   allowed_count;
+
+	/*
+	 * Resume point of a batched or search-after scan once it is
+	 * active, else NULL: documents ranking before it cannot enter.
+	 */
+	const TpScoreCursor *cursor;
+
+	/*
+	 * Static prior weighting of the query, or NULL (see prior.h), and
+	 * the largest prior bonus of the segment being scored: BM25 bounds
+	 * in that segment are compared to the threshold less this.
+	 */
+	const TpQueryPrior *prior;
+	float4			   prior_bound;
+
+	/*
+	 * Factor the threshold is inflated by for pruning (see
+	 * pg_textsearch.threshold_inflation); 1 keeps the top-k exact.
+	 */
+	float4 inflation;
+
+	/* Work allowed for filling the heap; unlimited by default */
+	TpScoreBudget budget;
 } TpTopKHeap;
 
+#define TP_DEFAULT_THRESHOLD_INFLATION 1.0
+#define TP_MAX_THRESHOLD_INFLATION	   10.0
+
+/* GUC: approximate top-k pruning factor - defined in mod.c */
+extern double tp_threshold_inflation;
+
+/* GUCs: scoring work budgets (0 = unlimited) - defined in mod.c */
+extern int tp_scoring_time_budget;	/* milliseconds */
+extern int tp_scoring_block_budget; /* posting blocks loaded */
+
+/*
+ * Multi-term evaluator for disjunctive segments.  AUTO picks per
+ * segment; the others force one for testing and benchmarking, except
+ * that probe-only terms always need MaxScore.
+ */
+typedef enum TpMultiTermEvaluator
+{
+	TP_EVALUATOR_AUTO,
+	TP_EVALUATOR_WAND,
+	TP_EVALUATOR_MAXSCORE
+} TpMultiTermEvaluator;
+
+/* GUC: pg_textsearch.multi_term_evaluator - defined in mod.c */
+extern int tp_multi_term_evaluator;
+
 /*
  * Initialize a top-k heap.
  * Allocates arrays in the given memory context.
@@ -53,23 +133,50 @@ extern void tp_topk_free(TpTopKHeap *heap);
 
 /*
  * Get current threshold (minimum score to enter top-k).
- * Returns 0 if heap not yet full.
+ * Returns 0 if heap not yet full and no shared threshold is set.
  */
 static inline float4
 tp_topk_threshold(TpTopKHeap *heap)
 {
-	return (heap->size >= heap->capacity) ? heap->scores[0] : 0.0f;
+	float4 threshold = (heap->size >= heap->capacity) ? heap->scores[0]
+													  : 0.0f;
+
+	if (heap->shared_threshold != NULL)
+	{
+		float4 shared = tp_shared_threshold_get(heap->shared_threshold);
+
+		if (shared > threshold)
+			threshold = shared;
+	}
+	return threshold;
+}
+
+/*
+ * Threshold bounds and scores are pruned against: the top-k threshold
+ * times the heap's inflation.  Above 1 this skips blocks and documents
+ * that might still have entered the top-k, trading recall for speed.
+ */
+static inline float4
+tp_topk_prune_threshold(TpTopKHeap *heap)
+{
+	return tp_topk_threshold(heap) * heap->inflation;
 }
 
 /*
  * Check if a score is definitely dominated (cannot enter top-k).
  * Quick check to avoid heap operations for non-competitive docs.
  * Returns false for equal scores since they may qualify via CTID tie-breaking.
+ * An inflated threshold also rejects scores just above it.
  */
 static inline bool
 tp_topk_dominated(TpTopKHeap *heap, float4 score)
 {
-	return heap->size >= heap->capacity && score < heap->scores[0];
+	if (heap->size >= heap->capacity &&
+		score < heap->scores[0] * heap->inflation)
+		return true;
+	return heap->shared_threshold != NULL &&
+		   score < tp_shared_threshold_get(heap->shared_threshold) *
+						   heap->inflation;
 }
 
 /*
@@ -115,6 +222,42 @@ typedef struct TpBMWStats
 
 	uint64 seeks_performed;	  /* Binary search seeks executed */
 	uint64 dead_docs_skipped; /* Dead docs filtered by alive bitset */
+
+	/* Multi-term evaluator chosen per segment */
+	uint64 segments_wand;		 /* Segments scored with WAND */
+	uint64 segments_maxscore;	 /* Segments scored with Block-Max MaxScore */
+	uint64 segments_conjunctive; /* Segments intersected on required terms */
+
+	/* Segments skipped whole because their upper bound was too low */
+	uint64 segments_pruned;
+
+	/* Candidates rejected by an excluded ("-word") term */
+	uint64 docs_excluded;
+
+	/* Competitive candidates outside the allowed CTID set */
+	uint64 docs_filtered;
+
+	/* Competitive candidates an earlier batch already returned */
+	uint64 docs_returned_earlier;
+
+	/* Block postings scored below the threshold in bulk */
+	uint64 postings_pruned;
+
+	/*
+	 * Of blocks_skipped, those an exact threshold would have scanned:
+	 * skipped only because pg_textsearch.threshold_inflation is above 1
+	 */
+	uint64 blocks_skipped_approx;
+
+	/* Segments left unscored once the scoring budget ran out */
+	uint64 segments_unvisited;
+
+	/* The budget ran out: the results are a partial top-k */
+	bool budget_exhausted;
+
+	/* Query terms removed or made probe-only by low-IDF term pruning */
+	uint64 terms_dropped;
+	uint64 terms_probe_only;
 } TpBMWStats;
 
 /*
@@ -129,49 +272,109 @@ typedef struct TpBMWStats
  * returns.  Threading the source in (instead of re-creating it
  * here) avoids a second full chain walk on every query.
  *
+ * `level_heads` is the segment set the caller computed corpus stats
+ * from.  Segments are scored in descending order of their query upper
+ * bound (from the V6 term bounds), and once that bound drops below the
+ * top-k threshold the remaining segments are skipped.  `parallel` is
+ * NULL for a serial scan; otherwise only the segments this participant
+ * claims are scored.  `cursor` (may be NULL) restricts the results to
+ * documents ranking after its position (see TpScoreCursor).
+ * `shared_threshold` (may be NULL) is a top-k threshold shared with
+ * other scans of the query: documents scoring below it are pruned,
+ * and the heap's own threshold is published into it once full.
+ * `prior` (may be NULL) adds a static prior bonus to every score; each
+ * block's bound then includes the bonus of its largest prior.
+ *
  * Returns number of results (up to max_results).
  */
 extern int tp_score_single_term_bmw(
-		TpLocalIndexState *local_state,
-		Relation		   index,
-		TpDataSource	  *memtable_src,
-		const char		  *term,
-		float4			   idf,
-		float4			   k1,
-		float4			   b,
-		float4			   avg_doc_len,
-		int				   max_results,
-		ItemPointerData	  *result_ctids,
-		float4			  *result_scores,
-		TpBMWStats		  *stats);
+		TpLocalIndexState	*local_state,
+		Relation			 index,
+		TpDataSource		*memtable_src,
+		const BlockNumber	*level_heads,
+		TpParallelScanState *parallel,
+		const TpScoreCursor *cursor,
+		pg_atomic_uint32	*shared_threshold,
+		const TpQueryPrior	*prior,
+		const char			*term,
+		float4				 idf,
+		float4				 k1,
+		float4				 b,
+		float4				 avg_doc_len,
+		int					 max_results,
+		ItemPointerData		*result_ctids,
+		float4				*result_scores,
+		TpBMWStats			*stats);
 
 /*
  * Score documents using multi-term Block-Max WAND.
  *
- * For multi-term queries, uses the WAND algorithm with block-level
- * upper bounds to find top-k documents efficiently.
+ * For multi-term queries, uses block-level upper bounds to find top-k
+ * documents efficiently.  Each segment is evaluated with either WAND
+ * or Block-Max MaxScore, chosen from the number of query terms present
+ * in the segment and their doc_freq spread.
+ *
+ * `filter` (may be NULL) adds +required / -excluded terms and
+ * min_should_match.  Segments lacking a required term, or holding
+ * fewer optional terms than min_should_match, are never opened;
+ * within a segment the required lists are intersected
+ * document-at-a-time, excluded lists reject candidates before they
+ * are scored, and WAND only accepts a pivot once min_should_match
+ * cursors reach it.
  *
  * `memtable_src` is the already-built chain source over the on-disk
  * memtable chain (may be NULL when the chain is empty).  The caller
- * retains ownership.
+ * retains ownership.  `level_heads`, `parallel`, `cursor`,
+ * `shared_threshold` and `prior` are as for tp_score_single_term_bmw,
+ * except that segments are bounded by the bonus of their largest
+ * prior rather than block by block.
  *
  * Returns number of results (up to max_results).
  */
 extern int tp_score_multi_term_bmw(
-		TpLocalIndexState *local_state,
-		Relation		   index,
-		TpDataSource	  *memtable_src,
-		char			 **terms,
-		int				   term_count,
-		int32			  *query_freqs,
-		float4			  *idfs,
-		float4			   k1,
-		float4			   b,
-		float4			   avg_doc_len,
-		int				   max_results,
-		ItemPointerData	  *result_ctids,
-		float4			  *result_scores,
-		TpBMWStats		  *stats);
+		TpLocalIndexState	*local_state,
+		Relation			 index,
+		TpDataSource		*memtable_src,
+		const BlockNumber	*level_heads,
+		TpParallelScanState *parallel,
+		const TpScoreCursor *cursor,
+		pg_atomic_uint32	*shared_threshold,
+		const TpQueryPrior	*prior,
+		char			   **terms,
+		int					 term_count,
+		int32				*query_freqs,
+		float4				*idfs,
+		const TpBooleanFilter *filter,
+		float4				 k1,
+		float4				 b,
+		float4				 avg_doc_len,
+		int					 max_results,
+		ItemPointerData		*result_ctids,
+		float4				*result_scores,
+		TpBMWStats			*stats);
+
+/*
+ * Add every document matching the query to `sink`.
+ *
+ * A document matches if it would be a candidate of
+ * tp_score_multi_term_bmw: it contains every required term (or, with
+ * none, at least one query term), min_should_match of the optional
+ * terms, no excluded term, and every phrase.  Nothing is scored.
+ * Within a segment the required lists are intersected and the
+ * optional lists unioned in doc ID order; CTIDs are looked up only
+ * for matches.
+ *
+ * `memtable_src` and `level_heads` are as for tp_score_multi_term_bmw.
+ * Returns the number of CTIDs added.
+ */
+extern int64 tp_match_multi_term(
+		Relation			   index,
+		TpDataSource		  *memtable_src,
+		const BlockNumber	  *level_heads,
+		char				 **terms,
+		int					   term_count,
+		const TpBooleanFilter *filter,
+		TpMatchSink			  *sink);
 
 /*
  * Compute block maximum BM25 score from skip entry metadata.
@@ -185,3 +388,14 @@ extern float4 tp_compute_block_max_score(
 		float4		 k1,
 		float4		 b,
 		float4		 avg_doc_len);
+
+/*
+ * Compute a term's segment-wide maximum BM25 score from its V6 term
+ * bounds (max tf and min fieldnorm over all of its blocks).
+ */
+extern float4 tp_compute_term_max_score(
+		const TpTermBounds *bounds,
+		float4				idf,
+		float4				k1,
+		float4				b,
+		float4				avg_doc_len);
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * doc_freq_cache.c - Cross-backend cache of segment document frequencies
+ *
+ * See doc_freq_cache.h for the keying and invalidation rules.
+ */
+#include <postgres.h>
+
+#include <access/htup_details.h>
+#include <common/hashfn.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <lib/dshash.h>
+#include <miscadmin.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/memutils.h>
+
+#include "index/metapage.h"
+#include "index/registry.h"
+#include "memtable/cache.h"
+#include "scoring/doc_freq_cache.h"
+
+/* GUC variables (registered in mod.c) */
+bool tp_doc_freq_cache_enabled = true;
+int	 tp_doc_freq_cache_size_kb = TP_DEFAULT_DOC_FREQ_CACHE_SIZE_KB;
+
+/*
+ * Hash key.  Field order avoids padding so dshash_memcmp/memhash see
+ * only meaningful bytes.
+ */
+typedef struct TpDocFreqCacheKey
+{
+	Oid	   index_oid;
+	uint32 term_len;
+	uint64 term_hash; /* hash_bytes_extended of the term */
+} TpDocFreqCacheKey;
+
+/*
+ * Cache entry stored in the dshash.  last_used is atomic so hits can
+ * refresh it under the shared partition lock.
+ */
+typedef struct TpDocFreqCacheEntry
+{
+	TpDocFreqCacheKey	key; /* Hash key - must be first */
+	TpDocFreqGeneration generation;
+	pg_atomic_uint64	last_used; /* Control clock at last hit/store */
+	dsa_pointer			term;	   /* term_len bytes */
+	uint64				charged_bytes;
+	uint32				doc_freq; /* Summed over every segment */
+} TpDocFreqCacheEntry;
+
+/*
+ * Fixed shared-memory control block
+ */
+typedef struct TpDocFreqCacheControl
+{
+	LWLock				lock; /* Table creation; serializes eviction */
+	dshash_table_handle table_handle;
+	pg_atomic_uint64	clock;	 /* LRU clock */
+	pg_atomic_uint64	bytes;	 /* Σ charged_bytes */
+	pg_atomic_uint64	entries; /* Live entries */
+	pg_atomic_uint64	hits;	 /* Per term */
+	pg_atomic_uint64	misses;	 /* Per term */
+} TpDocFreqCacheControl;
+
+static TpDocFreqCacheControl *doc_freq_cache_ctl = NULL;
+
+/* Backend-local attachment to the shared table */
+static dshash_table *doc_freq_cache_table = NULL;
+
+static void
+get_doc_freq_cache_params(dshash_parameters *params)
+{
+	params->key_size		 = sizeof(TpDocFreqCacheKey);
+	params->entry_size		 = sizeof(TpDocFreqCacheEntry);
+	params->compare_function = dshash_memcmp;
+	params->hash_function	 = dshash_memhash;
+	params->copy_function	 = dshash_memcpy;
+	params->tranche_id		 = TP_TRANCHE_DOC_FREQ_CACHE;
+}
+
+void
+tp_doc_freq_cache_shmem_request(void)
+{
+	RequestAddinShmemSpace(sizeof(TpDocFreqCacheControl));
+}
+
+void
+tp_doc_freq_cache_shmem_startup(void)
+{
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	doc_freq_cache_ctl = ShmemInitStruct(
+			"Tapir Doc Freq Cache", sizeof(TpDocFreqCacheControl), &found);
+
+	if (!found)
+	{
+		LWLockInitialize(
+				&doc_freq_cache_ctl->lock, TP_TRANCHE_DOC_FREQ_CACHE_LOCK);
+		doc_freq_cache_ctl->table_handle = DSHASH_HANDLE_INVALID;
+		pg_atomic_init_u64(&doc_freq_cache_ctl->clock, 0);
+		pg_atomic_init_u64(&doc_freq_cache_ctl->bytes, 0);
+		pg_atomic_init_u64(&doc_freq_cache_ctl->entries, 0);
+		pg_atomic_init_u64(&doc_freq_cache_ctl->hits, 0);
+		pg_atomic_init_u64(&doc_freq_cache_ctl->misses, 0);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	LWLockRegisterTranche(
+			TP_TRANCHE_DOC_FREQ_CACHE_LOCK, "tapir_doc_freq_cache");
+	LWLockRegisterTranche(
+			TP_TRANCHE_DOC_FREQ_CACHE, "tapir_doc_freq_cache_hash");
+}
+
+/*
+ * Attach to the shared table, creating it if `create` is set.
+ * Returns NULL if it does not exist yet and `create` is false.
+ */
+static dshash_table *
+doc_freq_cache_attach(bool create)
+{
+	dsa_area		 *dsa;
+	dshash_parameters params;
+	MemoryContext	  oldcontext;
+
+	if (doc_freq_cache_table != NULL)
+		return doc_freq_cache_table;
+
+	if (doc_freq_cache_ctl == NULL)
+		return NULL;
+
+	if (!create && doc_freq_cache_ctl->table_handle == DSHASH_HANDLE_INVALID)
+		return NULL;
+
+	dsa = tp_registry_get_dsa();
+	get_doc_freq_cache_params(&params);
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	LWLockAcquire(&doc_freq_cache_ctl->lock, LW_EXCLUSIVE);
+
+	if (doc_freq_cache_ctl->table_handle == DSHASH_HANDLE_INVALID)
+	{
+		if (create)
+		{
+			doc_freq_cache_table = dshash_create(dsa, &params, NULL);
+			doc_freq_cache_ctl->table_handle = dshash_get_hash_table_handle(
+					doc_freq_cache_table);
+		}
+	}
+	else
+		doc_freq_cache_table = dshash_attach(
+				dsa, &params, doc_freq_cache_ctl->table_handle, NULL);
+
+	LWLockRelease(&doc_freq_cache_ctl->lock);
+	MemoryContextSwitchTo(oldcontext);
+
+	return doc_freq_cache_table;
+}
+
+/* ---------- memory accounting ---------- */
+
+static uint64
+doc_freq_cache_cap_bytes(void)
+{
+	return (uint64)tp_doc_freq_cache_size_kb * 1024UL;
+}
+
+/*
+ * Charge entry bytes to our own counter and to the registry-wide
+ * counter that pg_textsearch.memory_limit is enforced against.
+ */
+static void
+account_add(uint64 bytes)
+{
+	pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->bytes, bytes);
+	pg_atomic_fetch_add_u64(tp_registry_estimated_total_bytes(), bytes);
+}
+
+/* Symmetric with account_add; clamps like tp_cache_account_bytes_drain */
+static void
+account_sub(uint64 bytes)
+{
+	pg_atomic_uint64 *gp = tp_registry_estimated_total_bytes();
+	uint64			  cur;
+
+	cur = pg_atomic_read_u64(&doc_freq_cache_ctl->bytes);
+	pg_atomic_fetch_sub_u64(&doc_freq_cache_ctl->bytes, Min(bytes, cur));
+
+	cur = pg_atomic_read_u64(gp);
+	if (Min(bytes, cur) > 0)
+		pg_atomic_fetch_sub_u64(gp, Min(bytes, cur));
+}
+
+/*
+ * Would charging `bytes` more exceed our own cap or the global
+ * memory_limit?
+ */
+static bool
+over_budget(uint64 bytes)
+{
+	uint64 hard = tp_cache_global_hard_cap_bytes();
+
+	if (pg_atomic_read_u64(&doc_freq_cache_ctl->bytes) + bytes >
+		doc_freq_cache_cap_bytes())
+		return true;
+	return hard > 0 &&
+		   pg_atomic_read_u64(tp_registry_estimated_total_bytes()) + bytes >
+				   hard;
+}
+
+/*
+ * Free an entry's term bytes and release its accounting.  The caller
+ * removes or reuses the dshash entry itself.
+ */
+static void
+release_entry(TpDocFreqCacheEntry *entry)
+{
+	dsa_free(tp_registry_get_dsa(), entry->term);
+	account_sub(entry->charged_bytes);
+	pg_atomic_fetch_sub_u64(&doc_freq_cache_ctl->entries, 1);
+}
+
+/*
+ * Evict the older half (by LRU clock) of the entries since the oldest
+ * one.  Entries are small and stored a query's worth at a time, so
+ * evicting them one scan per entry like the result cache would be
+ * quadratic.  Returns false once the table is empty.  Caller holds
+ * the control lock.
+ */
+static bool
+evict_old_entries(dshash_table *table)
+{
+	dshash_seq_status	 status;
+	TpDocFreqCacheEntry *entry;
+	uint64				 oldest = PG_UINT64_MAX;
+	uint64				 cutoff;
+
+	dshash_seq_init(&status, table, false);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+		oldest = Min(oldest, pg_atomic_read_u64(&entry->last_used));
+	dshash_seq_term(&status);
+
+	if (oldest == PG_UINT64_MAX)
+		return false;
+
+	cutoff = oldest +
+			 (pg_atomic_read_u64(&doc_freq_cache_ctl->clock) - oldest) / 2;
+
+	dshash_seq_init(&status, table, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (pg_atomic_read_u64(&entry->last_used) > cutoff)
+			continue;
+		release_entry(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+	return true;
+}
+
+/* ---------- keys ---------- */
+
+static void
+make_key(TpDocFreqCacheKey *key, Oid index_oid, const char *term)
+{
+	memset(key, 0, sizeof(TpDocFreqCacheKey));
+	key->index_oid = index_oid;
+	key->term_len  = (uint32)strlen(term);
+	key->term_hash = hash_bytes_extended(
+			(const unsigned char *)term, (int)key->term_len, 0);
+}
+
+static bool
+generations_equal(const TpDocFreqGeneration *a, const TpDocFreqGeneration *b)
+{
+	int level;
+
+	if (a->relfilenumber != b->relfilenumber ||
+		a->total_docs != b->total_docs || a->total_len != b->total_len)
+		return false;
+	for (level = 0; level < TP_MAX_LEVELS; level++)
+	{
+		if (a->level_heads[level] != b->level_heads[level] ||
+			a->level_counts[level] != b->level_counts[level])
+			return false;
+	}
+	return true;
+}
+
+/* ---------- public API ---------- */
+
+bool
+tp_doc_freq_cache_get_generation(
+		Relation			 index,
+		const BlockNumber	*level_heads,
+		TpDocFreqGeneration *generation)
+{
+	TpIndexMetaPage metap;
+	bool			any_segment = false;
+	int				level;
+
+	if (!tp_doc_freq_cache_enabled || tp_doc_freq_cache_size_kb <= 0 ||
+		doc_freq_cache_ctl == NULL)
+		return false;
+
+	for (level = 0; level < TP_MAX_LEVELS; level++)
+		any_segment |= level_heads[level] != InvalidBlockNumber;
+	if (!any_segment)
+		return false;
+
+	memset(generation, 0, sizeof(TpDocFreqGeneration));
+	generation->relfilenumber = index->rd_locator.relNumber;
+
+	metap = tp_get_metapage(index);
+	for (level = 0; level < TP_MAX_LEVELS; level++)
+	{
+		generation->level_heads[level]	= metap->level_heads[level];
+		generation->level_counts[level] = metap->level_counts[level];
+	}
+	generation->total_docs = metap->total_docs;
+	generation->total_len  = metap->total_len;
+	pfree(metap);
+
+	/* A spill or merge landed since the caller read the heads */
+	return memcmp(generation->level_heads,
+				  level_heads,
+				  sizeof(generation->level_heads)) == 0;
+}
+
+int
+tp_doc_freq_cache_lookup(
+		Oid						   index_oid,
+		const TpDocFreqGeneration *generation,
+		char					 **terms,
+		int						   term_count,
+		uint32					  *doc_freqs,
+		bool					  *found)
+{
+	dshash_table *table;
+	dsa_area	 *dsa;
+	int			  hits = 0;
+	int			  i;
+
+	table = doc_freq_cache_attach(false);
+	if (table == NULL)
+	{
+		pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->misses, term_count);
+		return 0;
+	}
+
+	dsa = tp_registry_get_dsa();
+	for (i = 0; i < term_count; i++)
+	{
+		TpDocFreqCacheEntry *entry;
+		TpDocFreqCacheKey	 key;
+
+		make_key(&key, index_oid, terms[i]);
+		entry = dshash_find(table, &key, false);
+		if (entry == NULL)
+			continue;
+
+		if (generations_equal(&entry->generation, generation) &&
+			memcmp(dsa_get_address(dsa, entry->term),
+				   terms[i],
+				   key.term_len) == 0)
+		{
+			doc_freqs[i] = entry->doc_freq;
+			found[i]	 = true;
+			pg_atomic_write_u64(
+					&entry->last_used,
+					pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->clock, 1));
+			hits++;
+		}
+		dshash_release_lock(table, entry);
+	}
+
+	pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->hits, hits);
+	pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->misses, term_count - hits);
+	return hits;
+}
+
+void
+tp_doc_freq_cache_store(
+		Oid						   index_oid,
+		const TpDocFreqGeneration *generation,
+		char					 **terms,
+		int						   term_count,
+		const uint32			  *doc_freqs,
+		const bool				  *found)
+{
+	dshash_table *table;
+	dsa_area	 *dsa;
+	uint64		  charge = 0;
+	int			  i;
+
+	for (i = 0; i < term_count; i++)
+	{
+		if (!found[i])
+			charge += sizeof(TpDocFreqCacheEntry) + strlen(terms[i]);
+	}
+	if (charge == 0)
+		return;
+
+	table = doc_freq_cache_attach(true);
+
+	/* Make room; if another backend is already evicting, don't wait */
+	if (over_budget(charge) &&
+		LWLockConditionalAcquire(&doc_freq_cache_ctl->lock, LW_EXCLUSIVE))
+	{
+		while (over_budget(charge) && evict_old_entries(table))
+			;
+		LWLockRelease(&doc_freq_cache_ctl->lock);
+	}
+	if (over_budget(charge))
+		return;
+
+	dsa = tp_registry_get_dsa();
+	for (i = 0; i < term_count; i++)
+	{
+		TpDocFreqCacheEntry *entry;
+		TpDocFreqCacheKey	 key;
+		dsa_pointer			 term_dp;
+		bool				 exists;
+
+		if (found[i])
+			continue;
+
+		make_key(&key, index_oid, terms[i]);
+		term_dp = dsa_allocate_extended(
+				dsa, Max(key.term_len, 1), DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(term_dp))
+			return;
+		memcpy(dsa_get_address(dsa, term_dp), terms[i], key.term_len);
+
+		/* A stale entry, or a concurrent store of the same term */
+		entry = dshash_find_or_insert(table, &key, &exists);
+		if (exists)
+			release_entry(entry);
+
+		entry->generation = *generation;
+		pg_atomic_init_u64(
+				&entry->last_used,
+				pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->clock, 1));
+		entry->term			 = term_dp;
+		entry->charged_bytes = sizeof(TpDocFreqCacheEntry) + key.term_len;
+		entry->doc_freq		 = doc_freqs[i];
+		account_add(entry->charged_bytes);
+		pg_atomic_fetch_add_u64(&doc_freq_cache_ctl->entries, 1);
+
+		dshash_release_lock(table, entry);
+	}
+}
+
+/*
+ * Remove every entry for `index_oid`, or every entry at all when it
+ * is InvalidOid.
+ */
+static void
+remove_entries(Oid index_oid)
+{
+	dshash_table		*table;
+	dshash_seq_status	 status;
+	TpDocFreqCacheEntry *entry;
+
+	table = doc_freq_cache_attach(false);
+	if (table == NULL)
+		return;
+
+	dshash_seq_init(&status, table, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (OidIsValid(index_oid) && entry->key.index_oid != index_oid)
+			continue;
+		release_entry(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+void
+tp_doc_freq_cache_invalidate_index(Oid index_oid)
+{
+	Assert(OidIsValid(index_oid));
+	remove_entries(index_oid);
+}
+
+/* ---------- SQL interface ---------- */
+
+/*
+ * bm25_doc_freq_cache_stats() -> (hits, misses, entries, bytes)
+ *
+ * Hits and misses count terms, not queries.
+ */
+PG_FUNCTION_INFO_V1(bm25_doc_freq_cache_stats);
+
+Datum
+bm25_doc_freq_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum	  values[4];
+	bool	  nulls[4] = {false, false, false, false};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	if (doc_freq_cache_ctl == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_textsearch doc_freq cache is not initialized")));
+
+	values[0] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&doc_freq_cache_ctl->hits));
+	values[1] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&doc_freq_cache_ctl->misses));
+	values[2] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&doc_freq_cache_ctl->entries));
+	values[3] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&doc_freq_cache_ctl->bytes));
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+/*
+ * bm25_doc_freq_cache_reset() -> void
+ *
+ * Drops every cached doc_freq and zeroes the hit/miss counters.
+ */
+PG_FUNCTION_INFO_V1(bm25_doc_freq_cache_reset);
+
+Datum
+bm25_doc_freq_cache_reset(PG_FUNCTION_ARGS)
+{
+	(void)fcinfo;
+
+	if (doc_freq_cache_ctl == NULL)
+		PG_RETURN_VOID();
+
+	remove_entries(InvalidOid);
+	pg_atomic_write_u64(&doc_freq_cache_ctl->hits, 0);
+	pg_atomic_write_u64(&doc_freq_cache_ctl->misses, 0);
+
+	PG_RETURN_VOID();
+}
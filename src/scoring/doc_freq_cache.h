@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * doc_freq_cache.h - Cross-backend cache of segment document frequencies
+ *
+ * Every ranked scan, planner estimate, and partition statistics call
+ * needs each query term's doc_freq summed over all segments, which
+ * means opening every segment and binary-searching its dictionary.
+ * Segments are immutable, so that sum only changes when a spill,
+ * merge, VACUUM, or REINDEX changes the set of segments.  It is kept
+ * per (index, term) in a dshash in the extension's global DSA so hot
+ * terms skip dictionary probing entirely.
+ *
+ * Each entry records the generation it was computed against
+ * (TpDocFreqGeneration).  A lookup whose generation differs is a
+ * miss and the entry is overwritten by the next store, so there is no
+ * explicit invalidation on spill or merge.  The term bytes are stored
+ * with the entry so a hash collision is a miss, never a wrong count.
+ *
+ * Only the segment part is cached.  The memtable part comes from the
+ * memtable cache, whose per-term posting counts the cache-apply path
+ * already keeps current on every insert.
+ *
+ * Entry memory is charged to pg_textsearch.doc_freq_cache_size and to
+ * the registry-wide estimated_total_bytes counter, like the result
+ * cache.  Least-recently-used entries are evicted to stay under it.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <storage/block.h>
+#include <utils/rel.h>
+
+#include "constants.h"
+
+/* Default for pg_textsearch.doc_freq_cache_size (in kilobytes) */
+#define TP_DEFAULT_DOC_FREQ_CACHE_SIZE_KB (8 * 1024)
+
+/*
+ * Segment set a cached doc_freq was summed over, read from the
+ * metapage.  A spill or merge changes a level's head and count,
+ * VACUUM changes the corpus totals of any segment it rewrites or
+ * drops, and REINDEX / TRUNCATE change the relfilenumber.  Unlike
+ * page LSNs these are maintained for unlogged indexes and on
+ * standbys too.
+ */
+typedef struct TpDocFreqGeneration
+{
+	RelFileNumber relfilenumber;
+	BlockNumber	  level_heads[TP_MAX_LEVELS];
+	uint16		  level_counts[TP_MAX_LEVELS];
+	uint64		  total_docs;
+	uint64		  total_len;
+} TpDocFreqGeneration;
+
+/* GUCs (mod.c) */
+extern bool tp_doc_freq_cache_enabled;
+extern int	tp_doc_freq_cache_size_kb;
+
+/* Shared memory hooks (mod.c) */
+extern void tp_doc_freq_cache_shmem_request(void);
+extern void tp_doc_freq_cache_shmem_startup(void);
+
+/*
+ * Capture the current generation of `index`.  Returns false when its
+ * doc_freqs must not be cached: the cache is disabled, the index has
+ * no segments, or `level_heads` (as read by the caller) no longer
+ * match the metapage.  Must be called under the per-index lock.
+ */
+extern bool tp_doc_freq_cache_get_generation(
+		Relation			 index,
+		const BlockNumber	*level_heads,
+		TpDocFreqGeneration *generation);
+
+/*
+ * Look up the segment doc_freq of each term.  Sets found[i] and
+ * doc_freqs[i] for the terms cached at `generation`, leaving the
+ * others untouched.  Returns the number found.
+ */
+extern int tp_doc_freq_cache_lookup(
+		Oid						   index_oid,
+		const TpDocFreqGeneration *generation,
+		char					 **terms,
+		int						   term_count,
+		uint32					  *doc_freqs,
+		bool					  *found);
+
+/*
+ * Store the segment doc_freq of each term whose found[i] is false
+ * (best effort; silently skips when out of budget)
+ */
+extern void tp_doc_freq_cache_store(
+		Oid						   index_oid,
+		const TpDocFreqGeneration *generation,
+		char					 **terms,
+		int						   term_count,
+		const uint32			  *doc_freqs,
+		const bool				  *found);
+
+/* Drop every cached doc_freq for `index_oid` (VACUUM, DROP INDEX) */
+extern void tp_doc_freq_cache_invalidate_index(Oid index_oid);
@@ -0,0 +1,631 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * expand.c - Prefix ("datab*") and fuzzy ("databse~1") term expansion
+ */
+#include <postgres.h>
+
+#include <common/hashfn.h>
+#include <limits.h>
+#include <mb/pg_wchar.h>
+#include <miscadmin.h>
+#include <utils/builtins.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+#include "access/am.h"
+#include "constants.h"
+#include "index/metapage.h"
+#include "index/source.h"
+#include "index/state.h"
+#include "memtable/cache_source.h"
+#include "scoring/expand.h"
+#include "segment/io.h"
+#include "segment/segment.h"
+
+int tp_prefix_expansions = TP_DEFAULT_PREFIX_EXPANSIONS;
+int tp_fuzzy_expansions	 = TP_DEFAULT_FUZZY_EXPANSIONS;
+
+/* One term a pattern matches, doc_freq summed over all sources */
+typedef struct ExpansionEntry
+{
+	char  *term; /* hash key; pointer into the expansion context */
+	uint64 doc_freq;
+	int	   edits; /* distance from a fuzzy term's lexeme; 0 for a prefix */
+} ExpansionEntry;
+
+/* A pattern being expanded */
+typedef struct PatternExpansion
+{
+	const char *lexeme;
+	int			max_edits; /* -1 for a prefix */
+	pg_wchar   *chars;	   /* lexeme's characters (fuzzy terms only) */
+	int			nchars;
+	HTAB	   *matches; /* ExpansionEntry by term */
+} PatternExpansion;
+
+static uint32
+expansion_term_hash(const void *key, Size keysize)
+{
+	const char *term = *(const char *const *)key;
+
+	(void)keysize;
+	return DatumGetUInt32(hash_any((const unsigned char *)term, strlen(term)));
+}
+
+static int
+expansion_term_match(const void *key1, const void *key2, Size keysize)
+{
+	const char *t1 = *(const char *const *)key1;
+	const char *t2 = *(const char *const *)key2;
+
+	(void)keysize;
+	return strcmp(t1, t2);
+}
+
+/* Add one source's doc_freq of a term the pattern matches */
+static void
+add_match(PatternExpansion *px, const char *term, uint32 doc_freq, int edits)
+{
+	ExpansionEntry *entry;
+	bool			found;
+
+	entry = (ExpansionEntry *)hash_search(
+			px->matches, &term, HASH_ENTER, &found);
+	if (!found)
+	{
+		/* Replace the borrowed key with a copy of our own */
+		entry->term		= pstrdup(term);
+		entry->doc_freq = 0;
+		entry->edits	= edits;
+	}
+	entry->doc_freq += doc_freq;
+}
+
+/* Nearest first, then most frequent, then alphabetical */
+static int
+expansion_entry_cmp(const void *a, const void *b)
+{
+	const ExpansionEntry *ea = *(const ExpansionEntry *const *)a;
+	const ExpansionEntry *eb = *(const ExpansionEntry *const *)b;
+
+	if (ea->edits != eb->edits)
+		return ea->edits < eb->edits ? -1 : 1;
+	if (ea->doc_freq != eb->doc_freq)
+		return ea->doc_freq > eb->doc_freq ? -1 : 1;
+	return strcmp(ea->term, eb->term);
+}
+
+/* Characters of a string, as a palloc'd array; *nchars is their count */
+static pg_wchar *
+string_chars(const char *str, int *nchars)
+{
+	int		  len	= strlen(str);
+	pg_wchar *chars = palloc((len + 1) * sizeof(pg_wchar));
+
+	*nchars = pg_mb2wchar_with_len(str, chars, len);
+	return chars;
+}
+
+/*
+ * One step of the Levenshtein automaton of word: from the row of edit
+ * distances between word's prefixes and some string, compute the row
+ * for that string followed by c.  Returns the smallest distance of the
+ * new row: once it exceeds the edits allowed, no continuation of the
+ * string can match.
+ */
+static int
+automaton_step(
+		const pg_wchar *word,
+		int				nchars,
+		const int	   *row,
+		int			   *next,
+		pg_wchar		c)
+{
+	int row_min;
+	int j;
+
+	next[0] = row[0] + 1;
+	row_min = next[0];
+	for (j = 1; j <= nchars; j++)
+	{
+		int cost = row[j - 1] + (word[j - 1] == c ? 0 : 1);
+
+		cost	= Min(cost, row[j] + 1);
+		cost	= Min(cost, next[j - 1] + 1);
+		next[j] = cost;
+		row_min = Min(row_min, cost);
+	}
+	return row_min;
+}
+
+/* Edit distance of word and term, or max_edits + 1 if it is larger */
+static int
+edit_distance(
+		const pg_wchar *word, int nchars, const char *term, int max_edits)
+{
+	int		  term_nchars;
+	pg_wchar *term_chars = string_chars(term, &term_nchars);
+	int		 *row		 = palloc((nchars + 1) * sizeof(int));
+	int		 *next		 = palloc((nchars + 1) * sizeof(int));
+	int		  distance	 = max_edits + 1;
+	int		  i;
+
+	if (Abs(term_nchars - nchars) <= max_edits)
+	{
+		for (i = 0; i <= nchars; i++)
+			row[i] = i;
+		for (i = 0; i < term_nchars; i++)
+		{
+			int *swap;
+
+			if (automaton_step(word, nchars, row, next, term_chars[i]) >
+				max_edits)
+				break;
+			swap = row;
+			row	 = next;
+			next = swap;
+		}
+		if (i == term_nchars)
+			distance = Min(row[nchars], max_edits + 1);
+	}
+
+	pfree(term_chars);
+	pfree(row);
+	pfree(next);
+	return distance;
+}
+
+/* Edits a fuzzy term allows: a one-character lexeme matches exactly */
+static int
+allowed_edits(int max_edits, int nchars)
+{
+	return Max(Min(max_edits, nchars - 1), 0);
+}
+
+/* IDF scale of a match: (n - e) / n for e edits from n characters */
+static float4
+expansion_weight(const PatternExpansion *px, int edits)
+{
+	if (px->max_edits < 0 || edits == 0)
+		return 1.0f;
+	return (float4)(px->nchars - edits) / px->nchars;
+}
+
+/* TpTermCallback of the memtable's terms starting with a prefix */
+static void
+add_prefix_term(const char *term, uint32 doc_freq, void *arg)
+{
+	add_match((PatternExpansion *)arg, term, doc_freq, 0);
+}
+
+/* TpTermCallback of all the memtable's terms, for a fuzzy term */
+static void
+add_fuzzy_term(const char *term, uint32 doc_freq, void *arg)
+{
+	PatternExpansion *px = (PatternExpansion *)arg;
+	int				  edits;
+
+	edits = edit_distance(px->chars, px->nchars, term, px->max_edits);
+	if (edits <= px->max_edits)
+		add_match(px, term, doc_freq, edits);
+}
+
+/*
+ * Add the terms of a level's segments within px->max_edits of the
+ * lexeme.  See the file header of expand.h for the walk.
+ */
+static void
+segment_foreach_fuzzy(
+		Relation index, BlockNumber first_segment, PatternExpansion *px)
+{
+	int			width		= px->nchars + 1;
+	int			max_depth	= px->nchars + px->max_edits + 1;
+	int		   *rows		= palloc((max_depth + 1) * width * sizeof(int));
+	int		   *byte_end	= palloc((max_depth + 1) * sizeof(int));
+	char	   *path;
+	char	   *term_buffer = NULL;
+	uint32		buffer_size = 0;
+	BlockNumber current		= first_segment;
+	int			i;
+
+	/* The bytes of the characters rows were computed for */
+	path = palloc(max_depth * pg_database_encoding_max_length());
+
+	/* Row 0: the distances of the lexeme's prefixes to "" */
+	for (i = 0; i < width; i++)
+		rows[i] = i;
+	byte_end[0] = 0;
+
+	while (current != InvalidBlockNumber)
+	{
+		TpSegmentReader *reader;
+		TpSegmentHeader *header;
+		uint32			 num_terms;
+		uint32			 idx   = 0;
+		int				 valid = 0; /* rows computed for path */
+
+		CHECK_FOR_INTERRUPTS();
+
+		reader = tp_segment_open(index, current);
+		if (!reader)
+			break;
+		header = reader->header;
+
+		num_terms = tp_segment_num_terms(reader);
+		if (num_terms == 0)
+		{
+			current = header->next_segment;
+			tp_segment_close(reader);
+			continue;
+		}
+
+		while (idx < num_terms)
+		{
+			const char *term = tp_segment_read_term(
+					reader, idx, &term_buffer, &buffer_size);
+			int			term_len = strlen(term);
+			int			depth	 = 0;
+			bool		dead	 = false;
+
+			/* Keep the rows of the characters shared with the last term */
+			while (depth < valid && byte_end[depth + 1] <= term_len &&
+				   memcmp(path + byte_end[depth],
+						  term + byte_end[depth],
+						  byte_end[depth + 1] - byte_end[depth]) == 0)
+				depth++;
+
+			while (byte_end[depth] < term_len)
+			{
+				int		 offset = byte_end[depth];
+				int		 mblen	= pg_mblen(term + offset);
+				pg_wchar c[2];
+
+				/* Rows deeper than max_depth are always dead */
+				if (depth == max_depth)
+				{
+					dead = true;
+					break;
+				}
+
+				mblen = Min(mblen, term_len - offset);
+				(void)pg_mb2wchar_with_len(term + offset, c, mblen);
+				memcpy(path + offset, term + offset, mblen);
+				byte_end[depth + 1] = offset + mblen;
+				depth++;
+
+				if (automaton_step(
+							px->chars,
+							px->nchars,
+							rows + (depth - 1) * width,
+							rows + depth * width,
+							c[0]) > px->max_edits)
+				{
+					dead = true;
+					break;
+				}
+			}
+			valid = depth;
+
+			if (dead)
+			{
+				/* No term starting with path[0 .. depth) can match */
+				idx = tp_segment_seek_term(
+						reader,
+						num_terms,
+						path,
+						byte_end[depth],
+						true,
+						&term_buffer,
+						&buffer_size);
+				continue;
+			}
+
+			if (rows[depth * width + px->nchars] <= px->max_edits)
+			{
+				TpDictEntry dict_entry;
+
+				tp_segment_read_dict_entry(reader, header, idx, &dict_entry);
+				if (dict_entry.doc_freq > 0)
+					add_match(
+							px,
+							term,
+							dict_entry.doc_freq,
+							rows[depth * width + px->nchars]);
+			}
+			idx++;
+		}
+
+		current = header->next_segment;
+		tp_segment_close(reader);
+	}
+
+	if (term_buffer)
+		pfree(term_buffer);
+	pfree(path);
+	pfree(byte_end);
+	pfree(rows);
+}
+
+/*
+ * Append the best matches of one pattern, or all of them, to (*terms,
+ * *weights), skipping those already in the seen set of (*terms)
+ */
+static void
+expand_one_pattern(
+		TpDataSource	  *memtable_src,
+		Relation		   index,
+		const BlockNumber *level_heads,
+		PatternExpansion  *px,
+		bool			   all_matches,
+		HTAB			  *seen,
+		char			***terms,
+		float4			 **weights,
+		int				  *count,
+		int				  *capacity)
+{
+	HASHCTL			 info;
+	HASH_SEQ_STATUS	 seq;
+	ExpansionEntry	*entry;
+	ExpansionEntry **sorted;
+	long			 nentries;
+	int				 limit;
+	int				 n = 0;
+	int				 kept;
+	int				 level;
+	int				 i;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize   = sizeof(char *);
+	info.entrysize = sizeof(ExpansionEntry);
+	info.hash	   = expansion_term_hash;
+	info.match	   = expansion_term_match;
+	info.hcxt	   = CurrentMemoryContext;
+
+	px->matches = hash_create(
+			"pg_textsearch term expansions",
+			64,
+			&info,
+			HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+	if (px->max_edits < 0)
+	{
+		if (memtable_src != NULL)
+			tp_source_foreach_prefix(
+					memtable_src, px->lexeme, add_prefix_term, px);
+		for (level = 0; level < TP_MAX_LEVELS; level++)
+		{
+			if (level_heads[level] != InvalidBlockNumber)
+				tp_segment_foreach_prefix(
+						index,
+						level_heads[level],
+						px->lexeme,
+						add_prefix_term,
+						px);
+		}
+		limit = tp_prefix_expansions;
+	}
+	else
+	{
+		/* The memtable's term table is unordered: try every term */
+		if (memtable_src != NULL)
+			tp_source_foreach_prefix(memtable_src, "", add_fuzzy_term, px);
+		for (level = 0; level < TP_MAX_LEVELS; level++)
+		{
+			if (level_heads[level] != InvalidBlockNumber)
+				segment_foreach_fuzzy(index, level_heads[level], px);
+		}
+		limit = tp_fuzzy_expansions;
+	}
+
+	if (all_matches)
+		limit = INT_MAX;
+
+	nentries = hash_get_num_entries(px->matches);
+	if (nentries == 0)
+	{
+		hash_destroy(px->matches);
+		return;
+	}
+
+	sorted = palloc(nentries * sizeof(ExpansionEntry *));
+	hash_seq_init(&seq, px->matches);
+	while ((entry = (ExpansionEntry *)hash_seq_search(&seq)) != NULL)
+		sorted[n++] = entry;
+	qsort(sorted, n, sizeof(ExpansionEntry *), expansion_entry_cmp);
+
+	for (i = 0, kept = 0; i < n && kept < limit; i++)
+	{
+		bool duplicate;
+
+		kept++;
+		(void)hash_search(seen, &sorted[i]->term, HASH_ENTER, &duplicate);
+		if (duplicate)
+			continue;
+
+		if (*count == *capacity)
+		{
+			*capacity *= 2;
+			*terms	 = repalloc(*terms, *capacity * sizeof(char *));
+			*weights = repalloc(*weights, *capacity * sizeof(float4));
+		}
+		(*terms)[*count]   = sorted[i]->term;
+		(*weights)[*count] = expansion_weight(px, sorted[i]->edits);
+		(*count)++;
+	}
+
+	pfree(sorted);
+	hash_destroy(px->matches);
+}
+
+char *
+tp_pattern_lexeme(const char *word, Oid text_config_oid)
+{
+	char  **lexemes;
+	int32  *frequencies;
+	int		count = 0;
+	char   *best  = NULL;
+	int		i;
+
+	(void)tp_tokenize_text(
+			cstring_to_text(word),
+			text_config_oid,
+			&lexemes,
+			&frequencies,
+			&count);
+	for (i = 0; i < count; i++)
+	{
+		if (best == NULL || strlen(lexemes[i]) > strlen(best))
+			best = lexemes[i];
+	}
+	return best;
+}
+
+bool
+tp_pattern_matches(
+		const TpTermPattern *pattern, const char *lexeme, const char *term)
+{
+	pg_wchar *chars;
+	int		  nchars;
+	int		  max_edits;
+	bool	  matches;
+
+	if (pattern->max_edits < 0)
+		return strncmp(term, lexeme, strlen(lexeme)) == 0;
+
+	chars	  = string_chars(lexeme, &nchars);
+	max_edits = allowed_edits(pattern->max_edits, nchars);
+	matches	  = edit_distance(chars, nchars, term, max_edits) <= max_edits;
+	pfree(chars);
+	return matches;
+}
+
+int
+tp_expand_patterns(
+		TpLocalIndexState *state,
+		Relation		   index,
+		Oid				   text_config_oid,
+		List			  *patterns,
+		bool			   all_matches,
+		char			***terms,
+		int32			 **frequencies,
+		float4			 **weights,
+		int				   term_count)
+{
+	TpIndexMetaPage metap;
+	BlockNumber		level_heads[TP_MAX_LEVELS];
+	TpDataSource   *memtable_src;
+	HASHCTL			info;
+	HTAB		   *seen;
+	char		  **all_terms;
+	float4		   *all_weights;
+	bool			acquired = false;
+	bool			weighted = false;
+	int				capacity = Max(term_count, 8) * 2;
+	int				count	 = term_count;
+	int				i;
+	ListCell	   *lc;
+
+	/*
+	 * The query's own terms come first, and are never added twice.  An
+	 * unlimited expansion can add thousands, so they are tracked in a hash.
+	 */
+	memset(&info, 0, sizeof(info));
+	info.keysize   = sizeof(char *);
+	info.entrysize = sizeof(char *);
+	info.hash	   = expansion_term_hash;
+	info.match	   = expansion_term_match;
+	info.hcxt	   = CurrentMemoryContext;
+
+	seen = hash_create(
+			"pg_textsearch expanded terms",
+			64,
+			&info,
+			HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+	all_terms	= palloc(capacity * sizeof(char *));
+	all_weights = palloc(capacity * sizeof(float4));
+	for (i = 0; i < term_count; i++)
+	{
+		all_terms[i]   = (*terms)[i];
+		all_weights[i] = 1.0f;
+		(void)hash_search(seen, &all_terms[i], HASH_ENTER, NULL);
+	}
+
+	if (!state->lock_held)
+	{
+		tp_acquire_index_lock(state, LW_SHARED);
+		acquired = true;
+	}
+
+	metap = tp_get_metapage(index);
+	for (i = 0; i < TP_MAX_LEVELS; i++)
+		level_heads[i] = metap->level_heads[i];
+	pfree(metap);
+
+	/* No query terms: the memtable source must know every term */
+	memtable_src = tp_memtable_source_create_for_read(state, index, NULL, 0);
+
+	foreach (lc, patterns)
+	{
+		TpTermPattern	*pattern = (TpTermPattern *)lfirst(lc);
+		PatternExpansion px;
+
+		memset(&px, 0, sizeof(px));
+		px.lexeme = tp_pattern_lexeme(pattern->word, text_config_oid);
+		if (px.lexeme == NULL)
+			continue;
+
+		px.max_edits = pattern->max_edits;
+		if (px.max_edits >= 0)
+		{
+			px.chars	 = string_chars(px.lexeme, &px.nchars);
+			px.max_edits = allowed_edits(px.max_edits, px.nchars);
+		}
+
+		expand_one_pattern(
+				memtable_src,
+				index,
+				level_heads,
+				&px,
+				all_matches,
+				seen,
+				&all_terms,
+				&all_weights,
+				&count,
+				&capacity);
+	}
+
+	if (memtable_src != NULL)
+		tp_source_close(memtable_src);
+	if (acquired)
+		tp_release_index_lock(state);
+	hash_destroy(seen);
+
+	for (i = term_count; i < count; i++)
+		weighted = weighted || all_weights[i] != 1.0f;
+	if (weighted)
+		*weights = all_weights;
+	else
+	{
+		*weights = NULL;
+		pfree(all_weights);
+	}
+
+	if (count == term_count)
+	{
+		pfree(all_terms);
+		return term_count;
+	}
+
+	/* Each expansion counts once, as a word written once would */
+	if (term_count > 0)
+		*frequencies = repalloc(*frequencies, count * sizeof(int32));
+	else
+		*frequencies = palloc(count * sizeof(int32));
+	for (i = term_count; i < count; i++)
+		(*frequencies)[i] = 1;
+	*terms = all_terms;
+	return count;
+}
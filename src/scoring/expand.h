@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * expand.h - Prefix ("datab*") and fuzzy ("databse~1") term expansion
+ *
+ * A term pattern (TpTermPattern, see types/query.h) stands for the
+ * indexed terms related to the lexeme of its word under the index's
+ * text search configuration (as with to_tsquery's "datab:*", the word
+ * itself is normalized first): the terms starting with it, or the
+ * terms within N edits (Levenshtein distance, in characters) of it.
+ * The memtable's term table and every segment's sorted dictionary are
+ * enumerated for them, their doc_freqs summed across them, and the
+ * best become ordinary optional query terms: the
+ * pg_textsearch.prefix_expansions most frequent terms of a prefix, the
+ * pg_textsearch.fuzzy_expansions nearest (then most frequent) terms of
+ * a fuzzy term.  They are then scored as one disjunction in the same
+ * scan, so block-max WAND bounds them as it does any other query term.
+ *
+ * A segment's dictionary is searched for a fuzzy term with a
+ * Levenshtein automaton: terms are visited in sorted order, the
+ * automaton state of the prefix a term shares with the one before is
+ * reused, and once a prefix can no longer be completed within N edits a
+ * binary search skips every term starting with it.  The work is bounded
+ * by the automaton rather than by the size of the dictionary.
+ *
+ * A fuzzy term e edits from a lexeme of n characters scales its IDF by
+ * (n - e) / n, and a lexeme of n characters allows at most n - 1 edits.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <nodes/pg_list.h>
+#include <utils/rel.h>
+
+#include "types/query.h"
+
+typedef struct TpLocalIndexState TpLocalIndexState;
+
+#define TP_DEFAULT_PREFIX_EXPANSIONS 50
+#define TP_DEFAULT_FUZZY_EXPANSIONS	 50
+#define TP_MAX_TERM_EXPANSIONS		 1000
+
+/* GUCs: most terms a prefix or fuzzy term expands to */
+extern int tp_prefix_expansions;
+extern int tp_fuzzy_expansions;
+
+/*
+ * Lexeme a pattern's word stands for, or NULL if the configuration
+ * drops it (a stop word).  A word the parser splits ("e-mail") stands
+ * for its longest lexeme.
+ */
+extern char *tp_pattern_lexeme(const char *word, Oid text_config_oid);
+
+/* Does term match a pattern whose word has the given lexeme? */
+extern bool tp_pattern_matches(
+		const TpTermPattern *pattern, const char *lexeme, const char *term);
+
+/*
+ * Append the terms a list of TpTermPattern (see tpquery_split_patterns)
+ * stand for to a query's term_count terms, each with frequency 1,
+ * skipping terms the query already has.  A ranked query takes the
+ * best pg_textsearch.prefix_expansions / fuzzy_expansions of each;
+ * with all_matches, as a boolean match must, it takes every one.  The arrays are replaced by
+ * palloc'd ones (either may be NULL when term_count is 0).  *weights is
+ * set to a palloc'd array of each term's IDF scale, or to NULL if they
+ * are all 1.  Returns the new number of terms.  Takes the per-index
+ * lock in shared mode unless the caller holds it.
+ */
+extern int tp_expand_patterns(
+		TpLocalIndexState *state,
+		Relation		   index,
+		Oid				   text_config_oid,
+		List			  *patterns,
+		bool			   all_matches,
+		char			***terms,
+		int32			 **frequencies,
+		float4			 **weights,
+		int				   term_count);
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * parallel.c - Parallel index scan coordination for BM25 top-k queries
+ *
+ * See parallel.h for the overall protocol.
+ */
+#include <postgres.h>
+
+#include <common/hashfn.h>
+#include <miscadmin.h>
+#include <storage/condition_variable.h>
+#include <utils/memutils.h>
+#include <utils/wait_event.h>
+
+#include "scoring/parallel.h"
+
+/*
+ * Initialize shared state in freshly allocated DSM
+ */
+void
+tp_parallel_scan_init_shared(TpParallelScanShared *shared)
+{
+	int i;
+
+	shared->limit = -1;
+	pg_atomic_init_u32(&shared->snapshot_state, TP_PARALLEL_SNAPSHOT_NONE);
+	ConditionVariableInit(&shared->snapshot_cv);
+	for (i = 0; i < TP_MAX_LEVELS; i++)
+		shared->level_heads[i] = InvalidBlockNumber;
+	shared->total_docs	= 0;
+	shared->avg_doc_len = 0.0f;
+	shared->term_count	= 0;
+	for (i = 0; i < TP_PARALLEL_CLAIM_WORDS; i++)
+		pg_atomic_init_u32(&shared->claimed_buckets[i], 0);
+	pg_atomic_init_u32(&shared->threshold, 0); /* 0.0f */
+}
+
+/*
+ * Reset shared state for a rescan.  Workers are relaunched after
+ * this, so nobody is reading the snapshot concurrently.
+ */
+void
+tp_parallel_scan_reset_shared(TpParallelScanShared *shared)
+{
+	int i;
+
+	pg_atomic_write_u32(&shared->snapshot_state, TP_PARALLEL_SNAPSHOT_NONE);
+	for (i = 0; i < TP_PARALLEL_CLAIM_WORDS; i++)
+		pg_atomic_write_u32(&shared->claimed_buckets[i], 0);
+	pg_atomic_write_u32(&shared->threshold, 0);
+}
+
+TpParallelScanState *
+tp_parallel_scan_begin(TpParallelScanShared *shared)
+{
+	TpParallelScanState *ps = palloc0(sizeof(TpParallelScanState));
+
+	ps->shared			= shared;
+	ps->snapshot_owner	= false;
+	ps->share_threshold = shared->limit > 0;
+	ps->replay			= false;
+
+	return ps;
+}
+
+void
+tp_parallel_scan_end(TpParallelScanState *ps)
+{
+	pfree(ps);
+}
+
+bool
+tp_parallel_scan_claim_snapshot(TpParallelScanState *ps)
+{
+	uint32 expected = TP_PARALLEL_SNAPSHOT_NONE;
+
+	if (ps->snapshot_owner)
+		return true;
+
+	if (pg_atomic_compare_exchange_u32(
+				&ps->shared->snapshot_state,
+				&expected,
+				TP_PARALLEL_SNAPSHOT_CLAIMED))
+		ps->snapshot_owner = true;
+
+	return ps->snapshot_owner;
+}
+
+/*
+ * Copy a query's terms into the snapshot, each NUL-terminated.
+ * Returns false if they do not fit.
+ */
+static bool
+copy_terms(TpParallelScanShared *shared, char *const *terms, int term_count)
+{
+	Size used = 0;
+	int	 i;
+
+	if (term_count > TP_PARALLEL_MAX_QUERY_TERMS)
+		return false;
+
+	for (i = 0; i < term_count; i++)
+	{
+		Size len = strlen(terms[i]) + 1;
+
+		if (used + len > TP_PARALLEL_MAX_TERM_BYTES)
+			return false;
+		memcpy(shared->terms + used, terms[i], len);
+		used += len;
+	}
+	return true;
+}
+
+void
+tp_parallel_scan_publish_snapshot(
+		TpParallelScanState *ps,
+		const BlockNumber	*level_heads,
+		int32				 total_docs,
+		float4				 avg_doc_len,
+		char *const			*terms,
+		const uint32		*doc_freqs,
+		int					 term_count)
+{
+	TpParallelScanShared *shared = ps->shared;
+	int					  i;
+
+	Assert(ps->snapshot_owner);
+
+	for (i = 0; i < TP_MAX_LEVELS; i++)
+		shared->level_heads[i] = level_heads[i];
+	shared->total_docs	= total_docs;
+	shared->avg_doc_len = avg_doc_len;
+
+	if (copy_terms(shared, terms, term_count))
+	{
+		shared->term_count = term_count;
+		memcpy(shared->doc_freqs, doc_freqs, term_count * sizeof(uint32));
+	}
+	else
+		shared->term_count = -1;
+
+	/* Snapshot fields must be visible before READY is */
+	pg_write_barrier();
+	pg_atomic_write_u32(&shared->snapshot_state, TP_PARALLEL_SNAPSHOT_READY);
+	ConditionVariableBroadcast(&shared->snapshot_cv);
+}
+
+bool
+tp_parallel_scan_shares_terms(
+		TpParallelScanState *ps, char *const *terms, int term_count)
+{
+	TpParallelScanShared *shared = ps->shared;
+	const char			 *published = shared->terms;
+	int					  i;
+
+	if (shared->term_count != term_count)
+		return false;
+
+	/* copy_terms() proved the published terms are in bounds */
+	for (i = 0; i < term_count; i++)
+	{
+		if (strcmp(published, terms[i]) != 0)
+			return false;
+		published += strlen(published) + 1;
+	}
+	return true;
+}
+
+void
+tp_parallel_scan_wait_snapshot(TpParallelScanState *ps)
+{
+	TpParallelScanShared *shared = ps->shared;
+
+	ConditionVariablePrepareToSleep(&shared->snapshot_cv);
+	while (pg_atomic_read_u32(&shared->snapshot_state) !=
+		   TP_PARALLEL_SNAPSHOT_READY)
+		ConditionVariableSleep(&shared->snapshot_cv, PG_WAIT_EXTENSION);
+	ConditionVariableCancelSleep();
+
+	/* Pairs with the write barrier in publish */
+	pg_read_barrier();
+}
+
+bool
+tp_parallel_scan_claim_segment(
+		TpParallelScanState *ps, BlockNumber root_block)
+{
+	uint32 bucket = hash_uint32(root_block) % TP_PARALLEL_CLAIM_BUCKETS;
+	uint32 word	  = bucket / 32;
+	uint32 bit	  = (uint32)1 << (bucket % 32);
+	uint32 old_bits;
+
+	/* Ours if we claimed its bucket, on this pass or an earlier one */
+	if (ps->claimed[word] & bit)
+		return true;
+	if (ps->replay)
+		return false;
+
+	/*
+	 * The segment is ours if we are the one to set its bucket's bit.
+	 * Participants may walk their plans in different orders, or even
+	 * see a merge relink a chain between their walks; the root block
+	 * names the segment either way.  Every participant plans the same
+	 * segments, so the claimer meets all of a bucket's segments.
+	 */
+	old_bits = pg_atomic_fetch_or_u32(&ps->shared->claimed_buckets[word], bit);
+	if (old_bits & bit)
+		return false;
+	ps->claimed[word] |= bit;
+	return true;
+}
+
+bool
+tp_parallel_scan_has_claims(TpParallelScanState *ps)
+{
+	int i;
+
+	for (i = 0; i < TP_PARALLEL_CLAIM_WORDS; i++)
+	{
+		if (ps->claimed[i] != 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Re-executions score with a larger k than the one the shared
+ * threshold was computed for, so they must not prune against it.
+ */
+void
+tp_parallel_scan_end_pass(TpParallelScanState *ps)
+{
+	ps->replay			= true;
+	ps->share_threshold = false;
+}
+
+void
+tp_shared_threshold_raise(pg_atomic_uint32 *threshold, float4 score)
+{
+	uint32 new_bits;
+	uint32 old_bits = pg_atomic_read_u32(threshold);
+
+	if (score <= 0.0f)
+		return;
+	memcpy(&new_bits, &score, sizeof(new_bits));
+
+	/* On failure old_bits is refreshed; retry only while we'd raise it */
+	while (new_bits > old_bits)
+	{
+		if (pg_atomic_compare_exchange_u32(threshold, &old_bits, new_bits))
+			break;
+	}
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * parallel.h - Parallel index scan coordination for BM25 top-k queries
+ *
+ * Architecture (partitioned top-k, Gather Merge combines):
+ * - The first participant to score claims the corpus snapshot: it
+ *   reads the metapage and the memtable under its per-index lock,
+ *   publishes level heads, corpus totals, and per-term doc_freqs, and
+ *   scores the memtable.  Everyone else waits for the snapshot so
+ *   every participant scores with identical IDF/avgdl and walks the
+ *   same segment set.
+ * - Each participant walks its own BMW scoring plan (descending query
+ *   upper bound) and, before scoring a segment, claims the bucket its
+ *   root block hashes to in a shared bitmap.  Whoever sets the bit
+ *   scores every segment of that bucket, however the participants'
+ *   plans happen to order them.  Each runs BMW only over the segments
+ *   it claimed, returning its own sorted top-k.
+ * - When the leader knows the query LIMIT, participants publish their
+ *   heap threshold into a shared atomic and prune against the best
+ *   one.  A doc below the shared threshold cannot make the global
+ *   top-k: some participant already holds LIMIT docs scoring at least
+ *   that much.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <port/atomics.h>
+#include <storage/block.h>
+#include <storage/condition_variable.h>
+
+#include "constants.h"
+
+/*
+ * Largest query whose terms and doc_freqs fit in the shared snapshot.
+ * A longer query is scored by the snapshot owner alone: the other
+ * participants return nothing and leave every segment to it.
+ */
+#define TP_PARALLEL_MAX_QUERY_TERMS 64
+#define TP_PARALLEL_MAX_TERM_BYTES	4096
+
+/*
+ * Buckets of the shared claim bitmap (a multiple of 32).  Past this
+ * many segments a bucket holds several, which coarsens the split
+ * between participants but never leaves a segment without one.
+ */
+#define TP_PARALLEL_CLAIM_BUCKETS 4096
+#define TP_PARALLEL_CLAIM_WORDS	  (TP_PARALLEL_CLAIM_BUCKETS / 32)
+
+/* Snapshot lifecycle (TpParallelScanShared.snapshot_state) */
+#define TP_PARALLEL_SNAPSHOT_NONE	 0 /* Nobody has claimed it yet */
+#define TP_PARALLEL_SNAPSHOT_CLAIMED 1 /* Owner is building it */
+#define TP_PARALLEL_SNAPSHOT_READY	 2 /* Published; safe to read */
+
+/*
+ * Shared state for a parallel BM25 index scan
+ *
+ * Lives in the executor's DSM segment (see amestimateparallelscan).
+ * Snapshot fields are written only by the owner before it sets
+ * snapshot_state to READY, and are read-only afterwards.
+ */
+typedef struct TpParallelScanShared
+{
+	/* Leader's pushed-down LIMIT (-1 if none); set before launch */
+	int32 limit;
+
+	/* Corpus snapshot */
+	pg_atomic_uint32  snapshot_state;
+	ConditionVariable snapshot_cv;
+	BlockNumber		  level_heads[TP_MAX_LEVELS];
+	int32			  total_docs;
+	float4			  avg_doc_len;
+	int32 term_count; /* -1 if the query overflowed the snapshot */
+	uint32 doc_freqs[TP_PARALLEL_MAX_QUERY_TERMS];
+	char   terms[TP_PARALLEL_MAX_TERM_BYTES]; /* NUL-terminated, in order */
+
+	/* Work queue: one bit per claimed bucket of root blocks */
+	pg_atomic_uint32 claimed_buckets[TP_PARALLEL_CLAIM_WORDS];
+
+	/* Best top-k threshold published so far (float4 bits) */
+	pg_atomic_uint32 threshold;
+} TpParallelScanShared;
+
+/*
+ * Backend-local view of a parallel scan
+ *
+ * Claimed buckets are remembered so that a re-execution (limit
+ * doubling in tp_gettuple) revisits exactly the same partition instead
+ * of competing for an already-drained queue.
+ */
+typedef struct TpParallelScanState
+{
+	TpParallelScanShared *shared;
+	bool snapshot_owner;  /* We published the snapshot; own memtable */
+	bool share_threshold; /* Prune against / publish shared threshold */
+	bool replay;		  /* Re-execution: only revisit claimed[] */
+
+	uint32 claimed[TP_PARALLEL_CLAIM_WORDS]; /* Buckets we claimed */
+} TpParallelScanState;
+
+/* Initialize / reset shared state (aminitparallelscan, amparallelrescan) */
+extern void tp_parallel_scan_init_shared(TpParallelScanShared *shared);
+extern void tp_parallel_scan_reset_shared(TpParallelScanShared *shared);
+
+/* Create / free the local view; allocates in CurrentMemoryContext */
+extern TpParallelScanState *
+tp_parallel_scan_begin(TpParallelScanShared *shared);
+extern void tp_parallel_scan_end(TpParallelScanState *ps);
+
+/*
+ * Try to become the snapshot owner.  Returns true if this participant
+ * owns (or already owned) the snapshot and must score the memtable.
+ * Returns false once another participant has claimed it; the caller
+ * then waits with tp_parallel_scan_wait_snapshot().
+ */
+extern bool tp_parallel_scan_claim_snapshot(TpParallelScanState *ps);
+
+/* Publish the snapshot and wake waiters (owner only) */
+extern void tp_parallel_scan_publish_snapshot(
+		TpParallelScanState *ps,
+		const BlockNumber	*level_heads,
+		int32				 total_docs,
+		float4				 avg_doc_len,
+		char *const			*terms,
+		const uint32		*doc_freqs,
+		int					 term_count);
+
+/*
+ * Whether the published snapshot holds doc_freqs for exactly these
+ * terms.  It does not if the query overflowed the snapshot, or if its
+ * word* / word~N patterns expanded differently for the owner, which
+ * saw the memtable at another moment.
+ */
+extern bool tp_parallel_scan_shares_terms(
+		TpParallelScanState *ps, char *const *terms, int term_count);
+
+/* Block until the snapshot is READY */
+extern void tp_parallel_scan_wait_snapshot(TpParallelScanState *ps);
+
+/*
+ * Decide whether the segment at `root_block` belongs to this
+ * participant.  Called for every segment it would score, in any order.
+ */
+extern bool tp_parallel_scan_claim_segment(
+		TpParallelScanState *ps, BlockNumber root_block);
+
+/* Whether this participant has claimed any segment yet */
+extern bool tp_parallel_scan_has_claims(TpParallelScanState *ps);
+
+/* Mark the end of a scoring pass; later passes replay claimed[] */
+extern void tp_parallel_scan_end_pass(TpParallelScanState *ps);
+
+/*
+ * Shared threshold helpers.  Scores are non-negative, so the IEEE-754
+ * bit pattern orders the same way as the float value and a plain
+ * compare-and-swap max works.
+ */
+static inline float4
+tp_shared_threshold_get(pg_atomic_uint32 *threshold)
+{
+	uint32 bits = pg_atomic_read_u32(threshold);
+	float4 value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+extern void
+tp_shared_threshold_raise(pg_atomic_uint32 *threshold, float4 score);
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * partition.c - Statistics shared across the partitions of an index
+ *
+ * The statistics of the last (partitioned index, query) of the current
+ * statement are kept in a context under TopTransactionContext: the
+ * scans of one Merge Append all start within the same statement, so
+ * one entry serves them all.  The entry is keyed by statement start
+ * and command ID as well, so a later statement of the transaction, or
+ * a later command of a function that has changed the table, gathers
+ * them again.
+ */
+#include <postgres.h>
+
+#include <access/genam.h>
+#include <access/xact.h>
+#include <catalog/partition.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_inherits.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+
+#include "index/state.h"
+#include "scoring/bm25.h"
+#include "scoring/partition.h"
+
+bool tp_partition_global_stats = false;
+
+/* Statistics of one partitioned index for one query */
+typedef struct PartitionStatsEntry
+{
+	Oid			root_oid;	/* Top-level partitioned index */
+	TimestampTz stmt_start; /* Statement they were gathered in */
+	CommandId	command_id;
+	char	  **terms;
+	int			term_count;
+	uint32	   *doc_freqs;
+	int32		total_docs;
+	float4		avg_doc_len;
+
+	pg_atomic_uint32 threshold; /* Shared by the partitions' scans */
+} PartitionStatsEntry;
+
+static MemoryContext		partition_stats_context = NULL;
+static PartitionStatsEntry *partition_stats_entry	= NULL;
+
+bool
+tp_partition_stats_enabled(Relation index)
+{
+	return tp_partition_global_stats && index->rd_rel->relispartition;
+}
+
+static bool
+entry_matches(Oid root_oid, char **terms, int term_count)
+{
+	PartitionStatsEntry *entry = partition_stats_entry;
+	int					 i;
+
+	if (entry == NULL || entry->root_oid != root_oid ||
+		entry->stmt_start != GetCurrentStatementStartTimestamp() ||
+		entry->command_id != GetCurrentCommandId(false) ||
+		entry->term_count != term_count)
+		return false;
+
+	for (i = 0; i < term_count; i++)
+	{
+		if (strcmp(entry->terms[i], terms[i]) != 0)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Add one leaf index's statistics to the sums.  Its per-index lock is
+ * taken unless the caller already holds it (the partition it scans).
+ */
+static void
+add_leaf_stats(
+		Oid		index_oid,
+		char  **terms,
+		int		term_count,
+		uint32 *doc_freqs,
+		int64  *total_docs,
+		int64  *total_len)
+{
+	Relation		   index = index_open(index_oid, AccessShareLock);
+	TpLocalIndexState *state = tp_get_local_index_state(index_oid);
+	uint32			  *leaf_freqs;
+	int64			   leaf_docs;
+	int64			   leaf_len;
+	bool			   acquired = false;
+	int				   i;
+
+	if (state == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not get index state for \"%s\"",
+						RelationGetRelationName(index))));
+
+	if (!state->lock_held)
+	{
+		tp_acquire_index_lock(state, LW_SHARED);
+		acquired = true;
+	}
+
+	leaf_freqs = palloc(Max(term_count, 1) * sizeof(uint32));
+	tp_get_corpus_stats(
+			state,
+			index,
+			terms,
+			term_count,
+			leaf_freqs,
+			&leaf_docs,
+			&leaf_len);
+
+	if (acquired)
+		tp_release_index_lock(state);
+
+	for (i = 0; i < term_count; i++)
+		doc_freqs[i] += leaf_freqs[i];
+	*total_docs += leaf_docs;
+	*total_len += leaf_len;
+
+	pfree(leaf_freqs);
+	index_close(index, AccessShareLock);
+}
+
+/*
+ * Gather the statistics of every leaf index below root_oid into a new
+ * cache entry
+ */
+static PartitionStatsEntry *
+build_entry(Oid root_oid, char **terms, int term_count)
+{
+	PartitionStatsEntry *entry;
+	MemoryContext		 oldcontext;
+	List				*inheritors;
+	ListCell			*lc;
+	int64				 total_docs = 0;
+	int64				 total_len	= 0;
+	int					 i;
+
+	if (partition_stats_context == NULL)
+		partition_stats_context = AllocSetContextCreate(
+				TopTransactionContext,
+				"pg_textsearch partition stats",
+				ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(partition_stats_context);
+	partition_stats_entry = NULL;
+
+	oldcontext		  = MemoryContextSwitchTo(partition_stats_context);
+	entry			  = palloc0(sizeof(PartitionStatsEntry));
+	entry->root_oid	  = root_oid;
+	entry->stmt_start = GetCurrentStatementStartTimestamp();
+	entry->command_id = GetCurrentCommandId(false);
+	entry->term_count = term_count;
+	entry->terms	  = palloc(Max(term_count, 1) * sizeof(char *));
+	for (i = 0; i < term_count; i++)
+		entry->terms[i] = pstrdup(terms[i]);
+	entry->doc_freqs = palloc0(Max(term_count, 1) * sizeof(uint32));
+	pg_atomic_init_u32(&entry->threshold, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Partitioned indexes have no storage; only leaves are summed */
+	inheritors = find_all_inheritors(root_oid, AccessShareLock, NULL);
+	foreach (lc, inheritors)
+	{
+		Oid oid = lfirst_oid(lc);
+
+		if (get_rel_relkind(oid) != RELKIND_INDEX)
+			continue;
+		add_leaf_stats(
+				oid,
+				terms,
+				term_count,
+				entry->doc_freqs,
+				&total_docs,
+				&total_len);
+	}
+	list_free(inheritors);
+
+	/* Same arithmetic as a single index (read_corpus_stats in bm25.c) */
+	entry->total_docs = (total_docs > PG_INT32_MAX) ? PG_INT32_MAX
+													: (int32)total_docs;
+	entry->avg_doc_len = entry->total_docs > 0
+							   ? (float4)((double)total_len /
+										  (double)entry->total_docs)
+							   : 0.0f;
+
+	partition_stats_entry = entry;
+	return entry;
+}
+
+bool
+tp_partition_stats_get(
+		Relation		  index,
+		char			**terms,
+		int				  term_count,
+		TpPartitionStats *stats)
+{
+	PartitionStatsEntry *entry;
+	List				*ancestors;
+	Oid					 root_oid;
+
+	if (!tp_partition_stats_enabled(index))
+		return false;
+
+	ancestors = get_partition_ancestors(RelationGetRelid(index));
+	if (ancestors == NIL)
+		return false;
+	root_oid = llast_oid(ancestors);
+	list_free(ancestors);
+
+	if (entry_matches(root_oid, terms, term_count))
+		entry = partition_stats_entry;
+	else
+		entry = build_entry(root_oid, terms, term_count);
+
+	stats->total_docs  = entry->total_docs;
+	stats->avg_doc_len = entry->avg_doc_len;
+	stats->doc_freqs   = entry->doc_freqs;
+	stats->threshold   = &entry->threshold;
+	return true;
+}
+
+void
+tp_partition_stats_reset(void)
+{
+	/* The context itself goes away with TopTransactionContext */
+	partition_stats_context = NULL;
+	partition_stats_entry	= NULL;
+}
+
+void
+tp_partition_scan_reset(TpPartitionScanState *ps)
+{
+	ps->share_threshold = true;
+	ps->threshold_used	= false;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * partition.h - Statistics shared across the partitions of an index
+ *
+ * Each partition of a partitioned BM25 index is a separate index with
+ * its own corpus, so by default a query scores every partition with
+ * that partition's IDF and average document length.  With
+ * pg_textsearch.partition_global_stats on, a scan of one partition
+ * scores with the statistics of the whole partitioned index instead:
+ * document count, total length and per-term doc_freq summed over all
+ * leaf indexes.  They are gathered once per statement and query (the
+ * first partition scanned pays for it) and reused by the scans of the
+ * other partitions.
+ *
+ * The partitions' scans of one statement also share a top-k threshold.
+ * Under Merge Append every partition's first batch is scored before
+ * any row is returned; once a partition holds a full batch, its
+ * weakest score is published and later partitions only rank documents
+ * scoring at least that much in their first batch.  That defers, but
+ * never loses, the rest: a first batch cut short by the threshold is
+ * resumed without it (see tp_gettuple), so rows below the threshold
+ * are still returned, in order, if the query reads that far.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <port/atomics.h>
+#include <utils/rel.h>
+
+/* GUC: score partitions with the whole partitioned index's statistics */
+extern bool tp_partition_global_stats;
+
+/*
+ * Corpus statistics of a partitioned index for one query, and the
+ * top-k threshold its partitions' scans share
+ */
+typedef struct TpPartitionStats
+{
+	int32			  total_docs;
+	float4			  avg_doc_len;
+	uint32			 *doc_freqs; /* Per query term */
+	pg_atomic_uint32 *threshold; /* Best threshold (float4 bits) */
+} TpPartitionStats;
+
+/* Per-scan state of a ranked scan of one partition */
+typedef struct TpPartitionScanState
+{
+	bool share_threshold; /* This pass prunes against the threshold */
+	bool threshold_used;  /* The last pass ran under a positive one */
+} TpPartitionScanState;
+
+/* Does a scan of this index use the partitioned index's statistics? */
+extern bool tp_partition_stats_enabled(Relation index);
+
+/*
+ * Fill *stats for the query terms, computing them on the first call of
+ * the statement.  Returns false if the index is not a partition or the
+ * setting is off.  The caller may hold this index's per-index lock;
+ * the other partitions' locks are taken one at a time.
+ */
+extern bool tp_partition_stats_get(
+		Relation		  index,
+		char			**terms,
+		int				  term_count,
+		TpPartitionStats *stats);
+
+/* Forget the cached statistics (transaction end) */
+extern void tp_partition_stats_reset(void);
+
+/* Start a new scan: its first pass shares the threshold */
+extern void tp_partition_scan_reset(TpPartitionScanState *ps);
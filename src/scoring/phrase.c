@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * phrase.c - Phrase and proximity matching
+ */
+#include <postgres.h>
+
+#include <utils/builtins.h>
+
+#include "access/am.h"
+#include "scoring/phrase.h"
+
+/* One analyzed phrase token, for sorting by position */
+typedef struct PhraseToken
+{
+	uint32 position;
+	int	   term;
+} PhraseToken;
+
+static int
+phrase_token_cmp(const void *a, const void *b)
+{
+	const PhraseToken *ta = (const PhraseToken *)a;
+	const PhraseToken *tb = (const PhraseToken *)b;
+
+	if (ta->position < tb->position)
+		return -1;
+	if (ta->position > tb->position)
+		return 1;
+	return 0;
+}
+
+TpPhrase *
+tp_phrase_create(const char *text, int len, int32 slop)
+{
+	TpPhrase *phrase = palloc0(sizeof(TpPhrase));
+
+	phrase->text = pnstrdup(text, len);
+	phrase->slop = slop;
+	return phrase;
+}
+
+void
+tp_phrase_analyze(TpPhrase *phrase, Oid text_config_oid)
+{
+	char	   **terms;
+	int32	   *frequencies;
+	uint32	  **positions;
+	int			 term_count;
+	int			 length = 0;
+	PhraseToken *tokens;
+	int			 i;
+	int			 j;
+
+	(void)tp_tokenize_text_with_positions(
+			cstring_to_text(phrase->text),
+			text_config_oid,
+			&terms,
+			&frequencies,
+			&positions,
+			&term_count);
+
+	for (i = 0; i < term_count; i++)
+		length += frequencies[i];
+
+	phrase->nterms	   = term_count;
+	phrase->lexemes	   = terms;
+	phrase->length	   = length;
+	phrase->token_term = palloc(Max(length, 1) * sizeof(int));
+	phrase->offsets	   = palloc(Max(length, 1) * sizeof(int32));
+
+	if (length == 0)
+		return;
+
+	tokens = palloc(length * sizeof(PhraseToken));
+	length = 0;
+	for (i = 0; i < term_count; i++)
+	{
+		for (j = 0; j < frequencies[i]; j++)
+		{
+			tokens[length].position = positions[i][j];
+			tokens[length].term		= i;
+			length++;
+		}
+	}
+	qsort(tokens, length, sizeof(PhraseToken), phrase_token_cmp);
+
+	for (i = 0; i < length; i++)
+	{
+		phrase->token_term[i] = tokens[i].term;
+		phrase->offsets[i] = (int32)(tokens[i].position - tokens[0].position);
+	}
+
+	pfree(tokens);
+	pfree(frequencies);
+	tp_free_term_positions(positions, term_count);
+}
+
+/*
+ * First entry of positions[0..count-1] that is >= target, or count
+ */
+static uint32
+positions_lower_bound(const uint32 *positions, uint32 count, uint32 target)
+{
+	uint32 lo = 0;
+	uint32 hi = count;
+
+	while (lo < hi)
+	{
+		uint32 mid = lo + (hi - lo) / 2;
+
+		if (positions[mid] < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * For every occurrence of the first token, place each following token
+ * at its earliest position that keeps at least the phrase's own gap to
+ * the previous one.  Earliest placement minimizes the span for that
+ * start, so the phrase matches iff some start's span fits in the slop.
+ * If a token cannot be placed, no later start can place it either.
+ */
+bool
+tp_phrase_matches(
+		const TpPhrase *phrase, uint32 *const *positions, const uint32 *counts)
+{
+	const uint32 *first;
+	uint32		  first_count;
+	uint32		  s;
+
+	if (phrase->length < 2)
+		return true;
+
+	first		= positions[phrase->token_term[0]];
+	first_count = counts[phrase->token_term[0]];
+
+	for (s = 0; s < first_count; s++)
+	{
+		uint32 start = first[s];
+		uint32 prev	 = start;
+		int	   k;
+
+		for (k = 1; k < phrase->length; k++)
+		{
+			int	   t   = phrase->token_term[k];
+			uint32 gap = (uint32)(phrase->offsets[k] - phrase->offsets[k - 1]);
+			uint32 idx;
+
+			idx = positions_lower_bound(positions[t], counts[t], prev + gap);
+			if (idx == counts[t])
+				return false;
+			prev = positions[t][idx];
+		}
+
+		if (prev - start - (uint32)phrase->offsets[phrase->length - 1] <=
+			(uint32)phrase->slop)
+			return true;
+	}
+	return false;
+}
+
+bool
+tp_phrase_matches_document(
+		const TpPhrase *phrase,
+		char		  **doc_terms,
+		int32		   *doc_frequencies,
+		uint32		  **doc_positions,
+		int				doc_term_count)
+{
+	uint32 **positions;
+	uint32	*counts;
+	bool	 matches = true;
+	int		 i;
+	int		 j;
+
+	if (phrase->length < 2)
+		return true;
+
+	positions = palloc(phrase->nterms * sizeof(uint32 *));
+	counts	  = palloc(phrase->nterms * sizeof(uint32));
+
+	for (i = 0; i < phrase->nterms && matches; i++)
+	{
+		matches = false;
+		for (j = 0; j < doc_term_count; j++)
+		{
+			if (strcmp(doc_terms[j], phrase->lexemes[i]) == 0)
+			{
+				positions[i] = doc_positions[j];
+				counts[i]	 = (uint32)doc_frequencies[j];
+				matches		 = true;
+				break;
+			}
+		}
+	}
+
+	if (matches)
+		matches = tp_phrase_matches(phrase, positions, counts);
+
+	pfree(positions);
+	pfree(counts);
+	return matches;
+}
+
+void
+tp_phrase_missing_positions(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("index data has no token positions for phrase query"),
+			 errhint("REINDEX the index after setting positions = true.")));
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * phrase.h - Phrase and proximity matching
+ *
+ * A query phrase ("quick brown fox", optionally followed by ~N) is
+ * analyzed with the index's text search configuration into a token
+ * sequence.  A document matches if it contains the tokens in order
+ * with at most `slop` extra positions between the first and the last
+ * one beyond the gaps the phrase itself has.  Slop 0 is an exact
+ * phrase; stopwords keep their positions on both sides, so "state of
+ * the art" matches only with the same number of words in between.
+ *
+ * Phrase terms are always required terms of the query: scoring
+ * narrows the candidates first and positions are checked only for
+ * documents that could still enter the top-k.
+ */
+#pragma once
+
+#include <postgres.h>
+
+/*
+ * One parsed phrase.  The lexeme fields are filled by
+ * tp_phrase_analyze; until then length is 0.
+ */
+typedef struct TpPhrase
+{
+	char  *text; /* Phrase words as written */
+	int32  slop; /* Extra positions allowed, 0 for exact */
+	int	   length;	   /* Tokens after analysis */
+	int	   nterms;	   /* Distinct lexemes */
+	char **lexemes;	   /* Distinct lexemes [nterms] */
+	int	  *token_term; /* Per token: index into lexemes [length] */
+	int32 *offsets;	   /* Per token: position relative to token 0 */
+} TpPhrase;
+
+/* Largest accepted ~N, the largest tsvector position */
+#define TP_PHRASE_MAX_SLOP 16383
+
+extern TpPhrase *tp_phrase_create(const char *text, int len, int32 slop);
+
+/* Tokenize the phrase text with the given configuration */
+extern void tp_phrase_analyze(TpPhrase *phrase, Oid text_config_oid);
+
+/*
+ * Does a document match the phrase?  positions[t] / counts[t] are the
+ * document's ascending positions of lexeme t of the phrase.
+ */
+extern bool tp_phrase_matches(
+		const TpPhrase *phrase, uint32 *const *positions, const uint32 *counts);
+
+/*
+ * As tp_phrase_matches, looking the lexemes up in a tokenized document
+ * (tp_tokenize_text_with_positions output).
+ */
+extern bool tp_phrase_matches_document(
+		const TpPhrase *phrase,
+		char		  **doc_terms,
+		int32		   *doc_frequencies,
+		uint32		  **doc_positions,
+		int				doc_term_count);
+
+/*
+ * Raise the error for a posting that has no positions, i.e. one
+ * written before the index stored them.
+ */
+extern void tp_phrase_missing_positions(void);
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * prior.h - Static prior bonus added to BM25 scores
+ *
+ * A query with a prior weighting (TpQueryPrior) ranks by BM25 plus a
+ * bonus computed from each document's static prior (segment/prior.h).
+ * The bonus never decreases as the prior grows, so the bonus of the
+ * largest prior of a block or segment bounds the bonus of every
+ * document in it, and Block-Max WAND stays exact: a block is skipped
+ * only when its BM25 bound plus that bonus cannot reach the threshold.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <math.h>
+
+#include "types/query.h"
+
+/*
+ * Bonus of a document with the given prior; 0 without a prior
+ * weighting.  Linear: weight * Max(prior, 0).  Decay: weight halved
+ * for every half_life seconds the prior lies before the origin, and
+ * the full weight at or after it.
+ */
+static inline float4
+tp_prior_bonus(const TpQueryPrior *prior, float4 doc_prior)
+{
+	float8 age;
+
+	if (prior == NULL)
+		return 0.0f;
+	if (prior->half_life <= 0.0f)
+		return prior->weight * Max(doc_prior, 0.0f);
+
+	age = Max(prior->origin - (float8)doc_prior, 0.0);
+	return (float4)(prior->weight * pow(0.5, age / prior->half_life));
+}
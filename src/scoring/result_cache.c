@@ -0,0 +1,766 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * result_cache.c - Cross-backend cache of top-k query results
+ *
+ * See result_cache.h for the keying and invalidation rules.
+ */
+#include <postgres.h>
+
+#include <access/htup_details.h>
+#include <access/xlog.h>
+#include <common/hashfn.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <lib/dshash.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <storage/bufmgr.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/memutils.h>
+
+#include "constants.h"
+#include "index/metapage.h"
+#include "index/registry.h"
+#include "memtable/cache.h"
+#include "scoring/bm25.h"
+#include "scoring/bmw.h"
+#include "scoring/partition.h"
+#include "scoring/result_cache.h"
+#include "types/query.h"
+
+/*
+ * Largest share of the cache a single entry may take.  Bigger result
+ * sets (huge LIMITs) are not worth evicting everything else for.
+ */
+#define TP_RESULT_CACHE_ENTRY_DIVISOR 8
+
+/* Canonical query section marker (see canonical_query) */
+#define TP_RESULT_CACHE_SECTION UINT32_MAX
+
+/* GUC variables (registered in mod.c) */
+bool tp_result_cache_enabled = false;
+int	 tp_result_cache_size_kb = TP_DEFAULT_RESULT_CACHE_SIZE_KB;
+
+/*
+ * Hash key.  Field order avoids padding so dshash_memcmp/memhash see
+ * only meaningful bytes.
+ */
+typedef struct TpResultCacheKey
+{
+	Oid	   index_oid;
+	int32  limit;
+	uint64 query_hash; /* hash_bytes_extended of the canonical query */
+} TpResultCacheKey;
+
+/*
+ * Cache entry stored in the dshash.  The payload is one DSA chunk:
+ * canonical query bytes, then result ctids, then scores.
+ */
+typedef struct TpResultCacheEntry
+{
+	TpResultCacheKey	 key; /* Hash key - must be first */
+	TpResultCacheVersion version;
+	uint64				 last_used; /* Control clock at last hit/store */
+	dsa_pointer			 payload;
+	uint64				 charged_bytes; /* Entry + payload, as accounted */
+	uint32				 query_len;
+	int32				 result_count;
+} TpResultCacheEntry;
+
+/*
+ * Fixed shared-memory control block
+ */
+typedef struct TpResultCacheControl
+{
+	LWLock				lock; /* Table creation; serializes eviction */
+	dshash_table_handle table_handle;
+	pg_atomic_uint64	clock;	 /* LRU clock */
+	pg_atomic_uint64	bytes;	 /* Σ charged_bytes */
+	pg_atomic_uint64	entries; /* Live entries */
+	pg_atomic_uint64	hits;
+	pg_atomic_uint64	misses;
+} TpResultCacheControl;
+
+static TpResultCacheControl *result_cache_ctl = NULL;
+
+/* Backend-local attachment to the shared table */
+static dshash_table *result_cache_table = NULL;
+
+static void
+get_result_cache_params(dshash_parameters *params)
+{
+	params->key_size		 = sizeof(TpResultCacheKey);
+	params->entry_size		 = sizeof(TpResultCacheEntry);
+	params->compare_function = dshash_memcmp;
+	params->hash_function	 = dshash_memhash;
+	params->copy_function	 = dshash_memcpy;
+	params->tranche_id		 = TP_TRANCHE_RESULT_CACHE;
+}
+
+void
+tp_result_cache_shmem_request(void)
+{
+	RequestAddinShmemSpace(sizeof(TpResultCacheControl));
+}
+
+void
+tp_result_cache_shmem_startup(void)
+{
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	result_cache_ctl = ShmemInitStruct(
+			"Tapir Result Cache", sizeof(TpResultCacheControl), &found);
+
+	if (!found)
+	{
+		LWLockInitialize(
+				&result_cache_ctl->lock, TP_TRANCHE_RESULT_CACHE_LOCK);
+		result_cache_ctl->table_handle = DSHASH_HANDLE_INVALID;
+		pg_atomic_init_u64(&result_cache_ctl->clock, 0);
+		pg_atomic_init_u64(&result_cache_ctl->bytes, 0);
+		pg_atomic_init_u64(&result_cache_ctl->entries, 0);
+		pg_atomic_init_u64(&result_cache_ctl->hits, 0);
+		pg_atomic_init_u64(&result_cache_ctl->misses, 0);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	LWLockRegisterTranche(TP_TRANCHE_RESULT_CACHE_LOCK, "tapir_result_cache");
+	LWLockRegisterTranche(TP_TRANCHE_RESULT_CACHE, "tapir_result_cache_hash");
+}
+
+/*
+ * Attach to the shared table, creating it if `create` is set.
+ * Returns NULL if it does not exist yet and `create` is false.
+ */
+static dshash_table *
+result_cache_attach(bool create)
+{
+	dsa_area		 *dsa;
+	dshash_parameters params;
+	MemoryContext	  oldcontext;
+
+	if (result_cache_table != NULL)
+		return result_cache_table;
+
+	if (result_cache_ctl == NULL)
+		return NULL;
+
+	if (!create && result_cache_ctl->table_handle == DSHASH_HANDLE_INVALID)
+		return NULL;
+
+	dsa = tp_registry_get_dsa();
+	get_result_cache_params(&params);
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	LWLockAcquire(&result_cache_ctl->lock, LW_EXCLUSIVE);
+
+	if (result_cache_ctl->table_handle == DSHASH_HANDLE_INVALID)
+	{
+		if (create)
+		{
+			result_cache_table = dshash_create(dsa, &params, NULL);
+			result_cache_ctl->table_handle = dshash_get_hash_table_handle(
+					result_cache_table);
+		}
+	}
+	else
+		result_cache_table = dshash_attach(
+				dsa, &params, result_cache_ctl->table_handle, NULL);
+
+	LWLockRelease(&result_cache_ctl->lock);
+	MemoryContextSwitchTo(oldcontext);
+
+	return result_cache_table;
+}
+
+/* ---------- memory accounting ---------- */
+
+static uint64
+result_cache_cap_bytes(void)
+{
+	return (uint64)tp_result_cache_size_kb * 1024UL;
+}
+
+/*
+ * Charge entry bytes to our own counter and to the registry-wide
+ * counter that pg_textsearch.memory_limit is enforced against.
+ */
+static void
+account_add(uint64 bytes)
+{
+	pg_atomic_fetch_add_u64(&result_cache_ctl->bytes, bytes);
+	pg_atomic_fetch_add_u64(tp_registry_estimated_total_bytes(), bytes);
+}
+
+/* Symmetric with account_add; clamps like tp_cache_account_bytes_drain */
+static void
+account_sub(uint64 bytes)
+{
+	pg_atomic_uint64 *gp = tp_registry_estimated_total_bytes();
+	uint64			  cur;
+
+	cur = pg_atomic_read_u64(&result_cache_ctl->bytes);
+	pg_atomic_fetch_sub_u64(&result_cache_ctl->bytes, Min(bytes, cur));
+
+	cur = pg_atomic_read_u64(gp);
+	if (Min(bytes, cur) > 0)
+		pg_atomic_fetch_sub_u64(gp, Min(bytes, cur));
+}
+
+/*
+ * Would charging `bytes` more exceed our own cap or the global
+ * memory_limit?
+ */
+static bool
+over_budget(uint64 bytes)
+{
+	uint64 hard = tp_cache_global_hard_cap_bytes();
+
+	if (pg_atomic_read_u64(&result_cache_ctl->bytes) + bytes >
+		result_cache_cap_bytes())
+		return true;
+	return hard > 0 &&
+		   pg_atomic_read_u64(tp_registry_estimated_total_bytes()) + bytes >
+				   hard;
+}
+
+/*
+ * Free an entry's payload and release its accounting.  The caller
+ * removes the dshash entry itself.
+ */
+static void
+release_entry(TpResultCacheEntry *entry)
+{
+	dsa_free(tp_registry_get_dsa(), entry->payload);
+	account_sub(entry->charged_bytes);
+	pg_atomic_fetch_sub_u64(&result_cache_ctl->entries, 1);
+}
+
+/*
+ * Evict the least recently used entry.  Returns false once the table
+ * is empty.  Caller holds the control lock, so evictions do not race
+ * each other; lookups and stores may still remove the victim first.
+ */
+static bool
+evict_lru_entry(dshash_table *table)
+{
+	dshash_seq_status	status;
+	TpResultCacheEntry *entry;
+	TpResultCacheKey	victim;
+	uint64				oldest = PG_UINT64_MAX;
+	bool				found  = false;
+
+	dshash_seq_init(&status, table, false);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (entry->last_used < oldest)
+		{
+			oldest = entry->last_used;
+			victim = entry->key;
+			found  = true;
+		}
+	}
+	dshash_seq_term(&status);
+
+	if (!found)
+		return false;
+
+	entry = dshash_find(table, &victim, true);
+	if (entry != NULL)
+	{
+		release_entry(entry);
+		dshash_delete_entry(table, entry);
+	}
+	return true;
+}
+
+/* ---------- keys ---------- */
+
+static int
+compare_entry_views(const void *a, const void *b)
+{
+	const TpVectorEntryView *va = (const TpVectorEntryView *)a;
+	const TpVectorEntryView *vb = (const TpVectorEntryView *)b;
+	int						 cmp;
+
+	cmp = memcmp(va->lexeme, vb->lexeme, Min(va->lexeme_len, vb->lexeme_len));
+
+	if (cmp != 0)
+		return cmp;
+	if (va->lexeme_len != vb->lexeme_len)
+		return va->lexeme_len < vb->lexeme_len ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Append `vec` as (frequency, lexeme_len, lexeme) triples sorted by
+ * lexeme, so the bytes do not depend on entry order.
+ */
+static void
+append_canonical_vector(StringInfo buf, TpVector *vec)
+{
+	TpVectorEntryView *views;
+	TpVectorEntry	  *entry;
+	int				   i;
+
+	views = palloc(Max(vec->entry_count, 1) * sizeof(TpVectorEntryView));
+	entry = get_tpvector_first_entry(vec);
+	for (i = 0; i < vec->entry_count; i++)
+		entry = tpvector_entry_decode_advance(entry, &views[i]);
+
+	if (vec->entry_count > 1)
+		qsort(views,
+			  vec->entry_count,
+			  sizeof(TpVectorEntryView),
+			  compare_entry_views);
+
+	for (i = 0; i < vec->entry_count; i++)
+	{
+		appendBinaryStringInfo(
+				buf, (const char *)&views[i].frequency, sizeof(uint32));
+		appendBinaryStringInfo(
+				buf, (const char *)&views[i].lexeme_len, sizeof(uint32));
+		appendBinaryStringInfo(buf, views[i].lexeme, views[i].lexeme_len);
+	}
+
+	pfree(views);
+}
+
+/*
+ * Serialize a query independently of entry order and index name.
+ *
+ * `required` and `excluded` ("+word" / "-word", may be NULL) follow
+ * the scoring terms, each introduced by a (TP_RESULT_CACHE_SECTION,
+ * section number) pair.  No lexeme frequency reaches that value, so
+ * "+a b" and "a b" never serialize alike.  A positive
+ * min_should_match is appended the same way as section 2, and
+ * pg_textsearch.query_operators off as an empty section 3.
+ */
+static char *
+canonical_query(
+		TpVector *query,
+		TpVector *required,
+		TpVector *excluded,
+		int		  min_should_match,
+		uint32	 *len_out)
+{
+	StringInfoData buf;
+	TpVector	  *sections[2];
+	uint32		   i;
+
+	initStringInfo(&buf);
+	append_canonical_vector(&buf, query);
+
+	sections[0] = required;
+	sections[1] = excluded;
+	for (i = 0; i < lengthof(sections); i++)
+	{
+		uint32 marker = TP_RESULT_CACHE_SECTION;
+
+		if (sections[i] == NULL || sections[i]->entry_count == 0)
+			continue;
+		appendBinaryStringInfo(&buf, (const char *)&marker, sizeof(uint32));
+		appendBinaryStringInfo(&buf, (const char *)&i, sizeof(uint32));
+		append_canonical_vector(&buf, sections[i]);
+	}
+
+	if (min_should_match > 0)
+	{
+		uint32 marker  = TP_RESULT_CACHE_SECTION;
+		uint32 section = lengthof(sections);
+		uint32 value   = (uint32)min_should_match;
+
+		appendBinaryStringInfo(&buf, (const char *)&marker, sizeof(uint32));
+		appendBinaryStringInfo(&buf, (const char *)&section, sizeof(uint32));
+		appendBinaryStringInfo(&buf, (const char *)&value, sizeof(uint32));
+	}
+
+	if (!tp_query_operators)
+	{
+		uint32 marker  = TP_RESULT_CACHE_SECTION;
+		uint32 section = lengthof(sections) + 1;
+
+		appendBinaryStringInfo(&buf, (const char *)&marker, sizeof(uint32));
+		appendBinaryStringInfo(&buf, (const char *)&section, sizeof(uint32));
+	}
+
+	*len_out = buf.len;
+	return buf.data;
+}
+
+static void
+make_key(
+		TpResultCacheKey *key,
+		Oid				  index_oid,
+		int				  limit,
+		const char		 *canon,
+		uint32			  canon_len)
+{
+	memset(key, 0, sizeof(TpResultCacheKey));
+	key->index_oid	= index_oid;
+	key->limit		= limit;
+	key->query_hash = hash_bytes_extended(
+			(const unsigned char *)canon, (int)canon_len, 0);
+}
+
+static bool
+versions_equal(const TpResultCacheVersion *a, const TpResultCacheVersion *b)
+{
+	return a->meta_lsn == b->meta_lsn && a->tail_lsn == b->tail_lsn &&
+		   a->tail_blkno == b->tail_blkno &&
+		   a->spill_generation == b->spill_generation && a->epoch == b->epoch;
+}
+
+/* Payload layout: canonical query, ctids, scores */
+static inline Size
+payload_ctids_offset(uint32 query_len)
+{
+	return MAXALIGN(query_len);
+}
+
+static inline Size
+payload_scores_offset(uint32 query_len, int result_count)
+{
+	return MAXALIGN(
+			payload_ctids_offset(query_len) +
+			result_count * sizeof(ItemPointerData));
+}
+
+/* ---------- public API ---------- */
+
+/*
+ * The key holds the index, the limit and the canonical query, so every
+ * other input that can change a scan's top-k must be at its default:
+ * a non-default one disables caching rather than being assumed
+ * harmless.
+ */
+bool
+tp_result_cache_applicable(TpScanOpaque so, Relation index)
+{
+	/* A parallel participant holds only its share of the results */
+	if (so->parallel != NULL)
+		return false;
+
+	/* Query state the canonical query does not serialize */
+	if (so->phrases != NIL || so->allowed_tids != NULL || so->has_prior ||
+		so->term_weights != NULL)
+		return false;
+
+	/* Approximate scoring: inflated threshold or pruned terms */
+	if (tp_threshold_inflation > 1.0 || tp_term_pruning_epsilon > 0.0)
+		return false;
+
+	/* Statistics summed over the partitioned index, not this one */
+	if (tp_partition_stats_enabled(index))
+		return false;
+
+	/* A resumed scan's later batches start below the earlier ones */
+	if (so->cursor != NULL && so->cursor->active)
+		return false;
+
+	return true;
+}
+
+bool
+tp_result_cache_get_version(
+		Relation			  index,
+		TpLocalIndexState	 *index_state,
+		TpResultCacheVersion *version)
+{
+	Buffer buf;
+	Page   page;
+
+	if (!tp_result_cache_enabled || tp_result_cache_size_kb <= 0 ||
+		result_cache_ctl == NULL)
+		return false;
+
+	/* Standbys and unlogged indexes: see TpResultCacheVersion */
+	if (RecoveryInProgress() || !RelationNeedsWAL(index))
+		return false;
+
+	memset(version, 0, sizeof(TpResultCacheVersion));
+
+	buf = ReadBuffer(index, TP_METAPAGE_BLKNO);
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page				= BufferGetPage(buf);
+	version->meta_lsn	= PageGetLSN(page);
+	version->tail_blkno = tp_metapage_read_memtable_tail(page);
+	UnlockReleaseBuffer(buf);
+
+	if (version->tail_blkno != InvalidBlockNumber)
+	{
+		buf = ReadBuffer(index, version->tail_blkno);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		version->tail_lsn = PageGetLSN(BufferGetPage(buf));
+		UnlockReleaseBuffer(buf);
+	}
+
+	version->spill_generation = pg_atomic_read_u64(
+			&index_state->shared->spill_generation);
+	version->epoch = pg_atomic_read_u64(
+			&index_state->shared->result_cache_epoch);
+	return true;
+}
+
+bool
+tp_result_cache_lookup(
+		Oid							index_oid,
+		TpVector				   *query,
+		TpVector				   *required,
+		TpVector				   *excluded,
+		int							min_should_match,
+		int							limit,
+		const TpResultCacheVersion *version,
+		ItemPointer					ctids,
+		float4					  **scores,
+		int						   *result_count)
+{
+	dshash_table	   *table;
+	TpResultCacheEntry *entry;
+	TpResultCacheKey	key;
+	char			   *canon;
+	uint32				canon_len;
+	char			   *payload;
+	bool				hit = false;
+
+	table = result_cache_attach(false);
+	if (table == NULL)
+	{
+		pg_atomic_fetch_add_u64(&result_cache_ctl->misses, 1);
+		return false;
+	}
+
+	canon = canonical_query(
+			query, required, excluded, min_should_match, &canon_len);
+	make_key(&key, index_oid, limit, canon, canon_len);
+
+	entry = dshash_find(table, &key, true);
+	if (entry != NULL)
+	{
+		payload = dsa_get_address(tp_registry_get_dsa(), entry->payload);
+
+		if (!versions_equal(&entry->version, version))
+		{
+			/* The index changed since this was cached */
+			release_entry(entry);
+			dshash_delete_entry(table, entry);
+			entry = NULL;
+		}
+		else if (entry->query_len == canon_len &&
+				 memcmp(payload, canon, canon_len) == 0)
+		{
+			Assert(entry->result_count <= limit);
+
+			*result_count = entry->result_count;
+			*scores		  = palloc(limit * sizeof(float4));
+			memcpy(ctids,
+				   payload + payload_ctids_offset(canon_len),
+				   entry->result_count * sizeof(ItemPointerData));
+			memcpy(*scores,
+				   payload +
+						   payload_scores_offset(
+								   canon_len, entry->result_count),
+				   entry->result_count * sizeof(float4));
+			entry->last_used = pg_atomic_fetch_add_u64(
+					&result_cache_ctl->clock, 1);
+			hit = true;
+		}
+	}
+
+	if (entry != NULL)
+		dshash_release_lock(table, entry);
+	pfree(canon);
+
+	pg_atomic_fetch_add_u64(
+			hit ? &result_cache_ctl->hits : &result_cache_ctl->misses, 1);
+	return hit;
+}
+
+void
+tp_result_cache_store(
+		Oid							index_oid,
+		TpVector				   *query,
+		TpVector				   *required,
+		TpVector				   *excluded,
+		int							min_should_match,
+		int							limit,
+		const TpResultCacheVersion *version,
+		ItemPointer					ctids,
+		float4					   *scores,
+		int							result_count)
+{
+	dshash_table	   *table;
+	dsa_area		   *dsa;
+	TpResultCacheEntry *entry;
+	TpResultCacheKey	key;
+	dsa_pointer			payload_dp;
+	char			   *payload;
+	char			   *canon;
+	uint32				canon_len;
+	Size				payload_size;
+	uint64				charge;
+	bool				found;
+
+	canon = canonical_query(
+			query, required, excluded, min_should_match, &canon_len);
+	payload_size = payload_scores_offset(canon_len, result_count) +
+				   result_count * sizeof(float4);
+	charge		 = sizeof(TpResultCacheEntry) + payload_size;
+
+	if (charge > result_cache_cap_bytes() / TP_RESULT_CACHE_ENTRY_DIVISOR)
+	{
+		pfree(canon);
+		return;
+	}
+
+	table = result_cache_attach(true);
+
+	/* Make room; if another backend is already evicting, don't wait */
+	if (over_budget(charge) &&
+		LWLockConditionalAcquire(&result_cache_ctl->lock, LW_EXCLUSIVE))
+	{
+		while (over_budget(charge) && evict_lru_entry(table))
+			;
+		LWLockRelease(&result_cache_ctl->lock);
+	}
+	if (over_budget(charge))
+	{
+		pfree(canon);
+		return;
+	}
+
+	dsa		   = tp_registry_get_dsa();
+	payload_dp = dsa_allocate_extended(dsa, payload_size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(payload_dp))
+	{
+		pfree(canon);
+		return;
+	}
+
+	payload = dsa_get_address(dsa, payload_dp);
+	memcpy(payload, canon, canon_len);
+	memcpy(payload + payload_ctids_offset(canon_len),
+		   ctids,
+		   result_count * sizeof(ItemPointerData));
+	memcpy(payload + payload_scores_offset(canon_len, result_count),
+		   scores,
+		   result_count * sizeof(float4));
+
+	make_key(&key, index_oid, limit, canon, canon_len);
+	pfree(canon);
+
+	entry = dshash_find_or_insert(table, &key, &found);
+	if (found)
+		release_entry(entry); /* Concurrent store of the same key */
+
+	entry->version		 = *version;
+	entry->last_used	 = pg_atomic_fetch_add_u64(&result_cache_ctl->clock, 1);
+	entry->payload		 = payload_dp;
+	entry->charged_bytes = charge;
+	entry->query_len	 = canon_len;
+	entry->result_count	 = result_count;
+	account_add(charge);
+	pg_atomic_fetch_add_u64(&result_cache_ctl->entries, 1);
+
+	dshash_release_lock(table, entry);
+}
+
+/*
+ * Remove every entry for `index_oid`, or every entry at all when it
+ * is InvalidOid.
+ */
+static void
+remove_entries(Oid index_oid)
+{
+	dshash_table	   *table;
+	dshash_seq_status	status;
+	TpResultCacheEntry *entry;
+
+	table = result_cache_attach(false);
+	if (table == NULL)
+		return;
+
+	dshash_seq_init(&status, table, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (OidIsValid(index_oid) && entry->key.index_oid != index_oid)
+			continue;
+		release_entry(entry);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+void
+tp_result_cache_invalidate_index(Oid index_oid)
+{
+	Assert(OidIsValid(index_oid));
+	remove_entries(index_oid);
+}
+
+/* ---------- SQL interface ---------- */
+
+/*
+ * bm25_result_cache_stats() -> (hits, misses, entries, bytes)
+ */
+PG_FUNCTION_INFO_V1(bm25_result_cache_stats);
+
+Datum
+bm25_result_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum	  values[4];
+	bool	  nulls[4] = {false, false, false, false};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	if (result_cache_ctl == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_textsearch result cache is not initialized")));
+
+	values[0] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&result_cache_ctl->hits));
+	values[1] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&result_cache_ctl->misses));
+	values[2] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&result_cache_ctl->entries));
+	values[3] = Int64GetDatum(
+			(int64)pg_atomic_read_u64(&result_cache_ctl->bytes));
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+/*
+ * bm25_result_cache_reset() -> void
+ *
+ * Drops every cached result and zeroes the hit/miss counters.
+ */
+PG_FUNCTION_INFO_V1(bm25_result_cache_reset);
+
+Datum
+bm25_result_cache_reset(PG_FUNCTION_ARGS)
+{
+	(void)fcinfo;
+
+	if (result_cache_ctl == NULL)
+		PG_RETURN_VOID();
+
+	remove_entries(InvalidOid);
+	pg_atomic_write_u64(&result_cache_ctl->hits, 0);
+	pg_atomic_write_u64(&result_cache_ctl->misses, 0);
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * result_cache.h - Cross-backend cache of top-k query results
+ *
+ * Repeated queries against an unchanged index return the same
+ * (ctid, score) arrays, so the final results are kept in a dshash in
+ * the extension's global DSA and served without re-running BMW.
+ *
+ * Key: (index OID, limit, hash of the canonicalized query vectors,
+ * including any "+word" / "-word" terms, min_should_match and the
+ * pg_textsearch.query_operators setting that parsed them).  A scan
+ * whose results depend on anything else is not cached; see
+ * tp_result_cache_applicable.
+ * The canonical query bytes are stored with the entry so a hash
+ * collision is a miss, never a wrong answer.
+ *
+ * Each entry also records the index version it was computed against
+ * (TpResultCacheVersion).  A lookup whose current version differs
+ * drops the entry and counts as a miss, so there is no explicit
+ * invalidation on insert, spill, or merge.
+ *
+ * Entry memory is charged to pg_textsearch.result_cache_size and to
+ * the registry-wide estimated_total_bytes counter, i.e. it counts
+ * against pg_textsearch.memory_limit alongside the memtable cache.
+ * Least-recently-used entries are evicted to stay under the cap.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <access/xlogdefs.h>
+#include <storage/block.h>
+#include <storage/itemptr.h>
+#include <utils/rel.h>
+
+#include "access/am.h"
+#include "index/state.h"
+#include "types/vector.h"
+
+/*
+ * Default for pg_textsearch.result_cache_size (in kilobytes).  Kept
+ * well under the memory_limit global soft cap (memory_limit / 2) so
+ * cached results do not push the memtable cache into eviction.
+ */
+#define TP_DEFAULT_RESULT_CACHE_SIZE_KB (64 * 1024)
+
+/*
+ * Index version a cached result was computed against.
+ *
+ * - meta_lsn changes whenever the metapage does: segment chain heads
+ *   (spill, merge, VACUUM drop), memtable head/tail, corpus totals.
+ * - tail_blkno / tail_lsn change on every append to the on-disk
+ *   memtable chain, which is where inserts land.
+ * - spill_generation is the memtable cache's own invalidation token.
+ * - epoch is bumped by VACUUM after it flips alive bits in place,
+ *   which touches neither the metapage nor the memtable.
+ *
+ * Page LSNs are only maintained for WAL-logged relations, so caching
+ * is disabled for unlogged and temporary indexes.
+ */
+typedef struct TpResultCacheVersion
+{
+	XLogRecPtr	meta_lsn;
+	XLogRecPtr	tail_lsn;
+	BlockNumber tail_blkno;
+	uint64		spill_generation;
+	uint64		epoch;
+} TpResultCacheVersion;
+
+/* GUCs (mod.c) */
+extern bool tp_result_cache_enabled;
+extern int	tp_result_cache_size_kb;
+
+/* Shared memory hooks (mod.c) */
+extern void tp_result_cache_shmem_request(void);
+extern void tp_result_cache_shmem_startup(void);
+
+/*
+ * Whether the results of scan `so` of `index` depend only on what the
+ * cache key holds, so they may be looked up and stored.
+ */
+extern bool tp_result_cache_applicable(TpScanOpaque so, Relation index);
+
+/*
+ * Capture the current version of `index`.  Returns false when results
+ * for this index must not be cached (cache disabled, hot standby, or
+ * an index without WAL).  Must be called under the per-index lock and
+ * before the memtable source is opened, so any later insert shows up
+ * as a version change.
+ */
+extern bool tp_result_cache_get_version(
+		Relation			  index,
+		TpLocalIndexState	 *index_state,
+		TpResultCacheVersion *version);
+
+/*
+ * Look up cached results.  `required` and `excluded` are the query's
+ * "+word" / "-word" vectors, or NULL; `min_should_match` is 0 if
+ * unset.  On a hit copies up to `limit` ctids into `ctids`, pallocs
+ * `*scores` (limit entries, like tp_score_documents), sets
+ * `*result_count`, and returns true.
+ */
+extern bool tp_result_cache_lookup(
+		Oid							index_oid,
+		TpVector				   *query,
+		TpVector				   *required,
+		TpVector				   *excluded,
+		int							min_should_match,
+		int							limit,
+		const TpResultCacheVersion *version,
+		ItemPointer					ctids,
+		float4					  **scores,
+		int						   *result_count);
+
+/* Store freshly scored results (best effort; silently skips on OOM) */
+extern void tp_result_cache_store(
+		Oid							index_oid,
+		TpVector				   *query,
+		TpVector				   *required,
+		TpVector				   *excluded,
+		int							min_should_match,
+		int							limit,
+		const TpResultCacheVersion *version,
+		ItemPointer					ctids,
+		float4					   *scores,
+		int							result_count);
+
+/* Drop every cached result for `index_oid` (VACUUM, DROP INDEX) */
+extern void tp_result_cache_invalidate_index(Oid index_oid);
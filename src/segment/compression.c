@@ -195,9 +195,11 @@ bitpack_decode(const uint8 *in, uint32 count, uint8 bits, uint32 *out)
  * 2. Find max delta and max frequency to determine bit widths
  * 3. Bitpack deltas and frequencies
  * 4. Copy fieldnorms as-is
+ * 5. Copy impacts as-is, if the block carries them
  */
 uint32
-tp_compress_block(TpBlockPosting *postings, uint32 count, uint8 *out_buf)
+tp_compress_block(
+		TpBlockPosting *postings, uint32 count, bool impacts, uint8 *out_buf)
 {
 	TpCompressedBlockHeader *header;
 	uint32					*doc_deltas;
@@ -252,6 +254,13 @@ tp_compress_block(TpBlockPosting *postings, uint32 count, uint8 *out_buf)
 	for (i = 0; i < count; i++)
 		out_buf[out_pos++] = postings[i].fieldnorm;
 
+	/* Copy impacts as-is (1 byte each) */
+	if (impacts)
+	{
+		for (i = 0; i < count; i++)
+			out_buf[out_pos++] = postings[i].impact;
+	}
+
 	pfree(doc_deltas);
 	pfree(frequencies);
 
@@ -274,6 +283,7 @@ tp_decompress_block(
 		const uint8	   *compressed,
 		uint32			count,
 		uint32			first_doc_id,
+		bool			impacts,
 		TpBlockPosting *out_postings)
 {
 	const TpCompressedBlockHeader *header;
@@ -336,7 +346,7 @@ tp_decompress_block(
 		out_postings[i].doc_id	  = doc_id;
 		out_postings[i].frequency = (uint16)frequencies[i];
 		out_postings[i].fieldnorm = compressed[pos + i];
-		out_postings[i].reserved  = 0;
+		out_postings[i].impact	  = impacts ? compressed[pos + count + i] : 0;
 
 		prev_doc = doc_id;
 	}
@@ -346,7 +356,7 @@ tp_decompress_block(
  * Get the size of compressed data.
  */
 uint32
-tp_compressed_block_size(const uint8 *compressed, uint32 count)
+tp_compressed_block_size(const uint8 *compressed, uint32 count, bool impacts)
 {
 	const TpCompressedBlockHeader *header;
 	uint32						   doc_id_bytes;
@@ -359,5 +369,6 @@ tp_compressed_block_size(const uint8 *compressed, uint32 count)
 	doc_id_bytes = (count * header->doc_id_bits + 7) / 8;
 	freq_bytes	 = (count * header->freq_bits + 7) / 8;
 
-	return sizeof(TpCompressedBlockHeader) + doc_id_bytes + freq_bytes + count;
+	return sizeof(TpCompressedBlockHeader) + doc_id_bytes + freq_bytes + count +
+		   (impacts ? count : 0);
 }
@@ -17,6 +17,7 @@
 /*
  * Compressed block header - stored at start of compressed block data.
  * Total: 2 bytes header + variable packed data + 128 bytes fieldnorms
+ * (+ 128 bytes impacts in blocks flagged TP_BLOCK_FLAG_IMPACTS)
  */
 typedef struct TpCompressedBlockHeader
 {
@@ -42,6 +43,18 @@ StaticAssertDecl(
 						TP_BLOCK_SIZE, /* fieldnorms (1 byte each) */
 		"TP_MAX_COMPRESSED_BLOCK_SIZE too small for worst-case compression");
 
+/* Maximum size of a compressed block that also carries impacts */
+#define TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE \
+	(TP_MAX_COMPRESSED_BLOCK_SIZE + TP_BLOCK_SIZE)
+
+/* Bytes to read for a compressed block with the given skip entry flags */
+static inline uint32
+tp_compressed_block_read_size(uint8 flags)
+{
+	return (flags & TP_BLOCK_FLAG_IMPACTS) ? TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE
+										   : TP_MAX_COMPRESSED_BLOCK_SIZE;
+}
+
 /*
  * Compression functions
  */
@@ -64,9 +77,10 @@ extern uint8 tp_compute_bit_width(uint32 max_value);
  *   [ceil(count * doc_id_bits / 8) bytes: bitpacked doc ID deltas]
  *   [ceil(count * freq_bits / 8) bytes: bitpacked frequencies]
  *   [count bytes: fieldnorms (uncompressed)]
+ *   [count bytes: impacts, only if impacts is true]
  */
-extern uint32
-tp_compress_block(TpBlockPosting *postings, uint32 count, uint8 *out_buf);
+extern uint32 tp_compress_block(
+		TpBlockPosting *postings, uint32 count, bool impacts, uint8 *out_buf);
 
 /*
  * Decompress a block of postings.
@@ -77,15 +91,19 @@ tp_compress_block(TpBlockPosting *postings, uint32 count, uint8 *out_buf);
  * first_doc_id: The first absolute doc ID for this block (from skip entry
  *               or previous block's last_doc_id + 1). For the first block
  *               of a term, this is 0.
+ * impacts: the block carries impacts (TP_BLOCK_FLAG_IMPACTS); otherwise
+ *          every posting's impact is set to 0.
  */
 extern void tp_decompress_block(
 		const uint8	   *compressed,
 		uint32			count,
 		uint32			first_doc_id,
+		bool			impacts,
 		TpBlockPosting *out_postings);
 
 /*
  * Get the size of compressed data (for validation/debugging).
  * Parses header to compute actual size without decompressing.
  */
-extern uint32 tp_compressed_block_size(const uint8 *compressed, uint32 count);
+extern uint32 tp_compressed_block_size(
+		const uint8 *compressed, uint32 count, bool impacts);
@@ -11,6 +11,7 @@
 #include "constants.h"
 #include "segment/dictionary.h"
 #include "segment/io.h"
+#include "types/vector.h"
 
 /*
  * Free dictionary's term strings.
@@ -38,36 +39,125 @@ tp_free_dictionary(TermInfo *terms, uint32 num_terms)
 }
 
 /*
- * Read a term string from a segment's string pool at a given dictionary
- * index. Returns a palloc'd string that must be freed by the caller.
+ * Start a front-coded dictionary of num_terms terms
  */
-char *
-tp_segment_read_term_at_index(
-		TpSegmentReader *reader,
-		TpSegmentHeader *header,
-		uint32			*string_offsets,
-		uint32			 index)
+void
+tp_dict_builder_init(TpDictBuilder *builder, uint32 num_terms)
+{
+	memset(builder, 0, sizeof(TpDictBuilder));
+	builder->num_terms	= num_terms;
+	builder->num_blocks = (num_terms + TP_DICT_BLOCK_TERMS - 1) /
+						  TP_DICT_BLOCK_TERMS;
+	builder->block_offsets =
+			palloc((builder->num_blocks + 1) * sizeof(uint32));
+	builder->first_term_offsets =
+			palloc((builder->num_blocks + 1) * sizeof(uint32));
+	initStringInfo(&builder->blocks);
+	initStringInfo(&builder->first_terms);
+	initStringInfo(&builder->prev_term);
+}
+
+/*
+ * Append the next term; terms must arrive in strcmp order
+ */
+void
+tp_dict_builder_add(TpDictBuilder *builder, const char *term, uint32 term_len)
+{
+	uint32 prefix = 0;
+	uint8  varint[5];
+
+	Assert(builder->num_added < builder->num_terms);
+
+	if (builder->num_added % TP_DICT_BLOCK_TERMS == 0)
+	{
+		uint32 block = builder->num_added / TP_DICT_BLOCK_TERMS;
+
+		/* A block starts with a whole term, also kept in the index */
+		builder->block_offsets[block]	   = builder->blocks.len;
+		builder->first_term_offsets[block] = builder->first_terms.len;
+		appendBinaryStringInfo(&builder->first_terms, term, term_len);
+	}
+	else
+	{
+		uint32 max_prefix = Min((uint32)builder->prev_term.len, term_len);
+
+		while (prefix < max_prefix &&
+			   builder->prev_term.data[prefix] == term[prefix])
+			prefix++;
+	}
+
+	appendBinaryStringInfo(
+			&builder->blocks,
+			(char *)varint,
+			tpvector_varint_encode(prefix, varint));
+	appendBinaryStringInfo(
+			&builder->blocks,
+			(char *)varint,
+			tpvector_varint_encode(term_len - prefix, varint));
+	appendBinaryStringInfo(&builder->blocks, term + prefix, term_len - prefix);
+
+	resetStringInfo(&builder->prev_term);
+	appendBinaryStringInfo(&builder->prev_term, term, term_len);
+	builder->num_added++;
+}
+
+/*
+ * Lay out the term index once every term has been added
+ */
+void
+tp_dict_builder_finish(TpDictBuilder *builder)
 {
-	uint64 string_offset;
-	uint32 length;
-	char  *term;
+	TpDictIndex dict_index;
 
-	string_offset = header->strings_offset + string_offsets[index];
+	Assert(builder->num_added == builder->num_terms);
 
-	/* Read string length */
-	tp_segment_read(reader, string_offset, &length, sizeof(uint32));
+	/* Final offsets mark the end of the blocks and of the pool */
+	builder->block_offsets[builder->num_blocks] = builder->blocks.len;
+	builder->first_term_offsets[builder->num_blocks] =
+			builder->first_terms.len;
 
-	if (length > TP_MAX_TERM_LENGTH)
-		ereport(ERROR,
-				(errcode(ERRCODE_DATA_CORRUPTED),
-				 errmsg("corrupt segment: term length %u exceeds "
-						"maximum",
-						length)));
+	dict_index.num_terms  = builder->num_terms;
+	dict_index.num_blocks = builder->num_blocks;
+
+	initStringInfo(&builder->index);
+	appendBinaryStringInfo(
+			&builder->index, (char *)&dict_index, sizeof(TpDictIndex));
+	appendBinaryStringInfo(
+			&builder->index,
+			(char *)builder->block_offsets,
+			(builder->num_blocks + 1) * sizeof(uint32));
+	appendBinaryStringInfo(
+			&builder->index,
+			(char *)builder->first_term_offsets,
+			(builder->num_blocks + 1) * sizeof(uint32));
+	appendBinaryStringInfo(
+			&builder->index,
+			builder->first_terms.data,
+			builder->first_terms.len);
+}
 
-	/* Allocate and read string */
-	term = palloc(length + 1);
-	tp_segment_read(reader, string_offset + sizeof(uint32), term, length);
-	term[length] = '\0';
+void
+tp_dict_builder_free(TpDictBuilder *builder)
+{
+	pfree(builder->block_offsets);
+	pfree(builder->first_term_offsets);
+	pfree(builder->blocks.data);
+	pfree(builder->first_terms.data);
+	pfree(builder->prev_term.data);
+	if (builder->index.data)
+		pfree(builder->index.data);
+}
+
+/*
+ * Read a term string from a segment's dictionary at a given index.
+ * Returns a palloc'd string that must be freed by the caller.
+ */
+char *
+tp_segment_read_term_at_index(TpSegmentReader *reader, uint32 index)
+{
+	char  *buf		= NULL;
+	uint32 buf_size = 0;
 
-	return term;
+	(void)tp_segment_read_term(reader, index, &buf, &buf_size);
+	return buf;
 }
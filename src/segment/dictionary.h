@@ -7,6 +7,7 @@
 #pragma once
 
 #include "postgres.h"
+#include "lib/stringinfo.h"
 #include "storage/itemptr.h"
 
 /* Forward declarations */
@@ -31,6 +32,13 @@ typedef struct TermInfo
 	uint32			 count;			 /* Length of ctids/freqs */
 	uint32			 doc_freq;		 /* Document frequency (used for IDF) */
 	uint32			 dict_entry_idx; /* Index in dict_entries array */
+
+	/*
+	 * Token positions, NULL unless the index stores them: posting j's
+	 * positions are positions[position_starts[j] .. position_starts[j+1]).
+	 */
+	uint32 *positions;
+	uint32 *position_starts; /* count + 1 entries */
 } TermInfo;
 
 /*
@@ -42,9 +50,31 @@ typedef struct TermInfo
  */
 extern void tp_free_dictionary(TermInfo *terms, uint32 num_terms);
 
-/* Shared term-reading helper */
-extern char *tp_segment_read_term_at_index(
-		struct TpSegmentReader *reader,
-		struct TpSegmentHeader *header,
-		uint32				   *string_offsets,
-		uint32					index);
+/*
+ * Front-coded dictionary builder (V6, see TpDictIndex in format.h).
+ * Writers add a segment's terms in sorted order, finish, then write
+ * `index` at dictionary_offset and `blocks` at strings_offset.
+ */
+typedef struct TpDictBuilder
+{
+	StringInfoData index;		/* TpDictIndex, offset arrays, first terms */
+	StringInfoData blocks;		/* Front-coded term blocks */
+	StringInfoData first_terms; /* First-term pool */
+	StringInfoData prev_term;	/* Last term added */
+
+	uint32	num_terms;			/* Expected number of terms */
+	uint32	num_added;
+	uint32	num_blocks;
+	uint32 *block_offsets;		/* num_blocks + 1 */
+	uint32 *first_term_offsets; /* num_blocks + 1 */
+} TpDictBuilder;
+
+extern void tp_dict_builder_init(TpDictBuilder *builder, uint32 num_terms);
+extern void tp_dict_builder_add(
+		TpDictBuilder *builder, const char *term, uint32 term_len);
+extern void tp_dict_builder_finish(TpDictBuilder *builder);
+extern void tp_dict_builder_free(TpDictBuilder *builder);
+
+/* Shared term-reading helper: palloc'd copy of term `index` */
+extern char *
+tp_segment_read_term_at_index(struct TpSegmentReader *reader, uint32 index);
@@ -64,9 +64,11 @@ tp_docmap_create(void)
 	builder->num_docs	  = 0;
 	builder->capacity	  = 0;
 	builder->finalized	  = false;
+	builder->has_priors	  = false;
 	builder->ctid_pages	  = NULL;
 	builder->ctid_offsets = NULL;
 	builder->fieldnorms	  = NULL;
+	builder->priors		  = NULL;
 	builder->total_tokens = 0;
 
 	return builder;
@@ -100,12 +102,30 @@ tp_docmap_add(TpDocMapBuilder *builder, ItemPointer ctid, uint32 doc_length)
 	/* New document - assign next sequential ID */
 	entry->doc_id	  = builder->num_docs;
 	entry->doc_length = doc_length;
+	entry->prior	  = 0.0f;
 	builder->num_docs++;
 	builder->total_tokens += doc_length;
 
 	return entry->doc_id;
 }
 
+void
+tp_docmap_set_prior(TpDocMapBuilder *builder, ItemPointer ctid, float4 prior)
+{
+	TpDocMapEntry *entry;
+
+	Assert(!builder->finalized);
+
+	entry = (TpDocMapEntry *)
+			hash_search(builder->ctid_to_id, ctid, HASH_FIND, NULL);
+	Assert(entry != NULL);
+	if (entry == NULL)
+		return;
+
+	entry->prior		= prior;
+	builder->has_priors = true;
+}
+
 uint32
 tp_docmap_lookup(TpDocMapBuilder *builder, ItemPointer ctid)
 {
@@ -185,6 +205,9 @@ tp_docmap_finalize(TpDocMapBuilder *builder)
 	builder->ctid_pages	  = palloc(sizeof(BlockNumber) * builder->num_docs);
 	builder->ctid_offsets = palloc(sizeof(OffsetNumber) * builder->num_docs);
 	builder->fieldnorms	  = palloc(sizeof(uint8) * builder->num_docs);
+	if (builder->has_priors)
+		builder->priors = palloc_extended(
+				sizeof(float4) * builder->num_docs, MCXT_ALLOC_HUGE);
 
 	/*
 	 * Fill arrays and reassign doc_ids in CTID order.
@@ -199,6 +222,8 @@ tp_docmap_finalize(TpDocMapBuilder *builder)
 		builder->ctid_offsets[i] = ItemPointerGetOffsetNumber(
 				&entries[i].ctid);
 		builder->fieldnorms[i] = encode_fieldnorm(entries[i].doc_length);
+		if (builder->priors)
+			builder->priors[i] = entries[i].prior;
 
 		/* Update hash table entry with new doc_id */
 		hash_entry = (TpDocMapEntry *)hash_search(
@@ -229,5 +254,8 @@ tp_docmap_destroy(TpDocMapBuilder *builder)
 	if (builder->fieldnorms)
 		pfree(builder->fieldnorms);
 
+	if (builder->priors)
+		pfree(builder->priors);
+
 	pfree(builder);
 }
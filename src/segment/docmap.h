@@ -30,6 +30,7 @@ typedef struct TpDocMapEntry
 	ItemPointerData ctid;		/* Key: heap tuple location */
 	uint32			doc_id;		/* Value: segment-local doc ID */
 	uint32			doc_length; /* Document length (for fieldnorm) */
+	float4			prior;		/* Static prior (see segment/prior.h) */
 } TpDocMapEntry;
 
 /*
@@ -42,11 +43,13 @@ typedef struct TpDocMapBuilder
 	uint32 num_docs;   /* Number of documents assigned */
 	uint32 capacity;   /* Current capacity of arrays */
 	bool   finalized;  /* True after tp_docmap_finalize called */
+	bool   has_priors; /* tp_docmap_set_prior was called */
 
 	/* Output arrays (indexed by doc_id, valid after finalize) */
 	BlockNumber	 *ctid_pages;	/* doc_id → page number (4 bytes) */
 	OffsetNumber *ctid_offsets; /* doc_id → tuple offset (2 bytes) */
 	uint8		 *fieldnorms;	/* doc_id → encoded length (1 byte) */
+	float4		 *priors;		/* doc_id → static prior, NULL if none */
 
 	/* Sum of per-doc token counts; used for segment.total_tokens. */
 	uint64 total_tokens;
@@ -67,6 +70,13 @@ extern TpDocMapBuilder *tp_docmap_create(void);
 extern uint32
 tp_docmap_add(TpDocMapBuilder *builder, ItemPointer ctid, uint32 doc_length);
 
+/*
+ * Set the static prior of a document already added.  A builder whose
+ * priors are never set produces a segment without a prior table.
+ */
+extern void
+tp_docmap_set_prior(TpDocMapBuilder *builder, ItemPointer ctid, float4 prior);
+
 /*
  * Look up doc_id for a CTID using hash table.
  * Returns UINT32_MAX if not found.
@@ -75,7 +85,7 @@ extern uint32 tp_docmap_lookup(TpDocMapBuilder *builder, ItemPointer ctid);
 
 /*
  * Finalize the document map.
- * Builds the ctid arrays and fieldnorms array sorted by doc_id.
+ * Builds the ctid arrays, fieldnorms and priors arrays sorted by doc_id.
  * After this call, the hash table is no longer needed.
  */
 extern void tp_docmap_finalize(TpDocMapBuilder *builder);
@@ -41,7 +41,8 @@ typedef struct TpPageIndexSpecial
  */
 #define TP_SEGMENT_FORMAT_VERSION_3 3 /* Legacy: uint32 offsets */
 #define TP_SEGMENT_FORMAT_VERSION_4 4 /* Legacy: no alive bitset */
-#define TP_SEGMENT_FORMAT_VERSION	5 /* Current: alive bitset */
+#define TP_SEGMENT_FORMAT_VERSION_5 5 /* Legacy: flat dictionary (1.3.x) */
+#define TP_SEGMENT_FORMAT_VERSION	6 /* Current: 1.4.0, see TpSegmentHeader */
 
 /*
  * V3 legacy segment header - preserved for reading old segments.
@@ -98,7 +99,14 @@ typedef struct TpSegmentHeaderV4
 } TpSegmentHeaderV4;
 
 /*
- * Segment header - stored on the first page (V5: alive bitset)
+ * Segment header - stored on the first page (V6)
+ *
+ * V6 adds per-term score bounds, optional per-block positions (see
+ * TpSkipEntry), quantized impacts and static priors, and a front-coded
+ * dictionary (see TpDictIndex).  V5 headers are this struct without
+ * the fields after page_index; every other field sits at the same
+ * offset, so in-place patches of V5 headers (next_segment,
+ * alive_count) stay valid.
  */
 typedef struct TpSegmentHeader
 {
@@ -136,10 +144,22 @@ typedef struct TpSegmentHeader
 
 	/* Page index reference */
 	BlockNumber page_index; /* First page of the page index */
+
+	/* Per-term score bounds (V6+, 0 if absent) */
+	uint64 term_bounds_offset; /* Offset to TpTermBounds array */
+
+	/* Quantized impacts (V6+, 0 if absent; see segment/impact.h) */
+	uint64 block_impacts_offset; /* Offset to per-block max impacts */
+	float4 impact_avg_doc_len;	 /* Avg doc length impacts assume */
+
+	/* Static per-document priors (V6+, 0 if absent; see segment/prior.h) */
+	uint64 prior_offset;		/* Offset to float4 prior per doc ID */
+	uint64 block_priors_offset; /* Offset to per-block max priors */
+	float4 max_prior;			/* Largest prior in the segment */
 } TpSegmentHeader;
 
 /*
- * Dictionary structure for fast term lookup
+ * Dictionary structure for fast term lookup (V5 and older)
  *
  * The dictionary is a sorted array of string offsets, enabling binary search.
  * Each string is stored as:
@@ -154,15 +174,11 @@ typedef struct TpDictionary
 } TpDictionary;
 
 /*
- * String entry in string pool
+ * String entry in string pool (V5 and older)
  *
- * TODO: Optimize storage for short strings. Current overhead is 8 bytes per
- * term (4-byte length + 4-byte dict_entry_offset). Since most stemmed terms
- * are short (3-10 chars), this overhead is significant. Options:
- * - Use 1-byte length (terms rarely > 255 chars), saves 3 bytes/term
- * - Eliminate dict_entry_offset by computing from term index, saves 4
- *   bytes/term
- * - Use varint encoding for length
+ * The overhead is 8 bytes per term (4-byte length + 4-byte
+ * dict_entry_offset), and a binary search reads an offset and a string
+ * per probe, on scattered pages.  V6 replaces both with TpDictIndex.
  */
 typedef struct TpStringEntry
 {
@@ -171,6 +187,39 @@ typedef struct TpStringEntry
 	/* Immediately after text: uint32 dict_entry_offset */
 } TpStringEntry;
 
+/*
+ * Front-coded dictionary (V6+)
+ *
+ * Terms are stored in blocks of TP_DICT_BLOCK_TERMS, the string pool at
+ * strings_offset.  Each term of a block is
+ *
+ *   varint(prefix_len) varint(suffix_len) suffix
+ *
+ * where prefix_len is the number of leading bytes it shares with the
+ * term before it; a block's first term has prefix_len 0, so a block
+ * decodes on its own.  Most stemmed terms share a prefix with their
+ * neighbour, so a term costs a few bytes.
+ *
+ * The term index at dictionary_offset is a TpDictIndex followed by
+ *
+ *   uint32 block_offsets[num_blocks + 1]       from strings_offset
+ *   uint32 first_term_offsets[num_blocks + 1]  into the first-term pool
+ *   first-term pool                            first terms, concatenated
+ *
+ * with a final offset marking the end of each.  A lookup binary-searches
+ * the first terms, which are num_terms / TP_DICT_BLOCK_TERMS entries
+ * long and packed on a few pages, then reads and decodes one block.
+ * Term idx's TpDictEntry is at entries_offset + idx * sizeof(TpDictEntry),
+ * so no per-term pointer is stored.
+ */
+#define TP_DICT_BLOCK_TERMS 64
+
+typedef struct TpDictIndex
+{
+	uint32 num_terms;  /* Number of terms in dictionary (as TpDictionary) */
+	uint32 num_blocks; /* ceil(num_terms / TP_DICT_BLOCK_TERMS) */
+} TpDictIndex;
+
 /*
  * V3 legacy dictionary entry - 12 bytes
  */
@@ -202,6 +251,22 @@ typedef struct TpDictEntry
 	uint32 doc_freq;		  /* Document frequency for IDF */
 } __attribute__((aligned(8))) TpDictEntry;
 
+/*
+ * Per-term score bounds (V6+) - 4 bytes, one per dictionary entry
+ *
+ * A dense array parallel to the TpDictEntry array.  max_tf and
+ * min_fieldnorm are taken over all of the term's blocks, so they give
+ * a segment-wide BM25 upper bound for the term without reading its
+ * skip index.  max_impact is the largest quantized impact of the
+ * term's postings, 0 if the segment has none.
+ */
+typedef struct TpTermBounds
+{
+	uint16 max_tf;		  /* Max term frequency over all postings */
+	uint8  min_fieldnorm; /* Min fieldnorm (shortest doc) */
+	uint8  max_impact;	  /* Max quantized impact, 0 if absent */
+} TpTermBounds;
+
 /*
  * Block storage constants
  */
@@ -234,15 +299,33 @@ typedef struct TpSkipEntry
 	uint16 block_max_tf;   /* Max term frequency in block (for BMW) */
 	uint8  block_max_norm; /* Min fieldnorm in block (shortest doc, for BMW) */
 	uint64 posting_offset; /* Byte offset from segment start to block data */
-	uint8  flags;		   /* Compression type, etc. */
-	uint8  reserved[3];	   /* Future use */
+	uint8  flags;		   /* Compression type, positions bit */
+	uint8  reserved[3];	   /* Block byte length if positions present */
 } __attribute__((packed)) TpSkipEntry;
 
-/* Skip entry flags */
-#define TP_BLOCK_FLAG_UNCOMPRESSED 0x00 /* Raw doc IDs and frequencies */
-#define TP_BLOCK_FLAG_DELTA		   0x01 /* Delta-encoded doc IDs */
-#define TP_BLOCK_FLAG_FOR		   0x02 /* Frame-of-reference (Phase 3) */
-#define TP_BLOCK_FLAG_PFOR		   0x03 /* Patched FOR (Phase 3) */
+/*
+ * Skip entry flags.  The low bits hold the compression type; mask
+ * with TP_BLOCK_FLAG_COMPRESSION_MASK before comparing.
+ *
+ * TP_BLOCK_FLAG_POSITIONS (V6+) means a positions stream follows the
+ * posting block: reserved[] then holds the block's byte length (24-bit,
+ * little-endian) so readers can find the stream without decoding the
+ * block.  The stream is a uint32 byte length followed by one entry per
+ * posting in block order; see segment/positions.h.
+ *
+ * TP_BLOCK_FLAG_IMPACTS (V6+) means every posting of the block carries
+ * its quantized impact: in TpBlockPosting.impact when uncompressed,
+ * after the fieldnorms when compressed (see segment/compression.h).
+ * Such segments also store each block's largest impact in a byte array
+ * parallel to the skip index, at header block_impacts_offset.
+ */
+#define TP_BLOCK_FLAG_UNCOMPRESSED	   0x00 /* Raw doc IDs and frequencies */
+#define TP_BLOCK_FLAG_DELTA			   0x01 /* Delta-encoded doc IDs */
+#define TP_BLOCK_FLAG_FOR			   0x02 /* Frame-of-reference (Phase 3) */
+#define TP_BLOCK_FLAG_PFOR			   0x03 /* Patched FOR (Phase 3) */
+#define TP_BLOCK_FLAG_IMPACTS		   0x40 /* Postings carry impacts */
+#define TP_BLOCK_FLAG_POSITIONS		   0x80 /* Positions stream follows */
+#define TP_BLOCK_FLAG_COMPRESSION_MASK 0x3F
 
 /*
  * Block posting entry - 8 bytes, used in uncompressed blocks
@@ -260,7 +343,7 @@ typedef struct TpBlockPosting
 	uint32 doc_id;	  /* Segment-local document ID */
 	uint16 frequency; /* Term frequency in document */
 	uint8  fieldnorm; /* Quantized document length (Lucene SmallFloat) */
-	uint8  reserved;  /* Padding for alignment */
+	uint8  impact;	  /* Quantized BM25 impact (V6), 0 if absent */
 } TpBlockPosting;
 
 /*
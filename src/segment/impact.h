@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * impact.h - Quantized per-posting BM25 impacts
+ *
+ * Indexes created WITH (impacts = true) store, for every posting, the
+ * BM25 term-frequency component
+ *
+ *   w = tf * (k1 + 1) / (tf + k1 * (1 - b + b * dl / avgdl))
+ *
+ * quantized to one byte against the segment's own average document
+ * length, plus the largest such byte of every block (format.h, V6).
+ * Impacts round up and are never 0, so 0 means "not stored".
+ *
+ * A query scores with the index-wide average length, which drifts
+ * from the segment's as the index grows.  Only the dl / avgdl term
+ * depends on it, so a query average r times the segment's raises w
+ * by at most max(1, r).  tp_impact_scale folds that factor and the
+ * term's IDF into one multiplier, making impact * scale an upper
+ * bound of the posting's exact score.  Scoring uses the bound to skip
+ * segments and blocks; every surviving posting is scored exactly, so
+ * results are the same as without impacts.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <math.h>
+
+#include "segment/fieldnorm.h"
+#include "segment/format.h"
+
+/* Largest quantized impact */
+#define TP_IMPACT_MAX 255
+
+/*
+ * Slack on impact bounds, covering float rounding in the scorer's own
+ * BM25 arithmetic
+ */
+#define TP_IMPACT_BOUND_SLACK 1.0001f
+
+/* BM25 parameters a segment writer quantizes impacts with */
+typedef struct TpImpactParams
+{
+	bool   enabled; /* Index was created WITH (impacts = true) */
+	float4 k1;
+	float4 b;
+} TpImpactParams;
+
+/*
+ * Average document length a new segment's impacts are quantized
+ * against; 0 means the segment gets no impacts.
+ */
+static inline float4
+tp_impact_segment_avg_doc_len(
+		const TpImpactParams *params, uint64 total_tokens, uint32 num_docs)
+{
+	if (!params->enabled || num_docs == 0 || total_tokens == 0)
+		return 0.0f;
+	return (float4)((double)total_tokens / (double)num_docs);
+}
+
+/*
+ * Quantize one posting's impact.  The segment iterator reports
+ * lengths as uint16 (TpSegmentPosting.doc_length), so the shorter of
+ * that and the decoded fieldnorm is used: the bound holds for both.
+ */
+static inline uint8
+tp_impact_quantize(
+		uint16				  frequency,
+		uint8				  fieldnorm,
+		const TpImpactParams *params,
+		float4				  avg_doc_len)
+{
+	uint32 dl = decode_fieldnorm(fieldnorm);
+	double tf = (double)frequency;
+	double w;
+	double q;
+
+	dl = Min(dl, (uint32)(uint16)dl);
+	w  = tf / (tf + params->k1 * (1.0 - params->b +
+								  params->b * (double)dl / avg_doc_len));
+	q  = floor(w * TP_IMPACT_MAX) + 1.0;
+
+	return (uint8)Min(q, (double)TP_IMPACT_MAX);
+}
+
+/*
+ * Fill in the impacts of a block's postings; returns the block's
+ * largest impact.
+ */
+static inline uint8
+tp_impact_fill_block(
+		TpBlockPosting		 *postings,
+		uint32				  count,
+		const TpImpactParams *params,
+		float4				  avg_doc_len)
+{
+	uint8  block_max = 0;
+	uint32 i;
+
+	for (i = 0; i < count; i++)
+	{
+		postings[i].impact = tp_impact_quantize(
+				postings[i].frequency,
+				postings[i].fieldnorm,
+				params,
+				avg_doc_len);
+		if (postings[i].impact > block_max)
+			block_max = postings[i].impact;
+	}
+	return block_max;
+}
+
+/*
+ * Multiplier turning a stored impact into an upper bound of the term's
+ * BM25 score under the query's IDF and average document length.
+ * Returns 0 (no bound) when the segment has no impacts.
+ */
+static inline float4
+tp_impact_scale(
+		float4 idf,
+		float4 k1,
+		float4 avg_doc_len,
+		float4 segment_avg_doc_len)
+{
+	float4 drift;
+
+	if (segment_avg_doc_len <= 0.0f || avg_doc_len <= 0.0f)
+		return 0.0f;
+
+	drift = Max(1.0f, avg_doc_len / segment_avg_doc_len);
+	return idf * (k1 + 1.0f) * drift * TP_IMPACT_BOUND_SLACK / TP_IMPACT_MAX;
+}
+
+/*
+ * Tighten a bound computed from max tf / min fieldnorm with an impact
+ * bound; impact 0 or scale 0 leave it unchanged
+ */
+static inline float4
+tp_impact_tighten(float4 bound, uint8 impact, float4 scale)
+{
+	if (impact == 0 || scale <= 0.0f)
+		return bound;
+	return Min(bound, (float4)impact * scale);
+}
@@ -46,6 +46,27 @@ typedef struct TpSegmentReader
 	OffsetNumber *cached_ctid_offsets; /* Tuple offsets (2 bytes/doc) */
 	uint32		  cached_num_docs;	   /* Number of docs cached */
 
+	/* Static priors by doc ID, loaded on first use (NULL until then) */
+	float4 *cached_priors;
+
+	/*
+	 * Front-coded dictionary (V6): the block decoded last and the term
+	 * decoding stopped at, so terms read in order are decoded once.
+	 * dict_block is NULL until a block is loaded; dict_num_blocks is 0
+	 * until the term index header is read.
+	 */
+	uint32 dict_num_terms;
+	uint32 dict_num_blocks;
+	char  *dict_block;		/* Raw bytes of block dict_block_no */
+	uint32 dict_block_size; /* Allocated size of dict_block */
+	uint32 dict_block_len;
+	uint32 dict_block_no;
+	uint32 dict_block_pos; /* Offset of term dict_next_idx in the block */
+	uint32 dict_next_idx;  /* Index of the next term to decode */
+	char  *dict_term;	   /* Term dict_next_idx - 1, NUL-terminated */
+	uint32 dict_term_len;
+	uint32 dict_term_size; /* Allocated size of dict_term */
+
 	/* BufFile-backed reading (for temp file segments, NULL for normal) */
 	BufFile *buffile;
 	uint64	 buffile_base; /* Base byte offset of segment in BufFile */
@@ -73,6 +94,7 @@ typedef struct TpSegmentWriter
 /* Forward declarations */
 struct TermInfo;
 struct TpDocMapBuilder;
+struct TpBlockPositions;
 
 /*
  * Function declarations
@@ -130,6 +152,45 @@ extern void tp_segment_read_dict_entry(
 		uint32			 index,
 		TpDictEntry		*entry);
 
+/*
+ * Dictionary terms by index: read term idx into *buf (grown as
+ * needed), and binary search for the first term whose first key_len
+ * bytes sort at or after key (or after it, with past).  Both read the
+ * flat (V5 and older) and front-coded (V6) layouts.
+ */
+extern const char *tp_segment_read_term(
+		TpSegmentReader *reader, uint32 idx, char **buf, uint32 *buf_size);
+extern uint32 tp_segment_seek_term(
+		TpSegmentReader *reader,
+		uint32			 num_terms,
+		const char		*key,
+		int				 key_len,
+		bool			 past,
+		char		   **buf,
+		uint32			*buf_size);
+
+/* Number of terms in a segment's dictionary */
+extern uint32 tp_segment_num_terms(TpSegmentReader *reader);
+
+/* Find a term's dictionary index; returns false if the segment lacks it */
+extern bool tp_segment_find_term(
+		TpSegmentReader *reader, const char *term, uint32 *idx);
+
+/* Per-term bounds reader; returns false for segments older than V6 */
+extern bool tp_segment_read_term_bounds(
+		TpSegmentReader *reader, uint32 index, TpTermBounds *bounds);
+
+/* Per-block max impacts reader; returns false without impacts */
+extern bool tp_segment_read_block_impacts(
+		TpSegmentReader *reader, const TpDictEntry *entry, uint8 *impacts);
+
+/* Per-block max priors reader; returns false without priors */
+extern bool tp_segment_read_block_priors(
+		TpSegmentReader *reader, const TpDictEntry *entry, float4 *priors);
+
+/* Static prior of one document; 0 without priors */
+extern float4 tp_segment_doc_prior(TpSegmentReader *reader, uint32 doc_id);
+
 /* Debug functions */
 struct DumpOutput; /* Forward declaration */
 extern void tp_dump_segment_to_output(
@@ -182,6 +243,15 @@ typedef struct TpSegmentPostingIterator
 	TpSkipEntry *cached_skip_entries;  /* Pre-loaded skip entries array */
 	uint8		*compressed_buf_cache; /* Reusable decompression buffer */
 
+	/*
+	 * Phrase verification: the current block's positions stream, loaded
+	 * on first use by tp_segment_posting_iterator_positions().
+	 */
+	struct TpBlockPositions *positions;
+	uint32					 positions_block; /* Block in positions */
+	uint32					*position_buf;	  /* Decoded positions */
+	uint32					 position_buf_cap;
+
 	/* Output posting (converted for scoring compatibility) */
 	TpSegmentPosting output_posting;
 } TpSegmentPostingIterator;
@@ -193,10 +263,22 @@ extern bool tp_segment_posting_iterator_init(
 		const char				 *term);
 extern bool
 tp_segment_posting_iterator_load_block(TpSegmentPostingIterator *iter);
+
+/* Posting blocks this backend has loaded, for scoring work budgets */
+extern uint64 tp_segment_blocks_loaded;
+
 extern bool tp_segment_posting_iterator_next(
 		TpSegmentPostingIterator *iter, TpSegmentPosting **posting);
 extern void tp_segment_posting_iterator_free(TpSegmentPostingIterator *iter);
 
+/*
+ * Positions of the posting at current_in_block.  Returns false if the
+ * block was written without positions.  *positions stays valid until
+ * the next call.
+ */
+extern bool tp_segment_posting_iterator_positions(
+		TpSegmentPostingIterator *iter, uint32 **positions, uint32 *count);
+
 /* Read a skip entry by block index */
 extern void tp_segment_read_skip_entry(
 		TpSegmentReader *reader,
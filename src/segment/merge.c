@@ -23,10 +23,13 @@
 #include "segment/dictionary.h"
 #include "segment/docmap.h"
 #include "segment/fieldnorm.h"
+#include "segment/impact.h"
 #include "segment/io.h"
 #include "segment/merge.h"
 #include "segment/merge_internal.h"
 #include "segment/pagemapper.h"
+#include "segment/positions.h"
+#include "segment/prior.h"
 #include "segment/segment.h"
 #include "segment/tombstone.h"
 
@@ -147,10 +150,7 @@ merge_source_advance(TpMergeSource *source)
 
 	/* Read the term at current index */
 	source->current_term = tp_segment_read_term_at_index(
-			source->reader,
-			source->reader->header,
-			source->string_offsets,
-			source->current_idx);
+			source->reader, source->current_idx);
 
 	/* Read the dictionary entry (version-aware) */
 	tp_segment_read_dict_entry(
@@ -170,7 +170,6 @@ bool
 merge_source_init(TpMergeSource *source, Relation index, BlockNumber root)
 {
 	TpSegmentHeader *header;
-	TpDictionary	 dict_header;
 
 	memset(source, 0, sizeof(TpMergeSource));
 	source->exhausted = true; /* Assume failure */
@@ -190,21 +189,6 @@ merge_source_init(TpMergeSource *source, Relation index, BlockNumber root)
 
 	source->num_terms = header->num_terms;
 
-	/* Read dictionary header */
-	tp_segment_read(
-			source->reader,
-			header->dictionary_offset,
-			&dict_header,
-			sizeof(dict_header.num_terms));
-
-	/* Cache all string offsets for this segment */
-	source->string_offsets = palloc(sizeof(uint32) * source->num_terms);
-	tp_segment_read(
-			source->reader,
-			header->dictionary_offset + sizeof(dict_header.num_terms),
-			source->string_offsets,
-			sizeof(uint32) * source->num_terms);
-
 	/* Position before first term (advance will move to index 0) */
 	source->current_idx	 = UINT32_MAX; /* Will wrap to 0 on advance */
 	source->exhausted	 = false;
@@ -215,8 +199,6 @@ merge_source_init(TpMergeSource *source, Relation index, BlockNumber root)
 	{
 		tp_segment_close(source->reader);
 		source->reader = NULL;
-		pfree(source->string_offsets);
-		source->string_offsets = NULL;
 		return false;
 	}
 
@@ -232,7 +214,6 @@ bool
 merge_source_init_from_reader(TpMergeSource *source, TpSegmentReader *reader)
 {
 	TpSegmentHeader *header;
-	TpDictionary	 dict_header;
 
 	memset(source, 0, sizeof(TpMergeSource));
 	source->exhausted = true; /* Assume failure */
@@ -248,21 +229,6 @@ merge_source_init_from_reader(TpMergeSource *source, TpSegmentReader *reader)
 
 	source->num_terms = header->num_terms;
 
-	/* Read dictionary header */
-	tp_segment_read(
-			source->reader,
-			header->dictionary_offset,
-			&dict_header,
-			sizeof(dict_header.num_terms));
-
-	/* Cache all string offsets for this segment */
-	source->string_offsets = palloc(sizeof(uint32) * source->num_terms);
-	tp_segment_read(
-			source->reader,
-			header->dictionary_offset + sizeof(dict_header.num_terms),
-			source->string_offsets,
-			sizeof(uint32) * source->num_terms);
-
 	/* Position before first term */
 	source->current_idx	 = UINT32_MAX;
 	source->exhausted	 = false;
@@ -271,9 +237,7 @@ merge_source_init_from_reader(TpMergeSource *source, TpSegmentReader *reader)
 	/* Advance to first term */
 	if (!merge_source_advance(source))
 	{
-		pfree(source->string_offsets);
-		source->string_offsets = NULL;
-		source->reader		   = NULL; /* Don't close, caller owns it */
+		source->reader = NULL; /* Don't close, caller owns it */
 		return false;
 	}
 
@@ -291,11 +255,6 @@ merge_source_close(TpMergeSource *source)
 		pfree(source->current_term);
 		source->current_term = NULL;
 	}
-	if (source->string_offsets)
-	{
-		pfree(source->string_offsets);
-		source->string_offsets = NULL;
-	}
 	if (source->reader)
 	{
 		tp_segment_close(source->reader);
@@ -394,21 +353,23 @@ posting_source_load_block(TpPostingMergeSource *ps)
 	}
 
 	/* Read posting data for this block (handle compression) */
-	if (ps->skip_entry.flags == TP_BLOCK_FLAG_DELTA)
+	if ((ps->skip_entry.flags & TP_BLOCK_FLAG_COMPRESSION_MASK) ==
+		TP_BLOCK_FLAG_DELTA)
 	{
 		/* Compressed block - read and decompress */
-		uint8 compressed_buf[TP_MAX_COMPRESSED_BLOCK_SIZE];
+		uint8 compressed_buf[TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE];
 
 		tp_segment_read(
 				ps->reader,
 				ps->skip_entry.posting_offset,
 				compressed_buf,
-				TP_MAX_COMPRESSED_BLOCK_SIZE);
+				tp_compressed_block_read_size(ps->skip_entry.flags));
 
 		tp_decompress_block(
 				compressed_buf,
 				ps->skip_entry.doc_count,
 				0, /* first_doc_id - deltas are relative within block */
+				(ps->skip_entry.flags & TP_BLOCK_FLAG_IMPACTS) != 0,
 				ps->block_postings);
 	}
 	else
@@ -421,6 +382,16 @@ posting_source_load_block(TpPostingMergeSource *ps)
 				ps->skip_entry.doc_count * sizeof(TpBlockPosting));
 	}
 
+	/* Carry positions through the merge */
+	ps->has_positions = false;
+	if (tp_skip_has_positions(&ps->skip_entry))
+	{
+		if (ps->positions == NULL)
+			ps->positions = palloc0(sizeof(TpBlockPositions));
+		ps->has_positions = tp_segment_read_block_positions(
+				ps->reader, &ps->skip_entry, ps->positions);
+	}
+
 	ps->current_in_block = 0;
 	return true;
 }
@@ -535,6 +506,9 @@ posting_source_free(TpPostingMergeSource *ps)
 		pfree(ps->block_postings);
 		ps->block_postings = NULL;
 	}
+	tp_block_positions_free(ps->positions);
+	ps->positions	  = NULL;
+	ps->has_positions = false;
 }
 
 /*
@@ -641,6 +615,7 @@ typedef struct TpDocmapMergeSource
 	BlockNumber	 *ctid_pages;	/* CTID page numbers (4 bytes/doc) */
 	OffsetNumber *ctid_offsets; /* CTID tuple offsets (2 bytes/doc) */
 	uint8		 *fieldnorms;	/* Encoded fieldnorms (1 byte/doc) */
+	float4		 *priors;		/* Static priors, NULL if none */
 	uint32		  num_docs;		/* Total docs in this source */
 	uint32		  cursor;		/* Current position in arrays */
 	bool		  owns_arrays;	/* True if we allocated the arrays */
@@ -668,6 +643,8 @@ build_merged_docmap(
 	BlockNumber			*out_pages;
 	OffsetNumber		*out_offsets;
 	uint8				*out_fieldnorms;
+	float4				*out_priors = NULL;
+	bool				 any_priors = false;
 	uint32				 new_doc_id = 0;
 	int					 i;
 
@@ -730,6 +707,19 @@ build_merged_docmap(
 				header->fieldnorm_offset,
 				ms->fieldnorms,
 				ms->num_docs * sizeof(uint8));
+
+		/* Static priors, if the segment stores them */
+		if (header->prior_offset != 0)
+		{
+			ms->priors = palloc_extended(
+					ms->num_docs * sizeof(float4), MCXT_ALLOC_HUGE);
+			tp_segment_read(
+					sources[i].reader,
+					header->prior_offset,
+					ms->priors,
+					ms->num_docs * sizeof(float4));
+			any_priors = true;
+		}
 	}
 
 	/* Step 2: Allocate output arrays (palloc(0) is valid in PG) */
@@ -737,6 +727,11 @@ build_merged_docmap(
 	out_offsets	   = palloc(total_docs * sizeof(OffsetNumber));
 	out_fieldnorms = palloc(total_docs * sizeof(uint8));
 
+	/* Sources without priors contribute 0 */
+	if (any_priors)
+		out_priors = palloc_extended(
+				total_docs * sizeof(float4), MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+
 	/*
 	 * Step 3: Merge docmaps.
 	 *
@@ -763,6 +758,8 @@ build_merged_docmap(
 				out_pages[new_doc_id]	   = ms->ctid_pages[j];
 				out_offsets[new_doc_id]	   = ms->ctid_offsets[j];
 				out_fieldnorms[new_doc_id] = ms->fieldnorms[j];
+				if (ms->priors)
+					out_priors[new_doc_id] = ms->priors[j];
 				new_doc_id++;
 			}
 		}
@@ -820,6 +817,8 @@ build_merged_docmap(
 				out_pages[new_doc_id]			  = ms->ctid_pages[pos];
 				out_offsets[new_doc_id]			  = ms->ctid_offsets[pos];
 				out_fieldnorms[new_doc_id]		  = ms->fieldnorms[pos];
+				if (ms->priors)
+					out_priors[new_doc_id] = ms->priors[pos];
 				ms->cursor++;
 			}
 			new_doc_id++;
@@ -835,6 +834,8 @@ build_merged_docmap(
 	docmap->ctid_pages	 = out_pages;
 	docmap->ctid_offsets = out_offsets;
 	docmap->fieldnorms	 = out_fieldnorms;
+	docmap->priors		 = out_priors;
+	docmap->has_priors	 = any_priors;
 
 	/*
 	 * Compute merged total_tokens as Σ source.header.total_tokens
@@ -875,6 +876,8 @@ build_merged_docmap(
 		}
 		if (msources[i].fieldnorms)
 			pfree(msources[i].fieldnorms);
+		if (msources[i].priors)
+			pfree(msources[i].priors);
 	}
 	pfree(msources);
 
@@ -987,12 +990,10 @@ write_merged_segment_to_sink(
 		bool		   disjoint_sources)
 {
 	TpSegmentHeader		header;
-	TpDictionary		dict;
+	TpDictBuilder		dict;
 	TpDocMapBuilder	   *docmap;
 	TpMergeDocMapping	doc_mapping;
 	MergeTermBlockInfo *term_blocks;
-	uint32			   *string_offsets;
-	uint32				string_pos;
 	uint32				i;
 
 	/* Accumulated skip entries for all terms */
@@ -1000,6 +1001,18 @@ write_merged_segment_to_sink(
 	uint32		 skip_entries_count;
 	uint32		 skip_entries_capacity;
 
+	/* Positions stream of the block being built */
+	StringInfoData block_pos;
+	bool		   block_pos_complete;
+
+	/* Quantized impacts, recomputed against the merged segment */
+	TpImpactParams impact_params;
+	float4		   impact_avg_doc_len;
+	uint8		  *all_block_impacts = NULL; /* Parallel to skip entries */
+
+	/* Per-block max priors, if the sources store priors */
+	float4 *all_block_priors = NULL; /* Parallel to skip entries */
+
 	if (num_terms == 0)
 		return;
 
@@ -1044,34 +1057,16 @@ write_merged_segment_to_sink(
 	/* Dictionary immediately follows header */
 	header.dictionary_offset = sink->current_offset;
 
-	/* Write dictionary header */
-	memset(&dict, 0, sizeof(dict));
-	dict.num_terms = num_terms;
-	merge_sink_write(sink, &dict, offsetof(TpDictionary, string_offsets));
-
-	/* Calculate string offsets */
-	string_offsets = palloc0(num_terms * sizeof(uint32));
-	string_pos	   = 0;
+	/* Write dictionary section: term index, then front-coded blocks */
+	tp_dict_builder_init(&dict, num_terms);
 	for (i = 0; i < num_terms; i++)
-	{
-		string_offsets[i] = string_pos;
-		string_pos += sizeof(uint32) + terms[i].term_len + sizeof(uint32);
-	}
+		tp_dict_builder_add(&dict, terms[i].term, terms[i].term_len);
+	tp_dict_builder_finish(&dict);
+	merge_sink_write(sink, dict.index.data, dict.index.len);
 
-	/* Write string offsets array */
-	merge_sink_write(sink, string_offsets, num_terms * sizeof(uint32));
-
-	/* Write string pool */
 	header.strings_offset = sink->current_offset;
-	for (i = 0; i < num_terms; i++)
-	{
-		uint32 length	   = terms[i].term_len;
-		uint32 dict_offset = i * sizeof(TpDictEntry);
-
-		merge_sink_write(sink, &length, sizeof(uint32));
-		merge_sink_write(sink, terms[i].term, length);
-		merge_sink_write(sink, &dict_offset, sizeof(uint32));
-	}
+	merge_sink_write(sink, dict.blocks.data, dict.blocks.len);
+	tp_dict_builder_free(&dict);
 
 	/* Record entries offset - dict entries written after postings */
 	header.entries_offset = sink->current_offset;
@@ -1094,10 +1089,23 @@ write_merged_segment_to_sink(
 	skip_entries_count	  = 0;
 	all_skip_entries = palloc(skip_entries_capacity * sizeof(TpSkipEntry));
 
+	initStringInfo(&block_pos);
+	block_pos_complete = true;
+
+	tp_index_impact_params(sink->index, &impact_params);
+	impact_avg_doc_len = tp_impact_segment_avg_doc_len(
+			&impact_params, total_tokens, docmap->num_docs);
+	if (impact_avg_doc_len > 0.0f)
+		all_block_impacts = palloc(skip_entries_capacity * sizeof(uint8));
+	if (docmap->priors)
+		all_block_priors = palloc(skip_entries_capacity * sizeof(float4));
+
 	/*
 	 * Helper macro: flush a full or partial block_buf to the sink.
-	 * Computes skip entry, optionally compresses, writes data,
-	 * and accumulates the skip entry.
+	 * Computes skip entry and impacts, optionally compresses, writes
+	 * data, and accumulates the skip entry.  The block's positions
+	 * stream (block_pos) follows it if every posting in the block had
+	 * one.
 	 */
 #define FLUSH_BLOCK(block_buf, block_count, num_blocks)                         \
 	do                                                                          \
@@ -1106,6 +1114,9 @@ write_merged_segment_to_sink(
 		uint16		max_tf_	  = 0;                                              \
 		uint8		min_norm_ = 255;                                            \
 		uint32		last_did_ = 0;                                              \
+		uint8		impact_	  = 0;                                              \
+		uint8		iflag_	  = 0;                                              \
+		float4		prior_	  = 0.0f;                                           \
 		uint32		j_;                                                         \
                                                                                 \
 		for (j_ = 0; j_ < (block_count); j_++)                                  \
@@ -1125,31 +1136,70 @@ write_merged_segment_to_sink(
 		skip_.posting_offset = sink->current_offset;                            \
 		memset(skip_.reserved, 0, sizeof(skip_.reserved));                      \
                                                                                 \
+		if (all_block_impacts)                                                  \
+		{                                                                       \
+			impact_ = tp_impact_fill_block(                                     \
+					(block_buf),                                                \
+					(block_count),                                              \
+					&impact_params,                                             \
+					impact_avg_doc_len);                                        \
+			iflag_ = TP_BLOCK_FLAG_IMPACTS;                                     \
+		}                                                                       \
+		if (all_block_priors)                                                   \
+			prior_ = tp_prior_block_max(                                        \
+					docmap->priors, (block_buf), (block_count));                \
+                                                                                \
 		if (tp_compress_segments)                                               \
 		{                                                                       \
-			uint8  cbuf_[TP_MAX_COMPRESSED_BLOCK_SIZE];                         \
+			uint8  cbuf_[TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE];                  \
 			uint32 csize_;                                                      \
                                                                                 \
-			csize_		= tp_compress_block((block_buf), (block_count), cbuf_); \
-			skip_.flags = TP_BLOCK_FLAG_DELTA;                                  \
+			csize_ = tp_compress_block(                                         \
+					(block_buf), (block_count), iflag_ != 0, cbuf_);            \
+			skip_.flags = TP_BLOCK_FLAG_DELTA | iflag_;                         \
 			merge_sink_write(sink, cbuf_, csize_);                              \
 		}                                                                       \
 		else                                                                    \
 		{                                                                       \
-			skip_.flags = TP_BLOCK_FLAG_UNCOMPRESSED;                           \
+			skip_.flags = TP_BLOCK_FLAG_UNCOMPRESSED | iflag_;                  \
 			merge_sink_write(                                                   \
 					sink,                                                       \
 					(block_buf),                                                \
 					(block_count) * sizeof(TpBlockPosting));                    \
 		}                                                                       \
                                                                                 \
+		if (block_pos_complete)                                                 \
+		{                                                                       \
+			uint32 plen_ = (uint32)block_pos.len;                               \
+                                                                                \
+			tp_skip_set_positions(                                              \
+					&skip_,                                                     \
+					(uint32)(sink->current_offset - skip_.posting_offset));     \
+			merge_sink_write(sink, &plen_, sizeof(uint32));                     \
+			merge_sink_write(sink, block_pos.data, plen_);                      \
+		}                                                                       \
+		resetStringInfo(&block_pos);                                            \
+		block_pos_complete = true;                                              \
+                                                                                \
 		if (skip_entries_count >= skip_entries_capacity)                        \
 		{                                                                       \
 			skip_entries_capacity *= 2;                                         \
 			all_skip_entries = repalloc_huge(                                   \
 					all_skip_entries,                                           \
 					skip_entries_capacity * sizeof(TpSkipEntry));               \
+			if (all_block_impacts)                                              \
+				all_block_impacts = repalloc_huge(                              \
+						all_block_impacts,                                      \
+						skip_entries_capacity * sizeof(uint8));                 \
+			if (all_block_priors)                                               \
+				all_block_priors = repalloc_huge(                               \
+						all_block_priors,                                       \
+						skip_entries_capacity * sizeof(float4));                \
 		}                                                                       \
+		if (all_block_impacts)                                                  \
+			all_block_impacts[skip_entries_count] = impact_;                    \
+		if (all_block_priors)                                                   \
+			all_block_priors[skip_entries_count] = prior_;                      \
 		all_skip_entries[skip_entries_count++] = skip_;                         \
 		(num_blocks)++;                                                         \
 	} while (0)
@@ -1171,6 +1221,9 @@ write_merged_segment_to_sink(
 		uint32				  doc_count	  = 0;
 		uint32				  num_blocks  = 0;
 
+		resetStringInfo(&block_pos);
+		block_pos_complete = true;
+
 		/* Record where this term's postings start */
 		term_blocks[i].posting_offset	= sink->current_offset;
 		term_blocks[i].skip_entry_start = skip_entries_count;
@@ -1213,10 +1266,18 @@ write_merged_segment_to_sink(
 					block_buf[block_count].doc_id	 = new_id;
 					block_buf[block_count].frequency = bp->frequency;
 					block_buf[block_count].fieldnorm = bp->fieldnorm;
-					block_buf[block_count].reserved	 = 0;
+					block_buf[block_count].impact	 = 0;
 					block_count++;
 					doc_count++;
 
+					if (psources[src].has_positions)
+						tp_positions_append_raw(
+								&block_pos,
+								psources[src].positions,
+								psources[src].current_in_block);
+					else
+						block_pos_complete = false;
+
 					posting_source_advance_fast(&psources[src]);
 
 					if (block_count == TP_BLOCK_SIZE)
@@ -1258,7 +1319,15 @@ write_merged_segment_to_sink(
 							psources[min_idx].current.frequency;
 					block_buf[block_count].fieldnorm =
 							psources[min_idx].current.fieldnorm;
-					block_buf[block_count].reserved = 0;
+					block_buf[block_count].impact = 0;
+
+					if (psources[min_idx].has_positions)
+						tp_positions_append_raw(
+								&block_pos,
+								psources[min_idx].positions,
+								psources[min_idx].current_in_block);
+					else
+						block_pos_complete = false;
 				}
 				block_count++;
 				doc_count++;
@@ -1289,6 +1358,8 @@ write_merged_segment_to_sink(
 
 #undef FLUSH_BLOCK
 
+	pfree(block_pos.data);
+
 	/* Skip index starts here - after all postings */
 	header.skip_index_offset = sink->current_offset;
 
@@ -1301,6 +1372,47 @@ write_merged_segment_to_sink(
 				skip_entries_count * sizeof(TpSkipEntry));
 	}
 
+	/* Write per-term bounds, parallel to the dict entries */
+	header.term_bounds_offset = sink->current_offset;
+	{
+		TpTermBounds *bounds = palloc(num_terms * sizeof(TpTermBounds));
+
+		for (i = 0; i < num_terms; i++)
+		{
+			uint32 start = term_blocks[i].skip_entry_start;
+
+			tp_term_bounds_from_skip(
+					&all_skip_entries[start],
+					all_block_impacts ? &all_block_impacts[start] : NULL,
+					term_blocks[i].block_count,
+					&bounds[i]);
+		}
+		merge_sink_write(sink, bounds, num_terms * sizeof(TpTermBounds));
+		pfree(bounds);
+	}
+
+	/* Write per-block max impacts, parallel to the skip index */
+	if (all_block_impacts)
+	{
+		header.block_impacts_offset = sink->current_offset;
+		header.impact_avg_doc_len	= impact_avg_doc_len;
+		if (skip_entries_count > 0)
+			merge_sink_write(sink, all_block_impacts, skip_entries_count);
+		pfree(all_block_impacts);
+	}
+
+	/* Write per-block max priors, parallel to the skip index */
+	if (all_block_priors)
+	{
+		header.block_priors_offset = sink->current_offset;
+		if (skip_entries_count > 0)
+			merge_sink_write(
+					sink,
+					all_block_priors,
+					skip_entries_count * sizeof(float4));
+		pfree(all_block_priors);
+	}
+
 	pfree(all_skip_entries);
 
 	/* Write fieldnorm table */
@@ -1311,6 +1423,16 @@ write_merged_segment_to_sink(
 				sink, docmap->fieldnorms, docmap->num_docs * sizeof(uint8));
 	}
 
+	/* Write prior table, parallel to the fieldnorm table */
+	if (docmap->priors)
+	{
+		header.prior_offset = sink->current_offset;
+		header.max_prior	= tp_prior_max(docmap->priors, docmap->num_docs);
+		if (docmap->num_docs > 0)
+			merge_sink_write(
+					sink, docmap->priors, docmap->num_docs * sizeof(float4));
+	}
+
 	/* Write CTID pages array */
 	header.ctid_pages_offset = sink->current_offset;
 	if (docmap->num_docs > 0)
@@ -1390,7 +1512,6 @@ write_merged_segment_to_sink(
 	tp_segment_writer_finish(&sink->writer);
 
 	/* Cleanup */
-	pfree(string_offsets);
 	pfree(term_blocks);
 	free_merge_doc_mapping(&doc_mapping);
 	tp_docmap_destroy(docmap);
@@ -21,13 +21,12 @@
  */
 typedef struct TpMergeSource
 {
-	TpSegmentReader *reader;		 /* Segment reader */
-	uint32			 current_idx;	 /* Current term index in dictionary */
-	uint32			 num_terms;		 /* Total terms in this segment */
-	char			*current_term;	 /* Current term text (palloc'd) */
-	TpDictEntry		 current_entry;	 /* dictionary entry */
-	bool			 exhausted;		 /* True if no more terms */
-	uint32			*string_offsets; /* Cached string offsets array */
+	TpSegmentReader *reader;		/* Segment reader */
+	uint32			 current_idx;	/* Current term index in dictionary */
+	uint32			 num_terms;		/* Total terms in this segment */
+	char			*current_term;	/* Current term text (palloc'd) */
+	TpDictEntry		 current_entry; /* dictionary entry */
+	bool			 exhausted;		/* True if no more terms */
 } TpMergeSource;
 
 /*
@@ -82,6 +81,10 @@ typedef struct TpPostingMergeSource
 	TpSkipEntry		skip_entry;		   /* Current block's skip entry */
 	TpBlockPosting *block_postings;	   /* Cached postings for block */
 	uint32			block_capacity;	   /* Allocated size */
+
+	/* Current block's positions stream, if the block has one */
+	struct TpBlockPositions *positions;
+	bool					 has_positions;
 } TpPostingMergeSource;
 
 /*
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * positions.c - Per-block token position streams
+ *
+ * See positions.h for the on-disk layout.
+ */
+#include <postgres.h>
+
+#include "segment/io.h"
+#include "segment/positions.h"
+#include "types/vector.h"
+
+/*
+ * Append one posting's entry: the position count, then the positions
+ * delta-encoded.  Positions must be ascending.
+ */
+void
+tp_positions_append(StringInfo buf, const uint32 *positions, uint32 count)
+{
+	uint8  tmp[5];
+	uint32 prev = 0;
+	uint32 i;
+
+	appendBinaryStringInfo(
+			buf, (char *)tmp, tpvector_varint_encode(count, tmp));
+	for (i = 0; i < count; i++)
+	{
+		Assert(i == 0 || positions[i] >= prev);
+		appendBinaryStringInfo(
+				buf,
+				(char *)tmp,
+				tpvector_varint_encode(positions[i] - prev, tmp));
+		prev = positions[i];
+	}
+}
+
+void
+tp_positions_append_raw(
+		StringInfo buf, const TpBlockPositions *bp, uint32 idx)
+{
+	Assert(idx < bp->doc_count);
+	appendBinaryStringInfo(
+			buf,
+			(char *)bp->data + bp->offsets[idx],
+			bp->offsets[idx + 1] - bp->offsets[idx]);
+}
+
+const uint8 *
+tp_positions_skip(const uint8 *p, const uint8 *end, uint32 ndocs)
+{
+	uint32 i;
+
+	for (i = 0; i < ndocs; i++)
+	{
+		uint32 count = tpvector_varint_decode(&p, end);
+		uint32 j;
+
+		for (j = 0; j < count; j++)
+			(void)tpvector_varint_decode(&p, end);
+	}
+	return p;
+}
+
+uint32
+tp_positions_decode(
+		const TpBlockPositions *bp, uint32 idx, uint32 **buf, uint32 *cap)
+{
+	const uint8 *p	 = bp->data + bp->offsets[idx];
+	const uint8 *end = bp->data + bp->offsets[idx + 1];
+	uint32		 count;
+	uint32		 pos = 0;
+	uint32		 i;
+
+	Assert(idx < bp->doc_count);
+
+	count = tpvector_varint_decode(&p, end);
+	if (count > *cap)
+	{
+		if (*buf != NULL)
+			pfree(*buf);
+		*cap = Max(count, 16);
+		*buf = palloc(*cap * sizeof(uint32));
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		pos += tpvector_varint_decode(&p, end);
+		(*buf)[i] = pos;
+	}
+	return count;
+}
+
+bool
+tp_segment_read_block_positions(
+		TpSegmentReader *reader, const TpSkipEntry *skip, TpBlockPositions *bp)
+{
+	uint64		 offset;
+	uint32		 len;
+	const uint8 *p;
+	const uint8 *end;
+	uint32		 i;
+
+	if (!tp_skip_has_positions(skip))
+		return false;
+
+	offset = tp_skip_positions_offset(skip);
+	tp_segment_read(reader, offset, &len, sizeof(uint32));
+
+	if (len > reader->header->data_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("corrupt segment: positions stream of %u bytes "
+						"at offset " UINT64_FORMAT,
+						len,
+						offset)));
+
+	if (len > bp->data_capacity)
+	{
+		if (bp->data != NULL)
+			pfree(bp->data);
+		bp->data_capacity = Max(len, 1024);
+		bp->data		  = palloc(bp->data_capacity);
+	}
+	if (len > 0)
+		tp_segment_read(reader, offset + sizeof(uint32), bp->data, len);
+	bp->data_len  = len;
+	bp->doc_count = skip->doc_count;
+
+	/* Index the entries so postings can be decoded out of order */
+	p	= bp->data;
+	end = bp->data + len;
+	for (i = 0; i < bp->doc_count; i++)
+	{
+		bp->offsets[i] = (uint32)(p - bp->data);
+		p			   = tp_positions_skip(p, end, 1);
+	}
+	bp->offsets[bp->doc_count] = (uint32)(p - bp->data);
+
+	return true;
+}
+
+void
+tp_block_positions_free(TpBlockPositions *bp)
+{
+	if (bp == NULL)
+		return;
+	if (bp->data != NULL)
+		pfree(bp->data);
+	pfree(bp);
+}
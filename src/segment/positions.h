@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * positions.h - Per-block token position streams
+ *
+ * Indexes created WITH (positions = true) store, after each posting
+ * block, the token positions of every posting in that block:
+ *
+ *   [posting block][uint32 stream_len][entry 0]...[entry doc_count-1]
+ *
+ * Each entry is varint(count) followed by count varint position
+ * deltas (the first delta is the absolute position).  Entries are in
+ * block order, so entry i belongs to the block's i-th posting.  The
+ * skip entry marks such blocks with TP_BLOCK_FLAG_POSITIONS and keeps
+ * the block's byte length in its reserved bytes (see format.h).
+ *
+ * Scoring never reads positions; they are loaded only when a phrase
+ * has to be verified for a document.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <lib/stringinfo.h>
+
+#include "segment/io.h"
+
+/*
+ * Mark a skip entry as followed by a positions stream.  block_bytes is
+ * the on-disk size of the posting block itself.
+ */
+static inline void
+tp_skip_set_positions(TpSkipEntry *skip, uint32 block_bytes)
+{
+	Assert(block_bytes < (1U << 24));
+	skip->flags |= TP_BLOCK_FLAG_POSITIONS;
+	skip->reserved[0] = (uint8)(block_bytes & 0xFF);
+	skip->reserved[1] = (uint8)((block_bytes >> 8) & 0xFF);
+	skip->reserved[2] = (uint8)((block_bytes >> 16) & 0xFF);
+}
+
+static inline bool
+tp_skip_has_positions(const TpSkipEntry *skip)
+{
+	return (skip->flags & TP_BLOCK_FLAG_POSITIONS) != 0;
+}
+
+/*
+ * Segment offset of a block's positions stream (its uint32 length)
+ */
+static inline uint64
+tp_skip_positions_offset(const TpSkipEntry *skip)
+{
+	uint32 block_bytes = (uint32)skip->reserved[0] |
+						 ((uint32)skip->reserved[1] << 8) |
+						 ((uint32)skip->reserved[2] << 16);
+
+	return skip->posting_offset + block_bytes;
+}
+
+/*
+ * One block's positions stream, read from disk.  offsets[i] is the
+ * byte offset of posting i's entry in data; offsets[doc_count] is the
+ * stream length.
+ */
+typedef struct TpBlockPositions
+{
+	uint8 *data;
+	uint32 data_len;
+	uint32 data_capacity;
+	uint32 doc_count;
+	uint32 offsets[TP_BLOCK_SIZE + 1];
+} TpBlockPositions;
+
+/* Append one posting's entry to a block stream being built */
+extern void tp_positions_append(
+		StringInfo buf, const uint32 *positions, uint32 count);
+
+/* Copy posting idx's entry from a loaded block (merge) */
+extern void tp_positions_append_raw(
+		StringInfo buf, const TpBlockPositions *bp, uint32 idx);
+
+/* Step over ndocs entries of a stream; errors if it is truncated */
+extern const uint8 *
+tp_positions_skip(const uint8 *p, const uint8 *end, uint32 ndocs);
+
+/*
+ * Decode posting idx's positions into *buf (grown as needed).
+ * Returns the number of positions.
+ */
+extern uint32 tp_positions_decode(
+		const TpBlockPositions *bp, uint32 idx, uint32 **buf, uint32 *cap);
+
+/*
+ * Load the positions stream of the block described by skip.  Returns
+ * false if the block was written without positions.
+ */
+extern bool tp_segment_read_block_positions(
+		TpSegmentReader *reader, const TpSkipEntry *skip, TpBlockPositions *bp);
+
+extern void tp_block_positions_free(TpBlockPositions *bp);
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * prior.h - Static per-document priors stored in segments
+ *
+ * An index with an INCLUDE column stores that column's value, as a
+ * float4, for every document: a popularity score, or a timestamp as
+ * seconds since the Unix epoch.  Segments keep it in a table parallel
+ * to the fieldnorm table (one float4 per doc ID, at header
+ * prior_offset) and keep the largest prior of every block in an array
+ * parallel to the skip index (header block_priors_offset), so that a
+ * query adding a monotone function of the prior to BM25 can still
+ * bound whole blocks and segments (see scoring/prior.h).
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "segment/format.h"
+
+/*
+ * Largest prior of a block's documents; priors is indexed by
+ * segment-local doc ID
+ */
+static inline float4
+tp_prior_block_max(
+		const float4 *priors, const TpBlockPosting *postings, uint32 count)
+{
+	float4 block_max = -FLT_MAX;
+	uint32 i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (priors[postings[i].doc_id] > block_max)
+			block_max = priors[postings[i].doc_id];
+	}
+	return block_max;
+}
+
+/* Largest of num_docs priors; 0 for an empty segment */
+static inline float4
+tp_prior_max(const float4 *priors, uint32 num_docs)
+{
+	float4 max_prior;
+	uint32 i;
+
+	if (num_docs == 0)
+		return 0.0f;
+
+	max_prior = priors[0];
+	for (i = 1; i < num_docs; i++)
+	{
+		if (priors[i] > max_prior)
+			max_prior = priors[i];
+	}
+	return max_prior;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * reader_cache.c - Backend-local cache of segment reader metadata
+ *
+ * See reader_cache.h for what is cached and how entries are validated.
+ */
+#include <postgres.h>
+
+#include <access/htup_details.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+
+#include "segment/reader_cache.h"
+
+/* GUC variable (registered in mod.c) */
+bool tp_segment_reader_cache_enabled = true;
+
+typedef struct TpReaderCacheKey
+{
+	Oid			index_oid;
+	BlockNumber root_block;
+} TpReaderCacheKey;
+
+/*
+ * What a segment's page map was built from, and the metadata kept
+ * for it
+ */
+typedef struct TpReaderCacheEntry
+{
+	TpReaderCacheKey key; /* Hash key - must be first */
+
+	/* Validation: must match the index and the freshly read header */
+	RelFileNumber relfilenumber;
+	TimestampTz	  created_at;
+	BlockNumber	  page_index;
+	uint32		  num_pages;
+	uint64		  data_size;
+
+	BlockNumber *page_map; /* num_pages entries */
+
+	/* Dictionary header (V6), 0 until a reader has read it */
+	uint32 dict_num_terms;
+	uint32 dict_num_blocks;
+} TpReaderCacheEntry;
+
+static HTAB			*reader_cache		  = NULL;
+static MemoryContext reader_cache_context = NULL;
+static Size			 reader_cache_bytes	  = 0; /* Σ page map bytes */
+static uint64		 reader_cache_hits	  = 0;
+static uint64		 reader_cache_misses  = 0;
+
+static void
+reader_cache_init(void)
+{
+	HASHCTL ctl;
+
+	if (reader_cache_context == NULL)
+		reader_cache_context = AllocSetContextCreate(
+				TopMemoryContext,
+				"pg_textsearch segment reader cache",
+				ALLOCSET_DEFAULT_SIZES);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize	  = sizeof(TpReaderCacheKey);
+	ctl.entrysize = sizeof(TpReaderCacheEntry);
+	ctl.hcxt	  = reader_cache_context;
+
+	reader_cache = hash_create(
+			"pg_textsearch segment reader cache",
+			64, /* initial size */
+			&ctl,
+			HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/* Drop every entry, page maps and hash table alike */
+static void
+reader_cache_empty(void)
+{
+	if (reader_cache_context != NULL)
+		MemoryContextReset(reader_cache_context);
+	reader_cache	   = NULL;
+	reader_cache_bytes = 0;
+}
+
+/*
+ * Entry for a reader's segment, or NULL.  Only readers of index pages
+ * are cached; BufFile-backed segments of a parallel build are not.
+ */
+static TpReaderCacheEntry *
+reader_cache_find(TpSegmentReader *reader, HASHACTION action, bool *found)
+{
+	TpReaderCacheKey key;
+
+	if (!tp_segment_reader_cache_enabled || reader->index == NULL ||
+		reader->buffile != NULL)
+		return NULL;
+	if (reader_cache == NULL)
+	{
+		if (action == HASH_FIND)
+			return NULL;
+		reader_cache_init();
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.index_oid  = RelationGetRelid(reader->index);
+	key.root_block = reader->root_block;
+	return (TpReaderCacheEntry *)
+			hash_search(reader_cache, &key, action, found);
+}
+
+/* Was the entry built from the segment this reader opened? */
+static bool
+reader_cache_valid(TpReaderCacheEntry *entry, TpSegmentReader *reader)
+{
+	TpSegmentHeader *header = reader->header;
+
+	return entry->relfilenumber == reader->index->rd_locator.relNumber &&
+		   entry->created_at == header->created_at &&
+		   entry->page_index == header->page_index &&
+		   entry->num_pages == header->num_pages &&
+		   entry->data_size == header->data_size;
+}
+
+bool
+tp_segment_reader_cache_fill(TpSegmentReader *reader)
+{
+	TpReaderCacheEntry *entry = reader_cache_find(reader, HASH_FIND, NULL);
+
+	if (entry == NULL || !reader_cache_valid(entry, reader))
+	{
+		if (tp_segment_reader_cache_enabled && reader->index != NULL)
+			reader_cache_misses++;
+		return false;
+	}
+
+	reader->page_map = palloc(sizeof(BlockNumber) * reader->num_pages);
+	memcpy(reader->page_map,
+		   entry->page_map,
+		   sizeof(BlockNumber) * reader->num_pages);
+	reader->dict_num_terms	= entry->dict_num_terms;
+	reader->dict_num_blocks = entry->dict_num_blocks;
+
+	reader_cache_hits++;
+	return true;
+}
+
+void
+tp_segment_reader_cache_store(TpSegmentReader *reader)
+{
+	TpReaderCacheEntry *entry;
+	Size				map_bytes = sizeof(BlockNumber) * reader->num_pages;
+	bool				found;
+
+	if (!tp_segment_reader_cache_enabled || reader->index == NULL)
+		return;
+
+	/* A single segment past the budget is not worth keeping */
+	if (map_bytes > TP_SEGMENT_READER_CACHE_BYTES)
+		return;
+	if (reader_cache_bytes + map_bytes > TP_SEGMENT_READER_CACHE_BYTES)
+		reader_cache_empty();
+
+	entry = reader_cache_find(reader, HASH_ENTER, &found);
+	if (entry == NULL)
+		return;
+
+	/* A stale entry for a segment since freed from this root block */
+	if (found && entry->page_map != NULL)
+	{
+		reader_cache_bytes -= sizeof(BlockNumber) * entry->num_pages;
+		pfree(entry->page_map);
+	}
+
+	entry->relfilenumber = reader->index->rd_locator.relNumber;
+	entry->created_at	 = reader->header->created_at;
+	entry->page_index	 = reader->header->page_index;
+	entry->num_pages	 = reader->header->num_pages;
+	entry->data_size	 = reader->header->data_size;
+	entry->page_map		 = MemoryContextAlloc(
+			 reader_cache_context, Max(map_bytes, sizeof(BlockNumber)));
+	memcpy(entry->page_map, reader->page_map, map_bytes);
+	entry->dict_num_terms  = 0;
+	entry->dict_num_blocks = 0;
+
+	reader_cache_bytes += map_bytes;
+}
+
+void
+tp_segment_reader_cache_store_dict(TpSegmentReader *reader)
+{
+	TpReaderCacheEntry *entry;
+
+	if (reader->dict_num_blocks == 0)
+		return;
+
+	entry = reader_cache_find(reader, HASH_FIND, NULL);
+	if (entry == NULL || entry->dict_num_blocks != 0 ||
+		!reader_cache_valid(entry, reader))
+		return;
+
+	entry->dict_num_terms  = reader->dict_num_terms;
+	entry->dict_num_blocks = reader->dict_num_blocks;
+}
+
+/*
+ * bm25_segment_reader_cache_stats() -> (hits, misses, entries, bytes)
+ *
+ * This backend's segment opens served from and missing the reader
+ * cache, and what it holds.
+ */
+PG_FUNCTION_INFO_V1(bm25_segment_reader_cache_stats);
+
+Datum
+bm25_segment_reader_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	Datum	  values[4];
+	bool	  nulls[4] = {false, false, false, false};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	values[0] = Int64GetDatum((int64)reader_cache_hits);
+	values[1] = Int64GetDatum((int64)reader_cache_misses);
+	values[2] = Int64GetDatum(
+			reader_cache ? (int64)hash_get_num_entries(reader_cache) : 0);
+	values[3] = Int64GetDatum((int64)reader_cache_bytes);
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+/*
+ * bm25_segment_reader_cache_reset() -> void
+ *
+ * Empties this backend's reader cache and zeroes its counters.
+ */
+PG_FUNCTION_INFO_V1(bm25_segment_reader_cache_reset);
+
+Datum
+bm25_segment_reader_cache_reset(PG_FUNCTION_ARGS)
+{
+	(void)fcinfo;
+
+	reader_cache_empty();
+	reader_cache_hits	= 0;
+	reader_cache_misses = 0;
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025-2026 Tiger Data, Inc.
+ * Licensed under the PostgreSQL License. See LICENSE for details.
+ *
+ * reader_cache.h - Backend-local cache of segment reader metadata
+ *
+ * Every query opens each segment of the index, and opening one walks
+ * its page index chain to rebuild the logical-to-physical page map,
+ * then reads the dictionary's term index header.  Segments are
+ * immutable once written, so this backend keeps both per (index OID,
+ * root block) and a later open copies them instead: it reads only the
+ * header page, which is the segment's first data page, and data pages.
+ *
+ * The header itself is still read on every open, since VACUUM patches
+ * alive_count and merges relink next_segment in place.  It also
+ * validates the entry: a cached page map is used only if the header's
+ * created_at, page_index, num_pages and data_size and the index's
+ * relfilenumber match the ones it was built from.  A root block freed
+ * by a merge and reused by a later segment, or an index rewritten by
+ * REINDEX or TRUNCATE, therefore misses, and the entry is replaced.
+ *
+ * Page maps are charged to a fixed budget; past it the cache is
+ * emptied, so it holds the segments of the indexes in current use.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "segment/io.h"
+
+/* Page map bytes held before the cache is emptied */
+#define TP_SEGMENT_READER_CACHE_BYTES (4 * 1024 * 1024)
+
+/* GUC (mod.c) */
+extern bool tp_segment_reader_cache_enabled;
+
+/*
+ * Fill an opened reader's page map (and dictionary header, if known)
+ * from the cache.  Returns false on a miss; the caller then loads them
+ * and calls tp_segment_reader_cache_store.
+ */
+extern bool tp_segment_reader_cache_fill(TpSegmentReader *reader);
+
+/* Remember a reader's page map after it was loaded from disk */
+extern void tp_segment_reader_cache_store(TpSegmentReader *reader);
+
+/* Remember a reader's dictionary header once it has been read */
+extern void tp_segment_reader_cache_store_dict(TpSegmentReader *reader);
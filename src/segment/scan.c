@@ -6,13 +6,16 @@
  */
 #include <postgres.h>
 
+#include <miscadmin.h>
 #include <utils/memutils.h>
 
 #include "segment/compression.h"
 #include "segment/dictionary.h"
 #include "segment/fieldnorm.h"
 #include "segment/io.h"
+#include "segment/positions.h"
 #include "segment/segment.h"
+#include "types/vector.h"
 
 /*
  * Read a skip entry by block index.
@@ -63,10 +66,6 @@ tp_segment_posting_iterator_init(
 		const char				 *term)
 {
 	TpSegmentHeader *header;
-	TpDictionary	 dict_header;
-	int				 left, right, mid;
-	char			*term_buffer = NULL;
-	uint32			 buffer_size = 0;
 
 	if (!reader || !reader->header)
 		return false;
@@ -86,97 +85,24 @@ tp_segment_posting_iterator_init(
 	iter->fallback_block_size  = 0;
 	iter->cached_skip_entries  = NULL;
 	iter->compressed_buf_cache = NULL;
+	iter->positions			   = NULL;
+	iter->positions_block	   = UINT32_MAX;
+	iter->position_buf		   = NULL;
+	iter->position_buf_cap	   = 0;
 
-	if (header->num_terms == 0 || header->dictionary_offset == 0)
+	if (!tp_segment_find_term(reader, term, &iter->dict_entry_idx))
 		return false;
 
-	/* Read dictionary header */
-	tp_segment_read(
-			reader,
-			header->dictionary_offset,
-			&dict_header,
-			sizeof(dict_header.num_terms));
-
-	/* Binary search for the term */
-	left  = 0;
-	right = dict_header.num_terms - 1;
-
-	while (left <= right)
-	{
-		TpStringEntry string_entry;
-		int			  cmp;
-		uint32		  string_offset_value;
-		uint32		  string_offset;
-
-		mid = left + (right - left) / 2;
-
-		/* Read string offset */
-		tp_segment_read(
-				reader,
-				header->dictionary_offset + sizeof(dict_header.num_terms) +
-						(mid * sizeof(uint32)),
-				&string_offset_value,
-				sizeof(uint32));
-
-		string_offset = header->strings_offset + string_offset_value;
-
-		/* Read string length */
-		tp_segment_read(
-				reader, string_offset, &string_entry.length, sizeof(uint32));
-
-		if (string_entry.length > TP_MAX_TERM_LENGTH)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg("corrupt segment: term length %u exceeds "
-							"maximum",
-							string_entry.length)));
-
-		/* Reallocate buffer if needed */
-		if (string_entry.length + 1 > buffer_size)
-		{
-			if (term_buffer)
-				pfree(term_buffer);
-			buffer_size = string_entry.length + 1;
-			term_buffer = palloc(buffer_size);
-		}
-
-		/* Read term text */
-		tp_segment_read(
-				reader,
-				string_offset + sizeof(uint32),
-				term_buffer,
-				string_entry.length);
-		term_buffer[string_entry.length] = '\0';
-
-		/* Compare terms */
-		cmp = strcmp(term, term_buffer);
-
-		if (cmp == 0)
-		{
-			/* Found! Read dictionary entry (version-aware) */
-			tp_segment_read_dict_entry(reader, header, mid, &iter->dict_entry);
-
-			iter->dict_entry_idx = mid;
-			iter->initialized	 = true;
-			iter->finished		 = (iter->dict_entry.block_count == 0);
-
-			pfree(term_buffer);
-			return true;
-		}
-		else if (cmp < 0)
-		{
-			right = mid - 1;
-		}
-		else
-		{
-			left = mid + 1;
-		}
-	}
-
-	pfree(term_buffer);
-	return false;
+	/* Found! Read dictionary entry (version-aware) */
+	tp_segment_read_dict_entry(
+			reader, header, iter->dict_entry_idx, &iter->dict_entry);
+	iter->initialized = true;
+	iter->finished	  = (iter->dict_entry.block_count == 0);
+	return true;
 }
 
+uint64 tp_segment_blocks_loaded = 0;
+
 /*
  * Load a block's postings for iteration.
  * Uses zero-copy access when block data fits within a single page and is
@@ -193,6 +119,8 @@ tp_segment_posting_iterator_load_block(TpSegmentPostingIterator *iter)
 	if (iter->current_block >= iter->dict_entry.block_count)
 		return false;
 
+	tp_segment_blocks_loaded++;
+
 	/* Release previous block access if any */
 	if (iter->has_block_access)
 	{
@@ -215,17 +143,21 @@ tp_segment_posting_iterator_load_block(TpSegmentPostingIterator *iter)
 	block_bytes = block_size * sizeof(TpBlockPosting);
 
 	/* Handle compressed blocks */
-	if (iter->skip_entry.flags == TP_BLOCK_FLAG_DELTA)
+	if ((iter->skip_entry.flags & TP_BLOCK_FLAG_COMPRESSION_MASK) ==
+		TP_BLOCK_FLAG_DELTA)
 	{
 		uint8 *compressed_buf;
 		bool   free_compressed = false;
+		bool   impacts;
+
+		impacts = (iter->skip_entry.flags & TP_BLOCK_FLAG_IMPACTS) != 0;
 
 		/* Use cached buffer if available, else palloc */
 		if (iter->compressed_buf_cache)
 			compressed_buf = iter->compressed_buf_cache;
 		else
 		{
-			compressed_buf	= palloc(TP_MAX_COMPRESSED_BLOCK_SIZE);
+			compressed_buf	= palloc(TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE);
 			free_compressed = true;
 		}
 
@@ -233,7 +165,7 @@ tp_segment_posting_iterator_load_block(TpSegmentPostingIterator *iter)
 				iter->reader,
 				iter->skip_entry.posting_offset,
 				compressed_buf,
-				TP_MAX_COMPRESSED_BLOCK_SIZE);
+				tp_compressed_block_read_size(iter->skip_entry.flags));
 
 		/* Ensure fallback buffer is large enough */
 		if (block_size > iter->fallback_block_size)
@@ -246,7 +178,7 @@ tp_segment_posting_iterator_load_block(TpSegmentPostingIterator *iter)
 
 		/* Decompress into fallback buffer */
 		tp_decompress_block(
-				compressed_buf, block_size, 0, iter->fallback_block);
+				compressed_buf, block_size, 0, impacts, iter->fallback_block);
 
 		if (free_compressed)
 			pfree(compressed_buf);
@@ -416,6 +348,17 @@ tp_segment_posting_iterator_free(TpSegmentPostingIterator *iter)
 		iter->fallback_block = NULL;
 	}
 
+	if (iter->positions)
+	{
+		tp_block_positions_free(iter->positions);
+		iter->positions = NULL;
+	}
+	if (iter->position_buf)
+	{
+		pfree(iter->position_buf);
+		iter->position_buf = NULL;
+	}
+
 	/*
 	 * Note: cached_skip_entries and compressed_buf_cache are borrowed
 	 * pointers owned by the BMW caller.  Do NOT free them here.
@@ -425,6 +368,39 @@ tp_segment_posting_iterator_free(TpSegmentPostingIterator *iter)
 	iter->block_postings	   = NULL;
 }
 
+/*
+ * Get the positions of the posting at current_in_block.
+ *
+ * The block's positions stream is read once and reused for every
+ * posting of that block the caller asks about.
+ */
+bool
+tp_segment_posting_iterator_positions(
+		TpSegmentPostingIterator *iter, uint32 **positions, uint32 *count)
+{
+	if (iter->block_postings == NULL ||
+		iter->current_in_block >= iter->skip_entry.doc_count)
+		return false;
+
+	if (iter->positions_block != iter->current_block)
+	{
+		if (iter->positions == NULL)
+			iter->positions = palloc0(sizeof(TpBlockPositions));
+		if (!tp_segment_read_block_positions(
+					iter->reader, &iter->skip_entry, iter->positions))
+			return false;
+		iter->positions_block = iter->current_block;
+	}
+
+	*count = tp_positions_decode(
+			iter->positions,
+			iter->current_in_block,
+			&iter->position_buf,
+			&iter->position_buf_cap);
+	*positions = iter->position_buf;
+	return true;
+}
+
 /*
  * Get current doc ID from iterator.
  * Returns UINT32_MAX if iterator is finished or not positioned.
@@ -580,110 +556,31 @@ uint32
 tp_segment_get_doc_freq(
 		Relation index, BlockNumber first_segment, const char *term)
 {
-	BlockNumber		 current	 = first_segment;
-	TpSegmentReader *reader		 = NULL;
-	uint32			 doc_freq	 = 0;
-	char			*term_buffer = NULL;
-	uint32			 buffer_size = 0;
+	BlockNumber current	 = first_segment;
+	uint32		doc_freq = 0;
 
 	while (current != InvalidBlockNumber)
 	{
-		TpSegmentHeader *header;
-		TpDictionary	 dict_header;
-		int				 left, right;
+		TpSegmentReader *reader;
+		uint32			 idx;
 
 		reader = tp_segment_open(index, current);
 		if (!reader)
 			break;
 
-		header = reader->header;
-		if (header->num_terms == 0 || header->dictionary_offset == 0)
-		{
-			current = header->next_segment;
-			tp_segment_close(reader);
-			continue;
-		}
-
-		tp_segment_read(
-				reader,
-				header->dictionary_offset,
-				&dict_header,
-				sizeof(dict_header.num_terms));
-
-		left  = 0;
-		right = dict_header.num_terms - 1;
-
-		while (left <= right)
+		if (tp_segment_find_term(reader, term, &idx))
 		{
-			TpStringEntry string_entry;
-			int			  cmp;
-			uint32		  string_offset_value;
-			uint32		  string_offset;
-			int			  mid = left + (right - left) / 2;
-
-			tp_segment_read(
-					reader,
-					header->dictionary_offset + sizeof(dict_header.num_terms) +
-							(mid * sizeof(uint32)),
-					&string_offset_value,
-					sizeof(uint32));
+			TpDictEntry dict_entry;
 
-			string_offset = header->strings_offset + string_offset_value;
-
-			tp_segment_read(
-					reader,
-					string_offset,
-					&string_entry.length,
-					sizeof(uint32));
-
-			if (string_entry.length > TP_MAX_TERM_LENGTH)
-				ereport(ERROR,
-						(errcode(ERRCODE_DATA_CORRUPTED),
-						 errmsg("corrupt segment: term length %u "
-								"exceeds maximum",
-								string_entry.length)));
-
-			if (string_entry.length + 1 > buffer_size)
-			{
-				if (term_buffer)
-					pfree(term_buffer);
-				buffer_size = string_entry.length + 1;
-				term_buffer = palloc(buffer_size);
-			}
-
-			tp_segment_read(
-					reader,
-					string_offset + sizeof(uint32),
-					term_buffer,
-					string_entry.length);
-			term_buffer[string_entry.length] = '\0';
-
-			cmp = strcmp(term, term_buffer);
-
-			if (cmp == 0)
-			{
-				TpDictEntry dict_entry;
-				tp_segment_read_dict_entry(reader, header, mid, &dict_entry);
-				doc_freq += dict_entry.doc_freq;
-				break;
-			}
-			else if (cmp < 0)
-			{
-				right = mid - 1;
-			}
-			else
-			{
-				left = mid + 1;
-			}
+			tp_segment_read_dict_entry(
+					reader, reader->header, idx, &dict_entry);
+			doc_freq += dict_entry.doc_freq;
 		}
 
-		current = header->next_segment;
+		current = reader->header->next_segment;
 		tp_segment_close(reader);
 	}
 
-	if (term_buffer)
-		pfree(term_buffer);
-
 	return doc_freq;
 }
 
@@ -702,8 +599,471 @@ tp_batch_get_segment_doc_freq(
 		char	  **terms,
 		int			term_count,
 		uint32	   *doc_freqs)
+{
+	BlockNumber current = first_segment;
+
+	while (current != InvalidBlockNumber)
+	{
+		TpSegmentReader *reader;
+		int				 term_idx;
+
+		/* Open segment ONCE for all terms */
+		reader = tp_segment_open(index, current);
+		if (!reader)
+			break;
+
+		/* Look up each term in this segment */
+		for (term_idx = 0; term_idx < term_count; term_idx++)
+		{
+			TpDictEntry dict_entry;
+			uint32		idx;
+
+			if (!tp_segment_find_term(reader, terms[term_idx], &idx))
+				continue;
+
+			/* Found - read dict entry and add doc_freq */
+			tp_segment_read_dict_entry(
+					reader, reader->header, idx, &dict_entry);
+			doc_freqs[term_idx] += dict_entry.doc_freq;
+		}
+
+		/* Move to next segment and close this one */
+		current = reader->header->next_segment;
+		tp_segment_close(reader);
+	}
+}
+
+/* ---------- front-coded dictionary (V6) ---------- */
+
+/* Segment offsets of the term index arrays (see TpDictIndex) */
+static inline uint64
+dict_block_offsets_at(TpSegmentReader *reader)
+{
+	return reader->header->dictionary_offset + sizeof(TpDictIndex);
+}
+
+static inline uint64
+dict_first_term_offsets_at(TpSegmentReader *reader)
+{
+	return dict_block_offsets_at(reader) +
+		   (uint64)(reader->dict_num_blocks + 1) * sizeof(uint32);
+}
+
+static inline uint64
+dict_first_terms_at(TpSegmentReader *reader)
+{
+	return dict_first_term_offsets_at(reader) +
+		   (uint64)(reader->dict_num_blocks + 1) * sizeof(uint32);
+}
+
+static void
+dict_corrupt(TpSegmentReader *reader, const char *what, uint32 value)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_DATA_CORRUPTED),
+			 errmsg("corrupt segment dictionary at block %u: %s %u",
+					reader->root_block,
+					what,
+					value)));
+}
+
+/* Read the term index header once per reader */
+static void
+dict_load_index(TpSegmentReader *reader)
+{
+	TpDictIndex dict_index;
+
+	if (reader->dict_num_blocks > 0)
+		return;
+
+	tp_segment_read(
+			reader,
+			reader->header->dictionary_offset,
+			&dict_index,
+			sizeof(TpDictIndex));
+	if (dict_index.num_blocks !=
+		(dict_index.num_terms + TP_DICT_BLOCK_TERMS - 1) / TP_DICT_BLOCK_TERMS)
+		dict_corrupt(reader, "block count", dict_index.num_blocks);
+
+	reader->dict_num_terms	= dict_index.num_terms;
+	reader->dict_num_blocks = dict_index.num_blocks;
+}
+
+/* Read the two offsets [i], [i + 1] of a term index array */
+static void
+dict_read_offset_pair(
+		TpSegmentReader *reader, uint64 array_at, uint32 i, uint32 *pair)
+{
+	tp_segment_read(
+			reader,
+			array_at + (uint64)i * sizeof(uint32),
+			pair,
+			2 * sizeof(uint32));
+	/* A term takes at most two 5-byte varints and its bytes */
+	if (pair[1] < pair[0] ||
+		pair[1] - pair[0] > TP_DICT_BLOCK_TERMS * (TP_MAX_TERM_LENGTH + 10))
+		dict_corrupt(reader, "offset", pair[0]);
+}
+
+/* First term of a block, from the term index, into *buf */
+static const char *
+dict_first_term(
+		TpSegmentReader *reader, uint32 block, char **buf, uint32 *buf_size)
+{
+	uint32 pair[2];
+	uint32 length;
+
+	dict_read_offset_pair(
+			reader, dict_first_term_offsets_at(reader), block, pair);
+	length = pair[1] - pair[0];
+	if (length > TP_MAX_TERM_LENGTH)
+		dict_corrupt(reader, "term length", length);
+
+	if (length + 1 > *buf_size)
+	{
+		if (*buf)
+			pfree(*buf);
+		*buf_size = length + 1;
+		*buf	  = palloc(*buf_size);
+	}
+	tp_segment_read(
+			reader, dict_first_terms_at(reader) + pair[0], *buf, length);
+	(*buf)[length] = '\0';
+	return *buf;
+}
+
+/* Read a block into the reader, positioned before its first term */
+static void
+dict_load_block(TpSegmentReader *reader, uint32 block)
+{
+	uint32 pair[2];
+	uint32 length;
+
+	dict_read_offset_pair(reader, dict_block_offsets_at(reader), block, pair);
+	length = pair[1] - pair[0];
+
+	if (length > reader->dict_block_size || reader->dict_block == NULL)
+	{
+		if (reader->dict_block)
+			pfree(reader->dict_block);
+		reader->dict_block_size = Max(length, 1);
+		reader->dict_block		= MemoryContextAlloc(
+				 GetMemoryChunkContext(reader), reader->dict_block_size);
+	}
+	tp_segment_read(
+			reader,
+			reader->header->strings_offset + pair[0],
+			reader->dict_block,
+			length);
+
+	reader->dict_block_no  = block;
+	reader->dict_block_len = length;
+	reader->dict_block_pos = 0;
+	reader->dict_next_idx  = block * TP_DICT_BLOCK_TERMS;
+	reader->dict_term_len  = 0;
+}
+
+/* Decode the next term of the loaded block over the previous one */
+static void
+dict_decode_next(TpSegmentReader *reader)
+{
+	const uint8 *block = (const uint8 *)reader->dict_block;
+	const uint8 *p	   = block + reader->dict_block_pos;
+	const uint8 *end   = block + reader->dict_block_len;
+	uint32		 prefix;
+	uint32		 suffix;
+
+	if (p >= end)
+		dict_corrupt(reader, "truncated block", reader->dict_block_no);
+
+	prefix = tpvector_varint_decode(&p, end);
+	suffix = tpvector_varint_decode(&p, end);
+	if (prefix > reader->dict_term_len || suffix > (uint32)(end - p) ||
+		prefix + suffix > TP_MAX_TERM_LENGTH)
+		dict_corrupt(reader, "term", reader->dict_next_idx);
+
+	if (prefix + suffix + 1 > reader->dict_term_size)
+	{
+		reader->dict_term_size = Max(prefix + suffix + 1, 64);
+		reader->dict_term =
+				reader->dict_term
+						? repalloc(reader->dict_term, reader->dict_term_size)
+						: MemoryContextAlloc(
+								  GetMemoryChunkContext(reader),
+								  reader->dict_term_size);
+	}
+	memcpy(reader->dict_term + prefix, p, suffix);
+	reader->dict_term_len					= prefix + suffix;
+	reader->dict_term[reader->dict_term_len] = '\0';
+
+	reader->dict_block_pos = (p + suffix) - block;
+	reader->dict_next_idx++;
+}
+
+/*
+ * Term idx, decoded in the reader.  Reading terms in order decodes
+ * each once; moving back or to another block reloads its block.
+ */
+static const char *
+dict_decode_term(TpSegmentReader *reader, uint32 idx)
+{
+	uint32 block = idx / TP_DICT_BLOCK_TERMS;
+
+	dict_load_index(reader);
+	if (idx >= reader->dict_num_terms)
+		dict_corrupt(reader, "term index", idx);
+
+	if (reader->dict_block == NULL || reader->dict_block_no != block ||
+		idx + 1 < reader->dict_next_idx)
+		dict_load_block(reader, block);
+	while (reader->dict_next_idx <= idx)
+		dict_decode_next(reader);
+	return reader->dict_term;
+}
+
+/* Does term sort before key's range, as tp_segment_seek_term defines it? */
+static inline bool
+term_before_key(const char *term, const char *key, int key_len, bool past)
+{
+	int cmp = strncmp(term, key, key_len);
+
+	return cmp < 0 || (past && cmp == 0);
+}
+
+/* ---------- flat dictionary (V5 and older) ---------- */
+
+static uint32
+flat_dict_num_terms(TpSegmentReader *reader)
+{
+	uint32 num_terms;
+
+	tp_segment_read(
+			reader,
+			reader->header->dictionary_offset,
+			&num_terms,
+			sizeof(uint32));
+	return num_terms;
+}
+
+static const char *
+flat_dict_read_term(
+		TpSegmentReader *reader, uint32 idx, char **buf, uint32 *buf_size)
+{
+	TpSegmentHeader *header = reader->header;
+	uint32			 string_offset_value;
+	uint64			 string_offset;
+	uint32			 length;
+
+	tp_segment_read(
+			reader,
+			header->dictionary_offset +
+					offsetof(TpDictionary, string_offsets) +
+					(uint64)idx * sizeof(uint32),
+			&string_offset_value,
+			sizeof(uint32));
+	string_offset = header->strings_offset + string_offset_value;
+
+	tp_segment_read(reader, string_offset, &length, sizeof(uint32));
+	if (length > TP_MAX_TERM_LENGTH)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("corrupt segment: term length %u exceeds maximum",
+						length)));
+
+	if (length + 1 > *buf_size)
+	{
+		if (*buf)
+			pfree(*buf);
+		*buf_size = length + 1;
+		*buf	  = palloc(*buf_size);
+	}
+	tp_segment_read(reader, string_offset + sizeof(uint32), *buf, length);
+	(*buf)[length] = '\0';
+	return *buf;
+}
+
+static uint32
+flat_dict_seek_term(
+		TpSegmentReader *reader,
+		uint32			 num_terms,
+		const char		*key,
+		int				 key_len,
+		bool			 past,
+		char		   **buf,
+		uint32			*buf_size)
+{
+	uint32 left	 = 0;
+	uint32 right = num_terms;
+
+	while (left < right)
+	{
+		uint32 mid = left + (right - left) / 2;
+
+		if (term_before_key(
+					flat_dict_read_term(reader, mid, buf, buf_size),
+					key,
+					key_len,
+					past))
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	return left;
+}
+
+/* ---------- dictionary access ---------- */
+
+/* Segments of the released 1.3.x formats have a flat dictionary */
+static inline bool
+segment_has_flat_dictionary(TpSegmentReader *reader)
+{
+	return reader->segment_version <= TP_SEGMENT_FORMAT_VERSION_5;
+}
+
+uint32
+tp_segment_num_terms(TpSegmentReader *reader)
+{
+	if (reader->header->num_terms == 0 ||
+		reader->header->dictionary_offset == 0)
+		return 0;
+
+	if (segment_has_flat_dictionary(reader))
+		return flat_dict_num_terms(reader);
+
+	dict_load_index(reader);
+	return reader->dict_num_terms;
+}
+
+/*
+ * Read term idx of a segment's dictionary into *buf, grown as needed
+ */
+const char *
+tp_segment_read_term(
+		TpSegmentReader *reader, uint32 idx, char **buf, uint32 *buf_size)
+{
+	const char *term;
+	uint32		length;
+
+	if (segment_has_flat_dictionary(reader))
+		return flat_dict_read_term(reader, idx, buf, buf_size);
+
+	term   = dict_decode_term(reader, idx);
+	length = reader->dict_term_len;
+	if (length + 1 > *buf_size)
+	{
+		if (*buf)
+			pfree(*buf);
+		*buf_size = length + 1;
+		*buf	  = palloc(*buf_size);
+	}
+	memcpy(*buf, term, length + 1);
+	return *buf;
+}
+
+/*
+ * Binary search the sorted dictionary of num_terms terms for the first
+ * term whose first key_len bytes sort at or after key, or, with past,
+ * after it: past the range of terms starting with key.
+ *
+ * A front-coded dictionary is searched by its blocks' first terms,
+ * which the term index keeps together, then within the one block the
+ * answer can be in.
+ */
+uint32
+tp_segment_seek_term(
+		TpSegmentReader *reader,
+		uint32			 num_terms,
+		const char		*key,
+		int				 key_len,
+		bool			 past,
+		char		   **buf,
+		uint32			*buf_size)
+{
+	uint32 left = 0;
+	uint32 right;
+	uint32 idx;
+	uint32 end;
+
+	if (segment_has_flat_dictionary(reader))
+		return flat_dict_seek_term(
+				reader, num_terms, key, key_len, past, buf, buf_size);
+
+	if (num_terms == 0)
+		return 0;
+
+	/* First block whose first term does not sort before the key */
+	dict_load_index(reader);
+	right = reader->dict_num_blocks;
+	while (left < right)
+	{
+		uint32 mid = left + (right - left) / 2;
+
+		if (term_before_key(
+					dict_first_term(reader, mid, buf, buf_size),
+					key,
+					key_len,
+					past))
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	if (left == 0)
+		return 0;
+
+	/* The answer is in the block before it, or is its first term */
+	idx = (left - 1) * TP_DICT_BLOCK_TERMS;
+	end = Min(left * TP_DICT_BLOCK_TERMS, num_terms);
+	for (; idx < end; idx++)
+	{
+		if (!term_before_key(
+					dict_decode_term(reader, idx), key, key_len, past))
+			break;
+	}
+	return idx;
+}
+
+bool
+tp_segment_find_term(TpSegmentReader *reader, const char *term, uint32 *idx)
+{
+	uint32 num_terms = tp_segment_num_terms(reader);
+	char  *buf		 = NULL;
+	uint32 buf_size	 = 0;
+	bool   found;
+
+	if (num_terms == 0)
+		return false;
+
+	/* The lower bound of the range of terms starting with it */
+	*idx = tp_segment_seek_term(
+			reader, num_terms, term, strlen(term), false, &buf, &buf_size);
+
+	found = false;
+	if (*idx < num_terms)
+		found = strcmp(tp_segment_read_term(reader, *idx, &buf, &buf_size),
+					   term) == 0;
+
+	if (buf)
+		pfree(buf);
+	return found;
+}
+
+/*
+ * Call fn for every term starting with prefix in the segments of a
+ * level chain, once per segment holding it, with that segment's
+ * doc_freq.  The dictionary is sorted, so the terms of one segment
+ * form a range: a binary search finds its first term and a scan
+ * stops at the first term past it.
+ */
+void
+tp_segment_foreach_prefix(
+		Relation	   index,
+		BlockNumber	   first_segment,
+		const char	  *prefix,
+		TpTermCallback fn,
+		void		  *arg)
 {
 	BlockNumber current		= first_segment;
+	size_t		prefix_len	= strlen(prefix);
 	char	   *term_buffer = NULL;
 	uint32		buffer_size = 0;
 
@@ -711,104 +1071,46 @@ tp_batch_get_segment_doc_freq(
 	{
 		TpSegmentReader *reader;
 		TpSegmentHeader *header;
-		TpDictionary	 dict_header;
-		int				 term_idx;
+		uint32			 num_terms;
+		uint32			 idx;
+
+		CHECK_FOR_INTERRUPTS();
 
-		/* Open segment ONCE for all terms */
 		reader = tp_segment_open(index, current);
 		if (!reader)
 			break;
-
 		header = reader->header;
 
-		if (header->num_terms == 0 || header->dictionary_offset == 0)
+		num_terms = tp_segment_num_terms(reader);
+		if (num_terms == 0)
 		{
 			current = header->next_segment;
 			tp_segment_close(reader);
 			continue;
 		}
 
-		/* Read dictionary header once per segment */
-		tp_segment_read(
-				reader,
-				header->dictionary_offset,
-				&dict_header,
-				sizeof(dict_header.num_terms));
-
-		/* Look up each term in this segment */
-		for (term_idx = 0; term_idx < term_count; term_idx++)
+		for (idx = tp_segment_seek_term(
+					 reader,
+					 num_terms,
+					 prefix,
+					 prefix_len,
+					 false,
+					 &term_buffer,
+					 &buffer_size);
+			 idx < num_terms;
+			 idx++)
 		{
-			const char *term  = terms[term_idx];
-			int			left  = 0;
-			int			right = dict_header.num_terms - 1;
+			const char *term = tp_segment_read_term(
+					reader, idx, &term_buffer, &buffer_size);
+			TpDictEntry dict_entry;
 
-			/* Binary search for term in dictionary */
-			while (left <= right)
-			{
-				int	   mid = left + (right - left) / 2;
-				uint32 string_offset_value;
-				uint32 string_offset;
-				uint32 string_length;
-				int	   cmp;
-
-				tp_segment_read(
-						reader,
-						header->dictionary_offset +
-								sizeof(dict_header.num_terms) +
-								(mid * sizeof(uint32)),
-						&string_offset_value,
-						sizeof(uint32));
-
-				string_offset = header->strings_offset + string_offset_value;
-
-				tp_segment_read(
-						reader, string_offset, &string_length, sizeof(uint32));
-
-				if (string_length > TP_MAX_TERM_LENGTH)
-					ereport(ERROR,
-							(errcode(ERRCODE_DATA_CORRUPTED),
-							 errmsg("corrupt segment: term length %u "
-									"exceeds maximum",
-									string_length)));
-
-				if (string_length + 1 > buffer_size)
-				{
-					if (term_buffer)
-						pfree(term_buffer);
-					buffer_size = string_length + 1;
-					term_buffer = palloc(buffer_size);
-				}
-
-				tp_segment_read(
-						reader,
-						string_offset + sizeof(uint32),
-						term_buffer,
-						string_length);
-				term_buffer[string_length] = '\0';
-
-				cmp = strcmp(term, term_buffer);
-
-				if (cmp == 0)
-				{
-					/* Found - read dict entry and add doc_freq */
-					TpDictEntry dict_entry;
-					tp_segment_read_dict_entry(
-							reader, header, mid, &dict_entry);
-					doc_freqs[term_idx] += dict_entry.doc_freq;
-					break;
-				}
-				else if (cmp < 0)
-				{
-					right = mid - 1;
-				}
-				else
-				{
-					left = mid + 1;
-				}
-			}
+			if (strncmp(term, prefix, prefix_len) != 0)
+				break;
+			tp_segment_read_dict_entry(reader, header, idx, &dict_entry);
+			if (dict_entry.doc_freq > 0)
+				fn(term, dict_entry.doc_freq, arg);
 		}
 
-		/* Move to next segment and close this one */
 		current = header->next_segment;
 		tp_segment_close(reader);
 	}
@@ -35,8 +35,11 @@
 #include "segment/dictionary.h"
 #include "segment/docmap.h"
 #include "segment/fieldnorm.h"
+#include "segment/impact.h"
 #include "segment/io.h"
 #include "segment/pagemapper.h"
+#include "segment/positions.h"
+#include "segment/prior.h"
 #include "segment/segment.h"
 
 /* External: compression GUC from mod.c */
@@ -94,26 +97,222 @@ tp_segment_read_dict_entry(
 }
 
 /*
- * Open segment for reading.
- * If load_ctids is true, preloads all CTID arrays into memory (expensive).
- * If load_ctids is false, skips CTID preloading - use tp_segment_lookup_ctid
- * for deferred resolution.
+ * Read the segment-wide bounds for the term at dictionary index `index`.
+ * Segments written before V6 have no bounds section; callers fall back
+ * to the skip index.
  */
-TpSegmentReader *
-tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
+bool
+tp_segment_read_term_bounds(
+		TpSegmentReader *reader, uint32 index, TpTermBounds *bounds)
+{
+	if (reader->header->term_bounds_offset == 0)
+		return false;
+
+	tp_segment_read(
+			reader,
+			reader->header->term_bounds_offset +
+					(uint64)index * sizeof(TpTermBounds),
+			bounds,
+			sizeof(TpTermBounds));
+	return true;
+}
+
+/*
+ * Read the largest quantized impact of each of a term's blocks into
+ * impacts[0..entry->block_count-1].  Returns false if the segment
+ * stores no impacts (written before V6 or without impacts = true).
+ */
+bool
+tp_segment_read_block_impacts(
+		TpSegmentReader *reader, const TpDictEntry *entry, uint8 *impacts)
+{
+	TpSegmentHeader *header = reader->header;
+	uint64			 first_block;
+
+	if (header->block_impacts_offset == 0 || entry->block_count == 0)
+		return false;
+
+	/* The section is parallel to the skip index, one byte per entry */
+	first_block = (entry->skip_index_offset - header->skip_index_offset) /
+				  sizeof(TpSkipEntry);
+	tp_segment_read(
+			reader,
+			header->block_impacts_offset + first_block,
+			impacts,
+			entry->block_count);
+	return true;
+}
+
+/*
+ * Read the largest static prior of each of a term's blocks into
+ * priors[0..entry->block_count-1].  Returns false if the segment
+ * stores no priors (written before V6 or by an index without one).
+ */
+bool
+tp_segment_read_block_priors(
+		TpSegmentReader *reader, const TpDictEntry *entry, float4 *priors)
+{
+	TpSegmentHeader *header = reader->header;
+	uint64			 first_block;
+
+	if (header->block_priors_offset == 0 || entry->block_count == 0)
+		return false;
+
+	/* Parallel to the skip index, one float4 per entry */
+	first_block = (entry->skip_index_offset - header->skip_index_offset) /
+				  sizeof(TpSkipEntry);
+	tp_segment_read(
+			reader,
+			header->block_priors_offset + first_block * sizeof(float4),
+			priors,
+			entry->block_count * sizeof(float4));
+	return true;
+}
+
+/*
+ * Static prior of a segment-local document, 0 if the segment has none.
+ * The whole table is read on first use and kept with the reader: a
+ * query that reaches per-document scoring usually looks up many.
+ */
+float4
+tp_segment_doc_prior(TpSegmentReader *reader, uint32 doc_id)
+{
+	TpSegmentHeader *header = reader->header;
+
+	if (header->prior_offset == 0 || doc_id >= header->num_docs)
+		return 0.0f;
+
+	if (reader->cached_priors == NULL)
+	{
+		reader->cached_priors = MemoryContextAllocHuge(
+				GetMemoryChunkContext(reader),
+				(Size)header->num_docs * sizeof(float4));
+		tp_segment_read(
+				reader,
+				header->prior_offset,
+				reader->cached_priors,
+				header->num_docs * sizeof(float4));
+	}
+	return reader->cached_priors[doc_id];
+}
+
+/*
+ * Build a reader's page map by walking its segment's page index chain
+ */
+static void
+load_page_map(TpSegmentReader *reader, BlockNumber page_index_block)
 {
-	TpSegmentReader	   *reader;
-	Buffer				header_buf;
-	Page				header_page;
-	TpSegmentHeader	   *header;
-	BlockNumber			page_index_block;
 	Buffer				index_buf;
 	Page				index_page;
 	TpPageIndexSpecial *special;
 	BlockNumber		   *page_entries;
 	uint32				pages_loaded = 0;
 	uint32				i;
-	BlockNumber			nblocks;
+
+	reader->page_map = palloc(sizeof(BlockNumber) * reader->num_pages);
+
+	/* Read page index chain to build page map */
+	while (page_index_block != InvalidBlockNumber &&
+		   pages_loaded < reader->num_pages)
+	{
+		index_buf = ReadBuffer(reader->index, page_index_block);
+		LockBuffer(index_buf, BUFFER_LOCK_SHARE);
+		index_page = BufferGetPage(index_buf);
+
+		/* Get special area with page index metadata */
+		special = (TpPageIndexSpecial *)PageGetSpecialPointer(index_page);
+
+		/* Validate magic number and page type */
+		if (special->magic != TP_PAGE_INDEX_MAGIC ||
+			special->page_type != TP_PAGE_FILE_INDEX)
+		{
+			UnlockReleaseBuffer(index_buf);
+			ReleaseBuffer(reader->header_buffer);
+			pfree(reader->page_map);
+			pfree(reader->header);
+			pfree(reader);
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid page index at block %u",
+							page_index_block),
+					 errdetail(
+							 "magic=0x%08X (expected 0x%08X), "
+							 "page_type=%u (expected %u)",
+							 special->magic,
+							 TP_PAGE_INDEX_MAGIC,
+							 special->page_type,
+							 TP_PAGE_FILE_INDEX)));
+		}
+
+		/* Get pointer to page entries array */
+		page_entries = (BlockNumber *)((char *)index_page +
+									   SizeOfPageHeaderData);
+
+		/* Copy page entries to our map with validation */
+		for (i = 0;
+			 i < special->num_entries && pages_loaded < reader->num_pages;
+			 i++)
+		{
+			BlockNumber page_block = page_entries[i];
+
+			/* Validate block number is within relation bounds */
+			if (page_block >= reader->nblocks)
+			{
+				UnlockReleaseBuffer(index_buf);
+				ReleaseBuffer(reader->header_buffer);
+				pfree(reader->page_map);
+				pfree(reader->header);
+				pfree(reader);
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page block in segment page_map"),
+						 errdetail(
+								 "block %u at entry %u >= nblocks %u",
+								 page_block,
+								 pages_loaded,
+								 reader->nblocks)));
+			}
+			reader->page_map[pages_loaded++] = page_block;
+		}
+
+		/* Move to next page in chain */
+		page_index_block = special->next_page;
+
+		UnlockReleaseBuffer(index_buf);
+	}
+
+	if (pages_loaded != reader->num_pages)
+	{
+		/* Free allocated memory before erroring out */
+		if (reader->page_map)
+			pfree(reader->page_map);
+		pfree(reader);
+
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("segment page index is incomplete"),
+				 errdetail(
+						 "Expected %u pages but only loaded %u pages",
+						 reader->num_pages,
+						 pages_loaded),
+				 errhint("The index may be corrupted and should be rebuilt")));
+	}
+}
+
+/*
+ * Open segment for reading.
+ * If load_ctids is true, preloads all CTID arrays into memory (expensive).
+ * If load_ctids is false, skips CTID preloading - use tp_segment_lookup_ctid
+ * for deferred resolution.
+ */
+TpSegmentReader *
+tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
+{
+	TpSegmentReader *reader;
+	Buffer			 header_buf;
+	Page			 header_page;
+	TpSegmentHeader *header;
+	BlockNumber		 nblocks;
 
 	/*
 	 * Validate root_block is within the relation. In Postgres, blocks are
@@ -164,7 +363,8 @@ tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
 		}
 
 		reader->segment_version = raw_version;
-		reader->header			= palloc(sizeof(TpSegmentHeader));
+		/* Zeroed, so fields older formats lack read as absent */
+		reader->header			= palloc0(sizeof(TpSegmentHeader));
 
 		if (raw_version <= TP_SEGMENT_FORMAT_VERSION_3)
 		{
@@ -199,6 +399,7 @@ tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
 			/* V3 has no alive bitset */
 			header->alive_bitset_offset = 0;
 			header->alive_count			= header->num_docs;
+			header->term_bounds_offset	= 0;
 		}
 		else if (raw_version <= TP_SEGMENT_FORMAT_VERSION_4)
 		{
@@ -233,10 +434,19 @@ tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
 			/* V4 has no alive bitset */
 			header->alive_bitset_offset = 0;
 			header->alive_count			= header->num_docs;
+			header->term_bounds_offset	= 0;
+		}
+		else if (raw_version <= TP_SEGMENT_FORMAT_VERSION_5)
+		{
+			/* V5: V6 layout without the fields after page_index */
+			memcpy(reader->header,
+				   PageGetContents(header_page),
+				   offsetof(TpSegmentHeader, term_bounds_offset));
+			header = reader->header;
 		}
 		else if (raw_version <= TP_SEGMENT_FORMAT_VERSION)
 		{
-			/* V5+: full header */
+			/* V6: full header */
 			memcpy(reader->header,
 				   PageGetContents(header_page),
 				   sizeof(TpSegmentHeader));
@@ -259,102 +469,19 @@ tp_segment_open_ex(Relation index, BlockNumber root_block, bool load_ctids)
 	reader->num_pages = header->num_pages;
 	reader->nblocks	  = nblocks;
 
-	/* Get page index location from header */
-	page_index_block = header->page_index;
-
 	/* Keep header buffer for later use */
 	reader->header_buffer = header_buf;
 	LockBuffer(
 			header_buf, BUFFER_LOCK_UNLOCK); /* Just unlock, don't release */
 
-	/* Always load page map from disk - no caching due to concurrency issues */
-	reader->page_map = palloc(sizeof(BlockNumber) * reader->num_pages);
-
-	/* Read page index chain to build page map */
-	while (page_index_block != InvalidBlockNumber &&
-		   pages_loaded < reader->num_pages)
-	{
-		index_buf = ReadBuffer(index, page_index_block);
-		LockBuffer(index_buf, BUFFER_LOCK_SHARE);
-		index_page = BufferGetPage(index_buf);
-
-		/* Get special area with page index metadata */
-		special = (TpPageIndexSpecial *)PageGetSpecialPointer(index_page);
-
-		/* Validate magic number and page type */
-		if (special->magic != TP_PAGE_INDEX_MAGIC ||
-			special->page_type != TP_PAGE_FILE_INDEX)
-		{
-			UnlockReleaseBuffer(index_buf);
-			ReleaseBuffer(reader->header_buffer);
-			pfree(reader->page_map);
-			pfree(reader->header);
-			pfree(reader);
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg("invalid page index at block %u",
-							page_index_block),
-					 errdetail(
-							 "magic=0x%08X (expected 0x%08X), "
-							 "page_type=%u (expected %u)",
-							 special->magic,
-							 TP_PAGE_INDEX_MAGIC,
-							 special->page_type,
-							 TP_PAGE_FILE_INDEX)));
-		}
-
-		/* Get pointer to page entries array */
-		page_entries = (BlockNumber *)((char *)index_page +
-									   SizeOfPageHeaderData);
-
-		/* Copy page entries to our map with validation */
-		for (i = 0;
-			 i < special->num_entries && pages_loaded < reader->num_pages;
-			 i++)
-		{
-			BlockNumber page_block = page_entries[i];
-
-			/* Validate block number is within relation bounds */
-			if (page_block >= nblocks)
-			{
-				UnlockReleaseBuffer(index_buf);
-				ReleaseBuffer(reader->header_buffer);
-				pfree(reader->page_map);
-				pfree(reader->header);
-				pfree(reader);
-				ereport(ERROR,
-						(errcode(ERRCODE_DATA_CORRUPTED),
-						 errmsg("invalid page block in segment page_map"),
-						 errdetail(
-								 "block %u at entry %u >= nblocks %u",
-								 page_block,
-								 pages_loaded,
-								 nblocks)));
-			}
-			reader->page_map[pages_loaded++] = page_block;
-		}
-
-		/* Move to next page in chain */
-		page_index_block = special->next_page;
-
-		UnlockReleaseBuffer(index_buf);
-	}
-
-	if (pages_loaded != reader->num_pages)
+	/*
+	 * The page map of a segment this backend opened before comes from
+	 * the reader cache; otherwise walk the page index chain.
+	 */
+	if (!tp_segment_reader_cache_fill(reader))
 	{
-		/* Free allocated memory before erroring out */
-		if (reader->page_map)
-			pfree(reader->page_map);
-		pfree(reader);
-
-		ereport(ERROR,
-				(errcode(ERRCODE_DATA_CORRUPTED),
-				 errmsg("segment page index is incomplete"),
-				 errdetail(
-						 "Expected %u pages but only loaded %u pages",
-						 reader->num_pages,
-						 pages_loaded),
-				 errhint("The index may be corrupted and should be rebuilt")));
+		load_page_map(reader, header->page_index);
+		tp_segment_reader_cache_store(reader);
 	}
 
 	/*
@@ -523,6 +650,9 @@ tp_segment_close(TpSegmentReader *reader)
 	 */
 	if (reader->buffile == NULL)
 	{
+		/* Let the next open of this segment skip the term index header */
+		tp_segment_reader_cache_store_dict(reader);
+
 		if (BufferIsValid(reader->current_buffer))
 			ReleaseBuffer(reader->current_buffer);
 
@@ -541,6 +671,12 @@ tp_segment_close(TpSegmentReader *reader)
 		pfree(reader->cached_ctid_pages);
 	if (reader->cached_ctid_offsets)
 		pfree(reader->cached_ctid_offsets);
+	if (reader->cached_priors)
+		pfree(reader->cached_priors);
+	if (reader->dict_block)
+		pfree(reader->dict_block);
+	if (reader->dict_term)
+		pfree(reader->dict_term);
 
 	pfree(reader);
 }
@@ -939,6 +1075,19 @@ block_posting_cmp_by_doc_id(const void *a, const void *b)
 	return 0;
 }
 
+/*
+ * As above, for sorting an index permutation of a TpBlockPosting array
+ * (arg) so that per-posting positions can follow their postings.
+ */
+static int
+block_posting_index_cmp(const void *a, const void *b, void *arg)
+{
+	const TpBlockPosting *postings = (const TpBlockPosting *)arg;
+
+	return block_posting_cmp_by_doc_id(
+			&postings[*(const uint32 *)a], &postings[*(const uint32 *)b]);
+}
+
 /*
  * Per-term block information for streaming format.
  * Updated for streaming layout: postings written before skip index.
@@ -981,10 +1130,8 @@ tp_write_segment(
 	BlockNumber		page_index_root;
 	TpSegmentWriter writer;
 	TpSegmentHeader header;
-	TpDictionary	dict;
+	TpDictBuilder	dict;
 
-	uint32			*string_offsets;
-	uint32			 string_pos;
 	uint32			 i;
 	Buffer			 header_buf;
 	Page			 header_page;
@@ -996,6 +1143,14 @@ tp_write_segment(
 	uint32		 skip_entries_count;
 	uint32		 skip_entries_capacity;
 
+	/* Quantized impacts, if the index stores them */
+	TpImpactParams impact_params;
+	float4		   impact_avg_doc_len;
+	uint8		  *all_block_impacts = NULL; /* Parallel to skip entries */
+
+	/* Per-block max priors, if the index stores priors */
+	float4 *all_block_priors = NULL; /* Parallel to skip entries */
+
 	/* Initialize the writer to avoid garbage values */
 	memset(&writer, 0, sizeof(TpSegmentWriter));
 
@@ -1042,35 +1197,16 @@ tp_write_segment(
 	/* Write placeholder header */
 	tp_segment_writer_write(&writer, &header, sizeof(TpSegmentHeader));
 
-	/* Write dictionary section */
-	dict.num_terms = num_terms;
-	tp_segment_writer_write(
-			&writer, &dict, offsetof(TpDictionary, string_offsets));
-
-	/* Build string offsets */
-	string_offsets = palloc0(num_terms * sizeof(uint32));
-	string_pos	   = 0;
+	/* Write dictionary section: term index, then front-coded blocks */
+	tp_dict_builder_init(&dict, num_terms);
 	for (i = 0; i < num_terms; i++)
-	{
-		string_offsets[i] = string_pos;
-		string_pos += sizeof(uint32) + terms[i].term_len + sizeof(uint32);
-	}
+		tp_dict_builder_add(&dict, terms[i].term, terms[i].term_len);
+	tp_dict_builder_finish(&dict);
+	tp_segment_writer_write(&writer, dict.index.data, dict.index.len);
 
-	/* Write string offsets array */
-	tp_segment_writer_write(
-			&writer, string_offsets, num_terms * sizeof(uint32));
-
-	/* Write string pool */
 	header.strings_offset = writer.current_offset;
-	for (i = 0; i < num_terms; i++)
-	{
-		uint32 length	   = terms[i].term_len;
-		uint32 dict_offset = i * sizeof(TpDictEntry);
-
-		tp_segment_writer_write(&writer, &length, sizeof(uint32));
-		tp_segment_writer_write(&writer, terms[i].term, length);
-		tp_segment_writer_write(&writer, &dict_offset, sizeof(uint32));
-	}
+	tp_segment_writer_write(&writer, dict.blocks.data, dict.blocks.len);
+	tp_dict_builder_free(&dict);
 
 	/* Record entries offset - dict entries written after postings loop */
 	header.entries_offset = writer.current_offset;
@@ -1094,6 +1230,14 @@ tp_write_segment(
 	skip_entries_count	  = 0;
 	all_skip_entries = palloc(skip_entries_capacity * sizeof(TpSkipEntry));
 
+	tp_index_impact_params(index, &impact_params);
+	impact_avg_doc_len = tp_impact_segment_avg_doc_len(
+			&impact_params, docmap->total_tokens, docmap->num_docs);
+	if (impact_avg_doc_len > 0.0f)
+		all_block_impacts = palloc(skip_entries_capacity * sizeof(uint8));
+	if (docmap->priors)
+		all_block_priors = palloc(skip_entries_capacity * sizeof(float4));
+
 	/*
 	 * Streaming pass: for each term, convert postings and write immediately.
 	 */
@@ -1103,6 +1247,7 @@ tp_write_segment(
 		uint32			block_idx;
 		uint32			num_blocks;
 		TpBlockPosting *block_postings = NULL;
+		uint32		   *order		   = NULL;
 
 		/* Record where this term's postings start */
 		term_blocks[i].posting_offset	= writer.current_offset;
@@ -1139,7 +1284,7 @@ tp_write_segment(
 				block_postings[j].doc_id	= doc_id;
 				block_postings[j].frequency = (uint16)terms[i].freqs[j];
 				block_postings[j].fieldnorm = norm;
-				block_postings[j].reserved	= 0;
+				block_postings[j].impact	= 0;
 			}
 		}
 
@@ -1172,10 +1317,35 @@ tp_write_segment(
 		 * CTID, which is the invariant the segment format
 		 * documents and the merge / scoring code assumes.
 		 */
-		qsort(block_postings,
-			  doc_count,
-			  sizeof(TpBlockPosting),
-			  block_posting_cmp_by_doc_id);
+		if (terms[i].positions == NULL)
+			qsort(block_postings,
+				  doc_count,
+				  sizeof(TpBlockPosting),
+				  block_posting_cmp_by_doc_id);
+		else
+		{
+			/*
+			 * Positions are indexed by the original posting order, so
+			 * sort a permutation and remember it for the block loop.
+			 */
+			TpBlockPosting *sorted;
+			uint32			j;
+
+			order = palloc(doc_count * sizeof(uint32));
+			for (j = 0; j < doc_count; j++)
+				order[j] = j;
+			qsort_arg(order,
+					  doc_count,
+					  sizeof(uint32),
+					  block_posting_index_cmp,
+					  block_postings);
+
+			sorted = palloc(doc_count * sizeof(TpBlockPosting));
+			for (j = 0; j < doc_count; j++)
+				sorted[j] = block_postings[order[j]];
+			pfree(block_postings);
+			block_postings = sorted;
+		}
 
 		/* Write posting blocks and build skip entries */
 		for (block_idx = 0; block_idx < num_blocks; block_idx++)
@@ -1184,9 +1354,12 @@ tp_write_segment(
 			uint32		block_start = block_idx * TP_BLOCK_SIZE;
 			uint32 block_end = Min(block_start + TP_BLOCK_SIZE, doc_count);
 			uint32 j;
-			uint16 max_tf	   = 0;
-			uint8  min_norm	   = 255;
-			uint32 last_doc_id = 0;
+			uint16 max_tf		= 0;
+			uint8  min_norm		= 255;
+			uint32 last_doc_id	= 0;
+			uint8  block_impact = 0;
+			uint8  impact_flag	= 0;
+			float4 block_prior	= 0.0f;
 
 			/* Calculate block stats */
 			for (j = block_start; j < block_end; j++)
@@ -1198,6 +1371,11 @@ tp_write_segment(
 				if (block_postings[j].fieldnorm < min_norm)
 					min_norm = block_postings[j].fieldnorm;
 			}
+			if (all_block_priors)
+				block_prior = tp_prior_block_max(
+						docmap->priors,
+						&block_postings[block_start],
+						block_end - block_start);
 
 			/* Build skip entry with actual posting offset */
 			skip.last_doc_id	= last_doc_id;
@@ -1207,30 +1385,68 @@ tp_write_segment(
 			skip.posting_offset = writer.current_offset;
 			memset(skip.reserved, 0, sizeof(skip.reserved));
 
+			if (all_block_impacts)
+			{
+				block_impact = tp_impact_fill_block(
+						&block_postings[block_start],
+						block_end - block_start,
+						&impact_params,
+						impact_avg_doc_len);
+				impact_flag = TP_BLOCK_FLAG_IMPACTS;
+			}
+
 			/* Write posting block data (compressed or uncompressed) */
 			if (tp_compress_segments)
 			{
-				uint8  compressed_buf[TP_MAX_COMPRESSED_BLOCK_SIZE];
+				uint8  compressed_buf[TP_MAX_COMPRESSED_IMPACT_BLOCK_SIZE];
 				uint32 compressed_size;
 
 				compressed_size = tp_compress_block(
 						&block_postings[block_start],
 						block_end - block_start,
+						impact_flag != 0,
 						compressed_buf);
 
-				skip.flags = TP_BLOCK_FLAG_DELTA;
+				skip.flags = TP_BLOCK_FLAG_DELTA | impact_flag;
 				tp_segment_writer_write(
 						&writer, compressed_buf, compressed_size);
 			}
 			else
 			{
-				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED;
+				skip.flags = TP_BLOCK_FLAG_UNCOMPRESSED | impact_flag;
 				tp_segment_writer_write(
 						&writer,
 						&block_postings[block_start],
 						(block_end - block_start) * sizeof(TpBlockPosting));
 			}
 
+			/* Positions stream follows the block */
+			if (order != NULL)
+			{
+				StringInfoData stream;
+				uint32		   len;
+
+				initStringInfo(&stream);
+				for (j = block_start; j < block_end; j++)
+				{
+					uint32 src = order[j];
+
+					tp_positions_append(
+							&stream,
+							&terms[i].positions[terms[i].position_starts[src]],
+							terms[i].position_starts[src + 1] -
+									terms[i].position_starts[src]);
+				}
+
+				tp_skip_set_positions(
+						&skip,
+						(uint32)(writer.current_offset - skip.posting_offset));
+				len = (uint32)stream.len;
+				tp_segment_writer_write(&writer, &len, sizeof(uint32));
+				tp_segment_writer_write(&writer, stream.data, len);
+				pfree(stream.data);
+			}
+
 			/* Accumulate skip entry */
 			if (skip_entries_count >= skip_entries_capacity)
 			{
@@ -1238,11 +1454,25 @@ tp_write_segment(
 				all_skip_entries = repalloc_huge(
 						all_skip_entries,
 						skip_entries_capacity * sizeof(TpSkipEntry));
+				if (all_block_impacts)
+					all_block_impacts = repalloc_huge(
+							all_block_impacts,
+							skip_entries_capacity * sizeof(uint8));
+				if (all_block_priors)
+					all_block_priors = repalloc_huge(
+							all_block_priors,
+							skip_entries_capacity * sizeof(float4));
 			}
+			if (all_block_impacts)
+				all_block_impacts[skip_entries_count] = block_impact;
+			if (all_block_priors)
+				all_block_priors[skip_entries_count] = block_prior;
 			all_skip_entries[skip_entries_count++] = skip;
 		}
 
 		pfree(block_postings);
+		if (order != NULL)
+			pfree(order);
 	}
 
 	/* Skip index starts here - after all postings */
@@ -1257,6 +1487,49 @@ tp_write_segment(
 				skip_entries_count * sizeof(TpSkipEntry));
 	}
 
+	/* Write per-term bounds, parallel to the dict entries */
+	header.term_bounds_offset = writer.current_offset;
+	{
+		TpTermBounds *bounds = palloc(num_terms * sizeof(TpTermBounds));
+
+		for (i = 0; i < num_terms; i++)
+		{
+			uint32 start = term_blocks[i].skip_entry_start;
+
+			tp_term_bounds_from_skip(
+					&all_skip_entries[start],
+					all_block_impacts ? &all_block_impacts[start] : NULL,
+					term_blocks[i].block_count,
+					&bounds[i]);
+		}
+		tp_segment_writer_write(
+				&writer, bounds, num_terms * sizeof(TpTermBounds));
+		pfree(bounds);
+	}
+
+	/* Write per-block max impacts, parallel to the skip index */
+	if (all_block_impacts)
+	{
+		header.block_impacts_offset = writer.current_offset;
+		header.impact_avg_doc_len	= impact_avg_doc_len;
+		if (skip_entries_count > 0)
+			tp_segment_writer_write(
+					&writer, all_block_impacts, skip_entries_count);
+		pfree(all_block_impacts);
+	}
+
+	/* Write per-block max priors, parallel to the skip index */
+	if (all_block_priors)
+	{
+		header.block_priors_offset = writer.current_offset;
+		if (skip_entries_count > 0)
+			tp_segment_writer_write(
+					&writer,
+					all_block_priors,
+					skip_entries_count * sizeof(float4));
+		pfree(all_block_priors);
+	}
+
 	pfree(all_skip_entries);
 
 	/* Write fieldnorm table */
@@ -1267,6 +1540,18 @@ tp_write_segment(
 				&writer, docmap->fieldnorms, docmap->num_docs * sizeof(uint8));
 	}
 
+	/* Write prior table, parallel to the fieldnorm table */
+	if (docmap->priors)
+	{
+		header.prior_offset = writer.current_offset;
+		header.max_prior	= tp_prior_max(docmap->priors, docmap->num_docs);
+		if (docmap->num_docs > 0)
+			tp_segment_writer_write(
+					&writer,
+					docmap->priors,
+					docmap->num_docs * sizeof(float4));
+	}
+
 	/* Write CTID pages array */
 	header.ctid_pages_offset = writer.current_offset;
 	if (docmap->num_docs > 0)
@@ -1468,6 +1753,12 @@ tp_write_segment(
 		existing_header->entries_offset		 = header.entries_offset;
 		existing_header->postings_offset	 = header.postings_offset;
 		existing_header->skip_index_offset	 = header.skip_index_offset;
+		existing_header->term_bounds_offset	 = header.term_bounds_offset;
+		existing_header->block_impacts_offset = header.block_impacts_offset;
+		existing_header->impact_avg_doc_len	  = header.impact_avg_doc_len;
+		existing_header->prior_offset		  = header.prior_offset;
+		existing_header->block_priors_offset  = header.block_priors_offset;
+		existing_header->max_prior			  = header.max_prior;
 		existing_header->fieldnorm_offset	 = header.fieldnorm_offset;
 		existing_header->ctid_pages_offset	 = header.ctid_pages_offset;
 		existing_header->ctid_offsets_offset = header.ctid_offsets_offset;
@@ -1486,7 +1777,6 @@ tp_write_segment(
 	FlushRelationBuffers(index);
 
 	/* Clean up writer-owned state. Caller frees terms[] and docmap. */
-	pfree(string_offsets);
 	pfree(term_blocks);
 	if (writer.pages)
 		pfree(writer.pages);
@@ -1619,7 +1909,8 @@ tp_dump_segment_to_output(
 	LockBuffer(header_buf, BUFFER_LOCK_SHARE);
 	header_page = BufferGetPage(header_buf);
 
-	/* Version-aware header read */
+	/* Version-aware header read; fields older formats lack stay 0 */
+	memset(&header, 0, sizeof(TpSegmentHeader));
 	{
 		uint32 raw_version;
 		memcpy(&raw_version,
@@ -1654,6 +1945,7 @@ tp_dump_segment_to_output(
 			header.num_docs			   = v3.num_docs;
 			header.total_tokens		   = v3.total_tokens;
 			header.page_index		   = v3.page_index;
+			header.term_bounds_offset  = 0;
 		}
 		else if (raw_version <= TP_SEGMENT_FORMAT_VERSION_4)
 		{
@@ -1684,6 +1976,13 @@ tp_dump_segment_to_output(
 			header.num_docs			   = v4.num_docs;
 			header.total_tokens		   = v4.total_tokens;
 			header.page_index		   = v4.page_index;
+			header.term_bounds_offset  = 0;
+		}
+		else if (raw_version <= TP_SEGMENT_FORMAT_VERSION_5)
+		{
+			memcpy(&header,
+				   PageGetContents(header_page),
+				   offsetof(TpSegmentHeader, term_bounds_offset));
 		}
 		else
 		{
@@ -1770,6 +2069,28 @@ tp_dump_segment_to_output(
 			out,
 			"CTID offsets offset: %" PRIu64 "\n",
 			header.ctid_offsets_offset);
+	dump_printf(
+			out,
+			"Term bounds offset: %" PRIu64 "\n",
+			header.term_bounds_offset);
+	dump_printf(
+			out,
+			"Block impacts offset: %" PRIu64 "\n",
+			header.block_impacts_offset);
+	if (header.block_impacts_offset != 0)
+		dump_printf(
+				out,
+				"Impact avg doc length: %.2f\n",
+				header.impact_avg_doc_len);
+	dump_printf(out, "Prior offset: %" PRIu64 "\n", header.prior_offset);
+	if (header.prior_offset != 0)
+	{
+		dump_printf(
+				out,
+				"Block priors offset: %" PRIu64 "\n",
+				header.block_priors_offset);
+		dump_printf(out, "Max prior: %g\n", header.max_prior);
+	}
 
 	/* Page layout summary */
 	if (header.data_size > 0)
@@ -1808,8 +2129,6 @@ tp_dump_segment_to_output(
 	if (header.num_terms > 0 && header.dictionary_offset > 0)
 	{
 		TpSegmentReader *reader;
-		TpDictionary	 dict_header;
-		uint32			*string_offsets;
 		uint32			 i;
 
 		/* Validate offsets */
@@ -1828,31 +2147,16 @@ tp_dump_segment_to_output(
 
 		reader = tp_segment_open(index, segment_root);
 
-		/* Read dictionary header */
-		tp_segment_read(
-				reader,
-				header.dictionary_offset,
-				&dict_header,
-				sizeof(dict_header.num_terms));
-
-		/* Read string offsets */
-		string_offsets = palloc(sizeof(uint32) * dict_header.num_terms);
-		tp_segment_read(
-				reader,
-				header.dictionary_offset + sizeof(dict_header.num_terms),
-				string_offsets,
-				sizeof(uint32) * dict_header.num_terms);
-
 		/* In full mode show all terms; otherwise limit */
 		terms_to_show = out->full_dump ? header.num_terms
 									   : Min(header.num_terms, 20);
+		terms_to_show = Min(terms_to_show, tp_segment_num_terms(reader));
 
 		for (i = 0; i < terms_to_show; i++)
 		{
 			char *term_text;
 
-			term_text = tp_segment_read_term_at_index(
-					reader, &header, string_offsets, i);
+			term_text = tp_segment_read_term_at_index(reader, i);
 
 			if (strlen(term_text) > 1024)
 			{
@@ -1954,7 +2258,6 @@ tp_dump_segment_to_output(
 					header.num_terms - terms_to_show);
 		}
 
-		pfree(string_offsets);
 		tp_segment_close(reader);
 	}
 
@@ -13,6 +13,7 @@
 #include <storage/buffile.h>
 
 #include "constants.h"
+#include "index/source.h"
 #include "segment/format.h"
 #include "storage/bufmgr.h"
 #include "storage/itemptr.h"
@@ -69,6 +70,36 @@ tp_skip_entry_size(uint32 version)
 													: sizeof(TpSkipEntry);
 }
 
+/*
+ * Fold a term's skip entries into its segment-wide bounds (V6+).
+ * Writers call this once per term after building its skip entries.
+ * block_impacts, parallel to skips, is NULL if the segment has no
+ * quantized impacts.
+ */
+static inline void
+tp_term_bounds_from_skip(
+		const TpSkipEntry *skips,
+		const uint8		  *block_impacts,
+		uint32			   block_count,
+		TpTermBounds	  *bounds)
+{
+	uint32 i;
+
+	bounds->max_tf		  = 0;
+	bounds->min_fieldnorm = 255;
+	bounds->max_impact	  = 0;
+
+	for (i = 0; i < block_count; i++)
+	{
+		if (skips[i].block_max_tf > bounds->max_tf)
+			bounds->max_tf = skips[i].block_max_tf;
+		if (skips[i].block_max_norm < bounds->min_fieldnorm)
+			bounds->min_fieldnorm = skips[i].block_max_norm;
+		if (block_impacts && block_impacts[i] > bounds->max_impact)
+			bounds->max_impact = block_impacts[i];
+	}
+}
+
 /*
  * Document length - 12 bytes (padded to 16)
  */
@@ -91,6 +122,17 @@ extern void tp_batch_get_segment_doc_freq(
 		int			term_count,
 		uint32	   *doc_freqs);
 
+/*
+ * Call fn with every term starting with prefix in a level's segments,
+ * and its doc_freq in each segment that has it
+ */
+extern void tp_segment_foreach_prefix(
+		Relation	   index,
+		BlockNumber	   first_segment,
+		const char	  *prefix,
+		TpTermCallback fn,
+		void		  *arg);
+
 /*
  * Mark a segment buffer dirty and immediately emit a full-page WAL image when
  * WAL is required for the relation.  Segment pages use custom layouts, so the
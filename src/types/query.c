@@ -18,7 +18,10 @@
 #include <catalog/pg_index.h>
 #include <catalog/pg_inherits.h>
 #include <commands/defrem.h>
+#include <ctype.h>
+#include <float.h>
 #include <fmgr.h>
+#include <math.h>
 #include <lib/stringinfo.h>
 #include <libpq/pqformat.h>
 #include <nodes/pg_list.h>
@@ -30,6 +33,7 @@
 #include <utils/regproc.h>
 #include <utils/rel.h>
 #include <utils/syscache.h>
+#include <utils/timestamp.h>
 #include <varatt.h>
 
 #include "access/am.h"
@@ -42,6 +46,8 @@
 #include "memtable/chain_source.h"
 #include "planner/hooks.h"
 #include "scoring/bm25.h"
+#include "scoring/expand.h"
+#include "scoring/phrase.h"
 #include "segment/fieldnorm.h"
 #include "segment/io.h"
 #include "segment/segment.h"
@@ -62,6 +68,9 @@
  */
 #define MAX_CACHED_TERMS 64
 
+/* GUC variable (registered in mod.c) */
+bool tp_query_operators = true;
+
 typedef struct TermIdfEntry
 {
 	char   term[NAMEDATALEN]; /* null-terminated term string */
@@ -163,12 +172,19 @@ PG_FUNCTION_INFO_V1(tpquery_recv);
 PG_FUNCTION_INFO_V1(tpquery_send);
 PG_FUNCTION_INFO_V1(to_tpquery_text);
 PG_FUNCTION_INFO_V1(to_tpquery_text_index);
+PG_FUNCTION_INFO_V1(to_tpquery_text_index_msm);
+PG_FUNCTION_INFO_V1(tpquery_search_after);
+PG_FUNCTION_INFO_V1(tpquery_with_prior);
+PG_FUNCTION_INFO_V1(tpquery_with_decay);
 PG_FUNCTION_INFO_V1(bm25_text_bm25query_score);
 PG_FUNCTION_INFO_V1(bm25_text_text_score);
 PG_FUNCTION_INFO_V1(bm25_textarray_bm25query_score);
 PG_FUNCTION_INFO_V1(bm25_textarray_text_score);
+PG_FUNCTION_INFO_V1(bm25_text_bm25query_match);
+PG_FUNCTION_INFO_V1(bm25_textarray_bm25query_match);
 PG_FUNCTION_INFO_V1(tpquery_eq);
 PG_FUNCTION_INFO_V1(bm25_get_current_score);
+PG_FUNCTION_INFO_V1(bm25_last_scan_partial);
 
 /*
  * bm25_get_current_score - stub function for ORDER BY optimization
@@ -184,19 +200,267 @@ bm25_get_current_score(PG_FUNCTION_ARGS pg_attribute_unused())
 	PG_RETURN_FLOAT8(tp_get_cached_score());
 }
 
+/*
+ * bm25_last_scan_partial - did the scoring budget cut the last scan short?
+ *
+ * True if the backend's most recent ranked index scan ran out of
+ * pg_textsearch.scoring_time_budget or scoring_block_budget and so
+ * returned the best documents found so far rather than the exact top-k.
+ */
+Datum
+bm25_last_scan_partial(PG_FUNCTION_ARGS pg_attribute_unused())
+{
+	PG_RETURN_BOOL(tp_get_scan_partial());
+}
+
+/*
+ * Reject a min_should_match outside [0, TPQUERY_MAX_MIN_SHOULD_MATCH]
+ */
+static void
+check_min_should_match(int64 min_should_match)
+{
+	if (min_should_match < 0 ||
+		min_should_match > TPQUERY_MAX_MIN_SHOULD_MATCH)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("min_should_match must be between 0 and %d",
+						TPQUERY_MAX_MIN_SHOULD_MATCH)));
+}
+
+/*
+ * Strip a trailing " @N" min_should_match suffix from `query_text` in
+ * place and return N, or 0 if there is none.  The suffix must be the
+ * last word and be preceded by whitespace, so "@2" on its own and
+ * "user@host" stay ordinary query text.
+ */
+static int32
+strip_min_should_match(char *query_text)
+{
+	char  *end = query_text + strlen(query_text);
+	char  *at;
+	char  *p;
+	int64  value = 0;
+
+	while (end > query_text && isspace((unsigned char)end[-1]))
+		end--;
+
+	for (p = end; p > query_text && isdigit((unsigned char)p[-1]); p--)
+		;
+	if (p == end || p - 1 <= query_text || p[-1] != '@' ||
+		!isspace((unsigned char)p[-2]))
+		return 0;
+	at = p - 1;
+
+	for (; p < end; p++)
+	{
+		value = value * 10 + (*p - '0');
+		if (value > TPQUERY_MAX_MIN_SHOULD_MATCH)
+			break;
+	}
+	check_min_should_match(value);
+
+	/* Drop the suffix and the whitespace before it */
+	while (at > query_text && isspace((unsigned char)at[-1]))
+		at--;
+	*at = '\0';
+	return (int32)value;
+}
+
+/* Text form of a search-after position: " @after:score,(block,offset)" */
+#define TPQUERY_SEARCH_AFTER_PREFIX " @after:"
+
+/*
+ * Reject a search-after score that no document can have
+ */
+static void
+check_search_after_score(float8 score)
+{
+	if (isnan(score) || isinf(score))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("search-after score must be a finite number")));
+}
+
+/*
+ * Strip a trailing " @after:S,(B,O)" search-after suffix from
+ * `query_text` in place.  Returns false if there is none.
+ */
+static bool
+strip_search_after(char *query_text, float4 *score, ItemPointerData *ctid)
+{
+	char *suffix = NULL;
+	char *p;
+	char *comma;
+	char *end;
+
+	for (p = strstr(query_text, TPQUERY_SEARCH_AFTER_PREFIX); p != NULL;
+		 p = strstr(p + 1, TPQUERY_SEARCH_AFTER_PREFIX))
+		suffix = p;
+	if (suffix == NULL)
+		return false;
+
+	p	  = suffix + strlen(TPQUERY_SEARCH_AFTER_PREFIX);
+	comma = strchr(p, ',');
+	if (comma == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid search-after position \"%s\"", p),
+				 errhint("Expected \"@after:score,(block,offset)\".")));
+	*comma = '\0';
+
+	end = comma + 1 + strlen(comma + 1);
+	while (end > comma + 1 && isspace((unsigned char)end[-1]))
+		*--end = '\0';
+
+	*score = DatumGetFloat4(DirectFunctionCall1(float4in, CStringGetDatum(p)));
+	check_search_after_score(*score);
+	*ctid = *(ItemPointer)DatumGetPointer(
+			DirectFunctionCall1(tidin, CStringGetDatum(comma + 1)));
+
+	/* Drop the suffix and the whitespace before it */
+	while (suffix > query_text && isspace((unsigned char)suffix[-1]))
+		suffix--;
+	*suffix = '\0';
+	return true;
+}
+
+/*
+ * Text forms of a static prior weighting: " @prior:weight" and
+ * " @decay:weight,half_life,origin" (seconds, epoch seconds)
+ */
+#define TPQUERY_PRIOR_PREFIX " @prior:"
+#define TPQUERY_DECAY_PREFIX " @decay:"
+
+/*
+ * Reject a prior weighting that would not keep scores finite and
+ * monotone in the prior
+ */
+static void
+check_prior(const TpQueryPrior *prior)
+{
+	if (isnan(prior->weight) || isinf(prior->weight) || prior->weight < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("prior weight must be a finite non-negative "
+						"number")));
+	if (isnan(prior->half_life) || isinf(prior->half_life) ||
+		prior->half_life < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("decay half-life must be positive")));
+	if (isnan(prior->origin) || isinf(prior->origin))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("decay origin must be finite")));
+}
+
+/* Parse one comma-terminated float8 field of a prior suffix */
+static float8
+prior_field(char **p, bool last, const char *suffix)
+{
+	char *field = *p;
+	char *comma = last ? NULL : strchr(field, ',');
+
+	if (!last && comma == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid decay prior \"%s\"", suffix),
+				 errhint("Expected \"@decay:weight,half_life,origin\".")));
+	if (comma != NULL)
+	{
+		*comma = '\0';
+		*p	   = comma + 1;
+	}
+	return DatumGetFloat8(
+			DirectFunctionCall1(float8in, CStringGetDatum(field)));
+}
+
+/*
+ * Strip a trailing " @prior:W" or " @decay:W,HL,O" suffix from
+ * `query_text` in place.  Returns false if there is none.
+ */
+static bool
+strip_prior(char *query_text, TpQueryPrior *prior)
+{
+	char *suffix = NULL;
+	bool  decay	 = false;
+	char *p;
+	char *end;
+
+	for (p = strstr(query_text, TPQUERY_PRIOR_PREFIX); p != NULL;
+		 p = strstr(p + 1, TPQUERY_PRIOR_PREFIX))
+		suffix = p;
+	for (p = strstr(query_text, TPQUERY_DECAY_PREFIX); p != NULL;
+		 p = strstr(p + 1, TPQUERY_DECAY_PREFIX))
+	{
+		if (suffix == NULL || p > suffix)
+		{
+			suffix = p;
+			decay  = true;
+		}
+	}
+	if (suffix == NULL)
+		return false;
+
+	p	= suffix + strlen(decay ? TPQUERY_DECAY_PREFIX : TPQUERY_PRIOR_PREFIX);
+	end = p + strlen(p);
+	while (end > p && isspace((unsigned char)end[-1]))
+		*--end = '\0';
+
+	memset(prior, 0, sizeof(TpQueryPrior));
+	if (decay)
+	{
+		char *text = pstrdup(p);
+
+		prior->weight	 = (float4)prior_field(&p, false, text);
+		prior->half_life = (float4)prior_field(&p, false, text);
+		prior->origin	 = prior_field(&p, true, text);
+		if (prior->half_life <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("decay half-life must be positive")));
+		pfree(text);
+	}
+	else
+		prior->weight = (float4)prior_field(&p, true, p);
+	check_prior(prior);
+
+	/* Drop the suffix and the whitespace before it */
+	while (suffix > query_text && isspace((unsigned char)suffix[-1]))
+		suffix--;
+	*suffix = '\0';
+	return true;
+}
+
 /*
  * tpquery input function
  * Formats:
  *   "query_text" - simple query without index (InvalidOid)
  *   "index_name:query_text" - query with index name (resolved to OID)
+ * Either form may end in " @N": at least N optional query terms must
+ * match (min_should_match), unless pg_textsearch.query_operators is
+ * off, in which case " @N" stays query text as in 1.3.x.  Then may come
+ * " @after:S,(B,O)": a
+ * search-after position, and then in " @prior:W" or " @decay:W,HL,O":
+ * a static prior weighting.
  * Note: If query_text contains a colon, use to_tpquery() instead
  */
 Datum
 tpquery_in(PG_FUNCTION_ARGS)
 {
-	char	*str = PG_GETARG_CSTRING(0);
-	char	*colon;
-	TpQuery *result;
+	char			*str = pstrdup(PG_GETARG_CSTRING(0));
+	char			*colon;
+	TpQuery			*result;
+	int32			 min_should_match;
+	bool			 search_after;
+	float4			 after_score = 0.0f;
+	ItemPointerData	 after_ctid;
+	bool			 has_prior;
+	TpQueryPrior	 prior;
+
+	has_prior		 = strip_prior(str, &prior);
+	search_after	 = strip_search_after(str, &after_score, &after_ctid);
+	min_should_match = tp_query_operators ? strip_min_should_match(str) : 0;
 
 	/* Check for index name prefix (format: "index_name:query") */
 	colon = strchr(str, ':');
@@ -212,15 +476,22 @@ tpquery_in(PG_FUNCTION_ARGS)
 		index_name[index_name_len] = '\0';
 
 		/* Create query with index name (resolves to OID) */
-		result = create_tpquery_from_name(query_text, index_name);
+		result = create_tpquery_from_name(
+				query_text, index_name, min_should_match);
 		pfree(index_name);
 	}
 	else
 	{
 		/* No index name prefix - create without index */
-		result = create_tpquery(str, InvalidOid);
+		result = create_tpquery_full(str, InvalidOid, false, min_should_match);
 	}
 
+	if (search_after)
+		result = tpquery_set_search_after(result, after_score, &after_ctid);
+	if (has_prior)
+		result = tpquery_set_prior(result, &prior);
+
+	pfree(str);
 	PG_RETURN_POINTER(result);
 }
 
@@ -255,6 +526,45 @@ tpquery_out(PG_FUNCTION_ARGS)
 		appendStringInfo(str, "%s", query_text);
 	}
 
+	if (get_tpquery_min_should_match(tpquery) > 0)
+		appendStringInfo(str, " @%d", get_tpquery_min_should_match(tpquery));
+
+	{
+		float4			after_score;
+		ItemPointerData after_ctid;
+
+		if (get_tpquery_search_after(tpquery, &after_score, &after_ctid))
+			appendStringInfo(
+					str,
+					TPQUERY_SEARCH_AFTER_PREFIX "%s,%s",
+					DatumGetCString(DirectFunctionCall1(
+							float4out, Float4GetDatum(after_score))),
+					DatumGetCString(DirectFunctionCall1(
+							tidout, PointerGetDatum(&after_ctid))));
+	}
+
+	{
+		TpQueryPrior prior;
+
+		if (get_tpquery_prior(tpquery, &prior))
+		{
+			char *weight = DatumGetCString(DirectFunctionCall1(
+					float4out, Float4GetDatum(prior.weight)));
+
+			if (prior.half_life > 0)
+				appendStringInfo(
+						str,
+						TPQUERY_DECAY_PREFIX "%s,%s,%s",
+						weight,
+						DatumGetCString(DirectFunctionCall1(
+								float4out, Float4GetDatum(prior.half_life))),
+						DatumGetCString(DirectFunctionCall1(
+								float8out, Float8GetDatum(prior.origin))));
+			else
+				appendStringInfo(str, TPQUERY_PRIOR_PREFIX "%s", weight);
+		}
+	}
+
 	PG_RETURN_CSTRING(str->data);
 }
 
@@ -264,6 +574,10 @@ tpquery_out(PG_FUNCTION_ARGS)
  *                   (4 bytes) + query_text
  * Binary format v2: version (1 byte) + flags (1 byte) + index_oid (4 bytes) +
  *                   query_text_len (4 bytes) + query_text
+ * Binary format v3: v2 + min_should_match (4 bytes) + score (float4)
+ *                   and CTID (block, offset) if the search-after flag
+ *                   is set + weight, half-life (float4) and origin
+ *                   (float8) if the prior flag is set
  */
 Datum
 tpquery_recv(PG_FUNCTION_ARGS)
@@ -276,16 +590,17 @@ tpquery_recv(PG_FUNCTION_ARGS)
 	int32	   query_text_len;
 	char	  *query_text;
 	bool	   explicit_index;
+	int32	   min_should_match = 0;
 
 	/* Read and validate version */
 	version = pq_getmsgbyte(buf);
-	if (version != 1 && version != 2)
+	if (version < 1 || version > TPQUERY_VERSION)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATA_EXCEPTION),
 				 errmsg("unsupported bm25query binary format version %u",
 						version),
-				 errhint("Expected version 1 or 2. This may indicate data "
-						 "from "
+				 errhint("Expected version 1 to 3. This may indicate "
+						 "data from "
 						 "an incompatible pg_textsearch version.")));
 
 	/* Read flags for v2+ */
@@ -305,17 +620,51 @@ tpquery_recv(PG_FUNCTION_ARGS)
 	pq_copymsgbytes(buf, query_text, query_text_len);
 	query_text[query_text_len] = '\0';
 
+	if (version >= 3)
+	{
+		min_should_match = pq_getmsgint(buf, sizeof(int32));
+		check_min_should_match(min_should_match);
+	}
+
 	explicit_index = (flags & TPQUERY_FLAG_EXPLICIT_INDEX) != 0;
-	result = create_tpquery_explicit(query_text, index_oid, explicit_index);
+	result		   = create_tpquery_full(
+			  query_text, index_oid, explicit_index, min_should_match);
 	pfree(query_text);
 
+	if (version >= 3 && (flags & TPQUERY_FLAG_SEARCH_AFTER) != 0)
+	{
+		float4			after_score = pq_getmsgfloat4(buf);
+		ItemPointerData after_ctid;
+		BlockNumber		block  = pq_getmsgint(buf, sizeof(BlockNumber));
+		OffsetNumber	offset = pq_getmsgint(buf, sizeof(OffsetNumber));
+
+		check_search_after_score(after_score);
+		ItemPointerSet(&after_ctid, block, offset);
+		result = tpquery_set_search_after(result, after_score, &after_ctid);
+	}
+
+	if (version >= 3 && (flags & TPQUERY_FLAG_PRIOR) != 0)
+	{
+		TpQueryPrior prior;
+
+		prior.weight	= pq_getmsgfloat4(buf);
+		prior.half_life = pq_getmsgfloat4(buf);
+		prior.origin	= pq_getmsgfloat8(buf);
+		check_prior(&prior);
+		result = tpquery_set_prior(result, &prior);
+	}
+
 	PG_RETURN_POINTER(result);
 }
 
 /*
  * tpquery send function (binary output)
- * Binary format v2: version (1 byte) + flags (1 byte) + index_oid (4 bytes) +
- *                   query_text_len (4 bytes) + query_text
+ * Binary format v3: version (1 byte) + flags (1 byte) + index_oid (4 bytes) +
+ *                   query_text_len (4 bytes) + query_text +
+ *                   min_should_match (4 bytes) + with the search-after
+ *                   flag, score (4 bytes), block (4 bytes), offset
+ *                   (2 bytes) + with the prior flag, weight (4 bytes),
+ *                   half-life (4 bytes), origin (8 bytes)
  */
 Datum
 tpquery_send(PG_FUNCTION_ARGS)
@@ -332,6 +681,30 @@ tpquery_send(PG_FUNCTION_ARGS)
 
 	query_text = get_tpquery_text(tpquery);
 	pq_sendbytes(&buf, query_text, tpquery->query_text_len);
+	pq_sendint32(&buf, get_tpquery_min_should_match(tpquery));
+
+	{
+		float4			after_score;
+		ItemPointerData after_ctid;
+
+		if (get_tpquery_search_after(tpquery, &after_score, &after_ctid))
+		{
+			pq_sendfloat4(&buf, after_score);
+			pq_sendint32(&buf, ItemPointerGetBlockNumber(&after_ctid));
+			pq_sendint16(&buf, ItemPointerGetOffsetNumber(&after_ctid));
+		}
+	}
+
+	{
+		TpQueryPrior prior;
+
+		if (get_tpquery_prior(tpquery, &prior))
+		{
+			pq_sendfloat4(&buf, prior.weight);
+			pq_sendfloat4(&buf, prior.half_life);
+			pq_sendfloat8(&buf, prior.origin);
+		}
+	}
 
 	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
 }
@@ -360,13 +733,107 @@ to_tpquery_text_index(PG_FUNCTION_ARGS)
 	text	*index_text = PG_GETARG_TEXT_PP(1);
 	char	*query_text = text_to_cstring(input_text);
 	char	*index_name = text_to_cstring(index_text);
-	TpQuery *result		= create_tpquery_from_name(query_text, index_name);
+	TpQuery *result = create_tpquery_from_name(query_text, index_name, 0);
 
 	pfree(query_text);
 	pfree(index_name);
 	PG_RETURN_POINTER(result);
 }
 
+/*
+ * Create a tpquery from text with index name and min_should_match
+ */
+Datum
+to_tpquery_text_index_msm(PG_FUNCTION_ARGS)
+{
+	text	*input_text		  = PG_GETARG_TEXT_PP(0);
+	text	*index_text		  = PG_GETARG_TEXT_PP(1);
+	int32	 min_should_match = PG_GETARG_INT32(2);
+	char	*query_text		  = text_to_cstring(input_text);
+	char	*index_name		  = text_to_cstring(index_text);
+	TpQuery *result;
+
+	check_min_should_match(min_should_match);
+	result = create_tpquery_from_name(
+			query_text, index_name, min_should_match);
+
+	pfree(query_text);
+	pfree(index_name);
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Copy a tpquery with a search-after position: the <@> score and CTID
+ * of the last row of the previous page
+ */
+Datum
+tpquery_search_after(PG_FUNCTION_ARGS)
+{
+	TpQuery	   *query = (TpQuery *)PG_DETOAST_DATUM(PG_GETARG_DATUM(0));
+	float8		score = PG_GETARG_FLOAT8(1);
+	ItemPointer ctid  = (ItemPointer)PG_GETARG_POINTER(2);
+
+	check_search_after_score(score);
+	if (!ItemPointerIsValid(ctid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("search-after CTID must be valid")));
+
+	PG_RETURN_POINTER(tpquery_set_search_after(query, (float4)score, ctid));
+}
+
+/*
+ * Copy a tpquery that adds weight times the index's static prior to
+ * every document's score
+ */
+Datum
+tpquery_with_prior(PG_FUNCTION_ARGS)
+{
+	TpQuery		*query = (TpQuery *)PG_DETOAST_DATUM(PG_GETARG_DATUM(0));
+	TpQueryPrior prior;
+
+	memset(&prior, 0, sizeof(TpQueryPrior));
+	prior.weight = (float4)PG_GETARG_FLOAT8(1);
+	check_prior(&prior);
+
+	PG_RETURN_POINTER(tpquery_set_prior(query, &prior));
+}
+
+/*
+ * Copy a tpquery that adds weight * 0.5^(age / half_life) to every
+ * document's score, age being how long before origin the document's
+ * prior (a timestamp) lies
+ */
+Datum
+tpquery_with_decay(PG_FUNCTION_ARGS)
+{
+	TpQuery		*query	   = (TpQuery *)PG_DETOAST_DATUM(PG_GETARG_DATUM(0));
+	float8		 weight	   = PG_GETARG_FLOAT8(1);
+	Interval	*half_life = PG_GETARG_INTERVAL_P(2);
+	TimestampTz	 origin	   = PG_GETARG_TIMESTAMPTZ(3);
+	TpQueryPrior prior;
+	float8		 seconds;
+
+	seconds = (float8)half_life->time / USECS_PER_SEC +
+			  ((float8)half_life->month * DAYS_PER_MONTH + half_life->day) *
+					  SECS_PER_DAY;
+	if (!(seconds > 0) || seconds > FLT_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("decay half-life must be positive")));
+	if (TIMESTAMP_NOT_FINITE(origin))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("decay origin must be finite")));
+
+	prior.weight	= (float4)weight;
+	prior.half_life = (float4)seconds;
+	prior.origin	= tp_epoch_seconds(origin);
+	check_prior(&prior);
+
+	PG_RETURN_POINTER(tpquery_set_prior(query, &prior));
+}
+
 /*
  * Find the first child index of a partitioned index via pg_inherits.
  * Returns InvalidOid if no children found.
@@ -655,6 +1122,153 @@ calculate_term_score(
 	return term_score;
 }
 
+/*
+ * Helper: Check a document's terms against +required / -excluded words.
+ * `words` is tokenized with the index's configuration; every lexeme
+ * must be present (required) or absent (excluded).
+ */
+static bool
+doc_terms_match(
+		Oid			text_config_oid,
+		const char *words,
+		bool		required,
+		char	  **doc_terms,
+		int32	   *doc_frequencies,
+		int			doc_term_count)
+{
+	TSVector   tsv;
+	WordEntry *entries;
+	int		   i;
+
+	tsv = DatumGetTSVector(DirectFunctionCall2Coll(
+			to_tsvector_byid,
+			InvalidOid,
+			ObjectIdGetDatum(text_config_oid),
+			PointerGetDatum(cstring_to_text(words))));
+	entries = ARRPTR(tsv);
+
+	for (i = 0; i < tsv->size; i++)
+	{
+		char *lexeme = pnstrdup(STRPTR(tsv) + entries[i].pos, entries[i].len);
+		bool  present;
+
+		present = find_term_frequency_in_arrays(
+						  doc_terms, doc_frequencies, doc_term_count, lexeme) >
+				  0.0f;
+		pfree(lexeme);
+
+		if (present != required)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Helper: Count the query lexemes present in a document, leaving out
+ * lexemes of the +required words (min_should_match only counts
+ * optional terms).
+ */
+static int
+count_optional_matches(
+		Oid			text_config_oid,
+		TSVector	query_tsvector,
+		const char *required_text,
+		char	  **doc_terms,
+		int32	   *doc_frequencies,
+		int			doc_term_count)
+{
+	TSVector   required_tsv = NULL;
+	WordEntry *entries		= ARRPTR(query_tsvector);
+	int		   matches		= 0;
+	int		   i;
+
+	if (required_text != NULL)
+		required_tsv = DatumGetTSVector(DirectFunctionCall2Coll(
+				to_tsvector_byid,
+				InvalidOid,
+				ObjectIdGetDatum(text_config_oid),
+				PointerGetDatum(cstring_to_text(required_text))));
+
+	for (i = 0; i < query_tsvector->size; i++)
+	{
+		char *lexeme = pnstrdup(
+				STRPTR(query_tsvector) + entries[i].pos, entries[i].len);
+		bool  optional = true;
+		int	  j;
+
+		for (j = 0; required_tsv != NULL && j < required_tsv->size; j++)
+		{
+			WordEntry *req = &ARRPTR(required_tsv)[j];
+
+			if (req->len == entries[i].len &&
+				memcmp(STRPTR(required_tsv) + req->pos,
+					   lexeme,
+					   req->len) == 0)
+				optional = false;
+		}
+
+		if (optional &&
+			find_term_frequency_in_arrays(
+					doc_terms, doc_frequencies, doc_term_count, lexeme) > 0.0f)
+			matches++;
+		pfree(lexeme);
+	}
+	return matches;
+}
+
+/*
+ * Helper: Count the document terms matching a "word*" or "word~N"
+ * pattern that are not query lexemes themselves.  An index scan
+ * expands a pattern to its best terms only, so this may match a
+ * document the index would not.
+ */
+static int
+count_pattern_matches(
+		Oid		  text_config_oid,
+		TSVector  query_tsvector,
+		List	 *patterns,
+		char	**doc_terms,
+		int		  doc_term_count)
+{
+	int		   pattern_count = list_length(patterns);
+	char	 **lexemes		 = palloc(pattern_count * sizeof(char *));
+	WordEntry *entries		 = ARRPTR(query_tsvector);
+	char	  *query_words	 = STRPTR(query_tsvector);
+	int		   matches		 = 0;
+	int		   i;
+
+	for (i = 0; i < pattern_count; i++)
+		lexemes[i] = tp_pattern_lexeme(
+				((TpTermPattern *)list_nth(patterns, i))->word,
+				text_config_oid);
+
+	for (i = 0; i < doc_term_count; i++)
+	{
+		const char *term	= doc_terms[i];
+		size_t		len		= strlen(term);
+		bool		matched = false;
+		int			j;
+
+		for (j = 0; j < pattern_count && !matched; j++)
+			matched = lexemes[j] != NULL &&
+					  tp_pattern_matches(
+							  (TpTermPattern *)list_nth(patterns, j),
+							  lexemes[j],
+							  term);
+		for (j = 0; j < query_tsvector->size && matched; j++)
+		{
+			if (entries[j].len == len &&
+				memcmp(query_words + entries[j].pos, term, len) == 0)
+				matched = false;
+		}
+		if (matched)
+			matches++;
+	}
+
+	pfree(lexemes);
+	return matches;
+}
+
 /*
  * BM25 scoring function for text <@> bm25query operations
  *
@@ -669,12 +1283,20 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 	TpQuery *query		= (TpQuery *)PG_DETOAST_DATUM(PG_GETARG_DATUM(1));
 	char	*query_text = get_tpquery_text(query);
 	Oid		 index_oid;
+	char	*required_text = NULL;
+	char	*excluded_text = NULL;
+	char	*scoring_text;
+	List	*phrases = NIL;
+	bool	 boolean_query;
+	bool	 positions;
+	int32	 min_should_match = get_tpquery_min_should_match(query);
 
 	Relation		   index_rel = NULL;
 	TpIndexMetaPage	   metap	 = NULL;
 	Oid				   text_config_oid;
 	char			 **doc_terms	   = NULL;
 	int32			  *doc_frequencies = NULL;
+	uint32			 **doc_positions   = NULL;
 	int				   doc_term_count  = 0;
 	int				   raw_doc_length;
 	Datum			   query_tsvector_datum;
@@ -698,6 +1320,29 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 	bool			   acquired_lock   = false;
 	bool			   segments_locked = false;
 	TpLocalIndexState *locked_state	   = NULL;
+	TpQueryPrior	   prior;
+	List			  *patterns;
+
+	/*
+	 * The prior is stored in the index, not in the text: only an index
+	 * scan can add it
+	 */
+	if (get_tpquery_prior(query, &prior))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("bm25query with a prior weighting requires an "
+						"index scan"),
+				 errhint("Use it in ORDER BY of a query the bm25 index "
+						 "can answer.")));
+
+	/* Term patterns expand to the index's terms in the same way */
+	if (tpquery_split_patterns(query_text, &scoring_text, &patterns))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("bm25query with a prefix or fuzzy term requires an "
+						"index scan"),
+				 errhint("Use it in ORDER BY of a query the bm25 index "
+						 "can answer.")));
 
 	/* Get index OID from query */
 	index_oid = get_tpquery_index_oid(query);
@@ -708,6 +1353,24 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 	 */
 	index_rel = validate_and_open_index(query, &index_oid);
 
+	/*
+	 * Score only the non-excluded words; check +/- per document below.
+	 * An index without positions matches phrases as separate words, as
+	 * its scans do.
+	 */
+	positions	  = tp_index_has_positions(index_rel);
+	boolean_query = tpquery_split_boolean(
+			query_text,
+			positions,
+			&scoring_text,
+			&required_text,
+			&excluded_text,
+			&phrases);
+	if (boolean_query)
+		query_text = scoring_text;
+	if (!positions)
+		phrases = NIL;
+
 	/* Check if this is a partitioned index */
 	is_partitioned = (get_rel_relkind(index_oid) == RELKIND_PARTITIONED_INDEX);
 
@@ -914,13 +1577,23 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 		/*
 		 * Tokenize the document. Uses tp_tokenize_text so that documents
 		 * larger than the tsvector dictionary cap are chunked + merged.
+		 * Phrases need the token positions as well.
 		 */
-		raw_doc_length = tp_tokenize_text(
-				text_arg,
-				text_config_oid,
-				&doc_terms,
-				&doc_frequencies,
-				&doc_term_count);
+		if (phrases != NIL)
+			raw_doc_length = tp_tokenize_text_with_positions(
+					text_arg,
+					text_config_oid,
+					&doc_terms,
+					&doc_frequencies,
+					&doc_positions,
+					&doc_term_count);
+		else
+			raw_doc_length = tp_tokenize_text(
+					text_arg,
+					text_config_oid,
+					&doc_terms,
+					&doc_frequencies,
+					&doc_term_count);
 
 		/* Tokenize the query text to get query terms (always small) */
 		query_tsvector_datum = DirectFunctionCall2Coll(
@@ -943,6 +1616,58 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 				encode_fieldnorm(raw_doc_length));
 		query_term_count = query_tsvector->size;
 
+		/* A document failing a +required / -excluded word scores 0 */
+		if (boolean_query &&
+			(!doc_terms_match(
+					 text_config_oid,
+					 required_text,
+					 true,
+					 doc_terms,
+					 doc_frequencies,
+					 doc_term_count) ||
+			 !doc_terms_match(
+					 text_config_oid,
+					 excluded_text,
+					 false,
+					 doc_terms,
+					 doc_frequencies,
+					 doc_term_count)))
+			query_term_count = 0;
+
+		/* ... as does one not containing a phrase */
+		if (query_term_count > 0)
+		{
+			ListCell *lc;
+
+			foreach (lc, phrases)
+			{
+				TpPhrase *phrase = (TpPhrase *)lfirst(lc);
+
+				tp_phrase_analyze(phrase, text_config_oid);
+				if (!tp_phrase_matches_document(
+							phrase,
+							doc_terms,
+							doc_frequencies,
+							doc_positions,
+							doc_term_count))
+				{
+					query_term_count = 0;
+					break;
+				}
+			}
+		}
+
+		/* ... as does one matching too few optional terms */
+		if (min_should_match > 0 && query_term_count > 0 &&
+			count_optional_matches(
+					text_config_oid,
+					query_tsvector,
+					required_text,
+					doc_terms,
+					doc_frequencies,
+					doc_term_count) < min_should_match)
+			query_term_count = 0;
+
 		/* Calculate BM25 score for each query term */
 		for (q_i = 0; q_i < query_term_count; q_i++)
 		{
@@ -1117,6 +1842,180 @@ bm25_text_bm25query_score(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT8((result > 0) ? -result : result);
 }
 
+/*
+ * Text search configuration of the index a @@ query names, cached in
+ * fn_extra for the duration of the query.
+ */
+typedef struct QueryMatchCache
+{
+	Oid	 index_oid;
+	Oid	 text_config_oid;
+	bool positions; /* The index stores positions */
+} QueryMatchCache;
+
+/*
+ * Boolean match for text @@ bm25query operations
+ *
+ * A document matches exactly when an index scan would consider it a
+ * candidate: it contains every +required word (and at least one query
+ * word), at least min_should_match optional words, no -excluded word,
+ * and every phrase.  Matching needs no corpus statistics, only the
+ * index's text search configuration.
+ */
+Datum
+bm25_text_bm25query_match(PG_FUNCTION_ARGS)
+{
+	text			*text_arg	= PG_GETARG_TEXT_PP(0);
+	TpQuery			*query		= (TpQuery *)PG_DETOAST_DATUM(PG_GETARG_DATUM(1));
+	char			*query_text = get_tpquery_text(query);
+	int32			 min_should_match = get_tpquery_min_should_match(query);
+	char			*scoring_text;
+	char			*required_text = NULL;
+	char			*excluded_text = NULL;
+	List			*phrases	   = NIL;
+	List			*patterns;
+	QueryMatchCache *cache;
+	char		   **doc_terms		 = NULL;
+	int32			*doc_frequencies = NULL;
+	uint32		   **doc_positions	 = NULL;
+	int				 doc_term_count	 = 0;
+	TSVector		 query_tsvector;
+	int				 optional_matches;
+	bool			 matches;
+	ListCell		*lc;
+
+	if (tpquery_split_patterns(query_text, &scoring_text, &patterns))
+		query_text = scoring_text;
+
+	cache = (QueryMatchCache *)fcinfo->flinfo->fn_extra;
+	if (cache == NULL || cache->index_oid != get_tpquery_index_oid(query))
+	{
+		Oid				index_oid;
+		Relation		index_rel = validate_and_open_index(query, &index_oid);
+		TpIndexMetaPage metap	  = tp_get_metapage(index_rel);
+
+		if (cache == NULL)
+			cache = (QueryMatchCache *)MemoryContextAlloc(
+					fcinfo->flinfo->fn_mcxt, sizeof(QueryMatchCache));
+		cache->index_oid		 = index_oid;
+		cache->text_config_oid	 = metap->text_config_oid;
+		cache->positions		 = tp_index_has_positions(index_rel);
+		fcinfo->flinfo->fn_extra = cache;
+
+		pfree(metap);
+		index_close(index_rel, AccessShareLock);
+	}
+
+	/* Phrases match as separate words where index scans match them so */
+	if (tpquery_split_boolean(
+				query_text,
+				cache->positions,
+				&scoring_text,
+				&required_text,
+				&excluded_text,
+				&phrases))
+		query_text = scoring_text;
+	if (!cache->positions)
+		phrases = NIL;
+
+	if (phrases != NIL)
+		(void)tp_tokenize_text_with_positions(
+				text_arg,
+				cache->text_config_oid,
+				&doc_terms,
+				&doc_frequencies,
+				&doc_positions,
+				&doc_term_count);
+	else
+		(void)tp_tokenize_text(
+				text_arg,
+				cache->text_config_oid,
+				&doc_terms,
+				&doc_frequencies,
+				&doc_term_count);
+
+	query_tsvector = DatumGetTSVector(DirectFunctionCall2Coll(
+			to_tsvector_byid,
+			InvalidOid,
+			ObjectIdGetDatum(cache->text_config_oid),
+			PointerGetDatum(cstring_to_text(query_text))));
+
+	/* Some query word, or a term a pattern stands for, must be present */
+	optional_matches = count_optional_matches(
+			cache->text_config_oid,
+			query_tsvector,
+			NULL,
+			doc_terms,
+			doc_frequencies,
+			doc_term_count);
+	if (patterns != NIL)
+		optional_matches += count_pattern_matches(
+				cache->text_config_oid,
+				query_tsvector,
+				patterns,
+				doc_terms,
+				doc_term_count);
+	matches = optional_matches > 0;
+
+	/* ... every +required word, and no -excluded one */
+	if (matches && required_text != NULL)
+		matches = doc_terms_match(
+						  cache->text_config_oid,
+						  required_text,
+						  true,
+						  doc_terms,
+						  doc_frequencies,
+						  doc_term_count) &&
+				  doc_terms_match(
+						  cache->text_config_oid,
+						  excluded_text,
+						  false,
+						  doc_terms,
+						  doc_frequencies,
+						  doc_term_count);
+
+	/* ... every phrase */
+	foreach (lc, phrases)
+	{
+		TpPhrase *phrase = (TpPhrase *)lfirst(lc);
+
+		if (!matches)
+			break;
+		tp_phrase_analyze(phrase, cache->text_config_oid);
+		matches = tp_phrase_matches_document(
+				phrase,
+				doc_terms,
+				doc_frequencies,
+				doc_positions,
+				doc_term_count);
+	}
+
+	/* ... and enough optional words */
+	if (matches && min_should_match > 0)
+	{
+		optional_matches = count_optional_matches(
+				cache->text_config_oid,
+				query_tsvector,
+				required_text,
+				doc_terms,
+				doc_frequencies,
+				doc_term_count);
+		if (patterns != NIL)
+			optional_matches += count_pattern_matches(
+					cache->text_config_oid,
+					query_tsvector,
+					patterns,
+					doc_terms,
+					doc_term_count);
+		matches = optional_matches >= min_should_match;
+	}
+
+	if (doc_positions != NULL)
+		tp_free_term_positions(doc_positions, doc_term_count);
+
+	PG_RETURN_BOOL(matches);
+}
+
 /*
  * tpquery equality function
  */
@@ -1143,15 +2042,46 @@ tpquery_eq(PG_FUNCTION_ARGS)
 			PG_RETURN_BOOL(false);
 	}
 
+	if (get_tpquery_min_should_match(a) != get_tpquery_min_should_match(b))
+		PG_RETURN_BOOL(false);
+
+	{
+		float4			score_a, score_b;
+		ItemPointerData ctid_a, ctid_b;
+		bool			after_a = get_tpquery_search_after(a, &score_a, &ctid_a);
+		bool			after_b = get_tpquery_search_after(b, &score_b, &ctid_b);
+
+		if (after_a != after_b ||
+			(after_a &&
+			 (score_a != score_b || !ItemPointerEquals(&ctid_a, &ctid_b))))
+			PG_RETURN_BOOL(false);
+	}
+
+	{
+		TpQueryPrior prior_a, prior_b;
+		bool		 has_a = get_tpquery_prior(a, &prior_a);
+		bool		 has_b = get_tpquery_prior(b, &prior_b);
+
+		if (has_a != has_b ||
+			(has_a && (prior_a.weight != prior_b.weight ||
+					   prior_a.half_life != prior_b.half_life ||
+					   prior_a.origin != prior_b.origin)))
+			PG_RETURN_BOOL(false);
+	}
+
 	PG_RETURN_BOOL(true);
 }
 
 /*
- * Utility function to create a tpquery with resolved index OID and flags.
+ * Utility function to create a tpquery with every field specified.
+ * min_should_match is only stored when it is positive.
  */
 TpQuery *
-create_tpquery_explicit(
-		const char *query_text, Oid index_oid, bool explicit_index)
+create_tpquery_full(
+		const char *query_text,
+		Oid			index_oid,
+		bool		explicit_index,
+		int32		min_should_match)
 {
 	TpQuery *result;
 	int		 query_text_len = strlen(query_text);
@@ -1159,6 +2089,8 @@ create_tpquery_explicit(
 
 	/* Calculate total size */
 	total_size = offsetof(TpQuery, data) + query_text_len + 1;
+	if (min_should_match > 0)
+		total_size += sizeof(int32);
 
 	result = (TpQuery *)palloc0(total_size);
 	SET_VARSIZE(result, total_size);
@@ -1171,9 +2103,27 @@ create_tpquery_explicit(
 	memcpy(result->data, query_text, query_text_len);
 	result->data[query_text_len] = '\0';
 
+	if (min_should_match > 0)
+	{
+		result->flags |= TPQUERY_FLAG_MIN_SHOULD_MATCH;
+		memcpy(result->data + query_text_len + 1,
+			   &min_should_match,
+			   sizeof(int32));
+	}
+
 	return result;
 }
 
+/*
+ * Utility function to create a tpquery with resolved index OID and flags.
+ */
+TpQuery *
+create_tpquery_explicit(
+		const char *query_text, Oid index_oid, bool explicit_index)
+{
+	return create_tpquery_full(query_text, index_oid, explicit_index, 0);
+}
+
 /*
  * Utility function to create a tpquery with resolved index OID.
  * Index is marked as NOT explicit (for implicit resolution).
@@ -1192,7 +2142,8 @@ create_tpquery(const char *query_text, Oid index_oid)
  * appropriate partition index at scan time.
  */
 TpQuery *
-create_tpquery_from_name(const char *query_text, const char *index_name)
+create_tpquery_from_name(
+		const char *query_text, const char *index_name, int32 min_should_match)
 {
 	Oid	 index_oid		= InvalidOid;
 	bool explicit_index = false;
@@ -1209,7 +2160,8 @@ create_tpquery_from_name(const char *query_text, const char *index_name)
 		explicit_index = true;
 	}
 
-	return create_tpquery_explicit(query_text, index_oid, explicit_index);
+	return create_tpquery_full(
+			query_text, index_oid, explicit_index, min_should_match);
 }
 
 /*
@@ -1254,6 +2206,381 @@ tpquery_is_explicit_index(TpQuery *tpquery)
 	return (tpquery->flags & TPQUERY_FLAG_EXPLICIT_INDEX) != 0;
 }
 
+/*
+ * Get min_should_match from tpquery (0 if none was given)
+ */
+int32
+get_tpquery_min_should_match(TpQuery *tpquery)
+{
+	int32 min_should_match;
+
+	if (tpquery->version < 3 ||
+		(tpquery->flags & TPQUERY_FLAG_MIN_SHOULD_MATCH) == 0)
+		return 0;
+
+	memcpy(&min_should_match,
+		   tpquery->data + tpquery->query_text_len + 1,
+		   sizeof(int32));
+	return min_should_match;
+}
+
+/* Offset in data[] of the search-after position, past text and msm */
+static int
+tpquery_search_after_offset(TpQuery *tpquery)
+{
+	int offset = tpquery->query_text_len + 1;
+
+	if (tpquery->version >= 3 &&
+		(tpquery->flags & TPQUERY_FLAG_MIN_SHOULD_MATCH) != 0)
+		offset += sizeof(int32);
+	return offset;
+}
+
+/*
+ * Get the search-after position from tpquery; false if there is none
+ */
+bool
+get_tpquery_search_after(
+		TpQuery *tpquery, float4 *score, ItemPointerData *ctid)
+{
+	char *pos;
+
+	if (tpquery->version < 3 ||
+		(tpquery->flags & TPQUERY_FLAG_SEARCH_AFTER) == 0)
+		return false;
+
+	pos = tpquery->data + tpquery_search_after_offset(tpquery);
+	memcpy(score, pos, sizeof(float4));
+	memcpy(ctid, pos + sizeof(float4), sizeof(ItemPointerData));
+	return true;
+}
+
+/*
+ * Copy tpquery with its search-after position set (or replaced); a
+ * static prior weighting is kept
+ */
+TpQuery *
+tpquery_set_search_after(TpQuery *tpquery, float4 score, ItemPointer ctid)
+{
+	int			 offset = tpquery_search_after_offset(tpquery);
+	int			 prefix = offsetof(TpQuery, data) + offset;
+	int			 total_size = prefix + sizeof(float4) + sizeof(ItemPointerData);
+	TpQuery		*result		= (TpQuery *)palloc0(total_size);
+	TpQueryPrior prior;
+	bool		 has_prior = get_tpquery_prior(tpquery, &prior);
+
+	memcpy(result, tpquery, prefix);
+	SET_VARSIZE(result, total_size);
+	result->version = TPQUERY_VERSION;
+	result->flags |= TPQUERY_FLAG_SEARCH_AFTER;
+	result->flags &= ~TPQUERY_FLAG_PRIOR;
+	memcpy(result->data + offset, &score, sizeof(float4));
+	memcpy(result->data + offset + sizeof(float4),
+		   ctid,
+		   sizeof(ItemPointerData));
+
+	if (has_prior)
+		result = tpquery_set_prior(result, &prior);
+	return result;
+}
+
+/* Offset in data[] of the prior weighting, past the search-after */
+static int
+tpquery_prior_offset(TpQuery *tpquery)
+{
+	int offset = tpquery_search_after_offset(tpquery);
+
+	if (tpquery->version >= 3 &&
+		(tpquery->flags & TPQUERY_FLAG_SEARCH_AFTER) != 0)
+		offset += sizeof(float4) + sizeof(ItemPointerData);
+	return offset;
+}
+
+/*
+ * Get the static prior weighting from tpquery; false if there is none
+ */
+bool
+get_tpquery_prior(TpQuery *tpquery, TpQueryPrior *prior)
+{
+	if (tpquery->version < 3 || (tpquery->flags & TPQUERY_FLAG_PRIOR) == 0)
+		return false;
+
+	memcpy(prior,
+		   tpquery->data + tpquery_prior_offset(tpquery),
+		   sizeof(TpQueryPrior));
+	return true;
+}
+
+/*
+ * Copy tpquery with its static prior weighting set (or replaced)
+ */
+TpQuery *
+tpquery_set_prior(TpQuery *tpquery, const TpQueryPrior *prior)
+{
+	int		 offset		= tpquery_prior_offset(tpquery);
+	int		 prefix		= offsetof(TpQuery, data) + offset;
+	int		 total_size = prefix + sizeof(TpQueryPrior);
+	TpQuery *result		= (TpQuery *)palloc0(total_size);
+
+	memcpy(result, tpquery, prefix);
+	SET_VARSIZE(result, total_size);
+	result->version = TPQUERY_VERSION;
+	result->flags |= TPQUERY_FLAG_PRIOR;
+	memcpy(result->data + offset, prior, sizeof(TpQueryPrior));
+	return result;
+}
+
+/*
+ * Split query text into its scoring, required, and excluded parts.
+ *
+ * A whitespace-separated word starting with '+' is required and one
+ * starting with '-' is excluded; the operator is stripped.  A lone
+ * '+' or '-' is an ordinary word, and so is a sign before a digit:
+ * "-20 degrees" searches for the number.  Required words are also
+ * scored, so they appear in both *scoring_text and *required_text.
+ *
+ * Text in double quotes is a phrase, optionally followed by ~N for a
+ * slop of N positions; an unterminated quote runs to the end of the
+ * text.  Phrase words are required and scored like "+word", and the
+ * phrase itself (not yet analyzed, see scoring/phrase.h) is appended
+ * to *phrases.  Excluded phrases are not supported.
+ *
+ * With positions false, for an index that stores none, a phrase's
+ * words are scored as ordinary optional words instead, as they were
+ * before phrase queries existed.  The phrase is still appended to
+ * *phrases, but only so the caller can report the fallback.
+ *
+ * Returns false (and leaves the outputs untouched) if the text has no
+ * operators, or pg_textsearch.query_operators is off: signs and
+ * quotes are then left to the tokenizer, as before 1.4.0.
+ */
+bool
+tpquery_split_boolean(
+		const char *query_text,
+		bool		positions,
+		char	  **scoring_text,
+		char	  **required_text,
+		char	  **excluded_text,
+		List	  **phrases)
+{
+	StringInfoData scoring;
+	StringInfoData required;
+	StringInfoData excluded;
+	const char	  *p		   = query_text;
+	bool		   has_ops	   = false;
+	List		  *phrase_list = NIL;
+
+	if (!tp_query_operators)
+		return false;
+
+	initStringInfo(&scoring);
+	initStringInfo(&required);
+	initStringInfo(&excluded);
+
+	while (*p != '\0')
+	{
+		const char *word;
+		int			len;
+
+		while (*p != '\0' && isspace((unsigned char)*p))
+			p++;
+		if (*p == '\0')
+			break;
+
+		/* "phrase"~N, also accepted as +"phrase" */
+		if (*p == '"' || (p[0] == '+' && p[1] == '"'))
+		{
+			const char *start;
+			int32		slop = 0;
+
+			p += (*p == '+') ? 2 : 1;
+			start = p;
+			while (*p != '\0' && *p != '"')
+				p++;
+			len = (int)(p - start);
+			if (*p == '"')
+				p++;
+
+			if (*p == '~' && isdigit((unsigned char)p[1]))
+			{
+				p++;
+				while (isdigit((unsigned char)*p))
+				{
+					slop = slop * 10 + (*p - '0');
+					if (slop > TP_PHRASE_MAX_SLOP)
+						ereport(ERROR,
+								(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+								 errmsg("phrase slop must be at most %d",
+										TP_PHRASE_MAX_SLOP)));
+					p++;
+				}
+			}
+
+			has_ops		= true;
+			phrase_list = lappend(
+					phrase_list, tp_phrase_create(start, len, slop));
+			if (positions)
+			{
+				appendBinaryStringInfo(&required, start, len);
+				appendStringInfoChar(&required, ' ');
+			}
+			appendBinaryStringInfo(&scoring, start, len);
+			appendStringInfoChar(&scoring, ' ');
+			continue;
+		}
+
+		if (p[0] == '-' && p[1] == '"')
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("excluded phrases are not supported"),
+					 errhint("Exclude the individual words with -word.")));
+
+		word = p;
+		while (*p != '\0' && !isspace((unsigned char)*p))
+			p++;
+		len = (int)(p - word);
+
+		if (len > 1 && (word[0] == '+' || word[0] == '-') &&
+			!isdigit((unsigned char)word[1]))
+		{
+			StringInfo target = word[0] == '+' ? &required : &excluded;
+
+			has_ops = true;
+			appendBinaryStringInfo(target, word + 1, len - 1);
+			appendStringInfoChar(target, ' ');
+			if (word[0] == '-')
+				continue;
+			word++;
+			len--;
+		}
+
+		appendBinaryStringInfo(&scoring, word, len);
+		appendStringInfoChar(&scoring, ' ');
+	}
+
+	if (!has_ops)
+	{
+		pfree(scoring.data);
+		pfree(required.data);
+		pfree(excluded.data);
+		return false;
+	}
+
+	*scoring_text  = scoring.data;
+	*required_text = required.data;
+	*excluded_text = excluded.data;
+	*phrases	   = phrase_list;
+	return true;
+}
+
+/*
+ * Split term patterns off query text.
+ *
+ * A whitespace-separated word that is not a +required or -excluded
+ * word or a phrase is a pattern if it ends in '*' ("datab*", a prefix
+ * term) or in '~' and a number of edits ("databse~1", a fuzzy term).
+ * A pattern stands for the indexed terms starting with, or within that
+ * many edits of, the word's lexeme (see scoring/expand.h).  Phrases
+ * are copied to *rest_text untouched, as are words that are only
+ * operators ("*", "~1").
+ *
+ * Returns false if the text has no patterns (and sets *patterns to
+ * NIL); otherwise *rest_text is the text without them and *patterns a
+ * list of TpTermPattern.
+ */
+bool
+tpquery_split_patterns(
+		const char *query_text, char **rest_text, List **patterns)
+{
+	StringInfoData rest;
+	const char	  *p			= query_text;
+	List		  *pattern_list = NIL;
+
+	initStringInfo(&rest);
+
+	while (*p != '\0')
+	{
+		const char	  *word;
+		int			   len;
+		int			   stem_len;
+		int			   max_edits = -1;
+		TpTermPattern *pattern;
+
+		while (*p != '\0' && isspace((unsigned char)*p))
+			p++;
+		if (*p == '\0')
+			break;
+
+		/* Copy a phrase, with its ~N, up to the word after it */
+		word = p;
+		if (*p == '"' || (p[0] == '+' && p[1] == '"'))
+		{
+			p += (*p == '+') ? 2 : 1;
+			while (*p != '\0' && *p != '"')
+				p++;
+			if (*p == '"')
+				p++;
+		}
+		while (*p != '\0' && !isspace((unsigned char)*p))
+			p++;
+		len = (int)(p - word);
+
+		/* word* or word~N */
+		stem_len = len;
+		while (stem_len > 0 && word[stem_len - 1] == '*')
+			stem_len--;
+		if (stem_len == len)
+		{
+			while (stem_len > 0 && isdigit((unsigned char)word[stem_len - 1]))
+				stem_len--;
+			if (stem_len < len && stem_len > 0 && word[stem_len - 1] == '~')
+			{
+				/* The digits end the word; three of them are too many */
+				if (len - stem_len > 2)
+					max_edits = TP_MAX_FUZZY_EDITS + 1;
+				else
+					max_edits = atoi(word + stem_len);
+				stem_len--;
+			}
+			else
+				stem_len = len;
+		}
+
+		if (stem_len == len || stem_len == 0 || word[0] == '"' ||
+			word[0] == '+' || word[0] == '-')
+		{
+			appendBinaryStringInfo(&rest, word, len);
+			appendStringInfoChar(&rest, ' ');
+			continue;
+		}
+
+		if (max_edits > TP_MAX_FUZZY_EDITS)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("fuzzy term \"%.*s\" allows too many edits",
+							len,
+							word),
+					 errdetail("A fuzzy term allows at most %d edits.",
+							   TP_MAX_FUZZY_EDITS)));
+
+		pattern			   = palloc(sizeof(TpTermPattern));
+		pattern->word	   = pnstrdup(word, stem_len);
+		pattern->max_edits = max_edits;
+		pattern_list	   = lappend(pattern_list, pattern);
+	}
+
+	if (pattern_list == NIL)
+	{
+		pfree(rest.data);
+		*patterns = NIL;
+		return false;
+	}
+
+	*rest_text = rest.data;
+	*patterns  = pattern_list;
+	return true;
+}
+
 /*
  * Scoring function for text <@> text operations.
  *
@@ -1295,6 +2622,21 @@ bm25_textarray_bm25query_score(PG_FUNCTION_ARGS)
 	return bm25_text_bm25query_score(fcinfo);
 }
 
+/*
+ * Boolean match for text[] @@ bm25query, on the flattened array
+ */
+Datum
+bm25_textarray_bm25query_match(PG_FUNCTION_ARGS)
+{
+	Datum array_datum = PG_GETARG_DATUM(0);
+	text *flattened	  = tp_flatten_text_array(array_datum);
+
+	fcinfo->args[0].value  = PointerGetDatum(flattened);
+	fcinfo->args[0].isnull = false;
+
+	return bm25_text_bm25query_match(fcinfo);
+}
+
 /*
  * Error stub for text[] <@> text when planner rewrite fails.
  */
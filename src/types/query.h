@@ -9,6 +9,8 @@
 #include <postgres.h>
 
 #include <fmgr.h>
+#include <nodes/pg_list.h>
+#include <storage/itemptr.h>
 
 /*
  * bm25query binary format version
@@ -17,13 +19,25 @@
  *   0: Pre-0.0.6 format with index_name string (no longer supported)
  *   1: 0.0.6+ format with index_oid
  *   2: 0.5.0+ adds explicit_index flag
+ *   3: 1.4.0+ adds optional min_should_match after the query text,
+ *      then an optional search-after position and static prior
+ *      weighting
  */
-#define TPQUERY_VERSION 2
+#define TPQUERY_VERSION 3
 
 /*
  * Flags for TpQuery
  */
-#define TPQUERY_FLAG_EXPLICIT_INDEX 0x01 /* Index was explicitly specified */
+#define TPQUERY_FLAG_EXPLICIT_INDEX	 0x01 /* Index was explicitly specified */
+#define TPQUERY_FLAG_MIN_SHOULD_MATCH 0x02 /* min_should_match follows text */
+#define TPQUERY_FLAG_SEARCH_AFTER	 0x04 /* search-after position follows */
+#define TPQUERY_FLAG_PRIOR			 0x08 /* TpQueryPrior follows */
+
+/*
+ * Largest accepted min_should_match.  Queries never get near this
+ * many distinct terms; the cap only keeps the value sane.
+ */
+#define TPQUERY_MAX_MIN_SHOULD_MATCH 1024
 
 /*
  * tpquery data type structure
@@ -31,6 +45,20 @@
  *
  * The index can be specified by OID (resolved at creation time) or left
  * unresolved (InvalidOid) for later resolution by planner hooks.
+ *
+ * With TPQUERY_FLAG_MIN_SHOULD_MATCH set, an unaligned int32 follows
+ * the query text's terminating NUL: the number of optional (not
+ * "+word") query terms a document must contain to match.  Values
+ * written before version 3 never carry it.
+ *
+ * With TPQUERY_FLAG_SEARCH_AFTER set, a float4 score and an
+ * ItemPointerData follow that (unaligned): the <@> score and CTID of
+ * the last row of the previous page.  An index scan then returns only
+ * documents ranking after it in (score, CTID) order.
+ *
+ * With TPQUERY_FLAG_PRIOR set, a TpQueryPrior follows last (unaligned):
+ * how much of the index's static prior (its INCLUDE column) to add to
+ * every document's BM25 score.
  */
 typedef struct TpQuery
 {
@@ -40,9 +68,23 @@ typedef struct TpQuery
 	Oid	  index_oid;				   /* resolved index OID (InvalidOid if
 										* unresolved) */
 	int32 query_text_len;			   /* length of query text */
-	char  data[FLEXIBLE_ARRAY_MEMBER]; /* payload: query text only */
+	char  data[FLEXIBLE_ARRAY_MEMBER]; /* payload: query text, then
+										* min_should_match if flagged */
 } TpQuery;
 
+/*
+ * Static prior weighting of a query.  A document with prior p scores
+ * BM25 + weight * p (half_life == 0), or, treating p as a timestamp in
+ * seconds since the Unix epoch, BM25 + weight * 0.5^(age / half_life)
+ * where age = Max(origin - p, 0).  See scoring/prior.h.
+ */
+typedef struct TpQueryPrior
+{
+	float4 weight;	  /* >= 0 */
+	float4 half_life; /* Seconds; 0 for a linear prior */
+	float8 origin;	  /* Decay origin, seconds since the Unix epoch */
+} TpQueryPrior;
+
 /* Macro for accessing query text */
 #define TPQUERY_TEXT_PTR(x) (((TpQuery *)(x))->data)
 
@@ -55,21 +97,72 @@ Datum tpquery_send(PG_FUNCTION_ARGS);
 /* Constructor functions */
 Datum to_tpquery_text(PG_FUNCTION_ARGS);
 Datum to_tpquery_text_index(PG_FUNCTION_ARGS);
+Datum to_tpquery_text_index_msm(PG_FUNCTION_ARGS);
+Datum tpquery_search_after(PG_FUNCTION_ARGS);
+Datum tpquery_with_prior(PG_FUNCTION_ARGS);
+Datum tpquery_with_decay(PG_FUNCTION_ARGS);
 
 /* Operator functions */
 Datum bm25_text_bm25query_score(PG_FUNCTION_ARGS);
 Datum bm25_text_text_score(PG_FUNCTION_ARGS);
 Datum bm25_textarray_bm25query_score(PG_FUNCTION_ARGS);
 Datum bm25_textarray_text_score(PG_FUNCTION_ARGS);
+Datum bm25_text_bm25query_match(PG_FUNCTION_ARGS);
+Datum bm25_textarray_bm25query_match(PG_FUNCTION_ARGS);
 Datum tpquery_eq(PG_FUNCTION_ARGS);
 
 /* Utility functions */
 TpQuery *create_tpquery(const char *query_text, Oid index_oid);
 TpQuery *create_tpquery_explicit(
 		const char *query_text, Oid index_oid, bool explicit_index);
-TpQuery		  *
-create_tpquery_from_name(const char *query_text, const char *index_name);
+TpQuery *create_tpquery_full(
+		const char *query_text,
+		Oid			index_oid,
+		bool		explicit_index,
+		int32		min_should_match);
+TpQuery *create_tpquery_from_name(
+		const char *query_text, const char *index_name, int32 min_should_match);
 Oid	  get_tpquery_index_oid(TpQuery *tpquery);
 char *get_tpquery_text(TpQuery *tpquery);
 bool  tpquery_has_index(TpQuery *tpquery);
 bool  tpquery_is_explicit_index(TpQuery *tpquery);
+int32 get_tpquery_min_should_match(TpQuery *tpquery);
+bool  get_tpquery_search_after(
+		 TpQuery *tpquery, float4 *score, ItemPointerData *ctid);
+TpQuery *tpquery_set_search_after(
+		TpQuery *tpquery, float4 score, ItemPointer ctid);
+bool	 get_tpquery_prior(TpQuery *tpquery, TpQueryPrior *prior);
+TpQuery *tpquery_set_prior(TpQuery *tpquery, const TpQueryPrior *prior);
+
+/*
+ * Boolean query syntax: "+word" must match, "-word" must not match,
+ * "quoted words"~N must match as a phrase, other words are optional.
+ * See tpquery_split_boolean in query.c.
+ */
+
+/* GUC (mod.c): whether query text is split into these operators */
+extern bool tp_query_operators;
+
+bool tpquery_split_boolean(
+		const char *query_text,
+		bool		positions,
+		char	  **scoring_text,
+		char	  **required_text,
+		char	  **excluded_text,
+		List	  **phrases);
+
+/*
+ * Term patterns: "word*" stands for the most frequent indexed terms
+ * starting with the word's lexeme, "word~N" for the indexed terms
+ * within N edits of it.  See tpquery_split_patterns in query.c.
+ */
+typedef struct TpTermPattern
+{
+	char *word;		 /* The word, without its operator */
+	int	  max_edits; /* word~N: N; -1 for a word* prefix */
+} TpTermPattern;
+
+#define TP_MAX_FUZZY_EDITS 2
+
+bool tpquery_split_patterns(
+		const char *query_text, char **rest_text, List **patterns);
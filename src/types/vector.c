@@ -117,6 +117,7 @@ typedef struct
 {
 	const char *lexeme;
 	int32		frequency;
+	uint32	   *positions; /* frequency entries, or NULL */
 } LexemeFreqPair;
 
 static int
@@ -228,6 +229,24 @@ tpvector_validate_v2(TpVector *v)
 							i)));
 		cursor += lex_len;
 	}
+
+	if ((v->flags & TPVECTOR_FLAG_POSITIONS) != 0)
+	{
+		for (i = 0; i < v->entry_count; i++)
+		{
+			uint32 count = tpvector_varint_decode(&cursor, end);
+			uint32 j;
+
+			for (j = 0; j < count; j++)
+				(void)tpvector_varint_decode(&cursor, end);
+		}
+	}
+
+	if ((v->flags & TPVECTOR_FLAG_PRIOR) != 0 &&
+		cursor + sizeof(float4) > end)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("bm25vector static prior extends beyond buffer")));
 }
 
 TpVector *
@@ -735,12 +754,13 @@ get_tpvector_index_name(TpVector *tpvec)
 	return index_name;
 }
 
-TpVector *
-create_tpvector_from_strings(
-		const char	*index_name,
-		int			 entry_count,
-		const char **lexemes,
-		const int32 *frequencies)
+static TpVector *
+create_tpvector_internal(
+		const char	  *index_name,
+		int			   entry_count,
+		const char	 **lexemes,
+		const int32	  *frequencies,
+		uint32 *const *positions)
 {
 	int				index_name_len;
 	int				total_size;
@@ -766,6 +786,7 @@ create_tpvector_from_strings(
 		{
 			pairs[i].lexeme	   = lexemes[i];
 			pairs[i].frequency = frequencies[i];
+			pairs[i].positions = positions ? positions[i] : NULL;
 		}
 		if (entry_count > 1)
 			qsort(pairs, entry_count, sizeof(LexemeFreqPair), strcmp_wrapper);
@@ -786,6 +807,20 @@ create_tpvector_from_strings(
 		lex_len = strlen(lex);
 		total_size += tpvector_varint_size((uint32)Max(freq, 0)) +
 					  tpvector_varint_size((uint32)lex_len) + lex_len;
+
+		if (pairs && positions)
+		{
+			uint32 prev = 0;
+			int	   j;
+
+			total_size += tpvector_varint_size((uint32)Max(freq, 0));
+			for (j = 0; j < freq; j++)
+			{
+				total_size += tpvector_varint_size(
+						pairs[i].positions[j] - prev);
+				prev = pairs[i].positions[j];
+			}
+		}
 	}
 
 	result = (TpVector *)palloc0(total_size);
@@ -796,6 +831,8 @@ create_tpvector_from_strings(
 	result->magic[2] = TPVECTOR_V2_MAGIC2;
 	result->magic[3] = TPVECTOR_V2_MAGIC3;
 	result->version	 = TPVECTOR_VERSION;
+	if (pairs && positions)
+		result->flags = TPVECTOR_FLAG_POSITIONS;
 
 	result->index_name_len = index_name_len;
 	result->entry_count	   = entry_count;
@@ -818,12 +855,128 @@ create_tpvector_from_strings(
 			entry_ptr += lex_len;
 		}
 
+		/* Positions section, delta-encoded per entry */
+		if (positions)
+		{
+			for (i = 0; i < entry_count; i++)
+			{
+				uint32 freq = (uint32)Max(pairs[i].frequency, 0);
+				uint32 prev = 0;
+				uint32 j;
+
+				entry_ptr += tpvector_varint_encode(freq, entry_ptr);
+				for (j = 0; j < freq; j++)
+				{
+					entry_ptr += tpvector_varint_encode(
+							pairs[i].positions[j] - prev, entry_ptr);
+					prev = pairs[i].positions[j];
+				}
+			}
+		}
+
 		pfree(pairs);
 	}
 
 	return result;
 }
 
+TpVector *
+create_tpvector_from_strings(
+		const char	*index_name,
+		int			 entry_count,
+		const char **lexemes,
+		const int32 *frequencies)
+{
+	return create_tpvector_internal(
+			index_name, entry_count, lexemes, frequencies, NULL);
+}
+
+TpVector *
+create_tpvector_with_positions(
+		const char	  *index_name,
+		int			   entry_count,
+		const char	 **lexemes,
+		const int32	  *frequencies,
+		uint32 *const *positions)
+{
+	return create_tpvector_internal(
+			index_name, entry_count, lexemes, frequencies, positions);
+}
+
+/*
+ * Start of the positions section (just past the last entry), or NULL
+ * if the vector was built without positions.
+ */
+const uint8 *
+tpvector_positions_start(TpVector *vec)
+{
+	TpVectorEntry *entry;
+	int			   i;
+
+	if ((vec->flags & TPVECTOR_FLAG_POSITIONS) == 0)
+		return NULL;
+
+	entry = get_tpvector_first_entry(vec);
+	for (i = 0; i < vec->entry_count; i++)
+		entry = get_tpvector_next_entry(entry);
+	return (const uint8 *)entry;
+}
+
+/*
+ * Copy of vec with a static prior appended as its last four bytes
+ */
+TpVector *
+tpvector_with_prior(TpVector *vec, float4 prior)
+{
+	Size	  size = VARSIZE(vec);
+	TpVector *result;
+
+	result = (TpVector *)palloc(size + sizeof(float4));
+	memcpy(result, vec, size);
+	memcpy((char *)result + size, &prior, sizeof(float4));
+	SET_VARSIZE(result, size + sizeof(float4));
+	result->flags |= TPVECTOR_FLAG_PRIOR;
+	return result;
+}
+
+float4
+tpvector_get_prior(TpVector *vec)
+{
+	float4 prior;
+
+	if ((vec->flags & TPVECTOR_FLAG_PRIOR) == 0)
+		return 0.0f;
+
+	memcpy(&prior,
+		   (char *)vec + VARSIZE(vec) - sizeof(float4),
+		   sizeof(float4));
+	return prior;
+}
+
+uint32
+tpvector_positions_decode_advance(
+		const uint8 **cursor, const uint8 *end, uint32 *out, uint32 max)
+{
+	uint32 count = tpvector_varint_decode(cursor, end);
+	uint32 pos	 = 0;
+	uint32 i;
+
+	if (count > max)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("bm25vector has %u positions for a term with "
+						"frequency %u",
+						count,
+						max)));
+
+	for (i = 0; i < count; i++)
+	{
+		pos += tpvector_varint_decode(cursor, end);
+		out[i] = pos;
+	}
+	return count;
+}
+
 /* ---------------------------------------------------------------------
  * to_tpvector: build a v2 vector from text + index name
  * ---------------------------------------------------------------------
@@ -842,6 +995,8 @@ to_tpvector(PG_FUNCTION_ARGS)
 	int				i;
 	char		  **lexemes;
 	int32		   *frequencies;
+	uint32		  **positions = NULL;
+	bool			with_positions;
 	int				entry_count;
 	TpVector	   *result;
 
@@ -870,13 +1025,37 @@ to_tpvector(PG_FUNCTION_ARGS)
 						index_name)));
 
 	pfree(metap);
+	with_positions = tp_index_has_positions(index_rel);
 	index_close(index_rel, AccessShareLock);
 
-	(void)tp_tokenize_text(
-			input_text, text_config_oid, &lexemes, &frequencies, &entry_count);
-
-	result = create_tpvector_from_strings(
-			index_name, entry_count, (const char **)lexemes, frequencies);
+	if (with_positions)
+	{
+		(void)tp_tokenize_text_with_positions(
+				input_text,
+				text_config_oid,
+				&lexemes,
+				&frequencies,
+				&positions,
+				&entry_count);
+		result = create_tpvector_with_positions(
+				index_name,
+				entry_count,
+				(const char **)lexemes,
+				frequencies,
+				positions);
+		tp_free_term_positions(positions, entry_count);
+	}
+	else
+	{
+		(void)tp_tokenize_text(
+				input_text,
+				text_config_oid,
+				&lexemes,
+				&frequencies,
+				&entry_count);
+		result = create_tpvector_from_strings(
+				index_name, entry_count, (const char **)lexemes, frequencies);
+	}
 
 	if (lexemes)
 	{
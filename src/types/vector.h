@@ -14,12 +14,23 @@
  * stemmed lexeme with frequency 1.
  *
  * v2 layout:
- *   int32 vl_len_, char magic[4], uint8 version, uint8 reserved[3],
- *   int32 index_name_len, int32 entry_count, data...
+ *   int32 vl_len_, char magic[4], uint8 version, uint8 flags,
+ *   uint8 reserved[2], int32 index_name_len, int32 entry_count, data...
  *   per-entry (variable-length, no padding):
  *     varint frequency       (1 byte for freq <= 127)
  *     varint lexeme_len      (1 byte for lex_len <= 127)
  *     char lexeme[lexeme_len]
+ *   then, only if flags has TPVECTOR_FLAG_POSITIONS, one positions
+ *   record per entry in the same order:
+ *     varint count (<= frequency), count varint position deltas
+ *   then, only if flags has TPVECTOR_FLAG_PRIOR, as the last four
+ *   bytes of the value:
+ *     float4 prior (unaligned)
+ *
+ * Vectors built for indexes WITH (positions = true) carry positions
+ * so the memtable can answer phrase queries, and vectors built for
+ * indexes with an INCLUDE column carry the document's static prior
+ * (see segment/prior.h); everything else ignores the trailing sections.
  *
  * Legacy (pre-1.2.0) values use a different layout. They are
  * detected via the absence of the v2 magic and rejected by
@@ -53,6 +64,10 @@
 #define TPVECTOR_V2_MAGIC3 '5'
 #define TPVECTOR_VERSION   2
 
+/* TpVector.flags */
+#define TPVECTOR_FLAG_POSITIONS 0x01 /* Positions section follows entries */
+#define TPVECTOR_FLAG_PRIOR		0x02 /* Static prior in the last 4 bytes */
+
 /*
  * Opaque entry handle. v2 entries are variable-length byte
  * sequences; field access goes through tpvector_entry_decode().
@@ -77,7 +92,8 @@ typedef struct TpVector
 	int32 vl_len_;					   /* varlena header (must be first) */
 	char  magic[4];					   /* "BM25" — discriminates v2 from v1 */
 	uint8 version;					   /* TPVECTOR_VERSION (2) */
-	uint8 reserved[3];				   /* zero; future flags / format bits */
+	uint8 flags;					   /* TPVECTOR_FLAG_* */
+	uint8 reserved[2];				   /* zero; future format bits */
 	int32 index_name_len;			   /* length of index name */
 	int32 entry_count;				   /* number of term/frequency pairs */
 	char  data[FLEXIBLE_ARRAY_MEMBER]; /* payload: index name + entries */
@@ -104,8 +120,38 @@ TpVector *create_tpvector_from_strings(
 		const char **lexemes,
 		const int32 *frequencies);
 
+/*
+ * As above, with positions[i] holding frequencies[i] ascending token
+ * positions for lexemes[i].
+ */
+TpVector *create_tpvector_with_positions(
+		const char	  *index_name,
+		int			   entry_count,
+		const char	 **lexemes,
+		const int32	  *frequencies,
+		uint32 *const *positions);
+
 char *get_tpvector_index_name(TpVector *tpvec);
 
+/*
+ * Positions section access.  tpvector_positions_start() returns NULL
+ * if the vector has no positions; otherwise decode one record per
+ * entry, in entry order, with tpvector_positions_decode_advance().
+ * `out` must have room for the entry's frequency; the number of
+ * positions decoded is returned.
+ */
+const uint8 *tpvector_positions_start(TpVector *vec);
+uint32		 tpvector_positions_decode_advance(
+			  const uint8 **cursor, const uint8 *end, uint32 *out, uint32 max);
+
+/*
+ * Static prior.  tpvector_with_prior() returns a palloc'd copy of vec
+ * with the prior appended; tpvector_get_prior() returns 0 for a vector
+ * without one.
+ */
+TpVector *tpvector_with_prior(TpVector *vec, float4 prior);
+float4	  tpvector_get_prior(TpVector *vec);
+
 /*
  * Entry iteration. Pattern:
  *
@@ -0,0 +1,118 @@
+-- Test case: bitmap_scan
+-- The @@ match operator filters in WHERE: bitmap and plain index scans
+-- return every document matching the bm25query (+required, -excluded,
+-- "phrases", min_should_match) from the memtable, spilled and merged
+-- segments, and combine with B-tree conditions.  Without an index the
+-- operator evaluates the same match per row.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+CREATE TABLE bs_docs (id INT PRIMARY KEY, category INT, content TEXT);
+CREATE INDEX bs_idx ON bs_docs USING bm25(content)
+    WITH (text_config='english', positions=true);
+CREATE INDEX bs_category_idx ON bs_docs (category);
+INSERT INTO bs_docs VALUES
+    (1, 1, 'the quick brown fox'),
+    (2, 2, 'the lazy brown dog'),
+    (3, 1, 'quick red fox jumps'),
+    (4, 2, 'a dog and a fox'),
+    (5, 1, 'brown bread and butter');
+
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+EXPLAIN (COSTS OFF)
+SELECT id FROM bs_docs WHERE content @@ to_bm25query('fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS fox FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS any_word FROM bs_docs
+WHERE content @@ to_bm25query('fox dog', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS required FROM bs_docs
+WHERE content @@ to_bm25query('+fox dog', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS excluded FROM bs_docs
+WHERE content @@ to_bm25query('brown -fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS msm FROM bs_docs
+WHERE content @@ to_bm25query('quick brown fox', 'bs_idx', 2);
+SELECT array_agg(id ORDER BY id) AS phrase FROM bs_docs
+WHERE content @@ to_bm25query('"brown fox"', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS slop1 FROM bs_docs
+WHERE content @@ to_bm25query('"quick fox"~1', 'bs_idx');
+SELECT count(*) AS nothing FROM bs_docs
+WHERE content @@ to_bm25query('zebra', 'bs_idx');
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows, with a B-tree
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('bs_idx') IS NOT NULL AS spilled;
+INSERT INTO bs_docs VALUES (6, 2, 'fox in the brown box');
+SELECT array_agg(id ORDER BY id) AS fox FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS required FROM bs_docs
+WHERE content @@ to_bm25query('+brown fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS excluded FROM bs_docs
+WHERE content @@ to_bm25query('brown -fox', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS category2 FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx') AND category = 2;
+SELECT array_agg(id ORDER BY id) AS both_keys FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx')
+  AND content @@ to_bm25query('brown', 'bs_idx');
+
+--------------------------------------------------------------------------------
+-- Test 3: segments after a merge
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('bs_idx') IS NOT NULL AS spilled;
+SELECT bm25_force_merge('bs_idx');
+SELECT array_agg(id ORDER BY id) AS msm FROM bs_docs
+WHERE content @@ to_bm25query('quick brown fox', 'bs_idx', 2);
+SELECT array_agg(id ORDER BY id) AS phrase FROM bs_docs
+WHERE content @@ to_bm25query('"brown fox"', 'bs_idx');
+SELECT array_agg(id ORDER BY id) AS category1 FROM bs_docs
+WHERE content @@ to_bm25query('+brown', 'bs_idx') AND category = 1;
+
+--------------------------------------------------------------------------------
+-- Test 4: plain index scan without ORDER BY, and ranking with a filter
+--------------------------------------------------------------------------------
+SET enable_bitmapscan = off;
+SET enable_indexscan = on;
+SELECT array_agg(id ORDER BY id) AS fox FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx');
+SELECT id FROM bs_docs
+WHERE content @@ to_bm25query('fox', 'bs_idx') AND category = 2
+ORDER BY content <@> to_bm25query('fox', 'bs_idx') LIMIT 10;
+
+--------------------------------------------------------------------------------
+-- Test 5: the standalone operator agrees with the index
+--------------------------------------------------------------------------------
+RESET enable_seqscan;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+SELECT id,
+       content @@ to_bm25query('fox', 'bs_idx') AS fox,
+       content @@ to_bm25query('brown -fox', 'bs_idx') AS excluded,
+       content @@ to_bm25query('"quick fox"~1', 'bs_idx') AS slop1,
+       content @@ to_bm25query('quick brown fox', 'bs_idx', 2) AS msm
+FROM bs_docs ORDER BY id;
+
+--------------------------------------------------------------------------------
+-- Test 6: selectivity estimates expand prefix and fuzzy terms
+--------------------------------------------------------------------------------
+CREATE FUNCTION bs_estimate(query TEXT) RETURNS FLOAT8
+LANGUAGE plpgsql AS $$
+DECLARE
+    plan JSON;
+BEGIN
+    EXECUTE format('EXPLAIN (FORMAT JSON) SELECT 1 FROM bs_docs '
+                   'WHERE content @@ to_bm25query(%L, ''bs_idx'')', query)
+        INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::FLOAT8;
+END $$;
+SELECT bs_estimate('quic*') = bs_estimate('quick') AS prefix,
+       bs_estimate('foz~1') = bs_estimate('fox') AS fuzzy;
+DROP FUNCTION bs_estimate(TEXT);
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE bs_docs;
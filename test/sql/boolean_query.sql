@@ -0,0 +1,116 @@
+-- Test case: boolean_query
+-- "+word" terms must appear in every match and "-word" terms must not
+-- appear in any, in the memtable, in segments, and through the
+-- standalone <@> operator.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE bq_docs (id INT PRIMARY KEY, content TEXT);
+INSERT INTO bq_docs VALUES
+    (1, 'apple banana'),
+    (2, 'apple cherry'),
+    (3, 'banana cherry'),
+    (4, 'apple banana cherry'),
+    (5, 'grape melon');
+CREATE INDEX bq_idx ON bq_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS plain FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS required FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+apple banana', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS both_required FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+apple +banana', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS excluded FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('apple -cherry', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS mixed FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+banana -cherry apple', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS missing_required FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+durian apple', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS only_excluded FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('-cherry', 'bq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('bq_idx') IS NOT NULL AS spilled;
+INSERT INTO bq_docs VALUES
+    (6, 'apple banana banana'),
+    (7, 'cherry apple');
+SELECT array_agg(id ORDER BY id) AS required FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+apple banana', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS both_required FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+apple +banana', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS excluded FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('apple -cherry', 'bq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS mixed FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('+banana -cherry apple', 'bq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 3: the standalone operator agrees with the index scan
+--------------------------------------------------------------------------------
+SELECT id,
+       (content <@> to_bm25query('+banana -cherry apple', 'bq_idx')) < 0
+           AS matches
+FROM bq_docs ORDER BY id;
+
+--------------------------------------------------------------------------------
+-- Test 4: a sign before a digit is part of the number
+--------------------------------------------------------------------------------
+INSERT INTO bq_docs VALUES
+    (8, 'it was -20 degrees'),
+    (9, 'degrees of freedom');
+SELECT array_agg(id ORDER BY id) AS signed_number FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('-20 degrees', 'bq_idx') LIMIT 10) s;
+SELECT id AS best FROM bq_docs
+ORDER BY content <@> to_bm25query('-20 degrees', 'bq_idx') LIMIT 1;
+
+--------------------------------------------------------------------------------
+-- Test 5: with query_operators off, +, - and quotes are not operators,
+-- so 1.3.x query text ranks as its words do
+--------------------------------------------------------------------------------
+SET pg_textsearch.query_operators = off;
+SELECT array_agg(id ORDER BY id) AS plain FROM (
+    SELECT id FROM bq_docs
+    ORDER BY content <@> to_bm25query('apple -cherry', 'bq_idx') LIMIT 10) s;
+SELECT id,
+       (content <@> to_bm25query('+banana -cherry', 'bq_idx')) < 0
+           AS matches
+FROM bq_docs WHERE id <= 3 ORDER BY id;
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS old_text FROM (
+    SELECT id,
+           round((content <@> to_bm25query('-apple "banana cherry"',
+                                           'bq_idx'))::numeric, 4) AS score
+    FROM bq_docs
+    ORDER BY content <@> to_bm25query('-apple "banana cherry"', 'bq_idx')
+    LIMIT 10) s \gset
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS words FROM (
+    SELECT id,
+           round((content <@> to_bm25query('apple banana cherry',
+                                           'bq_idx'))::numeric, 4) AS score
+    FROM bq_docs
+    ORDER BY content <@> to_bm25query('apple banana cherry', 'bq_idx')
+    LIMIT 10) s \gset
+SELECT :'old_text' = :'words' AS same_rows;
+RESET pg_textsearch.query_operators;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE bq_docs;
@@ -0,0 +1,70 @@
+-- Test case: dictionary
+-- Segment dictionaries are front-coded in blocks of 64 terms and
+-- searched by each block's first term.  Exact, prefix, and fuzzy
+-- lookups find terms on both sides of a block boundary, before the
+-- first term and after the last, in spilled and merged segments alike.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE dc_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX dc_idx ON dc_docs USING bm25(content)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+-- Sorted ids of the documents a query matches
+CREATE FUNCTION dc_ids(q text)
+RETURNS int[] LANGUAGE plpgsql AS $$
+DECLARE
+    result int[];
+BEGIN
+    EXECUTE format(
+        'SELECT array_agg(id ORDER BY id) FROM (
+             SELECT id FROM dc_docs
+             ORDER BY content <@> to_bm25query(%L, ''dc_idx'')
+             LIMIT 50) t',
+        q) INTO result;
+    RETURN result;
+END;
+$$;
+
+-- Document i holds the one term w0001 .. w0300, so a segment of all
+-- 300 has blocks starting at w0001, w0065, w0129, w0193, and w0257
+CREATE TABLE dc_queries (n SERIAL, q TEXT);
+INSERT INTO dc_queries (q) VALUES
+    ('w0001'), ('w0064'), ('w0065'), ('w0128'), ('w0129'), ('w0257'),
+    ('w0300'), ('a0001'), ('w0000'), ('w00'), ('w0301'), ('zz'),
+    ('w006*'), ('w012*'), ('w03*'), ('w0065~1');
+
+--------------------------------------------------------------------------------
+-- Test 1: two spilled segments of 150 terms
+--------------------------------------------------------------------------------
+INSERT INTO dc_docs
+SELECT i, 'w' || lpad(i::text, 4, '0') FROM generate_series(1, 150) i;
+SELECT bm25_spill_index('dc_idx') IS NOT NULL AS spilled;
+INSERT INTO dc_docs
+SELECT i, 'w' || lpad(i::text, 4, '0') FROM generate_series(151, 300) i;
+SELECT bm25_spill_index('dc_idx') IS NOT NULL AS spilled;
+
+SELECT q, dc_ids(q) AS ids FROM dc_queries ORDER BY n;
+
+--------------------------------------------------------------------------------
+-- Test 2: one merged segment of 300 terms
+--------------------------------------------------------------------------------
+SELECT bm25_force_merge('dc_idx');
+
+SELECT q, dc_ids(q) AS ids FROM dc_queries ORDER BY n;
+
+--------------------------------------------------------------------------------
+-- Test 3: every term is found at its own index
+--------------------------------------------------------------------------------
+SELECT count(*) AS missed FROM generate_series(1, 300) i
+WHERE dc_ids('w' || lpad(i::text, 4, '0')) IS DISTINCT FROM ARRAY[i];
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP FUNCTION dc_ids(text);
+DROP TABLE dc_queries;
+DROP TABLE dc_docs;
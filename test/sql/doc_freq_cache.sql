@@ -0,0 +1,101 @@
+-- Test case: doc_freq_cache
+-- A term's doc_freq summed over the segments is served from the shared
+-- doc_freq cache until a spill, merge, or VACUUM changes the segments;
+-- the memtable's share is added on top, so inserts need no
+-- invalidation.  Scores match those computed with the cache off.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+SELECT bm25_doc_freq_cache_reset();
+
+CREATE TABLE df_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX df_idx ON df_docs USING bm25(content)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+INSERT INTO df_docs VALUES
+    (1, 'apple banana'),
+    (2, 'apple apple cherry'),
+    (3, 'banana cherry');
+
+--------------------------------------------------------------------------------
+-- Test 1: an index without segments does not use the cache
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM df_docs
+    ORDER BY content <@> to_bm25query('apple', 'df_idx') LIMIT 10) s;
+SELECT hits, misses, entries FROM bm25_doc_freq_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 2: after a spill, repeated terms are hits
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('df_idx') IS NOT NULL AS spilled;
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM df_docs
+    ORDER BY content <@> to_bm25query('apple', 'df_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS apple_banana FROM (
+    SELECT id FROM df_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'df_idx') LIMIT 10) s;
+SELECT hits > 0 AS hit, misses > 0 AS missed, entries
+FROM bm25_doc_freq_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 3: memtable rows are counted on top of cached segment counts
+--------------------------------------------------------------------------------
+INSERT INTO df_docs VALUES (4, 'apple apple apple');
+SELECT hits AS hits_before FROM bm25_doc_freq_cache_stats() \gset
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS cached FROM (
+    SELECT id,
+           round((content <@>
+                  to_bm25query('apple banana', 'df_idx'))::numeric, 4) AS score
+    FROM df_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'df_idx')
+    LIMIT 10) s \gset
+SELECT hits > :hits_before AS hit, entries FROM bm25_doc_freq_cache_stats();
+
+SET pg_textsearch.doc_freq_cache = off;
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS uncached FROM (
+    SELECT id,
+           round((content <@>
+                  to_bm25query('apple banana', 'df_idx'))::numeric, 4) AS score
+    FROM df_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'df_idx')
+    LIMIT 10) s \gset
+RESET pg_textsearch.doc_freq_cache;
+SELECT :'cached' = :'uncached' AS same_scores,
+       :'cached' LIKE '%4:%' AS memtable_row;
+
+--------------------------------------------------------------------------------
+-- Test 4: a second spill changes the generation; entries are replaced
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('df_idx') IS NOT NULL AS spilled;
+SELECT misses AS misses_before FROM bm25_doc_freq_cache_stats() \gset
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS cached FROM (
+    SELECT id,
+           round((content <@>
+                  to_bm25query('apple banana', 'df_idx'))::numeric, 4) AS score
+    FROM df_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'df_idx')
+    LIMIT 10) s \gset
+SELECT misses > :misses_before AS recomputed, entries
+FROM bm25_doc_freq_cache_stats();
+SELECT :'cached' = :'uncached' AS same_scores;
+
+--------------------------------------------------------------------------------
+-- Test 5: disabled cache is neither consulted nor filled
+--------------------------------------------------------------------------------
+SET pg_textsearch.doc_freq_cache = off;
+SELECT hits + misses AS lookups_before FROM bm25_doc_freq_cache_stats() \gset
+SELECT array_agg(id ORDER BY id) AS cherry FROM (
+    SELECT id FROM df_docs
+    ORDER BY content <@> to_bm25query('cherry', 'df_idx') LIMIT 10) s;
+SELECT hits + misses = :lookups_before AS untouched, entries
+FROM bm25_doc_freq_cache_stats();
+RESET pg_textsearch.doc_freq_cache;
+
+--------------------------------------------------------------------------------
+-- Cleanup: dropping the index drops its entries
+--------------------------------------------------------------------------------
+DROP TABLE df_docs;
+SELECT entries, bytes FROM bm25_doc_freq_cache_stats();
@@ -0,0 +1,67 @@
+-- Test case: filtered_topk
+-- ORDER BY <@> with @@ conditions on the same index: the @@ keys are
+-- matched first and only documents matching all of them can enter the
+-- top-k, so LIMIT returns the best filtered documents even when many
+-- better-scoring ones are filtered out.  Covers the memtable, a
+-- spilled segment plus memtable, and several @@ keys.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+CREATE TABLE ft_docs (id INT PRIMARY KEY, content TEXT);
+CREATE INDEX ft_idx ON ft_docs USING bm25(content)
+    WITH (text_config='english');
+-- Twenty top-scoring "fox" documents without "zebra"
+INSERT INTO ft_docs SELECT g, 'fox fox fox fox' FROM generate_series(1, 20) g;
+INSERT INTO ft_docs VALUES
+    (21, 'fox fox fox zebra'),
+    (22, 'fox fox zebra zebra'),
+    (23, 'fox zebra zebra zebra'),
+    (24, 'zebra zebra zebra zebra');
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('zebra', 'ft_idx')
+ORDER BY content <@> to_bm25query('fox', 'ft_idx') LIMIT 2;
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('+fox', 'ft_idx')
+ORDER BY content <@> to_bm25query('zebra', 'ft_idx') LIMIT 2;
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('zebra', 'ft_idx')
+  AND content @@ to_bm25query('fox', 'ft_idx')
+ORDER BY content <@> to_bm25query('fox', 'ft_idx') LIMIT 10;
+SELECT count(*) AS nothing FROM (
+    SELECT id FROM ft_docs
+    WHERE content @@ to_bm25query('unicorn', 'ft_idx')
+    ORDER BY content <@> to_bm25query('fox', 'ft_idx') LIMIT 2) s;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('ft_idx') IS NOT NULL AS spilled;
+INSERT INTO ft_docs VALUES (25, 'fox fox fox fox zebra');
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('zebra', 'ft_idx')
+ORDER BY content <@> to_bm25query('fox', 'ft_idx') LIMIT 2;
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('zebra -fox', 'ft_idx')
+ORDER BY content <@> to_bm25query('zebra', 'ft_idx') LIMIT 2;
+SELECT id FROM ft_docs
+WHERE content @@ to_bm25query('zebra', 'ft_idx')
+  AND content @@ to_bm25query('fox', 'ft_idx')
+ORDER BY content <@> to_bm25query('zebra', 'ft_idx') LIMIT 2;
+
+--------------------------------------------------------------------------------
+-- Test 3: several @@ keys without ORDER BY are intersected by the index
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS both_keys FROM ft_docs
+WHERE content @@ to_bm25query('zebra', 'ft_idx')
+  AND content @@ to_bm25query('+fox', 'ft_idx');
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE ft_docs;
@@ -0,0 +1,128 @@
+-- Test case: fuzzy_query
+-- A "word~N" term stands for the indexed terms within N edits of the
+-- word's lexeme, gathered from the memtable and every segment; only the
+-- pg_textsearch.fuzzy_expansions nearest of them are scored, while a
+-- @@ match takes them all.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE fz_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX fz_idx ON fz_docs USING bm25(content)
+    WITH (text_config='simple');
+RESET client_min_messages;
+
+INSERT INTO fz_docs VALUES
+    (1, 'postgres database'),
+    (2, 'postgres databases'),
+    (3, 'postgress tuning'),
+    (4, 'postgis extension'),
+    (5, 'progress report'),
+    (6, 'unrelated text');
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS edits0 FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~0', 'fz_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS edits1 FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~1', 'fz_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS edits2 FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~2', 'fz_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS typo FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('databse~1', 'fz_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS with_word FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('databse~1 report', 'fz_idx')
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS excluded FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~1 -tuning', 'fz_idx')
+    LIMIT 10) s;
+
+-- An exact match outranks an equally rare term one edit away
+SELECT id FROM fz_docs
+ORDER BY content <@> to_bm25query('database~1', 'fz_idx') LIMIT 1;
+
+-- A one-character lexeme allows no edits
+SELECT array_agg(id ORDER BY id) AS short FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('x~1', 'fz_idx') LIMIT 10) s;
+
+-- At most two edits
+SELECT id FROM fz_docs
+ORDER BY content <@> to_bm25query('postgres~3', 'fz_idx') LIMIT 10;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('fz_idx') IS NOT NULL AS spilled;
+INSERT INTO fz_docs VALUES
+    (7, 'postgrs replication'),
+    (8, 'databse tips');
+
+SELECT array_agg(id ORDER BY id) AS edits1 FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~1', 'fz_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS database FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('database~1', 'fz_idx') LIMIT 10) s;
+
+-- The nearest terms first: postgres (0 edits), then postgrs (1)
+SET pg_textsearch.fuzzy_expansions = 1;
+SELECT array_agg(id ORDER BY id) AS top1 FROM (
+    SELECT id FROM fz_docs
+    ORDER BY content <@> to_bm25query('postgres~2', 'fz_idx') LIMIT 10) s;
+RESET pg_textsearch.fuzzy_expansions;
+
+--------------------------------------------------------------------------------
+-- Test 3: the @@ operator, through the index and standalone
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS edits1 FROM fz_docs
+WHERE content @@ to_bm25query('postgres~1', 'fz_idx');
+
+RESET enable_seqscan;
+SELECT id, content @@ to_bm25query('postgres~1', 'fz_idx') AS edits1,
+       content @@ to_bm25query('postgres~2 text', 'fz_idx') AS edits2
+FROM fz_docs ORDER BY id;
+
+-- Scoring a fuzzy term needs the index
+SELECT id, content <@> to_bm25query('postgres~1', 'fz_idx')
+FROM fz_docs WHERE id = 1;
+
+--------------------------------------------------------------------------------
+-- Test 4: a @@ match takes every expansion, past fuzzy_expansions
+--------------------------------------------------------------------------------
+-- postgres~2 expands to postgres, postgrs, postgress and postgis
+SET pg_textsearch.fuzzy_expansions = 1;
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF)
+SELECT id FROM fz_docs WHERE content @@ to_bm25query('postgres~2', 'fz_idx');
+SELECT array_agg(id ORDER BY id) AS bitmap FROM fz_docs
+WHERE content @@ to_bm25query('postgres~2', 'fz_idx');
+
+SET enable_bitmapscan = off;
+SET enable_indexscan = on;
+SELECT array_agg(id ORDER BY id) AS index FROM fz_docs
+WHERE content @@ to_bm25query('postgres~2', 'fz_idx');
+
+RESET enable_seqscan;
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF)
+SELECT id FROM fz_docs WHERE content @@ to_bm25query('postgres~2', 'fz_idx');
+SELECT array_agg(id ORDER BY id) AS seqscan FROM fz_docs
+WHERE content @@ to_bm25query('postgres~2', 'fz_idx');
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+RESET pg_textsearch.fuzzy_expansions;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE fz_docs;
@@ -0,0 +1,103 @@
+-- Test case: impacts
+-- Indexes created WITH (impacts = true) store each posting's quantized
+-- BM25 impact and every block's largest impact (format V6).  Scoring
+-- uses them only as upper bounds, so results must match the reference
+-- BM25 computation for segments written by spills, merges and CREATE
+-- INDEX, compressed or not, and for indexes mixing segments with and
+-- without impacts.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+\set ECHO none
+\i test/sql/validation.sql
+\set ECHO all
+
+SET enable_seqscan = off;
+
+CREATE TABLE im_docs (id SERIAL PRIMARY KEY, content TEXT);
+CREATE INDEX im_docs_idx ON im_docs USING bm25(content)
+    WITH (text_config='english', impacts=true);
+SELECT reloptions FROM pg_class WHERE relname = 'im_docs_idx';
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+INSERT INTO im_docs (content)
+SELECT repeat('alpha ', 1 + i % 3) ||
+    CASE WHEN i % 4 = 0 THEN 'beta ' ELSE '' END || repeat('filler ', i % 5)
+FROM generate_series(1, 300) i;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha', 'english', 1.2, 0.75) AS memtable_valid;
+
+--------------------------------------------------------------------------------
+-- Test 2: a segment of short documents, then longer ones, so the index
+-- average length drifts above the one the first segment quantized with
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('im_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO im_docs (content)
+SELECT 'alpha ' || CASE WHEN i % 3 = 0 THEN 'beta ' ELSE '' END ||
+    repeat('filler ', 20 + i % 13)
+FROM generate_series(1, 300) i;
+SELECT bm25_spill_index('im_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO im_docs (content)
+SELECT repeat('beta ', 1 + i % 4) || 'doc' || i
+FROM generate_series(1, 50) i;
+
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha', 'english', 1.2, 0.75) AS single_term_valid;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS multi_term_valid;
+
+--------------------------------------------------------------------------------
+-- Test 3: a merge quantizes against the merged segment
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('im_docs_idx') IS NOT NULL AS spilled;
+SELECT bm25_force_merge('im_docs_idx');
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha', 'english', 1.2, 0.75) AS merged_single_valid;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS merged_multi_valid;
+
+--------------------------------------------------------------------------------
+-- Test 4: CREATE INDEX, with uncompressed and compressed blocks
+--------------------------------------------------------------------------------
+DROP INDEX im_docs_idx;
+SET client_min_messages = warning;
+SET pg_textsearch.compress_segments = off;
+CREATE INDEX im_docs_idx ON im_docs USING bm25(content)
+    WITH (text_config='english', impacts=true);
+RESET client_min_messages;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS uncompressed_valid;
+
+DROP INDEX im_docs_idx;
+SET client_min_messages = warning;
+RESET pg_textsearch.compress_segments;
+CREATE INDEX im_docs_idx ON im_docs USING bm25(content)
+    WITH (text_config='english', impacts=true);
+RESET client_min_messages;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha', 'english', 1.2, 0.75) AS built_valid;
+
+--------------------------------------------------------------------------------
+-- Test 5: segments without impacts next to segments with them
+--------------------------------------------------------------------------------
+ALTER INDEX im_docs_idx SET (impacts = false);
+INSERT INTO im_docs (content)
+SELECT repeat('alpha ', 1 + i % 5) || 'beta'
+FROM generate_series(1, 200) i;
+SELECT bm25_spill_index('im_docs_idx') IS NOT NULL AS spilled;
+SELECT validate_bm25_scoring('im_docs', 'content', 'im_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS mixed_valid;
+
+--------------------------------------------------------------------------------
+-- Test 6: errors
+--------------------------------------------------------------------------------
+CREATE INDEX im_bad_idx ON im_docs USING bm25(content)
+    WITH (text_config='english', impacts='maybe');
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE im_docs;
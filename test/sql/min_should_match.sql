@@ -0,0 +1,100 @@
+-- Test case: min_should_match
+-- A bm25query may require a document to contain at least N of the
+-- query's optional terms, set with to_bm25query(text, index, N) or a
+-- trailing " @N" in the text input format while query_operators is on.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE msm_docs (id INT PRIMARY KEY, content TEXT);
+INSERT INTO msm_docs VALUES
+    (1, 'apple banana cherry'),
+    (2, 'apple banana'),
+    (3, 'apple'),
+    (4, 'banana cherry grape'),
+    (5, 'grape melon');
+CREATE INDEX msm_idx ON msm_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Test 1: text input and output
+--------------------------------------------------------------------------------
+SELECT 'msm_idx:apple banana @2'::bm25query AS q;
+SELECT to_bm25query('apple banana', 'msm_idx', 2) AS q;
+SELECT 'msm_idx:mail user@host'::bm25query AS literal;
+SELECT to_bm25query('apple banana', 'msm_idx', 2) =
+       to_bm25query('apple banana', 'msm_idx') AS same;
+SELECT to_bm25query('apple', 'msm_idx', -1);
+
+--------------------------------------------------------------------------------
+-- Test 2: memtable
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS two_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> 'msm_idx:apple banana cherry @2'::bm25query
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS three_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> 'msm_idx:apple banana cherry @3'::bm25query
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS three_of_four FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> to_bm25query('apple banana cherry grape', 'msm_idx', 3)
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS too_many FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> to_bm25query('apple banana', 'msm_idx', 3)
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS with_required FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> to_bm25query('+apple banana cherry', 'msm_idx', 1)
+    LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 3: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('msm_idx') IS NOT NULL AS spilled;
+INSERT INTO msm_docs VALUES
+    (6, 'cherry grape melon'),
+    (7, 'apple cherry');
+SELECT array_agg(id ORDER BY id) AS two_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> 'msm_idx:apple banana cherry @2'::bm25query
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS three_of_four FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> to_bm25query('apple banana cherry grape', 'msm_idx', 3)
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS three_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> 'msm_idx:cherry grape melon @3'::bm25query
+    LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 4: the standalone operator agrees with the index scan
+--------------------------------------------------------------------------------
+SELECT id,
+       (content <@> 'msm_idx:apple banana cherry @2'::bm25query) < 0
+           AS matches
+FROM msm_docs ORDER BY id;
+
+--------------------------------------------------------------------------------
+-- Test 5: with query_operators off, " @N" is query text as in 1.3.x
+--------------------------------------------------------------------------------
+SET pg_textsearch.query_operators = off;
+SELECT 'msm_idx:apple banana cherry @3'::bm25query =
+       to_bm25query('apple banana cherry @3', 'msm_idx') AS literal;
+SELECT array_agg(id ORDER BY id) AS any_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> 'msm_idx:apple banana cherry @3'::bm25query
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS three_of_three FROM (
+    SELECT id FROM msm_docs
+    ORDER BY content <@> to_bm25query('apple banana cherry', 'msm_idx', 3)
+    LIMIT 10) s;
+RESET pg_textsearch.query_operators;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE msm_docs;
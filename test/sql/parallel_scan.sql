@@ -0,0 +1,153 @@
+-- Test case: parallel_scan
+-- Parallel index scan: participants claim segments from a shared work
+-- queue, score with a shared corpus snapshot and top-k threshold, and
+-- Gather Merge combines their sorted streams.  Results must match a
+-- serial scan, also for a query too long to share its doc_freqs, which
+-- the participant owning the snapshot scores alone.
+
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE pscan_docs (id int PRIMARY KEY, content text);
+CREATE INDEX pscan_docs_idx ON pscan_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Setup: four segments plus a non-empty memtable.  Scores depend only on
+-- document length, so the shortest documents (i % 211 = 0) are spread over
+-- every segment and the memtable.
+--------------------------------------------------------------------------------
+INSERT INTO pscan_docs
+SELECT i, 'quick fox ' || repeat('filler ', i % 211)
+FROM generate_series(1, 2000) i;
+SELECT bm25_spill_index('pscan_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO pscan_docs
+SELECT i, 'quick fox ' || repeat('filler ', i % 211)
+FROM generate_series(2001, 4000) i;
+SELECT bm25_spill_index('pscan_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO pscan_docs
+SELECT i, 'quick ' || repeat('filler ', i % 211)
+FROM generate_series(4001, 6000) i;
+SELECT bm25_spill_index('pscan_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO pscan_docs
+SELECT i, 'fox ' || repeat('filler ', i % 211)
+FROM generate_series(6001, 8000) i;
+SELECT bm25_spill_index('pscan_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO pscan_docs
+SELECT i, 'quick fox ' || repeat('filler ', i % 211)
+FROM generate_series(8001, 8500) i;
+
+ANALYZE pscan_docs;
+
+--------------------------------------------------------------------------------
+-- Serial baseline
+--------------------------------------------------------------------------------
+SET max_parallel_workers_per_gather = 0;
+
+-- 72 terms, more than the shared snapshot holds doc_freqs for
+SELECT 'quick fox ' || string_agg('absent' || i, ' ') AS long_query
+FROM generate_series(1, 70) i \gset
+
+CREATE TABLE pscan_serial_multi AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> 'quick fox'
+LIMIT 40;
+
+CREATE TABLE pscan_serial_single AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> 'fox'
+LIMIT 40;
+
+CREATE TABLE pscan_serial_long AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> :'long_query'
+LIMIT 40;
+
+--------------------------------------------------------------------------------
+-- Parallel run
+--------------------------------------------------------------------------------
+SET max_parallel_workers_per_gather = 2;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_index_scan_size = 0;
+SET min_parallel_table_scan_size = 0;
+
+EXPLAIN (COSTS OFF)
+SELECT id FROM pscan_docs
+ORDER BY content <@> 'quick fox'
+LIMIT 40;
+
+CREATE TABLE pscan_parallel_multi AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> 'quick fox'
+LIMIT 40;
+
+CREATE TABLE pscan_parallel_single AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> 'fox'
+LIMIT 40;
+
+CREATE TABLE pscan_parallel_long AS
+SELECT id FROM pscan_docs
+ORDER BY content <@> :'long_query'
+LIMIT 40;
+
+RESET max_parallel_workers_per_gather;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_index_scan_size;
+RESET min_parallel_table_scan_size;
+
+--------------------------------------------------------------------------------
+-- Test 1: same number of rows, same score multiset (ties may resolve to
+-- different ids, so compare document lengths, which determine the score)
+--------------------------------------------------------------------------------
+SELECT
+    (SELECT count(*) FROM pscan_parallel_multi) AS parallel_rows,
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_parallel_multi p JOIN pscan_docs d USING (id)) =
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_serial_multi s JOIN pscan_docs d USING (id))
+        AS multi_term_matches;
+
+SELECT
+    (SELECT count(*) FROM pscan_parallel_single) AS parallel_rows,
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_parallel_single p JOIN pscan_docs d USING (id)) =
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_serial_single s JOIN pscan_docs d USING (id))
+        AS single_term_matches;
+
+--------------------------------------------------------------------------------
+-- Test 2: every returned row really matches the query
+--------------------------------------------------------------------------------
+SELECT count(*) AS non_matching
+FROM pscan_parallel_multi p JOIN pscan_docs d USING (id)
+WHERE d.content NOT LIKE '%quick%' AND d.content NOT LIKE '%fox%';
+
+--------------------------------------------------------------------------------
+-- Test 3: a query over 64 terms matches the serial scan
+--------------------------------------------------------------------------------
+SELECT
+    (SELECT count(*) FROM pscan_parallel_long) AS parallel_rows,
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_parallel_long p JOIN pscan_docs d USING (id)) =
+    (SELECT array_agg(length(d.content) ORDER BY length(d.content))
+       FROM pscan_serial_long s JOIN pscan_docs d USING (id))
+        AS long_query_matches;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE pscan_serial_multi;
+DROP TABLE pscan_serial_single;
+DROP TABLE pscan_parallel_multi;
+DROP TABLE pscan_parallel_single;
+DROP TABLE pscan_serial_long;
+DROP TABLE pscan_parallel_long;
+DROP TABLE pscan_docs;
@@ -0,0 +1,123 @@
+-- Test case: partition_stats
+-- With pg_textsearch.partition_global_stats on, partitions of a
+-- partitioned BM25 index score with statistics summed over all
+-- partitions, so a cross-partition query returns the scores an
+-- unpartitioned index over the same rows would.  The partitions'
+-- scans also share a top-k threshold; a small default_limit makes
+-- them fetch several batches so batches cut short by it are resumed.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+SET pg_textsearch.default_limit = 5;
+
+-- The same rows, partitioned with a skewed term distribution and flat
+CREATE TABLE ps_docs (id INT, part INT, content TEXT) PARTITION BY LIST (part);
+CREATE TABLE ps_a PARTITION OF ps_docs FOR VALUES IN (1);
+CREATE TABLE ps_b PARTITION OF ps_docs FOR VALUES IN (2);
+CREATE TABLE ps_c PARTITION OF ps_docs FOR VALUES IN (3);
+CREATE TABLE ps_flat (id INT, part INT, content TEXT);
+
+INSERT INTO ps_docs
+SELECT i, 1, repeat('alpha ', 1 + i % 4) || repeat('filler ', i % 7) ||
+    CASE WHEN i % 10 = 0 THEN 'beta' ELSE '' END
+FROM generate_series(1, 400) i;
+INSERT INTO ps_docs
+SELECT 1000 + i, 2, 'alpha beta ' || repeat('gamma ', i % 5)
+FROM generate_series(1, 40) i;
+INSERT INTO ps_docs
+SELECT 2000 + i, 3, repeat('beta ', 1 + i % 3) || repeat('filler ', i % 9) ||
+    CASE WHEN i % 20 = 0 THEN 'alpha' ELSE '' END
+FROM generate_series(1, 100) i;
+INSERT INTO ps_flat SELECT * FROM ps_docs;
+
+SET client_min_messages = warning;
+CREATE INDEX ps_docs_idx ON ps_docs USING bm25(content)
+    WITH (text_config='english');
+CREATE INDEX ps_flat_idx ON ps_flat USING bm25(content)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+-- Top scores (sorted, so ties cut by LIMIT do not matter) and every
+-- (id, score) of a query, from the partitioned and the flat table
+CREATE FUNCTION ps_top(tbl regclass, idx text, q text, n int)
+RETURNS numeric[] LANGUAGE plpgsql AS $$
+DECLARE
+    result numeric[];
+BEGIN
+    EXECUTE format(
+        'SELECT array_agg(s ORDER BY s) FROM (
+             SELECT round(-(content <@> to_bm25query(%L, %L))::numeric, 4) AS s
+             FROM %s ORDER BY content <@> to_bm25query(%L, %L) LIMIT %s) t',
+        q, idx, tbl, q, idx, n) INTO result;
+    RETURN result;
+END;
+$$;
+
+CREATE FUNCTION ps_all(tbl regclass, idx text, q text)
+RETURNS text[] LANGUAGE plpgsql AS $$
+DECLARE
+    result text[];
+BEGIN
+    EXECUTE format(
+        'SELECT array_agg(id || '':'' || s ORDER BY id) FROM (
+             SELECT id,
+                 round(-(content <@> to_bm25query(%L, %L))::numeric, 4) AS s
+             FROM %s ORDER BY content <@> to_bm25query(%L, %L) LIMIT 1000) t',
+        q, idx, tbl, q, idx) INTO result;
+    RETURN result;
+END;
+$$;
+
+--------------------------------------------------------------------------------
+-- Test 1: partition-local statistics (default) score differently
+--------------------------------------------------------------------------------
+SHOW pg_textsearch.partition_global_stats;
+SELECT ps_top('ps_docs', 'ps_docs_idx', 'beta', 10) =
+       ps_top('ps_flat', 'ps_flat_idx', 'beta', 10) AS local_same_top10;
+
+--------------------------------------------------------------------------------
+-- Test 2: global statistics match the flat index
+--------------------------------------------------------------------------------
+SET pg_textsearch.partition_global_stats = on;
+SELECT ps_top('ps_docs', 'ps_docs_idx', 'beta', 10) =
+       ps_top('ps_flat', 'ps_flat_idx', 'beta', 10) AS single_same_top10;
+SELECT ps_top('ps_docs', 'ps_docs_idx', 'alpha beta', 10) =
+       ps_top('ps_flat', 'ps_flat_idx', 'alpha beta', 10) AS multi_same_top10;
+SELECT ps_top('ps_docs', 'ps_docs_idx', 'gamma', 3) =
+       ps_top('ps_flat', 'ps_flat_idx', 'gamma', 3) AS rare_same_top3;
+
+-- Every match is returned, with the flat index's score, even rows the
+-- shared threshold deferred
+SELECT ps_all('ps_docs', 'ps_docs_idx', 'beta') =
+       ps_all('ps_flat', 'ps_flat_idx', 'beta') AS single_same_all;
+SELECT ps_all('ps_docs', 'ps_docs_idx', 'alpha beta') =
+       ps_all('ps_flat', 'ps_flat_idx', 'alpha beta') AS multi_same_all;
+SELECT cardinality(ps_all('ps_docs', 'ps_docs_idx', 'alpha beta'))
+    AS multi_matches;
+
+--------------------------------------------------------------------------------
+-- Test 3: segments, and statistics gathered again after inserts
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('ps_a_content_idx') IS NOT NULL AS spilled;
+SELECT bm25_spill_index('ps_c_content_idx') IS NOT NULL AS spilled;
+SELECT bm25_spill_index('ps_flat_idx') IS NOT NULL AS spilled;
+
+INSERT INTO ps_docs
+SELECT 3000 + i, 2, 'beta gamma ' || repeat('filler ', i % 3)
+FROM generate_series(1, 30) i;
+INSERT INTO ps_flat SELECT * FROM ps_docs WHERE id > 3000;
+
+SELECT ps_top('ps_docs', 'ps_docs_idx', 'beta', 10) =
+       ps_top('ps_flat', 'ps_flat_idx', 'beta', 10) AS spilled_same_top10;
+SELECT ps_all('ps_docs', 'ps_docs_idx', 'beta gamma') =
+       ps_all('ps_flat', 'ps_flat_idx', 'beta gamma') AS spilled_same_all;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+RESET pg_textsearch.partition_global_stats;
+RESET pg_textsearch.default_limit;
+DROP FUNCTION ps_top(regclass, text, text, int);
+DROP FUNCTION ps_all(regclass, text, text);
+DROP TABLE ps_docs;
+DROP TABLE ps_flat;
@@ -0,0 +1,116 @@
+-- Test case: phrase_query
+-- "quoted phrases" (with an optional ~N slop) match only documents
+-- containing the words in order, in the memtable, in spilled and
+-- merged segments, in a built index, and through the standalone <@>
+-- operator.  Positions are stored only WITH (positions = true); an
+-- index without them scores a phrase's words as ordinary words.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE pq_docs (id INT PRIMARY KEY, content TEXT);
+CREATE INDEX pq_idx ON pq_docs USING bm25(content)
+    WITH (text_config='english', positions=true);
+INSERT INTO pq_docs VALUES
+    (1, 'the quick brown fox jumps'),
+    (2, 'brown quick fox'),
+    (3, 'quick red brown fox'),
+    (4, 'fox brown quick'),
+    (5, 'quick fox');
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS exact FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS slop1 FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"~1', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS with_word FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"brown fox" jumps', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS slop2 FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick fox"~2', 'pq_idx') LIMIT 10) s;
+-- A stopword leaves a one-word phrase, i.e. a required word
+SELECT array_agg(id ORDER BY id) AS stopword FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"the quick"', 'pq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('pq_idx') IS NOT NULL AS spilled;
+INSERT INTO pq_docs VALUES
+    (6, 'quick brown bear'),
+    (7, 'brown bear quick');
+SELECT array_agg(id ORDER BY id) AS exact FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS reversed FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"brown quick"', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS slop1 FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"~1', 'pq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 3: positions survive a merge
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('pq_idx') IS NOT NULL AS spilled;
+SELECT bm25_force_merge('pq_idx');
+SELECT array_agg(id ORDER BY id) AS slop1 FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"~1', 'pq_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS exact FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"brown bear"', 'pq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 4: positions written by CREATE INDEX
+--------------------------------------------------------------------------------
+DROP INDEX pq_idx;
+CREATE INDEX pq_idx ON pq_docs USING bm25(content)
+    WITH (text_config='english', positions=true);
+SELECT array_agg(id ORDER BY id) AS slop1 FROM (
+    SELECT id FROM pq_docs
+    ORDER BY content <@> to_bm25query('"quick brown"~1', 'pq_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 5: the standalone operator agrees with the index scan
+--------------------------------------------------------------------------------
+SELECT id,
+       (content <@> to_bm25query('"quick brown"~1', 'pq_idx')) < 0 AS matches
+FROM pq_docs ORDER BY id;
+
+--------------------------------------------------------------------------------
+-- Test 6: errors
+--------------------------------------------------------------------------------
+SELECT id FROM pq_docs
+ORDER BY content <@> to_bm25query('fox -"quick brown"', 'pq_idx') LIMIT 10;
+
+--------------------------------------------------------------------------------
+-- Test 7: an index without positions scores a phrase's words on their own
+--------------------------------------------------------------------------------
+CREATE TABLE pq_plain (id INT PRIMARY KEY, content TEXT);
+INSERT INTO pq_plain VALUES
+    (1, 'quick brown'), (2, 'brown quick'), (3, 'quick fox'), (4, 'lazy dog');
+CREATE INDEX pq_plain_idx ON pq_plain USING bm25(content)
+    WITH (text_config='english');
+SELECT array_agg(id ORDER BY id) AS words FROM (
+    SELECT id FROM pq_plain
+    ORDER BY content <@> to_bm25query('"quick brown"', 'pq_plain_idx')
+    LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS matched FROM pq_plain
+WHERE content @@ to_bm25query('"quick brown"', 'pq_plain_idx');
+
+RESET enable_seqscan;
+SELECT id, content @@ to_bm25query('"quick brown"', 'pq_plain_idx') AS standalone
+FROM pq_plain ORDER BY id;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE pq_docs;
+DROP TABLE pq_plain;
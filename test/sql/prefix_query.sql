@@ -0,0 +1,127 @@
+-- Test case: prefix_query
+-- A "word*" term stands for the indexed terms starting with the word's
+-- lexeme, gathered from the memtable and every segment; only the
+-- pg_textsearch.prefix_expansions most frequent of them are scored,
+-- while a @@ match takes them all.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE px_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX px_idx ON px_docs USING bm25(content)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+INSERT INTO px_docs VALUES
+    (1, 'database systems'),
+    (2, 'databases scale out'),
+    (3, 'data lake'),
+    (4, 'data warehouse'),
+    (5, 'data pipeline'),
+    (6, 'dated design'),
+    (7, 'unrelated text');
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS datab FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('datab*', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS dat FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat*', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS with_word FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('datab* lake', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS required FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('+lake dat*', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS excluded FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat* -lake', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS no_terms FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('zebr*', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS stop_word FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('the*', 'px_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('px_idx') IS NOT NULL AS spilled;
+INSERT INTO px_docs VALUES
+    (8, 'data science'),
+    (9, 'datasets ready');
+
+SELECT array_agg(id ORDER BY id) AS datab FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('datab*', 'px_idx') LIMIT 10) s;
+SELECT array_agg(id ORDER BY id) AS dat FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat*', 'px_idx') LIMIT 10) s;
+
+-- The most frequent terms over both: data (4), then databas (2)
+SET pg_textsearch.prefix_expansions = 1;
+SELECT array_agg(id ORDER BY id) AS top1 FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat*', 'px_idx') LIMIT 10) s;
+SET pg_textsearch.prefix_expansions = 2;
+SELECT array_agg(id ORDER BY id) AS top2 FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat*', 'px_idx') LIMIT 10) s;
+RESET pg_textsearch.prefix_expansions;
+
+-- Every expansion counts toward min_should_match
+SELECT array_agg(id ORDER BY id) AS msm FROM (
+    SELECT id FROM px_docs
+    ORDER BY content <@> to_bm25query('dat* scienc*', 'px_idx', 2)
+    LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Test 3: the @@ operator, through the index and standalone
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS datab FROM px_docs
+WHERE content @@ to_bm25query('datab*', 'px_idx');
+
+RESET enable_seqscan;
+SELECT id, content @@ to_bm25query('datab*', 'px_idx') AS datab,
+       content @@ to_bm25query('data* -lake', 'px_idx') AS excluded
+FROM px_docs ORDER BY id;
+
+-- Scoring a prefix term needs the index
+SELECT id, content <@> to_bm25query('datab*', 'px_idx')
+FROM px_docs WHERE id = 1;
+
+--------------------------------------------------------------------------------
+-- Test 4: a @@ match takes every expansion, past prefix_expansions
+--------------------------------------------------------------------------------
+-- dat* expands to data, databas, date and dataset
+SET pg_textsearch.prefix_expansions = 1;
+SET enable_seqscan = off;
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF)
+SELECT id FROM px_docs WHERE content @@ to_bm25query('dat*', 'px_idx');
+SELECT array_agg(id ORDER BY id) AS bitmap FROM px_docs
+WHERE content @@ to_bm25query('dat*', 'px_idx');
+
+SET enable_bitmapscan = off;
+SET enable_indexscan = on;
+SELECT array_agg(id ORDER BY id) AS index FROM px_docs
+WHERE content @@ to_bm25query('dat*', 'px_idx');
+
+RESET enable_seqscan;
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF)
+SELECT id FROM px_docs WHERE content @@ to_bm25query('dat*', 'px_idx');
+SELECT array_agg(id ORDER BY id) AS seqscan FROM px_docs
+WHERE content @@ to_bm25query('dat*', 'px_idx');
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+RESET pg_textsearch.prefix_expansions;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE px_docs;
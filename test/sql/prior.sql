@@ -0,0 +1,166 @@
+-- Test case: prior
+-- An index's INCLUDE column is stored as each document's static
+-- prior.  bm25query_with_prior adds weight * prior to every score and
+-- bm25query_with_decay adds a bonus that halves every half-life before
+-- the origin; the top-k of an index scan matches ranking every match
+-- by hand, in the memtable and in segments.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE pr_docs (id INT PRIMARY KEY, content TEXT, popularity REAL);
+SET client_min_messages = warning;
+CREATE INDEX pr_idx ON pr_docs USING bm25(content) INCLUDE (popularity)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+--------------------------------------------------------------------------------
+-- Test 1: equal BM25 scores are ordered by the prior
+--------------------------------------------------------------------------------
+INSERT INTO pr_docs SELECT i, 'fox fox', i FROM generate_series(1, 20) i;
+
+SELECT id FROM pr_docs
+ORDER BY content <@> bm25query_with_prior(to_bm25query('fox', 'pr_idx'), 1)
+LIMIT 5;
+
+SELECT bm25_spill_index('pr_idx') IS NOT NULL AS spilled;
+INSERT INTO pr_docs VALUES (21, 'fox fox', 17.5), (22, 'fox fox', 0);
+
+SELECT id FROM pr_docs
+ORDER BY content <@> bm25query_with_prior(to_bm25query('fox', 'pr_idx'), 1)
+LIMIT 5;
+
+--------------------------------------------------------------------------------
+-- Test 2: the index top-k matches BM25 plus the prior, ranked by hand
+--------------------------------------------------------------------------------
+CREATE TABLE pr_mixed (id INT PRIMARY KEY, content TEXT, popularity REAL);
+INSERT INTO pr_mixed
+SELECT i, repeat('fox ', 1 + i % 5) || repeat('filler ', i % 7),
+    (i * 37 % 101) / 10.0
+FROM generate_series(1, 300) i;
+SET client_min_messages = warning;
+CREATE INDEX pm_idx ON pr_mixed USING bm25(content) INCLUDE (popularity)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+-- Top-n ids (sorted, so the order of ties does not matter) from the
+-- index and from every match's BM25 score plus weight * prior
+CREATE FUNCTION pr_top(q text, weight float8, n int)
+RETURNS int[] LANGUAGE plpgsql AS $$
+DECLARE
+    result int[];
+BEGIN
+    EXECUTE format(
+        'SELECT array_agg(id ORDER BY id) FROM (
+             SELECT id FROM pr_mixed
+             ORDER BY content <@> bm25query_with_prior(
+                 to_bm25query(%L, ''pm_idx''), %s)
+             LIMIT %s) t',
+        q, weight, n) INTO result;
+    RETURN result;
+END;
+$$;
+
+CREATE FUNCTION pr_brute(q text, weight float8, n int)
+RETURNS int[] LANGUAGE plpgsql AS $$
+DECLARE
+    result int[];
+BEGIN
+    EXECUTE format(
+        'SELECT array_agg(id ORDER BY id) FROM (
+             SELECT id FROM (
+                 SELECT id, popularity,
+                     -(content <@> to_bm25query(%L, ''pm_idx'')) AS score
+                 FROM pr_mixed
+                 ORDER BY content <@> to_bm25query(%L, ''pm_idx'')
+                 LIMIT 1000) m
+             ORDER BY score + %s * popularity DESC LIMIT %s) t',
+        q, q, weight, n) INTO result;
+    RETURN result;
+END;
+$$;
+
+SELECT pr_top('fox', 0.3, 10) = pr_brute('fox', 0.3, 10) AS single_memtable;
+SELECT pr_top('fox filler', 0.3, 10) = pr_brute('fox filler', 0.3, 10)
+    AS multi_memtable;
+
+SELECT bm25_spill_index('pm_idx') IS NOT NULL AS spilled;
+INSERT INTO pr_mixed
+SELECT i, repeat('fox ', 1 + i % 3) || repeat('filler ', i % 4),
+    (i * 53 % 97) / 10.0
+FROM generate_series(301, 350) i;
+
+SELECT pr_top('fox', 0.3, 10) = pr_brute('fox', 0.3, 10) AS single_segment;
+SELECT pr_top('fox', 5, 10) = pr_brute('fox', 5, 10) AS single_heavy;
+SELECT pr_top('fox filler', 0.3, 10) = pr_brute('fox filler', 0.3, 10)
+    AS multi_segment;
+SELECT pr_top('fox filler', 0, 10) = pr_brute('fox filler', 0, 10)
+    AS multi_weight_zero;
+
+--------------------------------------------------------------------------------
+-- Test 3: recency decay of a timestamp prior
+--------------------------------------------------------------------------------
+CREATE TABLE pr_events (id INT PRIMARY KEY, content TEXT, created_at TIMESTAMPTZ);
+SET client_min_messages = warning;
+CREATE INDEX pe_idx ON pr_events USING bm25(content) INCLUDE (created_at)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+-- One event a day before the origin, and one after it
+INSERT INTO pr_events
+SELECT i, 'fox', '2026-01-01 00:00:00+00'::timestamptz - i * interval '1 day'
+FROM generate_series(1, 10) i;
+INSERT INTO pr_events VALUES (100, 'fox', '2026-06-01 00:00:00+00');
+
+SELECT id FROM pr_events
+ORDER BY content <@> bm25query_with_decay(
+    to_bm25query('fox', 'pe_idx'), 10, '1 day', '2026-01-01 00:00:00+00')
+LIMIT 5;
+
+SELECT bm25_spill_index('pe_idx') IS NOT NULL AS spilled;
+SELECT id FROM pr_events
+ORDER BY content <@> bm25query_with_decay(
+    to_bm25query('fox', 'pe_idx'), 10, '1 day', '2026-01-01 00:00:00+00')
+LIMIT 5;
+
+--------------------------------------------------------------------------------
+-- Test 4: text form and errors
+--------------------------------------------------------------------------------
+SELECT bm25query_with_prior(to_bm25query('fox', 'pr_idx'), 0.5) AS q;
+SELECT bm25query_with_decay(to_bm25query('fox', 'pe_idx'), 2, '1 day',
+    '1970-01-02 00:00:00+00') AS q;
+SELECT 'pe_idx:fox @decay:2,86400,86400'::bm25query =
+       bm25query_with_decay(to_bm25query('fox', 'pe_idx'), 2, '1 day',
+           '1970-01-02 00:00:00+00') AS same;
+
+SELECT bm25query_with_prior(to_bm25query('fox', 'pr_idx'), -1);
+SELECT bm25query_with_decay(to_bm25query('fox', 'pe_idx'), 1, '0 seconds');
+
+-- The prior is only known to the index
+SELECT id, content <@> bm25query_with_prior(to_bm25query('fox', 'pr_idx'), 1)
+FROM pr_docs WHERE id = 1;
+
+CREATE TABLE pr_plain (id INT, content TEXT, tag TEXT, a REAL, b REAL);
+SET client_min_messages = warning;
+CREATE INDEX pr_plain_idx ON pr_plain USING bm25(content)
+    WITH (text_config='english');
+CREATE INDEX pr_bad_idx ON pr_plain USING bm25(content) INCLUDE (tag)
+    WITH (text_config='english');
+CREATE INDEX pr_bad_idx ON pr_plain USING bm25(content) INCLUDE (a, b)
+    WITH (text_config='english');
+RESET client_min_messages;
+INSERT INTO pr_plain VALUES (1, 'fox', 'x', 1, 2);
+SELECT id FROM pr_plain
+ORDER BY content <@> bm25query_with_prior(
+    to_bm25query('fox', 'pr_plain_idx'), 1)
+LIMIT 1;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP FUNCTION pr_top(text, float8, int);
+DROP FUNCTION pr_brute(text, float8, int);
+DROP TABLE pr_docs;
+DROP TABLE pr_mixed;
+DROP TABLE pr_events;
+DROP TABLE pr_plain;
@@ -8,8 +8,9 @@
 -- returned even though qualifying rows exist in the table.
 --
 -- The fix: when the executor exhausts the index's result set without
--- satisfying LIMIT, the index rescans with a larger internal limit
--- (exponential backoff: 2x, 4x, ...) until enough rows are found.
+-- satisfying LIMIT, the index scores another batch, resuming below the
+-- rows already returned, with a larger internal limit (exponential
+-- backoff: 2x, 4x, ...) until enough rows are found.
 
 SET log_duration = off;
 CREATE EXTENSION IF NOT EXISTS pg_textsearch;
@@ -208,13 +209,16 @@ FROM (
 ------------------------------------------------------------------------
 -- Test 8: multiple backoffs required
 --
--- With default_limit=5, finding 3 rows with tag=1 among 500 rows
--- requires the limit to grow: 5 -> 10 -> 20 -> 40 -> 80 -> 160 ->
--- 320 -> 640.  That's 7 doublings.  The NOTICE trace messages from
--- the rescan code confirm each backoff step.
+-- The LIMIT is pushed down, so the first batch holds 3 rows.  Finding
+-- 3 rows with tag=1 below the 490 rows with tag=0 requires the batch
+-- to grow: 3 -> 6 -> 12 -> 24 -> 48 -> 96 -> 192 -> 384.  That's 7
+-- doublings, each batch resuming below the rows the previous ones
+-- returned.  The NOTICE trace messages from the rescan code confirm
+-- each backoff step.
 ------------------------------------------------------------------------
 
 SET pg_textsearch.default_limit = 5;
+SET pg_textsearch.log_bmw_stats = on;
 
 SELECT COUNT(*) AS multi_backoff
 FROM (
@@ -224,16 +228,20 @@ FROM (
     LIMIT 3
 ) q;
 
+SET pg_textsearch.log_bmw_stats = off;
 SET pg_textsearch.default_limit = 1000;
 
 ------------------------------------------------------------------------
 -- Test 9: backoff terminates when all matching rows exhausted
 --
 -- Ask for 20 rows with tag=1, but only 10 exist.  The index should
--- keep doubling until it has scanned all 500 docs, then stop.
+-- keep doubling the batch until it has returned all 500 docs, then
+-- stop: the NOTICE trace ends with the batch of 320 that comes back
+-- short.
 ------------------------------------------------------------------------
 
 SET pg_textsearch.default_limit = 5;
+SET pg_textsearch.log_bmw_stats = on;
 
 SELECT COUNT(*) AS exhausted_backoff
 FROM (
@@ -243,6 +251,7 @@ FROM (
     LIMIT 20
 ) q;
 
+SET pg_textsearch.log_bmw_stats = off;
 SET pg_textsearch.default_limit = 1000;
 
 ------------------------------------------------------------------------
@@ -265,9 +274,80 @@ LATERAL (
 ) t
 ORDER BY v.x, t.id;
 
+------------------------------------------------------------------------
+-- Test 11: batches resume across a run of equal scores
+--
+-- 490 rows of rescan_large share one score.  With default_limit=7
+-- every batch boundary falls inside that run, so each batch must
+-- resume among the tied rows it has not returned yet: every row
+-- exactly once, in score order.
+------------------------------------------------------------------------
+
+SET pg_textsearch.default_limit = 7;
+
+SELECT COUNT(*) AS all_rows,
+       COUNT(DISTINCT id) AS distinct_rows,
+       bool_and(prev IS NULL OR score >= prev) AS in_score_order
+FROM (
+    SELECT id, score, lag(score) OVER (ORDER BY n) AS prev
+    FROM (
+        SELECT id, score, row_number() OVER () AS n
+        FROM (
+            SELECT id,
+                   content <@> to_bm25query('server', 'rescan_large_idx')
+                       AS score
+            FROM rescan_large
+            ORDER BY content <@> to_bm25query('server', 'rescan_large_idx')
+        ) s
+    ) t
+) u;
+
+SET pg_textsearch.default_limit = 1000;
+
+------------------------------------------------------------------------
+-- Test 12: a spill between batches
+--
+-- Spilling the memtable between two batches moves the rows already
+-- scored into a segment, so the next batch starts over from the top
+-- and skips the rows the scan has returned: every row exactly once.
+------------------------------------------------------------------------
+
+CREATE TABLE rescan_spill (id INT PRIMARY KEY, content TEXT);
+CREATE INDEX rescan_spill_idx ON rescan_spill
+USING bm25(content) WITH (text_config='english');
+INSERT INTO rescan_spill
+SELECT i, 'server ' || repeat('cluster ', i % 7)
+FROM generate_series(1, 60) i;
+CREATE TEMP TABLE rescan_spill_seen (id INT);
+
+SET pg_textsearch.default_limit = 5;
+
+DO $$
+DECLARE
+    r RECORD;
+    n INT := 0;
+BEGIN
+    FOR r IN
+        SELECT id FROM rescan_spill
+        ORDER BY content <@> to_bm25query('server', 'rescan_spill_idx')
+    LOOP
+        INSERT INTO rescan_spill_seen VALUES (r.id);
+        n := n + 1;
+        IF n = 8 THEN
+            PERFORM bm25_spill_index('rescan_spill_idx');
+        END IF;
+    END LOOP;
+END $$;
+
+SET pg_textsearch.default_limit = 1000;
+
+SELECT COUNT(*) AS all_rows, COUNT(DISTINCT id) AS distinct_rows
+FROM rescan_spill_seen;
+
 ------------------------------------------------------------------------
 -- Cleanup
 ------------------------------------------------------------------------
 DROP TABLE rescan_test CASCADE;
 DROP TABLE rescan_large CASCADE;
+DROP TABLE rescan_spill CASCADE;
 DROP EXTENSION pg_textsearch CASCADE;
@@ -0,0 +1,87 @@
+-- Test case: result_cache
+-- Repeated queries are served from the shared result cache until the
+-- index changes: an insert, a spill, or a VACUUM that removes
+-- documents makes the cached entry stale.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+SET pg_textsearch.result_cache = on;
+SELECT bm25_result_cache_reset();
+
+CREATE TABLE rc_docs (id INT PRIMARY KEY, content TEXT);
+INSERT INTO rc_docs VALUES
+    (1, 'apple banana'),
+    (2, 'apple apple cherry'),
+    (3, 'banana cherry');
+CREATE INDEX rc_docs_idx ON rc_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Test 1: the second identical query is a hit
+--------------------------------------------------------------------------------
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses, entries FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 2: a different LIMIT is a different entry
+--------------------------------------------------------------------------------
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 1;
+SELECT hits, misses, entries FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 3: an insert invalidates; the new document is returned
+--------------------------------------------------------------------------------
+INSERT INTO rc_docs VALUES (4, 'apple apple apple');
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 4: a spill invalidates
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('rc_docs_idx') IS NOT NULL AS spilled;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 5: VACUUM removing a document invalidates
+--------------------------------------------------------------------------------
+DELETE FROM rc_docs WHERE id = 4;
+VACUUM rc_docs;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 6: disabled cache is neither consulted nor filled
+--------------------------------------------------------------------------------
+SET pg_textsearch.result_cache = off;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+RESET pg_textsearch.result_cache;
+
+--------------------------------------------------------------------------------
+-- Test 7: the same words parsed without query operators are a new entry
+--------------------------------------------------------------------------------
+SET pg_textsearch.query_operators = off;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+RESET pg_textsearch.query_operators;
+SELECT id FROM rc_docs
+ORDER BY content <@> to_bm25query('apple', 'rc_docs_idx') LIMIT 10;
+SELECT hits, misses FROM bm25_result_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Cleanup: dropping the index drops its entries
+--------------------------------------------------------------------------------
+DROP TABLE rc_docs;
+SELECT entries, bytes FROM bm25_result_cache_stats();
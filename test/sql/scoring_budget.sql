@@ -0,0 +1,78 @@
+-- Test case: scoring_budget
+-- pg_textsearch.scoring_block_budget and scoring_time_budget cap the
+-- work of a ranked scan.  Once spent, scoring stops between blocks or
+-- segments, the best documents found so far are returned, and
+-- bm25_last_scan_partial() reports the cut.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE sb_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX sb_idx ON sb_docs USING bm25(content)
+    WITH (text_config='simple');
+RESET client_min_messages;
+
+-- Three segments of 600 documents, each term spanning several blocks
+INSERT INTO sb_docs
+SELECT i, 'alpha ' || CASE WHEN i % 2 = 0 THEN 'beta ' ELSE '' END ||
+    repeat('filler ', i % 9)
+FROM generate_series(1, 600) i;
+SELECT bm25_spill_index('sb_idx') IS NOT NULL AS spilled;
+INSERT INTO sb_docs
+SELECT i, 'alpha ' || CASE WHEN i % 3 = 0 THEN 'beta ' ELSE '' END ||
+    repeat('filler ', i % 7)
+FROM generate_series(601, 1200) i;
+SELECT bm25_spill_index('sb_idx') IS NOT NULL AS spilled;
+INSERT INTO sb_docs
+SELECT i, 'alpha beta ' || repeat('filler ', i % 5)
+FROM generate_series(1201, 1800) i;
+SELECT bm25_spill_index('sb_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Test 1: no budget
+--------------------------------------------------------------------------------
+SELECT count(*) AS rows FROM (
+    SELECT id FROM sb_docs
+    ORDER BY content <@> to_bm25query('alpha', 'sb_idx') LIMIT 10) s;
+SELECT bm25_last_scan_partial() AS partial;
+
+--------------------------------------------------------------------------------
+-- Test 2: a block budget
+--------------------------------------------------------------------------------
+-- One block fills the top 10, then the scan stops
+SET pg_textsearch.scoring_block_budget = 1;
+SELECT count(*) AS rows FROM (
+    SELECT id FROM sb_docs
+    ORDER BY content <@> to_bm25query('alpha', 'sb_idx') LIMIT 10) s;
+SELECT bm25_last_scan_partial() AS partial;
+
+-- Multi-term scans stop the same way, possibly with fewer rows
+SELECT count(*) <= 10 AS at_most_limit FROM (
+    SELECT id FROM sb_docs
+    ORDER BY content <@> to_bm25query('alpha beta', 'sb_idx') LIMIT 10) s;
+SELECT bm25_last_scan_partial() AS partial;
+
+-- A budget the scan never reaches changes nothing
+SET pg_textsearch.scoring_block_budget = 100000;
+SELECT count(*) AS rows FROM (
+    SELECT id FROM sb_docs
+    ORDER BY content <@> to_bm25query('alpha beta', 'sb_idx') LIMIT 10) s;
+SELECT bm25_last_scan_partial() AS partial;
+RESET pg_textsearch.scoring_block_budget;
+
+--------------------------------------------------------------------------------
+-- Test 3: a time budget
+--------------------------------------------------------------------------------
+SET pg_textsearch.scoring_time_budget = '1h';
+SHOW pg_textsearch.scoring_time_budget;
+SELECT count(*) AS rows FROM (
+    SELECT id FROM sb_docs
+    ORDER BY content <@> to_bm25query('alpha beta', 'sb_idx') LIMIT 10) s;
+SELECT bm25_last_scan_partial() AS partial;
+RESET pg_textsearch.scoring_time_budget;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE sb_docs;
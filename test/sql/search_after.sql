@@ -0,0 +1,72 @@
+-- Test case: search_after
+-- bm25query_after(query, score, ctid) pages through ranked results:
+-- an index scan returns only documents ranking after the given <@>
+-- score and CTID, in (score, CTID) order, so every page is a top-k of
+-- the page size however deep it is.  Covers ties at the page boundary,
+-- the memtable, a spilled segment plus memtable, and the text form.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+CREATE TABLE sa_docs (id INT PRIMARY KEY, content TEXT);
+CREATE INDEX sa_idx ON sa_docs USING bm25(content)
+    WITH (text_config='english');
+-- Four score levels of three tied documents each; rank order is id
+INSERT INTO sa_docs VALUES
+    (1, 'fox fox fox fox'), (2, 'fox fox fox fox'), (3, 'fox fox fox fox'),
+    (4, 'fox fox fox bear'), (5, 'fox fox fox bear'), (6, 'fox fox fox bear'),
+    (7, 'fox fox bear bear'), (8, 'fox fox bear bear'),
+    (9, 'fox fox bear bear'), (10, 'fox bear bear bear'),
+    (11, 'fox bear bear bear'), (12, 'fox bear bear bear');
+
+SET enable_seqscan = off;
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable, one page after another
+--------------------------------------------------------------------------------
+SELECT id FROM sa_docs
+ORDER BY content <@> to_bm25query('fox', 'sa_idx') LIMIT 5;
+SELECT content <@> to_bm25query('fox', 'sa_idx') AS after_score,
+       ctid AS after_ctid
+FROM sa_docs
+ORDER BY content <@> to_bm25query('fox', 'sa_idx') LIMIT 1 OFFSET 4 \gset
+SELECT id FROM sa_docs
+ORDER BY content <@> bm25query_after(
+    to_bm25query('fox', 'sa_idx'), :'after_score', :'after_ctid')
+LIMIT 5;
+SELECT content <@> bm25query_after(
+           to_bm25query('fox', 'sa_idx'), :'after_score', :'after_ctid')
+           AS after_score,
+       ctid AS after_ctid
+FROM sa_docs
+ORDER BY content <@> bm25query_after(
+    to_bm25query('fox', 'sa_idx'), :'after_score', :'after_ctid')
+LIMIT 1 OFFSET 4 \gset
+SELECT id FROM sa_docs
+ORDER BY content <@> bm25query_after(
+    to_bm25query('fox', 'sa_idx'), :'after_score', :'after_ctid')
+LIMIT 5;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus a tied memtable row
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('sa_idx') IS NOT NULL AS spilled;
+INSERT INTO sa_docs VALUES (13, 'fox fox fox bear');
+SELECT content <@> to_bm25query('fox', 'sa_idx') AS after_score,
+       ctid AS after_ctid
+FROM sa_docs
+ORDER BY content <@> to_bm25query('fox', 'sa_idx') LIMIT 1 OFFSET 3 \gset
+SELECT id FROM sa_docs
+ORDER BY content <@> bm25query_after(
+    to_bm25query('fox', 'sa_idx'), :'after_score', :'after_ctid')
+LIMIT 5;
+
+--------------------------------------------------------------------------------
+-- Test 3: text form and errors
+--------------------------------------------------------------------------------
+SELECT bm25query_after(to_bm25query('fox', 'sa_idx'), -2.25, '(1,2)') AS q;
+SELECT 'sa_idx:fox bear @1 @after:-1.5,(0,3)'::bm25query AS q;
+SELECT bm25query_after(to_bm25query('fox', 'sa_idx'), 'NaN', '(0,1)');
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE sa_docs;
@@ -0,0 +1,106 @@
+-- Test case: search_batch
+-- bm25_search_batch(index, queries, k) returns the top k of every
+-- query in one call, with the documents and scores the index scan of
+-- each query would return: boolean operators, a search-after position,
+-- NULL and empty queries, the memtable and a spilled segment, and
+-- only rows visible to the snapshot.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+CREATE TABLE sb_docs (id INT PRIMARY KEY, content TEXT);
+CREATE INDEX sb_idx ON sb_docs USING bm25(content)
+    WITH (text_config='english');
+INSERT INTO sb_docs VALUES
+    (1, 'fox fox fox'),
+    (2, 'fox dog'),
+    (3, 'dog dog dog'),
+    (4, 'quick fox'),
+    (5, 'quick brown dog'),
+    (6, 'brown bread');
+
+SET enable_seqscan = off;
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT b.query_ordinal, array_agg(d.id ORDER BY b.score, b.ctid) AS ids
+FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx'),
+        to_bm25query('quick dog', 'sb_idx'),
+        to_bm25query('+brown dog', 'sb_idx'),
+        to_bm25query('brown -dog', 'sb_idx'),
+        to_bm25query('zebra', 'sb_idx'),
+        NULL,
+        bm25query_after(to_bm25query('fox', 'sb_idx'),
+            (SELECT score FROM bm25_search_batch(
+                'sb_idx', ARRAY[to_bm25query('fox', 'sb_idx')], 1)),
+            '(0,1)')], 3) b
+JOIN sb_docs d ON d.ctid = b.ctid
+GROUP BY b.query_ordinal ORDER BY b.query_ordinal;
+-- Same documents and scores as an index scan
+SELECT count(*) AS differences FROM (
+    (SELECT ctid, round((content <@> to_bm25query('quick dog', 'sb_idx'))::numeric, 4)
+     FROM sb_docs
+     ORDER BY content <@> to_bm25query('quick dog', 'sb_idx') LIMIT 3)
+    EXCEPT
+    SELECT ctid, round(score::numeric, 4)
+    FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx'),
+        to_bm25query('quick dog', 'sb_idx')], 3)
+    WHERE query_ordinal = 2
+) d;
+
+--------------------------------------------------------------------------------
+-- Test 2: a spilled segment plus new memtable rows
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('sb_idx') IS NOT NULL AS spilled;
+INSERT INTO sb_docs VALUES (7, 'quick quick dog'), (8, 'lazy fox');
+SELECT b.query_ordinal, array_agg(d.id ORDER BY b.score, b.ctid) AS ids
+FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx'),
+        to_bm25query('quick dog', 'sb_idx'),
+        to_bm25query('+brown dog', 'sb_idx')], 3) b
+JOIN sb_docs d ON d.ctid = b.ctid
+GROUP BY b.query_ordinal ORDER BY b.query_ordinal;
+SELECT count(*) AS differences FROM (
+    (SELECT ctid, round((content <@> to_bm25query('brown dog', 'sb_idx'))::numeric, 4)
+     FROM sb_docs
+     ORDER BY content <@> to_bm25query('brown dog', 'sb_idx') LIMIT 5)
+    EXCEPT
+    SELECT ctid, round(score::numeric, 4)
+    FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('brown dog', 'sb_idx')], 5)
+) d;
+
+--------------------------------------------------------------------------------
+-- Test 3: deleted rows are skipped, and the top k refilled below them
+--------------------------------------------------------------------------------
+DELETE FROM sb_docs WHERE id = 1;
+SELECT b.query_ordinal, array_agg(d.id ORDER BY b.score, b.ctid) AS ids
+FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx')], 3) b
+JOIN sb_docs d ON d.ctid = b.ctid
+GROUP BY b.query_ordinal ORDER BY b.query_ordinal;
+SELECT count(*) AS rows FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx')], 3);
+SELECT count(*) AS differences FROM (
+    (SELECT ctid, round((content <@> to_bm25query('fox', 'sb_idx'))::numeric, 4)
+     FROM sb_docs
+     ORDER BY content <@> to_bm25query('fox', 'sb_idx') LIMIT 3)
+    EXCEPT
+    SELECT ctid, round(score::numeric, 4)
+    FROM bm25_search_batch('sb_idx', ARRAY[
+        to_bm25query('fox', 'sb_idx')], 3)
+) d;
+
+--------------------------------------------------------------------------------
+-- Test 4: errors
+--------------------------------------------------------------------------------
+SELECT * FROM bm25_search_batch(
+    'sb_idx', ARRAY[to_bm25query('fox', 'sb_idx')], 0);
+SELECT * FROM bm25_search_batch(
+    'sb_docs_pkey', ARRAY[to_bm25query('fox', 'sb_idx')], 3);
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE sb_docs;
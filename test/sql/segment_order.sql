@@ -0,0 +1,76 @@
+-- Test case: segment_order
+-- Segments are scored from the highest query upper bound to the lowest,
+-- so the strongest segment fills the top-k heap first and weaker ones
+-- can be skipped whole.  Here the strong documents sit in the oldest
+-- segment, which chain order would reach last.  Results must match the
+-- reference BM25 computation.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+\set ECHO none
+\i test/sql/validation.sql
+\set ECHO all
+
+SET enable_seqscan = off;
+
+CREATE TABLE so_docs (id SERIAL PRIMARY KEY, content TEXT);
+CREATE INDEX so_docs_idx ON so_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Oldest segment: short documents with repeated query terms
+--------------------------------------------------------------------------------
+INSERT INTO so_docs (content)
+SELECT repeat('gamma ', 2 + i % 3) || repeat('delta ', 1 + i % 2) || 'doc' || i
+FROM generate_series(1, 40) i;
+SELECT bm25_spill_index('so_docs_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Newer segments: long documents with single occurrences
+--------------------------------------------------------------------------------
+INSERT INTO so_docs (content)
+SELECT 'gamma ' || repeat('filler ', 30 + i % 9)
+FROM generate_series(1, 200) i;
+SELECT bm25_spill_index('so_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO so_docs (content)
+SELECT 'delta ' || repeat('filler ', 25 + i % 7)
+FROM generate_series(1, 200) i;
+SELECT bm25_spill_index('so_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO so_docs (content)
+SELECT 'gamma delta ' || repeat('filler ', 35 + i % 5)
+FROM generate_series(1, 200) i;
+SELECT bm25_spill_index('so_docs_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Segment without any query term: never planned
+--------------------------------------------------------------------------------
+INSERT INTO so_docs (content)
+SELECT 'epsilon ' || repeat('filler ', 10)
+FROM generate_series(1, 100) i;
+SELECT bm25_spill_index('so_docs_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Test 1: single-term query
+--------------------------------------------------------------------------------
+SELECT validate_bm25_scoring('so_docs', 'content', 'so_docs_idx',
+    'gamma', 'english', 1.2, 0.75) AS single_term_valid;
+
+--------------------------------------------------------------------------------
+-- Test 2: multi-term query
+--------------------------------------------------------------------------------
+SELECT validate_bm25_scoring('so_docs', 'content', 'so_docs_idx',
+    'gamma delta', 'english', 1.2, 0.75) AS multi_term_valid;
+
+--------------------------------------------------------------------------------
+-- Test 3: the top results all come from the oldest segment
+--------------------------------------------------------------------------------
+SELECT bool_and(id <= 40) AS top_from_oldest
+FROM (SELECT id FROM so_docs
+      ORDER BY content <@> to_bm25query('gamma delta', 'so_docs_idx')
+      LIMIT 10) t;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE so_docs;
@@ -0,0 +1,95 @@
+-- Test case: segment_reader_cache
+-- A backend keeps the page map of each segment it opens and reuses it
+-- on the next open: repeated queries hit the cache, the segment a merge
+-- writes misses it, and results match those read with the cache off.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+SELECT bm25_segment_reader_cache_reset();
+
+CREATE TABLE rc_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX rc_idx ON rc_docs USING bm25(content)
+    WITH (text_config='english');
+RESET client_min_messages;
+
+INSERT INTO rc_docs VALUES
+    (1, 'apple banana'),
+    (2, 'apple cherry'),
+    (3, 'banana');
+SELECT bm25_spill_index('rc_idx') IS NOT NULL AS spilled;
+INSERT INTO rc_docs VALUES
+    (4, 'apple date'),
+    (5, 'cherry date'),
+    (6, 'apple');
+SELECT bm25_spill_index('rc_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Test 1: a repeated query reuses both segments' page maps
+--------------------------------------------------------------------------------
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx') LIMIT 10) s;
+SELECT hits AS hits_before FROM bm25_segment_reader_cache_stats() \gset
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx') LIMIT 10) s;
+SELECT hits > :hits_before AS hit, entries >= 2 AS cached, bytes > 0 AS bytes
+FROM bm25_segment_reader_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 2: the merged segment misses, then hits
+--------------------------------------------------------------------------------
+SELECT bm25_force_merge('rc_idx');
+SELECT misses AS misses_before FROM bm25_segment_reader_cache_stats() \gset
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx') LIMIT 10) s;
+SELECT misses > :misses_before AS missed
+FROM bm25_segment_reader_cache_stats();
+SELECT hits AS hits_before FROM bm25_segment_reader_cache_stats() \gset
+SELECT array_agg(id ORDER BY id) AS cherry_date FROM (
+    SELECT id FROM rc_docs
+    ORDER BY content <@> to_bm25query('cherry date', 'rc_idx') LIMIT 10) s;
+SELECT hits > :hits_before AS hit FROM bm25_segment_reader_cache_stats();
+
+--------------------------------------------------------------------------------
+-- Test 3: segments VACUUM changed are read correctly
+--------------------------------------------------------------------------------
+DELETE FROM rc_docs WHERE id = 2;
+VACUUM rc_docs;
+SELECT array_agg(id ORDER BY id) AS apple FROM (
+    SELECT id FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx') LIMIT 10) s;
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS cached FROM (
+    SELECT id,
+           round((content <@> to_bm25query('apple', 'rc_idx'))::numeric,
+                 4) AS score
+    FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx')
+    LIMIT 10) s \gset
+
+--------------------------------------------------------------------------------
+-- Test 4: a disabled cache is neither consulted nor filled
+--------------------------------------------------------------------------------
+SET pg_textsearch.segment_reader_cache = off;
+SELECT hits + misses AS opens_before
+FROM bm25_segment_reader_cache_stats() \gset
+SELECT string_agg(id || ':' || score, ' ' ORDER BY id) AS uncached FROM (
+    SELECT id,
+           round((content <@> to_bm25query('apple', 'rc_idx'))::numeric,
+                 4) AS score
+    FROM rc_docs
+    ORDER BY content <@> to_bm25query('apple', 'rc_idx')
+    LIMIT 10) s \gset
+RESET pg_textsearch.segment_reader_cache;
+SELECT hits + misses = :opens_before AS untouched
+FROM bm25_segment_reader_cache_stats();
+SELECT :'cached' = :'uncached' AS same_scores;
+
+--------------------------------------------------------------------------------
+-- Cleanup: reset empties the cache
+--------------------------------------------------------------------------------
+DROP TABLE rc_docs;
+SELECT bm25_segment_reader_cache_reset();
+SELECT hits, misses, entries, bytes FROM bm25_segment_reader_cache_stats();
@@ -0,0 +1,75 @@
+-- Test case: term_bounds
+-- Segments store each term's max tf and min fieldnorm (format V6) so
+-- the scorer can skip whole segments whose best possible score cannot
+-- beat the top-k threshold, without reading their skip index.  Results
+-- must match the reference BM25 computation.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+\set ECHO none
+\i test/sql/validation.sql
+\set ECHO all
+
+SET enable_seqscan = off;
+
+CREATE TABLE tb_docs (id SERIAL PRIMARY KEY, content TEXT);
+CREATE INDEX tb_docs_idx ON tb_docs USING bm25(content)
+    WITH (text_config='english');
+
+--------------------------------------------------------------------------------
+-- Four segments of long, low-scoring documents ...
+--------------------------------------------------------------------------------
+INSERT INTO tb_docs (content)
+SELECT 'alpha ' || CASE WHEN i % 3 = 0 THEN 'beta ' ELSE '' END ||
+    repeat('filler ', 20 + i % 13)
+FROM generate_series(1, 300) i;
+SELECT bm25_spill_index('tb_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO tb_docs (content)
+SELECT 'alpha ' || CASE WHEN i % 4 = 0 THEN 'beta ' ELSE '' END ||
+    repeat('filler ', 25 + i % 11)
+FROM generate_series(1, 300) i;
+SELECT bm25_spill_index('tb_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO tb_docs (content)
+SELECT 'beta ' || repeat('filler ', 20 + i % 7)
+FROM generate_series(1, 300) i;
+SELECT bm25_spill_index('tb_docs_idx') IS NOT NULL AS spilled;
+
+INSERT INTO tb_docs (content)
+SELECT 'alpha ' || repeat('filler ', 30 + i % 5)
+FROM generate_series(1, 300) i;
+SELECT bm25_spill_index('tb_docs_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- ... then the newest segment (scored first) holds short documents with
+-- repeated query terms, which fill the heap before the older segments
+-- are reached.
+--------------------------------------------------------------------------------
+INSERT INTO tb_docs (content)
+SELECT repeat('alpha ', 1 + i % 4) || repeat('beta ', 1 + i % 3) || 'doc' || i
+FROM generate_series(1, 50) i;
+SELECT bm25_spill_index('tb_docs_idx') IS NOT NULL AS spilled;
+
+--------------------------------------------------------------------------------
+-- Test 1: single-term query
+--------------------------------------------------------------------------------
+SELECT validate_bm25_scoring('tb_docs', 'content', 'tb_docs_idx',
+    'alpha', 'english', 1.2, 0.75) AS single_term_valid;
+
+--------------------------------------------------------------------------------
+-- Test 2: multi-term query
+--------------------------------------------------------------------------------
+SELECT validate_bm25_scoring('tb_docs', 'content', 'tb_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS multi_term_valid;
+
+--------------------------------------------------------------------------------
+-- Test 3: the bounds survive a merge into one segment
+--------------------------------------------------------------------------------
+SELECT bm25_force_merge('tb_docs_idx');
+SELECT validate_bm25_scoring('tb_docs', 'content', 'tb_docs_idx',
+    'alpha beta', 'english', 1.2, 0.75) AS merged_valid;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE tb_docs;
@@ -0,0 +1,85 @@
+-- Test case: term_pruning
+-- pg_textsearch.term_pruning_epsilon prunes optional query terms too
+-- weak to reorder the top-k: a term adds at most idf * (k1 + 1) to any
+-- score.  The weakest are dropped while their bounds sum to at most
+-- epsilon; the rest bounded by epsilon only add to documents the other
+-- terms find.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE tpr_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX tpr_idx ON tpr_docs USING bm25(content)
+    WITH (text_config='simple');
+RESET client_min_messages;
+
+-- "the" and "a" are in every document (bound about 0.011 each), "rare"
+-- only in documents 5, 50 and 95
+INSERT INTO tpr_docs
+SELECT i, 'the a ' || CASE WHEN i % 45 = 5 THEN 'rare' ELSE 'common' END
+FROM generate_series(1, 100) i;
+
+--------------------------------------------------------------------------------
+-- Test 1: memtable
+--------------------------------------------------------------------------------
+SELECT count(*) AS exact FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+
+-- One weak term dropped, the other only probed
+SET pg_textsearch.term_pruning_epsilon = 0.015;
+SELECT array_agg(id ORDER BY id) AS probed FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+
+-- Both dropped
+SET pg_textsearch.term_pruning_epsilon = 0.05;
+SELECT array_agg(id ORDER BY id) AS dropped FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+
+-- The strongest optional term always drives
+SELECT count(*) AS weak_only FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a', 'tpr_idx') LIMIT 10) s;
+
+-- Behind a required term every weak optional term can go
+SELECT array_agg(id ORDER BY id) AS required FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('+rare the a', 'tpr_idx') LIMIT 10) s;
+
+-- Nothing is pruned with min_should_match
+SELECT count(*) AS msm FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx', 1)
+    LIMIT 10) s;
+RESET pg_textsearch.term_pruning_epsilon;
+
+--------------------------------------------------------------------------------
+-- Test 2: segment
+--------------------------------------------------------------------------------
+SELECT bm25_spill_index('tpr_idx') IS NOT NULL AS spilled;
+
+SELECT count(*) AS exact FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+
+SET pg_textsearch.term_pruning_epsilon = 0.015;
+SELECT array_agg(id ORDER BY id) AS probed FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+
+SET pg_textsearch.term_pruning_epsilon = 0.05;
+SELECT array_agg(id ORDER BY id) AS dropped FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a rare', 'tpr_idx') LIMIT 10) s;
+SELECT count(*) AS weak_only FROM (
+    SELECT id FROM tpr_docs
+    ORDER BY content <@> to_bm25query('the a', 'tpr_idx') LIMIT 10) s;
+RESET pg_textsearch.term_pruning_epsilon;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE tpr_docs;
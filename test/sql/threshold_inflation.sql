@@ -0,0 +1,79 @@
+-- Test case: threshold_inflation
+-- pg_textsearch.threshold_inflation prunes against the top-k threshold
+-- times a factor, trading recall for speed.  The rows it returns still
+-- carry their exact scores, and a LIMIT the matches never fill is not
+-- pruned at all.
+CREATE EXTENSION IF NOT EXISTS pg_textsearch;
+
+SET enable_seqscan = off;
+
+CREATE TABLE ti_docs (id INT PRIMARY KEY, content TEXT);
+SET client_min_messages = warning;
+CREATE INDEX ti_idx ON ti_docs USING bm25(content)
+    WITH (text_config='simple');
+RESET client_min_messages;
+
+INSERT INTO ti_docs
+SELECT i, repeat('common ', 1 + i % 5) ||
+    CASE WHEN i % 7 = 0 THEN 'rare ' ELSE '' END ||
+    repeat('filler ', i % 11)
+FROM generate_series(1, 1500) i;
+SELECT bm25_spill_index('ti_idx') IS NOT NULL AS spilled;
+INSERT INTO ti_docs
+SELECT i, 'common rare ' || repeat('filler ', i % 3)
+FROM generate_series(1501, 1600) i;
+
+CREATE TABLE ti_exact AS
+SELECT id, content <@> to_bm25query('common rare', 'ti_idx') AS score
+FROM ti_docs
+ORDER BY content <@> to_bm25query('common rare', 'ti_idx') LIMIT 2000;
+
+--------------------------------------------------------------------------------
+-- Test 1: the factor's range
+--------------------------------------------------------------------------------
+SET pg_textsearch.threshold_inflation = 0.5;
+SET pg_textsearch.threshold_inflation = 11;
+SHOW pg_textsearch.threshold_inflation;
+
+--------------------------------------------------------------------------------
+-- Test 2: an inflated threshold still returns LIMIT rows, exactly scored
+--------------------------------------------------------------------------------
+SET pg_textsearch.threshold_inflation = 2;
+
+CREATE TABLE ti_approx AS
+SELECT id, content <@> to_bm25query('common rare', 'ti_idx') AS score
+FROM ti_docs
+ORDER BY content <@> to_bm25query('common rare', 'ti_idx') LIMIT 10;
+
+SELECT count(*) AS rows,
+       bool_and(abs(a.score - e.score) < 0.0001) AS exact_scores
+FROM ti_approx a JOIN ti_exact e USING (id);
+
+-- Single-term queries prune the same way
+SELECT count(*) AS rows FROM (
+    SELECT id FROM ti_docs
+    ORDER BY content <@> to_bm25query('rare', 'ti_idx') LIMIT 10) s;
+
+-- A LIMIT beyond the matches never fills the heap: nothing is pruned
+SELECT count(*) AS rows FROM (
+    SELECT id FROM ti_docs
+    ORDER BY content <@> to_bm25query('common rare', 'ti_idx')
+    LIMIT 2000) s;
+
+--------------------------------------------------------------------------------
+-- Test 3: back to exact
+--------------------------------------------------------------------------------
+RESET pg_textsearch.threshold_inflation;
+SELECT array_agg(round(score::numeric, 4) ORDER BY score) =
+       (SELECT array_agg(round(score::numeric, 4) ORDER BY score)
+        FROM (SELECT score FROM ti_exact ORDER BY score LIMIT 10) e)
+       AS exact_top10
+FROM (
+    SELECT content <@> to_bm25query('common rare', 'ti_idx') AS score
+    FROM ti_docs
+    ORDER BY content <@> to_bm25query('common rare', 'ti_idx') LIMIT 10) s;
+
+--------------------------------------------------------------------------------
+-- Cleanup
+--------------------------------------------------------------------------------
+DROP TABLE ti_docs, ti_exact, ti_approx;
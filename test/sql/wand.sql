@@ -35,10 +35,17 @@ SELECT bm25_spill_index('bmw_bug_idx');
 --
 -- Doc 6 is the only multi-term document.
 
+SELECT wand AS wand_before, maxscore AS maxscore_before
+FROM bm25_evaluator_stats() \gset
 -- Validate BMW produces correct scores for multi-term query
 SELECT validate_bm25_scoring('bmw_bug', 'content', 'bmw_bug_idx',
     'alpha beta', 'english', 1.2, 0.75) as two_term_valid;
 
+-- Two terms are too few for MaxScore
+SELECT wand > :wand_before AS used_wand,
+       maxscore = :maxscore_before AS skipped_maxscore
+FROM bm25_evaluator_stats();
+
 DROP TABLE bmw_bug;
 
 -- ============================================================
@@ -104,7 +111,34 @@ FROM generate_series(1, 500) i;
 
 SELECT bm25_spill_index('wand_many_terms_idx');
 
--- 8-term query: WAND vs exhaustive (LIMIT 10 avoids tie boundary)
+SELECT wand AS wand_before, maxscore AS maxscore_before
+FROM bm25_evaluator_stats() \gset
+-- 8-term query: MaxScore vs exhaustive (LIMIT 10 avoids tie boundary)
+WITH bmw AS (
+    SELECT id, content <@> 'alpha beta gamma delta epsilon zeta eta theta'::bm25query as score
+    FROM wand_many_terms
+    ORDER BY content <@> 'alpha beta gamma delta epsilon zeta eta theta'::bm25query LIMIT 10
+),
+exhaustive AS (
+    SELECT id, score FROM (
+        SELECT id, content <@> 'alpha beta gamma delta epsilon zeta eta theta'::bm25query as score
+        FROM wand_many_terms
+        ORDER BY content <@> 'alpha beta gamma delta epsilon zeta eta theta'::bm25query
+    ) x LIMIT 10
+)
+SELECT 'maxscore-8-term' as test,
+    CASE WHEN COUNT(*) = 0 THEN 'PASS' ELSE 'FAIL' END as result
+FROM (SELECT * FROM bmw EXCEPT SELECT * FROM exhaustive) diff;
+
+-- Eight terms present in the segment select MaxScore
+SELECT maxscore > :maxscore_before AS used_maxscore,
+       wand = :wand_before AS skipped_wand
+FROM bm25_evaluator_stats();
+
+-- The same query forced through WAND pivot selection
+SET pg_textsearch.multi_term_evaluator = wand;
+SELECT wand AS wand_before, maxscore AS maxscore_before
+FROM bm25_evaluator_stats() \gset
 WITH bmw AS (
     SELECT id, content <@> 'alpha beta gamma delta epsilon zeta eta theta'::bm25query as score
     FROM wand_many_terms
@@ -120,6 +154,10 @@ exhaustive AS (
 SELECT 'wand-8-term' as test,
     CASE WHEN COUNT(*) = 0 THEN 'PASS' ELSE 'FAIL' END as result
 FROM (SELECT * FROM bmw EXCEPT SELECT * FROM exhaustive) diff;
+SELECT wand > :wand_before AS used_wand,
+       maxscore = :maxscore_before AS skipped_maxscore
+FROM bm25_evaluator_stats();
+RESET pg_textsearch.multi_term_evaluator;
 
 -- Validate scores match reference BM25 computation
 SELECT validate_bm25_scoring('wand_many_terms', 'content',
@@ -129,4 +167,57 @@ SELECT validate_bm25_scoring('wand_many_terms', 'content',
 
 DROP TABLE wand_many_terms;
 
+-- ============================================================
+-- TEST: Block-Max MaxScore on skewed doc_freqs
+-- ============================================================
+-- Three terms whose posting lists differ in length by far more than
+-- the MaxScore skew threshold, so the segment is evaluated with
+-- Block-Max MaxScore: 'common' becomes non-essential once the heap
+-- fills and is only probed for candidates from the shorter lists.
+
+CREATE TABLE maxscore_skew (id SERIAL PRIMARY KEY, content TEXT);
+CREATE INDEX maxscore_skew_idx ON maxscore_skew USING bm25(content)
+    WITH (text_config='english');
+
+INSERT INTO maxscore_skew (content)
+SELECT 'common ' ||
+    CASE WHEN i % 10 = 0 THEN 'medium ' ELSE '' END ||
+    CASE WHEN i % 97 = 0 THEN 'rare ' ELSE '' END ||
+    repeat('filler ', i % 7) || 'document ' || i
+FROM generate_series(1, 2000) i;
+
+SELECT bm25_spill_index('maxscore_skew_idx') IS NOT NULL AS spilled;
+
+SELECT wand AS wand_before, maxscore AS maxscore_before
+FROM bm25_evaluator_stats() \gset
+-- MaxScore vs exhaustive; many docs tie on score, so compare scores
+WITH maxscore AS (
+    SELECT content <@> 'common medium rare'::bm25query as score
+    FROM maxscore_skew
+    ORDER BY content <@> 'common medium rare'::bm25query LIMIT 10
+),
+exhaustive AS (
+    SELECT score FROM (
+        SELECT content <@> 'common medium rare'::bm25query as score
+        FROM maxscore_skew
+        ORDER BY content <@> 'common medium rare'::bm25query
+    ) x LIMIT 10
+)
+SELECT 'maxscore-skewed' as test,
+    CASE WHEN (SELECT array_agg(score ORDER BY score) FROM maxscore) =
+              (SELECT array_agg(score ORDER BY score) FROM exhaustive)
+         THEN 'PASS' ELSE 'FAIL' END as result;
+
+-- Skewed doc_freqs select MaxScore
+SELECT maxscore > :maxscore_before AS used_maxscore,
+       wand = :wand_before AS skipped_wand
+FROM bm25_evaluator_stats();
+
+-- Validate scores match reference BM25 computation
+SELECT validate_bm25_scoring('maxscore_skew', 'content',
+    'maxscore_skew_idx', 'common medium rare',
+    'english', 1.2, 0.75) as skewed_valid;
+
+DROP TABLE maxscore_skew;
+
 DROP EXTENSION pg_textsearch CASCADE;